@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h> // strtoul()
+#include <string.h> // strcmp()
+#include <time.h> // clock_gettime()
+#include <pthread.h>
+#include "common.h"
+#include "memory.h"
+#include "Strings.h"
+#include "ThreadPool.h"
+#include "Ast/StringTable.h"
+
+/**
+ * A multi-threaded microbenchmark of StringTable.
+ * Every thread interns a stream of identifiers like a parser would: mostly names that were already
+ * interned (keywords, common identifiers, names interned by other threads), and some new ones.
+ * With '--locked', every call is made while holding a single global lock
+ * (how a StringTable had to be shared between threads before it was thread-safe) for comparison.
+ *
+ * Usage: string_table_bench [--locked] [max threads] [operations per thread]
+ **/
+
+#define COMMON_NAMES 4096
+// One in NEW_NAME_RATIO operations interns a name no other thread interns.
+#define NEW_NAME_RATIO 16
+
+typedef struct bench {
+    StringTable *strings;
+    char **commonNames;
+    usize operations;
+    bool locked;
+    pthread_mutex_t lock;
+    pthread_barrier_t start;
+} Bench;
+
+typedef struct worker {
+    Bench *bench;
+    usize index;
+    usize checksum; // Keeps the lookups from being optimized away.
+    bool failed;
+} Worker;
+
+static void *run_worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    Bench *b = w->bench;
+    char name[64];
+    // A simple LCG so every thread has its own deterministic stream of names.
+    u64 state = 0x9E3779B97F4A7C15ull * (w->index + 1);
+    pthread_barrier_wait(&b->start);
+    for(usize i = 0; i < b->operations; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        const char *s;
+        if(i % NEW_NAME_RATIO == 0) {
+            snprintf(name, sizeof(name), "thread%zu_local%zu", w->index, i);
+            s = name;
+        } else {
+            s = b->commonNames[(state >> 33) % COMMON_NAMES];
+        }
+        if(b->locked) {
+            pthread_mutex_lock(&b->lock);
+        }
+        ASTString interned = stringTableString(b->strings, (char *)s);
+        if(b->locked) {
+            pthread_mutex_unlock(&b->lock);
+        }
+        w->failed = w->failed || strcmp(interned, s) != 0;
+        w->checksum += (usize)interned;
+    }
+    return NULL;
+}
+
+static f64 seconds_since(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)(now.tv_sec - start->tv_sec) + (f64)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Returns the amount of operations per second, or a negative number if an interned string was wrong.
+static f64 run(Bench *b, usize numThreads) {
+    StringTable strings;
+    stringTableInit(&strings);
+    b->strings = &strings;
+    // Like keywords & primitive types, the common names exist before parsing starts,
+    // but the first thread to use each of them interns it (so both hits and misses are measured.)
+    for(usize i = 0; i < COMMON_NAMES / 4; ++i) {
+        stringTableString(&strings, b->commonNames[i]);
+    }
+    pthread_barrier_init(&b->start, NULL, (unsigned)numThreads + 1);
+    pthread_t *threads = CALLOC(numThreads, sizeof(*threads));
+    Worker *workers = CALLOC(numThreads, sizeof(*workers));
+    for(usize i = 0; i < numThreads; ++i) {
+        workers[i].bench = b;
+        workers[i].index = i;
+        pthread_create(&threads[i], NULL, run_worker, (void *)&workers[i]);
+    }
+    pthread_barrier_wait(&b->start);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool failed = false;
+    for(usize i = 0; i < numThreads; ++i) {
+        pthread_join(threads[i], NULL);
+        failed = failed || workers[i].failed;
+    }
+    f64 seconds = seconds_since(&start);
+    pthread_barrier_destroy(&b->start);
+    FREE(workers);
+    FREE(threads);
+    stringTableFree(&strings);
+    return failed ? -1.0 : (f64)(b->operations * numThreads) / seconds;
+}
+
+static usize next_thread_count(usize threads, usize maxThreads) {
+    if(threads < maxThreads && threads * 2 > maxThreads) {
+        return maxThreads;
+    }
+    return threads * 2;
+}
+
+int main(int argc, char **argv) {
+    Bench b = {
+        .operations = 2000000,
+        .locked = false
+    };
+    usize maxThreads = threadPoolDefaultSize();
+    int arg = 1;
+    if(arg < argc && strcmp(argv[arg], "--locked") == 0) {
+        b.locked = true;
+        arg++;
+    }
+    if(arg < argc) {
+        maxThreads = strtoul(argv[arg++], NULL, 10);
+    }
+    if(arg < argc) {
+        b.operations = strtoul(argv[arg++], NULL, 10);
+    }
+    if(maxThreads == 0 || b.operations == 0) {
+        fprintf(stderr, "Usage: %s [--locked] [max threads] [operations per thread]\n", argv[0]);
+        return 1;
+    }
+
+    pthread_mutex_init(&b.lock, NULL);
+    b.commonNames = CALLOC(COMMON_NAMES, sizeof(*b.commonNames));
+    for(usize i = 0; i < COMMON_NAMES; ++i) {
+        b.commonNames[i] = stringFormat("identifier_%zu", i * 7919);
+    }
+
+    printf("StringTable (%s): %zu operations per thread, 1 in %d new.\n", b.locked ? "global lock" : "lock-free lookups", b.operations, NEW_NAME_RATIO);
+    f64 single = 0.0;
+    // 1, 2, 4, ... threads, and [maxThreads] threads last.
+    for(usize threads = 1; threads <= maxThreads; threads = next_thread_count(threads, maxThreads)) {
+        f64 opsPerSecond = run(&b, threads);
+        if(opsPerSecond < 0.0) {
+            fprintf(stderr, "Interned the wrong string!\n");
+            return 1;
+        }
+        if(threads == 1) {
+            single = opsPerSecond;
+        }
+        printf("%3zu threads: %8.2f M ops/s (%.2fx)\n", threads, opsPerSecond / 1e6, opsPerSecond / single);
+    }
+
+    for(usize i = 0; i < COMMON_NAMES; ++i) {
+        stringFree(b.commonNames[i]);
+    }
+    FREE(b.commonNames);
+    pthread_mutex_destroy(&b.lock);
+    return 0;
+}
@@ -17,6 +17,9 @@ void arenaInit(Arena *a);
 
 void arenaFree(Arena *a);
 
+// Free all the memory allocated from the arena, but keep enough storage for the same amount of allocations.
+void arenaReset(Arena *a);
+
 void *arenaAlloc(Arena *a, size_t size);
 
 void *arenaCalloc(Arena *a, size_t nmemb, size_t size);
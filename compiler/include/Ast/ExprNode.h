@@ -25,6 +25,7 @@ typedef enum ast_expression_types {
     EXPR_NUMBER_CONSTANT,
     EXPR_STRING_CONSTANT,
     EXPR_BOOLEAN_CONSTANT,
+    EXPR_STRUCT_CONSTANT, // Only created by the Evaluator (see Evaluator.h).
 
     // Obj nodes
     EXPR_VARIABLE,
@@ -76,6 +77,12 @@ typedef struct ast_constant_value_expression {
     } as;
 } ASTConstantValueExpr;
 
+typedef struct ast_struct_constant_expression {
+    ASTExprNode header;
+    Array fields; // Array<ASTObj *> (OBJ_VAR)
+    Array values; // Array<ASTExprNode *> (a constant value for every field in [fields].)
+} ASTStructConstantExpr;
+
 typedef struct ast_object_expression {
     ASTExprNode header;
     ASTObj *obj;
@@ -129,6 +136,18 @@ void astExprPrint(FILE *to, ASTExprNode *n);
  **/
 ASTConstantValueExpr *astConstantValueExprNew(Allocator *a, ASTExprType type, Location loc, Type *valueTy);
 
+/**
+ * Create a new ASTStructConstantExpr (with no fields.)
+ * NOTE: Caller must push the fields and their values (at most [fieldCount].)
+ *
+ * @param a The allocator to use to allocate the node.
+ * @param loc The location of the node.
+ * @param structTy The struct type of the value.
+ * @param fieldCount The amount of fields of the struct.
+ * @return A new node initialized with the above data.
+ **/
+ASTStructConstantExpr *astStructConstantExprNew(Allocator *a, Location loc, Type *structTy, usize fieldCount);
+
 /**
  * Create a new ASTObjExpr.
  * C.R.E for obj == NULL.
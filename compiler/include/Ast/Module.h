@@ -60,6 +60,14 @@ ASTModule *astModuleNew(ASTString name);
  **/
 void astModuleFree(ASTModule *module);
 
+/**
+ * Reset an ASTModule to the state of a new module, keeping its storage for reuse.
+ *
+ * @param module The ASTModule to reset.
+ * @param name The new name of the module.
+ **/
+void astModuleReset(ASTModule *module, ASTString name);
+
 /**
  * Check if a type exists in a module.
  *
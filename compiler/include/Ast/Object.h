@@ -3,6 +3,9 @@
 
 #include <stdio.h> // FILE
 #include <stdbool.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
 #include "Token.h"
 #include "StringTable.h"
 #include "Type.h" // Note: defines ModuleID b/c can't include Program.h that includes it and us (indirectly).
@@ -33,6 +36,33 @@ typedef enum ast_object_types {
     OBJ_TYPE_COUNT
 } ASTObjType;
 
+/**
+ * Attributes ('#[name]' or '#[name(argument)]') are written before function & struct declarations.
+ * The parser only stores the name & argument, and the Validator resolves the type of the attribute
+ * and checks that it can be applied to the object (see validateAttributes() in Validator.c).
+ * The code generator lowers them to the matching GCC/Clang attributes.
+ **/
+typedef enum ast_attribute_type {
+    ATTR_UNKNOWN, // Not resolved yet (parsed attributes.)
+    ATTR_INLINE, // fn: always_inline
+    ATTR_NOINLINE, // fn: noinline
+    ATTR_HOT, // fn: hot
+    ATTR_COLD, // fn: cold
+    ATTR_PURE, // fn: pure
+    ATTR_CONST, // fn: const
+    ATTR_NORETURN, // fn: noreturn
+    ATTR_ALIGNED, // struct: aligned(argument)
+    ATTR_TYPE_COUNT
+} ASTAttributeType;
+
+typedef struct ast_attribute {
+    ASTAttributeType type;
+    Location location;
+    ASTString name;
+    bool hasArgument;
+    u64 argument;
+} ASTAttribute;
+
 typedef struct ast_object {
     ASTObjType type;
     Location location;
@@ -40,6 +70,7 @@ typedef struct ast_object {
     Type *dataType;
     ModuleID ownerModule;
     struct ast_object *parent;
+    Array attributes; // Array<ASTAttribute *> (functions & structs only, always empty for variables.)
     union {
         //struct {} var;
         struct {
@@ -49,11 +80,31 @@ typedef struct ast_object {
         } fn;
         struct {
             Scope *scope;
+            Array fields; // Array<ASTObj *> (OBJ_VAR, in declaration order.)
         } structure;
     } as;
 } ASTObj;
 
 
+/**
+ * Create a new ASTAttribute.
+ *
+ * @param a The allocator to use.
+ * @param type The type of the attribute (ATTR_UNKNOWN for parsed attributes.)
+ * @param loc The location of the attribute.
+ * @param name The name of the attribute.
+ * @return The new attribute (without an argument.)
+ **/
+ASTAttribute *astAttributeNew(Allocator *a, ASTAttributeType type, Location loc, ASTString name);
+
+/**
+ * Get the type of the attribute named [name].
+ *
+ * @param name The name of the attribute.
+ * @return The type of the attribute, or ATTR_UNKNOWN if there is no such attribute.
+ **/
+ASTAttributeType astAttributeTypeFromName(const char *name);
+
 /**
  * Pretty print an ASTObj.
  *
@@ -76,6 +127,15 @@ void astObjectPrint(FILE *to, ASTObj *obj, bool compact);
  **/
 ASTObj *astObjectNew(ASTObjType type, Location loc, ASTString name, Type *dataType, ModuleID moduleOwner, ASTObj *parent);
 
+/**
+ * Get an attribute of an object.
+ *
+ * @param obj The object.
+ * @param type The type of the attribute.
+ * @return The attribute, or NULL if [obj] doesn't have it.
+ **/
+ASTAttribute *astObjectGetAttribute(ASTObj *obj, ASTAttributeType type);
+
 /**
  * Free an ASTObj.
  *
@@ -26,6 +26,7 @@ typedef struct ast_program {
     StringTable *strings;
     Array modules; // Array<ASTModule *>;
     Table moduleIDToIdx; // Table<ModuleID, usize>
+    Array unusedModules; // Array<ASTModule *> (modules kept by astProgramClear() for reuse.)
 } ASTProgram;
 
 // A ModuleID is an index into the moduleIDToIdx array.
@@ -58,6 +59,14 @@ void astProgramInit(ASTProgram *prog, StringTable *st);
  **/
 void astProgramFree(ASTProgram *prog);
 
+/**
+ * Remove all the modules from an ASTProgram.
+ * The modules are kept (along with their arenas & tables) and reused by the next modules created.
+ *
+ * @param prog The ASTProgram to clear.
+ **/
+void astProgramClear(ASTProgram *prog);
+
 /**
  * Creates a new ASTModule and adds it to the internal list.
  *
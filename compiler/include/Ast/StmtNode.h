@@ -60,6 +60,9 @@ typedef struct ast_conditional_statement {
     ASTExprNode *condition;
     ASTStmtNode *then;
     ASTStmtNode *else_; // optional
+    // STMT_EXPECT only: where the statement is (reported when it fails.)
+    ASTString file;
+    u32 line;
 } ASTConditionalStmt;
 
 typedef struct ast_loop_statement {
@@ -2,8 +2,10 @@
 #define STRING_TABLE_H
 
 #include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "common.h"
 #include "Strings.h"
-#include "Table.h"
 
 /**
  * A StringTable holds a single copy of each string put in it.
@@ -13,12 +15,41 @@
  * StringTable operates on ASTStrings which are used only to differentiate interned strings (strings in the table).
  * An ASTString is an alias to a String.
  * @see Strings.h#String
+ *
+ * A StringTable can be used by many threads at once.
+ * The strings are split between shards (by hash), and every shard is an open addressing hash table
+ * whose slots are published atomically, so looking up a string that was already added never takes a lock.
+ * Only adding a new string locks (only its shard).
+ * When a shard grows, a new slot array is published and the old one is kept until the table is freed
+ * (threads may still be looking strings up in it), so the interned strings never move
+ * and comparing ASTString pointers is valid across threads.
  **/
 
 typedef String ASTString;
 
+#define STRING_TABLE_SHARDS 16
+#define STRING_TABLE_SHARD_INITIAL_CAPACITY 32
+
+typedef struct string_table_slot {
+    unsigned hash; // Only valid once [string] is set.
+    _Atomic(ASTString) string; // NULL if the slot is empty.
+} StringTableSlot;
+
+typedef struct string_table_slots {
+    usize capacity; // A power of 2.
+    struct string_table_slots *previous; // The slots this array replaced (freed with the table.)
+    StringTableSlot slots[];
+} StringTableSlots;
+
+// Aligned to a cache line so threads adding strings to different shards don't slow each other down.
+typedef struct string_table_shard {
+    _Alignas(64) _Atomic(StringTableSlots *) slots;
+    pthread_mutex_t lock; // Taken only to add strings.
+    usize used; // Only accessed with [lock] held.
+} StringTableShard;
+
 typedef struct string_table {
-    Table strings; // Table<ASTString, void>
+    StringTableShard shards[STRING_TABLE_SHARDS];
 } StringTable;
 
 
@@ -54,6 +54,7 @@ typedef struct type {
         } fn;
         struct {
             Array fieldTypes; // Array<Type *>
+            u64 alignment; // Set by the Validator from the 'aligned' attribute (0 if it has none.)
         } structure;
         struct {
             ASTString actualName;
@@ -110,4 +111,16 @@ bool typeEqual(Type *a, Type *b);
  **/
 bool typeIsPrimitive(Type *ty);
 
+/**
+ * Wrap an integer to the range of an integer type (i32 or u32).
+ * Arithmetic on integer constants is done on u64 values, and wrapped to the type of the result
+ * to get the same wraparound semantics as the generated code.
+ * Signed values are sign-extended (so they can be cast to i64).
+ *
+ * @param ty The integer type (TY_I32 or TY_U32, C.R.E otherwise).
+ * @param value The value to wrap.
+ * @return [value] wrapped to the range of [ty].
+ **/
+u64 typeWrapInteger(Type *ty, u64 value);
+
 #endif // AST_TYPE_H
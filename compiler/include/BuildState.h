@@ -0,0 +1,119 @@
+#ifndef BUILD_STATE_H
+#define BUILD_STATE_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Array.h"
+#include "Table.h"
+#include "Strings.h"
+#include "Sha256.h"
+
+/**
+ * The state of the last successful build (kept in the build directory.)
+ * Every module has a fingerprint made of the hash of its source file,
+ * and the interface hash (the hash of the generated header) of every module it imports
+ * as it was when the module was last generated.
+ * A module only has to be generated & compiled again if its source or
+ * the interface of one of its imports changed.
+ **/
+
+#define BUILD_STATE_FILE_NAME "ilc_build_state"
+
+typedef struct import_state {
+    String name;
+    char interfaceHash[SHA256_HEX_SIZE];
+} ImportState;
+
+typedef struct module_state {
+    String name;
+    String path; // The path of the source file.
+    char sourceHash[SHA256_HEX_SIZE];
+    char interfaceHash[SHA256_HEX_SIZE];
+    Array imports; // Array<ImportState *>
+} ModuleState;
+
+typedef struct build_state {
+    char config[SHA256_HEX_SIZE]; // A hash of everything else the build depends on (e.g. the C compiler.)
+    Array modules; // Array<ModuleState *> (owns the ModuleStates.)
+    Table moduleIndex; // Table<char *, ModuleState *> (module name -> state.)
+} BuildState;
+
+/***
+ * Initialize an empty BuildState.
+ *
+ * @param s The BuildState to initialize.
+ ***/
+void buildStateInit(BuildState *s);
+
+/***
+ * Free a BuildState.
+ *
+ * @param s The BuildState to free.
+ ***/
+void buildStateFree(BuildState *s);
+
+/***
+ * Add a module to a BuildState.
+ *
+ * @param s The BuildState to add the module to.
+ * @param name The name of the module.
+ * @param path The path of the source file of the module.
+ * @return The new ModuleState (owned by [s]).
+ ***/
+ModuleState *buildStateAddModule(BuildState *s, const char *name, const char *path);
+
+/***
+ * Add an import to a ModuleState.
+ *
+ * @param m The ModuleState to add the import to.
+ * @param name The name of the imported module.
+ * @param interfaceHash The interface hash of the imported module.
+ ***/
+void moduleStateAddImport(ModuleState *m, const char *name, const char *interfaceHash);
+
+/***
+ * Get the state of a module.
+ *
+ * @param s The BuildState to use.
+ * @param name The name of the module.
+ * @return The ModuleState or NULL if the module doesn't exist.
+ ***/
+ModuleState *buildStateGetModule(BuildState *s, const char *name);
+
+/***
+ * Load a BuildState from a file.
+ *
+ * @param s An empty BuildState to load into.
+ * @param path The path of the file.
+ * @return true on success, false if the file doesn't exist or is invalid (in which case [s] is left empty.)
+ ***/
+bool buildStateLoad(BuildState *s, const char *path);
+
+/***
+ * Save a BuildState to a file.
+ * The file is written to a temporary file and renamed into place.
+ *
+ * @param s The BuildState to save.
+ * @param path The path of the file.
+ * @return true on success, false on failure.
+ ***/
+bool buildStateSave(BuildState *s, const char *path);
+
+/***
+ * Hash a source file for a ModuleState.
+ *
+ * @param path The path of the source file.
+ * @param hash Where to store the hash.
+ * @return true on success, false if the file couldn't be read.
+ ***/
+bool buildStateHashSource(const char *path, char hash[SHA256_HEX_SIZE]);
+
+/***
+ * Check if none of the source files in a BuildState changed.
+ *
+ * @param s The BuildState to check.
+ * @return true if all the source files exist and are unchanged, false otherwise.
+ ***/
+bool buildStateSourcesUnchanged(BuildState *s);
+
+#endif // BUILD_STATE_H
@@ -3,7 +3,8 @@
 
 /**
  * This is a "temporary" C code generator (transpiler.)
- * It directly walks the AST and outputs equivalent C code.
+ * Declarations are generated by walking the AST, and function bodies are generated
+ * from the IR (see Ir/Ir.h, Ir/Lower.h & Ir/Pass.h) as C code using goto's for control flow.
  *
  * I say its temporary since the final goal is to have a generic front-end
  * for the code generator that either generates a bytecode, or requires
@@ -20,15 +21,56 @@
  **/
 
 #include <stdio.h> // FILE
+#include <stdbool.h>
+#include "common.h"
+#include "Writer.h"
 #include "Ast/Program.h"
+#include "Reachability.h"
+
+// The name of the header included by all module headers (see codegenGenerateModules()).
+#define PRELUDE_HEADER_NAME "ilc_prelude.h"
 
 /**
  * Transpile program represented by 'prog' to C code.
+ * Note: The code is written directly to the file descriptor of [output] (it is flushed first.)
  *
  * @param output The stream to output the C code to.
  * @param prog The ASTProgram to transpile from.
+ * @param jobs The maximum amount of modules to generate in parallel.
+ * @param reachable What the entry point can reach (only that is generated), or NULL to generate everything.
+ * @param expectChecks Whether expect statements without an else body are checked (see irLowerModule()).
+ * @return true on success, false if writing the output failed.
+ **/
+bool codegenGenerate(FILE *output, ASTProgram *prog, usize jobs, Reachability *reachable, bool expectChecks);
+
+/**
+ * Transpile program represented by 'prog' to C code written to a Writer.
+ *
+ * @param output The Writer to write the C code to (for example an in-memory Writer).
+ * @param prog The ASTProgram to transpile from.
+ * @param jobs The maximum amount of modules to generate in parallel.
+ * @param reachable What the entry point can reach (only that is generated), or NULL to generate everything.
+ * @param expectChecks Whether expect statements without an else body are checked (see irLowerModule()).
+ * @return true on success, false if writing the output failed.
+ **/
+bool codegenGenerateToWriter(Writer *output, ASTProgram *prog, usize jobs, Reachability *reachable, bool expectChecks);
+
+/**
+ * Transpile program represented by 'prog' to C code, one translation unit per module.
+ * For every module, '<module>.h' (the declarations other modules can use) and
+ * '<module>.c' (the definitions) are written to [outputDir], along with a shared
+ * 'ilc_prelude.h' header which is included by all the module headers.
+ * Note: Files whose content didn't change are not rewritten.
+ * Note: Unreachable code is generated as well since a module's code can't depend on the modules importing it.
+ *
+ * @param outputDir The directory to write the files to (created if it doesn't exist).
+ * @param prog The ASTProgram to transpile from.
+ * @param jobs The maximum amount of modules to generate in parallel.
+ * @param generate Which modules to generate (indexed by ModuleID), or NULL to generate all of them.
+ * @param expectChecks Whether expect statements without an else body are checked (see irLowerModule()).
+ * @return true on success, false on failure (an error is printed.)
  **/
-void codegenGenerate(FILE *output, ASTProgram *prog);
+bool codegenGenerateModules(const char *outputDir, ASTProgram *prog, usize jobs, const bool *generate, bool expectChecks);
 
 
 #endif // CODEGEN_H
@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "Array.h"
+#include "Table.h"
 #include "Strings.h"
 
 // predeclarations for types (as Error.h includes this file, this file can't include Error.h)
@@ -22,6 +23,7 @@ typedef struct compiler {
     Array errors; // Array<Error *>
     FileID current_file;
     bool current_file_initialized; // if true current_file is valid, else it's invalid.
+    Table *sources; // Table<char *, String> in-memory sources (path -> contents), not owned (see compilerSetSources()).
 } Compiler;
 
 
@@ -87,6 +89,32 @@ void compilerInit(Compiler *c);
  ***/
 void compilerFree(Compiler *c);
 
+/***
+ * Remove all the files & errors from a Compiler (the storage is kept for reuse).
+ * NOTE: The in-memory sources are NOT removed.
+ *
+ * @param c The Compiler to clear.
+ ***/
+void compilerClear(Compiler *c);
+
+/***
+ * Set the in-memory sources to use instead of the files on disk.
+ * When a file whose path is in [sources] is added, its contents are taken from [sources] instead of being read.
+ *
+ * @param c The Compiler.
+ * @param sources Table<char *, String> (path -> contents), not owned (NULL to only use files on disk).
+ ***/
+void compilerSetSources(Compiler *c, Table *sources);
+
+/***
+ * Check if a file exists, either as an in-memory source or in the current directory.
+ *
+ * @param c The Compiler.
+ * @param path The path of the file (relative to the current directory).
+ * @return true if the file exists, false if it doesn't.
+ ***/
+bool compilerHasFile(Compiler *c, const char *path);
+
 /***
  * Add a file to the file list.
  *
@@ -112,6 +140,14 @@ bool compilerHasNextFile(Compiler *c);
  ***/
 FileID compilerNextFile(Compiler *c);
 
+/***
+ * Set the current file.
+ *
+ * @param c The compiler to set the current file in.
+ * @param id The FileID of the new current file.
+ ***/
+void compilerSetCurrentFile(Compiler *c, FileID id);
+
 /***
  * Get a pointer to the File pointed to by a FileID.
  *
@@ -0,0 +1,54 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdbool.h>
+#include "common.h"
+
+/**
+ * The compiler daemon ('ilc daemon socket').
+ * The daemon listens on a Unix domain socket, and runs the command lines forwarded to it
+ * by clients one at a time in the same process, so everything it keeps between requests
+ * (see main.c) stays warm.
+ * A request holds the working directory, the command line & the environment of the client,
+ * and its stdin, stdout & stderr (passed with SCM_RIGHTS). The daemon runs the request
+ * in that directory & environment with those files, and replies with the exit status.
+ *
+ * When $ILC_DAEMON is set to the socket of a daemon, ilc forwards its command line
+ * to the daemon instead of running it (see daemonForward()).
+ **/
+
+#define DAEMON_SOCKET_ENV "ILC_DAEMON"
+
+/***
+ * Run a request.
+ *
+ * @param argc The amount of arguments.
+ * @param argv The arguments (argv[0] is the client's program name.)
+ * @param context The context passed to daemonServe().
+ * @return The exit status of the request.
+ ***/
+typedef int (*DaemonHandler)(int argc, char **argv, void *context);
+
+/***
+ * Listen on a Unix domain socket and handle requests until SIGINT or SIGTERM is received.
+ * The socket is removed when the daemon stops.
+ *
+ * @param socketPath The path of the socket (an existing socket is replaced.)
+ * @param handler The function running the requests.
+ * @param context A context to pass to [handler].
+ * @return true if the daemon stopped normally, false if it failed to start (an error is printed.)
+ ***/
+bool daemonServe(const char *socketPath, DaemonHandler handler, void *context);
+
+/***
+ * Forward a command line to a daemon and wait for it to finish.
+ *
+ * @param socketPath The path of the daemon's socket.
+ * @param argc The amount of arguments.
+ * @param argv The arguments.
+ * @param status Where to store the exit status of the request.
+ * @return true if the daemon ran the request, false if it couldn't be reached.
+ ***/
+bool daemonForward(const char *socketPath, int argc, char **argv, int *status);
+
+#endif // DAEMON_H
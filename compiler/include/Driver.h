@@ -0,0 +1,90 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Ast/Program.h"
+#include "Table.h"
+#include "Compiler.h"
+#include "ObjectCache.h"
+
+/**
+ * The build driver.
+ * Generates a C translation unit per module (see codegenGenerateModules()),
+ * compiles them in parallel using an external C compiler, and links the result.
+ * If an ObjectCache is used, units whose object is cached aren't compiled at all.
+ * The cache key of a unit is a SHA-256 of the C compiler command, the unit's source,
+ * and all the generated headers it (transitively) includes.
+ *
+ * Builds are incremental: the fingerprints of all the modules are kept in the build directory
+ * (see BuildState.h), and only modules whose source or imported interfaces changed
+ * are generated and compiled again.
+ * An interface file is written for every module (see ModuleInterface.h), and modules that
+ * didn't change (and don't import modules that changed) are loaded from their interface
+ * instead of being parsed (see driverFindModuleInterfaces()). The function bodies of the other
+ * unchanged modules are skipped by the parser, and only parsed if the module has to be generated after all.
+ * When no source file changed at all, the whole build is skipped (see driverIsUpToDate()).
+ *
+ * A unity build (see BuildOptions::unity) generates the whole program as a single translation unit instead
+ * (see codegenGenerate()), so the C compiler can optimize across modules and everything the entry point
+ * can't reach is left out. It is only skipped when no source file changed.
+ **/
+
+#define DRIVER_DEFAULT_CC "cc"
+
+typedef struct build_options {
+    const char *mainFile; // The path of the main source file.
+    const char *cc; // The C compiler command (may include arguments, e.g. "gcc -O2").
+    const char *buildDir; // Where the generated C code and the object files are placed.
+    const char *output; // The path of the linked executable.
+    usize jobs; // The maximum amount of C compiler processes to run at once.
+    bool printTimes; // Print how long compiling every unit (and linking) took, and the cache statistics.
+    bool unity; // Generate & compile the whole program as a single translation unit (see driverBuild()).
+    bool expectChecks; // Check expect statements without an else body (see irLowerModule()).
+    ObjectCache *cache; // NULL if objects shouldn't be cached.
+    // Called before generating the modules marked in [modules] (indexed by ModuleID). NULL if not needed.
+    // Used to parse the function bodies skipped by the parser (see driverFindModuleInterfaces()).
+    bool (*beforeGenerate)(void *context, ASTProgram *prog, bool *modules);
+    void *beforeGenerateContext;
+} BuildOptions;
+
+/***
+ * Check if the output of a previous build is up to date,
+ * i.e. the build options and all the source files are the same as in the last successful build.
+ *
+ * @param opts The build options.
+ * @return true if nothing has to be done, false if the program has to be built.
+ ***/
+bool driverIsUpToDate(BuildOptions *opts);
+
+/***
+ * Find the modules that can be loaded from the interfaces written by the previous build
+ * (see parserSetModuleInterfaces()), i.e. the modules whose source and imported modules didn't change.
+ * Modules whose source didn't change but import modules that did are only needed for their declarations
+ * unless an imported interface changed, so their function bodies don't have to be parsed (see parserSetSkipBodies()).
+ *
+ * @param opts The build options.
+ * @param interfaces An initialized Table<char *, char *> to fill (module name -> interface path, both owned Strings.)
+ * @param skipBodies An initialized Table<char *, char *> to fill (module name -> source path, both owned Strings.)
+ ***/
+void driverFindModuleInterfaces(BuildOptions *opts, Table *interfaces, Table *skipBodies);
+
+/***
+ * Free a Table filled by driverFindModuleInterfaces().
+ *
+ * @param interfaces The Table to free.
+ ***/
+void driverFreeModuleInterfaces(Table *interfaces);
+
+/***
+ * Build an executable from a checked program.
+ * Compiler failures are reported on stderr.
+ *
+ * @param opts The build options.
+ * @param c The Compiler used to compile [prog] (for the paths of the source files.)
+ * @param prog The checked ASTProgram to build.
+ * @return true on success, false on failure.
+ ***/
+bool driverBuild(BuildOptions *opts, Compiler *c, ASTProgram *prog);
+
+#endif // DRIVER_H
@@ -0,0 +1,87 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "memory.h"
+#include "Arena.h"
+#include "Table.h"
+#include "Compiler.h"
+#include "Ast/Program.h"
+
+/**
+ * The Evaluator evaluates the initializers of module variables at compile time
+ * so they can be generated as static data (and cost nothing at startup).
+ * It is an interpreter over the checked AST, run after typechecking.
+ *
+ * An initializer can use constants, the module variables declared before it, and call the functions
+ * (and methods) of its own module, as long as they are pure: they may not modify module variables
+ * (directly or through a pointer), and expect statements must not fail. Loops and recursion are limited
+ * (see EVALUATOR_MAX_STEPS and EVALUATOR_MAX_CALL_DEPTH) so evaluation always ends.
+ * Initializers that can't be evaluated are reported as not being constant expressions.
+ *
+ * The initializer of every evaluated variable is replaced by its value: a constant expression
+ * (ASTConstantValueExpr, ASTStructConstantExpr, or an EXPR_FUNCTION ASTObjExpr),
+ * or no initializer at all if the value is zero (module variables are zero initialized).
+ *
+ * Variables of modules whose function bodies were skipped by the parser (see parserSetSkipBodies())
+ * are left as they are when they need a skipped body. These modules aren't generated
+ * unless their bodies are parsed and the program is checked (and evaluated) again.
+ **/
+
+#define EVALUATOR_MAX_STEPS 1000000
+#define EVALUATOR_MAX_CALL_DEPTH 256
+
+typedef struct eval_frame EvalFrame; // from Evaluator.c
+
+typedef struct evaluator {
+    Compiler *compiler;
+    ASTProgram *program;
+    bool hadError;
+    Table variables; // Table<ASTObj *, EvalVariable *> (module variables.)
+    struct {
+        Arena storage;
+        Allocator alloc;
+    } values;
+
+    struct {
+        ASTModule *module; // The module of the variable being evaluated.
+        EvalFrame *frame; // NULL when not in a call.
+        usize steps;
+        usize callDepth;
+    } current;
+
+    // Why evaluating the current initializer failed.
+    struct {
+        bool failed;
+        bool skippedBody; // Failed because a function body was skipped by the parser.
+        Location location;
+        String message;
+    } failure;
+} Evaluator;
+
+/**
+ * Initialize an Evaluator.
+ *
+ * @param e The Evaluator to initialize.
+ * @param c A Compiler to use to report errors.
+ **/
+void evaluatorInit(Evaluator *e, Compiler *c);
+
+/**
+ * Free an Evaluator.
+ *
+ * @param e The Evaluator to free.
+ **/
+void evaluatorFree(Evaluator *e);
+
+/**
+ * Evaluate the initializers of the module variables of a program.
+ *
+ * @param e The Evaluator to use.
+ * @param prog The ASTProgram (MUST be validated & typechecked first.)
+ * @return true on success, false on failure.
+ **/
+bool evaluatorEvaluate(Evaluator *e, ASTProgram *prog);
+
+#endif // EVALUATOR_H
@@ -0,0 +1,77 @@
+#ifndef FRONT_END_H
+#define FRONT_END_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Table.h"
+#include "Ast/StringTable.h"
+#include "Ast/Program.h"
+#include "Compiler.h"
+#include "Scanner.h"
+#include "Parser.h"
+#include "Validator.h"
+#include "Typechecker.h"
+#include "Evaluator.h"
+
+/**
+ * The front end: everything needed to parse, validate, typecheck & evaluate a program, wired together.
+ * A FrontEnd compiles a single program, but it can be reset (see frontEndReset()) to compile
+ * another one while reusing the storage of the previous compilation.
+ * Used by both ilc (main.c) and libilc (see Ilc.h).
+ **/
+
+// Note: the members point to each other, so a FrontEnd must not be moved (see frontEndNew()).
+typedef struct front_end {
+    Compiler compiler;
+    Scanner scanner;
+    Parser parser;
+    Validator validator;
+    Typechecker typechecker;
+    Evaluator evaluator;
+    bool fusedCheck;
+    ASTProgram parsedProgram;
+    ASTProgram checkedProgram;
+    Table interfaces, skipBodies; // Table<String, String> (see driverFindModuleInterfaces().)
+} FrontEnd;
+
+/***
+ * Create a new FrontEnd.
+ *
+ * @param strings The StringTable to use for the programs (not owned).
+ * @return A new FrontEnd.
+ ***/
+FrontEnd *frontEndNew(StringTable *strings);
+
+/***
+ * Free a FrontEnd.
+ *
+ * @param fe The FrontEnd to free.
+ ***/
+void frontEndFree(FrontEnd *fe);
+
+/***
+ * Validate & typecheck in a single pass (see validatorSetFusedTypechecker()).
+ * NOTE: The setting is kept when the FrontEnd is reset.
+ *
+ * @param fe The FrontEnd.
+ * @param fused Whether to use a single pass.
+ ***/
+void frontEndSetFusedCheck(FrontEnd *fe, bool fused);
+
+/***
+ * Discard the checked program so the parsed program can be checked again.
+ *
+ * @param fe The FrontEnd.
+ ***/
+void frontEndResetChecker(FrontEnd *fe);
+
+/***
+ * Discard everything compiled so another program can be compiled.
+ * The modules (with their arenas & tables) and the arrays of the previous compilation are kept for reuse.
+ * NOTE: The parser settings (e.g. parserSetModuleInterfaces()) are reset too.
+ *
+ * @param fe The FrontEnd to reset.
+ ***/
+void frontEndReset(FrontEnd *fe);
+
+#endif // FRONT_END_H
@@ -0,0 +1,157 @@
+#ifndef ILC_H
+#define ILC_H
+
+#include <stdbool.h>
+#include <stddef.h> // size_t
+
+/**
+ * libilc - the compiler as a library.
+ * An IlcContext compiles a program from in-memory sources (or files on disk) to C code kept in memory.
+ * Contexts are independent of each other, so many compilations can run at once in different threads
+ * (as long as each context is only used by one thread at a time).
+ *
+ * Typical use:
+ *   IlcContext *ctx = ilcContextNew();
+ *   ilcContextAddSource(ctx, "main.ilc", source, sourceLength);
+ *   if(ilcCompile(ctx, "main.ilc")) {
+ *       size_t length;
+ *       const char *c = ilcContextOutput(ctx, &length);
+ *       ...
+ *   } else {
+ *       fputs(ilcContextErrors(ctx), stderr);
+ *   }
+ *   ilcContextReset(ctx); // and compile the next program.
+ *   ...
+ *   ilcContextFree(ctx);
+ *
+ * Resetting a context is cheap: the memory used by the previous compilation (the AST arenas, tables,
+ * arrays & the output buffer) is kept and reused, and so are the interned strings.
+ **/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ILC_API __attribute__((visibility("default")))
+
+typedef struct ilc_context IlcContext;
+
+typedef enum ilc_diagnostic_kind {
+    ILC_DIAGNOSTIC_ERROR,
+    ILC_DIAGNOSTIC_HINT // Follows the error it explains.
+} IlcDiagnosticKind;
+
+// An error (or hint) reported by a compilation.
+typedef struct ilc_diagnostic {
+    IlcDiagnosticKind kind;
+    const char *message;
+    const char *file; // The path of the file the diagnostic is in, NULL if it has no location.
+    size_t start, end; // The byte offsets of the location in [file].
+    size_t line; // The line of [start] (the first line is 1).
+    size_t column; // The column of [start] (the first column is 0).
+} IlcDiagnostic;
+
+/***
+ * Create a new compilation context.
+ *
+ * @return A new IlcContext.
+ ***/
+ILC_API IlcContext *ilcContextNew(void);
+
+/***
+ * Free a compilation context.
+ *
+ * @param ctx The IlcContext to free.
+ ***/
+ILC_API void ilcContextFree(IlcContext *ctx);
+
+/***
+ * Discard the sources, output & errors of a context so it can be used to compile another program.
+ * The options are kept.
+ *
+ * @param ctx The IlcContext to reset.
+ ***/
+ILC_API void ilcContextReset(IlcContext *ctx);
+
+/***
+ * Set the maximum amount of modules to generate in parallel (default: 1).
+ *
+ * @param ctx The IlcContext.
+ * @param jobs The amount of threads to use (0 is treated as 1).
+ ***/
+ILC_API void ilcContextSetJobs(IlcContext *ctx, size_t jobs);
+
+/***
+ * Validate & typecheck in a single pass (default: false).
+ *
+ * @param ctx The IlcContext.
+ * @param fused Whether to use a single pass.
+ ***/
+ILC_API void ilcContextSetFusedCheck(IlcContext *ctx, bool fused);
+
+/***
+ * Add an in-memory source file.
+ * Files added to a context are used instead of the files on disk with the same path,
+ * both for the main file and for imported modules (module 'name' is found at "name.ilc").
+ * Adding a path again replaces its contents.
+ *
+ * @param ctx The IlcContext.
+ * @param path The path of the file (copied).
+ * @param contents The contents of the file (copied).
+ * @param length The length of [contents].
+ ***/
+ILC_API void ilcContextAddSource(IlcContext *ctx, const char *path, const char *contents, size_t length);
+
+/***
+ * Compile a program to C.
+ * Compiling again using the same context replaces the previous output & errors.
+ *
+ * @param ctx The IlcContext.
+ * @param mainFile The path of the main file (an in-memory source, or a file on disk).
+ * @return true on success, false on failure (see ilcContextErrors()).
+ ***/
+ILC_API bool ilcCompile(IlcContext *ctx, const char *mainFile);
+
+/***
+ * Get the C code generated by the last successful compilation.
+ * NOTE: The output is owned by the context, and is valid until the context is compiled again, reset or freed.
+ *
+ * @param ctx The IlcContext.
+ * @param length Where to store the length of the output (can be NULL).
+ * @return The nul-terminated C code ("" if there is none).
+ ***/
+ILC_API const char *ilcContextOutput(IlcContext *ctx, size_t *length);
+
+/***
+ * Get the errors reported by the last compilation, formatted like ilc prints them.
+ * NOTE: The errors are owned by the context, and are valid until the context is compiled again, reset or freed.
+ *
+ * @param ctx The IlcContext.
+ * @return The nul-terminated errors ("" if there are none).
+ ***/
+ILC_API const char *ilcContextErrors(IlcContext *ctx);
+
+/***
+ * Get the amount of diagnostics (errors & hints) reported by the last compilation.
+ *
+ * @param ctx The IlcContext.
+ * @return The amount of diagnostics.
+ ***/
+ILC_API size_t ilcContextDiagnosticCount(IlcContext *ctx);
+
+/***
+ * Get a diagnostic reported by the last compilation (in the order they were reported).
+ * NOTE: The strings are owned by the context, and are valid until the context is compiled again, reset or freed.
+ *
+ * @param ctx The IlcContext.
+ * @param index The index of the diagnostic (less than ilcContextDiagnosticCount()).
+ * @param diagnostic Where to store the diagnostic.
+ * @return true on success, false if [index] is out of range.
+ ***/
+ILC_API bool ilcContextGetDiagnostic(IlcContext *ctx, size_t index, IlcDiagnostic *diagnostic);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // ILC_H
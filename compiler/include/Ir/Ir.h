@@ -0,0 +1,437 @@
+#ifndef IR_IR_H
+#define IR_IR_H
+
+#include <stdio.h> // FILE
+#include <stdbool.h>
+#include "common.h"
+#include "memory.h"
+#include "Arena.h"
+#include "Array.h"
+#include "Table.h"
+#include "Token.h"
+#include "Ast/Type.h"
+#include "Ast/Object.h"
+#include "Ast/Program.h"
+
+/**
+ * The IR is a typed, SSA-form intermediate representation of the functions of a checked program.
+ * It sits between the typechecker and the code generator (see Ir/Lower.h, Ir/Pass.h and Codegen.h).
+ *
+ * A function is a list of basic blocks (the first one is the entry block), and each block is a list
+ * of instructions ending with exactly one terminator (jump, branch, return, or a failed expect).
+ * Control flow is explicit: if statements, loops, short-circuiting operators, expect statements,
+ * returns and defers are all lowered to blocks and terminators.
+ *
+ * Every value has a Type (the same Types the AST uses.) Values are instructions, or operands that are
+ * not computed by an instruction: constants, undefined values, parameters, module variables (their address)
+ * and functions. Local variables are SSA values unless their address is taken or they are structs,
+ * in which case they live in a stack slot (IR_ALLOCA) that is accessed with loads and stores.
+ * Values merged from several predecessors are phi instructions, whose operands are in the same order
+ * as the predecessors of their block.
+ *
+ * Every value keeps a list of the instructions using it, so values can be replaced and removed cheaply.
+ * All the values and blocks of a function are allocated from the function's arena.
+ **/
+
+typedef enum ir_value_kind {
+    IR_VALUE_CONSTANT,
+    IR_VALUE_UNDEFINED,
+    IR_VALUE_PARAMETER,
+    IR_VALUE_GLOBAL, // The address of a module variable.
+    IR_VALUE_FUNCTION,
+    IR_VALUE_INSTRUCTION
+} IrValueKind;
+
+typedef struct ir_value {
+    IrValueKind kind;
+    Type *type; // NULL for instructions that don't produce a value.
+    Array uses; // Array<IrInstr *> (an instruction appears once for every operand using the value.)
+} IrValue;
+
+typedef struct ir_constant {
+    IrValue header;
+    union {
+        u64 number;
+        ASTString string;
+        bool boolean;
+    } as;
+} IrConstant;
+
+// IR_VALUE_PARAMETER, IR_VALUE_GLOBAL & IR_VALUE_FUNCTION.
+typedef struct ir_object_value {
+    IrValue header;
+    ASTObj *obj;
+} IrObjectValue;
+
+typedef enum ir_op {
+    // Memory
+    IR_ALLOCA, // A stack slot for [as.variable] (the value is its address.)
+    IR_LOAD, // [address]
+    IR_STORE, // [address, value]
+    IR_FIELD_ADDRESS, // [struct address] -> the address of the field [as.field].
+    // Arithmetic & comparison
+    IR_ADD, IR_SUBTRACT, IR_MULTIPLY, IR_DIVIDE, // [lhs, rhs]
+    IR_EQ, IR_NE, IR_LT, IR_LE, IR_GT, IR_GE, // [lhs, rhs]
+    IR_NEGATE, IR_NOT, // [operand]
+    // Other
+    IR_CALL, // [callee, arguments...]
+    IR_PHI, // [a value for every predecessor]
+    // Terminators
+    IR_JUMP, // [] -> as.targets[0]
+    IR_BRANCH, // [condition] -> as.targets[0] if true, as.targets[1] if false.
+    IR_RETURN, // [] or [value]
+    IR_EXPECT_FAILED, // [file, line] (report a failed expect statement and exit.)
+    IR_OP_COUNT // not an op.
+} IrOp;
+
+typedef struct ir_block IrBlock;
+typedef struct ir_function IrFunction;
+
+typedef struct ir_instruction {
+    IrValue header;
+    IrOp op;
+    u32 id;
+    IrBlock *block; // NULL once removed.
+    Location location;
+    Array operands; // Array<IrValue *>
+    union {
+        ASTObj *variable; // IR_ALLOCA, IR_PHI (the variable being merged, NULL if it isn't a variable.)
+        ASTObj *field; // IR_FIELD_ADDRESS
+        IrBlock *targets[2]; // IR_JUMP, IR_BRANCH
+        bool tail; // IR_CALL (the call is returned right away by the return after it, see irPassTailCalls.)
+    } as;
+} IrInstr;
+
+struct ir_block {
+    u32 id;
+    IrFunction *function;
+    Array instructions; // Array<IrInstr *> (phis first, the terminator last.)
+    Array predecessors; // Array<IrBlock *>
+    bool cold; // Only runs when an expect statement fails (branches to it are unlikely.)
+};
+
+typedef struct ir_module IrModule;
+
+struct ir_function {
+    ASTObj *fn;
+    IrModule *module;
+    Array parameters; // Array<IrValue *> (IR_VALUE_PARAMETER)
+    Array blocks; // Array<IrBlock *> (the entry block is first.)
+    Array values; // Array<IrValue *> (every value ever created, owned.)
+    Array removedBlocks; // Array<IrBlock *> (owned.)
+    u32 nextInstrId, nextBlockId;
+    struct {
+        Arena storage;
+        Allocator alloc;
+    } allocator;
+};
+
+struct ir_module {
+    ASTProgram *program;
+    ASTModule *module;
+    Array functions; // Array<IrFunction *> (in declaration order.)
+    Table functionTable; // Table<ASTObj *, IrFunction *>
+    Table pointerTypes; // Table<ASTString, Type *> (pointer types the module doesn't have, owned.)
+};
+
+typedef struct ir_program {
+    ASTProgram *ast;
+    Array modules; // Array<IrModule *> (in the same order as the modules of [ast].)
+} IrProgram;
+
+#define IR_VALUE_IS(value, value_kind) ((value)->kind == (value_kind))
+#define IR_IS_INSTR(value, instr_op) (IR_VALUE_IS((value), IR_VALUE_INSTRUCTION) && ((IrInstr *)(value))->op == (instr_op))
+#define IR_OPERAND(instr, index) ARRAY_GET_AS(IrValue *, &(instr)->operands, (index))
+
+/** IrModule **/
+
+/**
+ * Create a new (empty) IrModule.
+ *
+ * @param prog The checked program the module belongs to.
+ * @param module The ASTModule the IR is lowered from.
+ * @return A new IrModule.
+ **/
+IrModule *irModuleNew(ASTProgram *prog, ASTModule *module);
+
+/**
+ * Free an IrModule and all of its functions.
+ *
+ * @param m The IrModule to free.
+ **/
+void irModuleFree(IrModule *m);
+
+/**
+ * Get the IR of a function.
+ *
+ * @param m The module the function belongs to.
+ * @param fn The function (OBJ_FN).
+ * @return The IrFunction or NULL if [fn] has no IR (for example, extern functions.)
+ **/
+IrFunction *irModuleGetFunction(IrModule *m, ASTObj *fn);
+
+/**
+ * Get the pointer type to a type.
+ * The pointer types the AST already has are reused, and missing ones are created (and owned by the module).
+ *
+ * @param m The module the type is used in.
+ * @param ty The pointee type.
+ * @return The type '&[ty]'.
+ **/
+Type *irModulePointerType(IrModule *m, Type *ty);
+
+/**
+ * Pretty print an IrModule.
+ *
+ * @param to The stream to print to.
+ * @param m The module to print.
+ **/
+void irModulePrint(FILE *to, IrModule *m);
+
+/** IrProgram **/
+
+/**
+ * Free an IrProgram and all of its modules.
+ *
+ * @param prog The IrProgram to free.
+ **/
+void irProgramFree(IrProgram *prog);
+
+/**
+ * Pretty print an IrProgram.
+ *
+ * @param to The stream to print to.
+ * @param prog The program to print.
+ **/
+void irProgramPrint(FILE *to, IrProgram *prog);
+
+/** IrFunction **/
+
+/**
+ * Create a new IrFunction (with no blocks) and add it to a module.
+ *
+ * @param m The module the function belongs to.
+ * @param fn The function (OBJ_FN).
+ * @return A new IrFunction.
+ **/
+IrFunction *irFunctionNew(IrModule *m, ASTObj *fn);
+
+/**
+ * Free an IrFunction.
+ *
+ * @param fn The IrFunction to free.
+ **/
+void irFunctionFree(IrFunction *fn);
+
+/**
+ * Pretty print an IrFunction.
+ *
+ * @param to The stream to print to.
+ * @param fn The function to print.
+ **/
+void irFunctionPrint(FILE *to, IrFunction *fn);
+
+/**
+ * Remove blocks from a function (all at once, so removing many blocks is linear in the size of the function.)
+ * NOTE: The blocks must not have any predecessors, and the values of their instructions must not be used
+ *       outside of them. The instructions in the blocks are removed as well.
+ *
+ * @param fn The function containing the blocks.
+ * @param blocks The blocks to remove (Array<IrBlock *>).
+ **/
+void irFunctionRemoveBlocks(IrFunction *fn, Array *blocks);
+
+/** Values **/
+
+/**
+ * Create a new constant.
+ * NOTE: The caller must initialize the right field of the constant's 'as' union.
+ *
+ * @param fn The function the constant is used in.
+ * @param type The type of the constant (numbers, strings & booleans.)
+ * @return A new IrConstant.
+ **/
+IrConstant *irConstantNew(IrFunction *fn, Type *type);
+
+/**
+ * Create a new undefined value (the value of a variable before it is assigned.)
+ *
+ * @param fn The function the value is used in.
+ * @param type The type of the value.
+ * @return A new undefined value.
+ **/
+IrValue *irUndefinedNew(IrFunction *fn, Type *type);
+
+/**
+ * Create a new value referring to an object (a parameter, a module variable, or a function.)
+ *
+ * @param fn The function the value is used in.
+ * @param kind IR_VALUE_PARAMETER, IR_VALUE_GLOBAL or IR_VALUE_FUNCTION.
+ * @param type The type of the value (the pointer type to the variable for IR_VALUE_GLOBAL.)
+ * @param obj The object.
+ * @return A new IrObjectValue.
+ **/
+IrObjectValue *irObjectValueNew(IrFunction *fn, IrValueKind kind, Type *type, ASTObj *obj);
+
+/**
+ * Replace all uses of a value with another value.
+ *
+ * @param value The value to replace.
+ * @param replacement The value to use instead.
+ **/
+void irValueReplaceAllUses(IrValue *value, IrValue *replacement);
+
+/**
+ * Check if an address (of a stack slot, or of one of its fields) is used for anything
+ * but loading from & storing to it, i.e. if the object might be accessed through a pointer.
+ *
+ * @param address The address.
+ * @return true if [address] escapes, false if the object is only accessed directly.
+ **/
+bool irAddressEscapes(IrValue *address);
+
+/** Instructions **/
+
+/**
+ * Create a new instruction (not in any block.)
+ *
+ * @param fn The function the instruction belongs to.
+ * @param op The instruction's op.
+ * @param type The type of the value the instruction produces (NULL if none.)
+ * @param location The source location the instruction was lowered from.
+ * @return A new IrInstr.
+ **/
+IrInstr *irInstrNew(IrFunction *fn, IrOp op, Type *type, Location location);
+
+/**
+ * Add an operand to an instruction.
+ *
+ * @param instr The instruction.
+ * @param operand The operand to add.
+ **/
+void irInstrAddOperand(IrInstr *instr, IrValue *operand);
+
+/**
+ * Remove an operand from an instruction.
+ *
+ * @param instr The instruction.
+ * @param index The index of the operand to remove.
+ **/
+void irInstrRemoveOperand(IrInstr *instr, usize index);
+
+/**
+ * Remove an instruction from its block and stop using its operands.
+ * Removing a terminator also removes the block from the predecessors of its successors.
+ * NOTE: The value of the instruction must not be used anymore.
+ *
+ * @param instr The instruction to remove.
+ **/
+void irInstrRemove(IrInstr *instr);
+
+/**
+ * Check if an op is a terminator.
+ *
+ * @param op The op to check.
+ * @return true if [op] ends a block.
+ **/
+bool irOpIsTerminator(IrOp op);
+
+/**
+ * Get the name of an op (as it is printed.)
+ *
+ * @param op The op.
+ * @return The name of [op].
+ **/
+const char *irOpName(IrOp op);
+
+/** Blocks **/
+
+/**
+ * Create a new block and add it to the end of a function.
+ *
+ * @param fn The function to add the block to.
+ * @return A new IrBlock.
+ **/
+IrBlock *irBlockNew(IrFunction *fn);
+
+/**
+ * Append an instruction to a block.
+ * Phis are inserted after the phis already in the block instead (even if the block is terminated.)
+ *
+ * @param block The block.
+ * @param instr The instruction to add.
+ **/
+void irBlockAppend(IrBlock *block, IrInstr *instr);
+
+/**
+ * Get the terminator of a block.
+ *
+ * @param block The block.
+ * @return The terminator, or NULL if the block isn't terminated yet.
+ **/
+IrInstr *irBlockTerminator(IrBlock *block);
+
+/**
+ * Get the successors of a block.
+ *
+ * @param block The block.
+ * @param successors Where to store the successors.
+ * @return The amount of successors (at most 2.)
+ **/
+usize irBlockSuccessors(IrBlock *block, IrBlock *successors[2]);
+
+/**
+ * Get the index of a predecessor of a block (the index of its phi operands.)
+ *
+ * @param block The block.
+ * @param predecessor The predecessor.
+ * @return The index of [predecessor] (C.R.E if it isn't a predecessor.)
+ **/
+usize irBlockPredecessorIndex(IrBlock *block, IrBlock *predecessor);
+
+/**
+ * Remove a predecessor of a block, and the operands of the block's phis for it.
+ *
+ * @param block The block.
+ * @param predecessor The predecessor to remove.
+ **/
+void irBlockRemovePredecessor(IrBlock *block, IrBlock *predecessor);
+
+/**
+ * Terminate a block with a jump.
+ *
+ * @param block The block to terminate.
+ * @param target The block to jump to.
+ * @param location The source location of the jump.
+ **/
+void irBuildJump(IrBlock *block, IrBlock *target, Location location);
+
+/**
+ * Terminate a block with a conditional branch.
+ *
+ * @param block The block to terminate.
+ * @param condition The condition (bool.)
+ * @param then The block to branch to if the condition is true.
+ * @param else_ The block to branch to if the condition is false (C.R.E if the same as [then].)
+ * @param location The source location of the branch.
+ **/
+void irBuildBranch(IrBlock *block, IrValue *condition, IrBlock *then, IrBlock *else_, Location location);
+
+/** Calling convention **/
+
+// Structs bigger than this (in bytes) aren't copied when passed to & returned from functions (see irTypeIsPassedByPointer()).
+#define IR_MAX_STRUCT_VALUE_SIZE 16
+
+/**
+ * Check if the values of a type are passed to functions as a pointer to a constant
+ * (the callee only copies the value if it modifies it), and returned through a pointer to
+ * storage the caller provides, instead of being copied (see genFunctionSignature() in Codegen.c).
+ * This is the case for structs bigger than IR_MAX_STRUCT_VALUE_SIZE.
+ * Note: Only the type is used, so all the modules (and function types) agree on how a function is called.
+ *
+ * @param ty The type of a parameter or return value.
+ * @return true if [ty] is passed by pointer, false if it is passed by value.
+ **/
+bool irTypeIsPassedByPointer(Type *ty);
+
+#endif // IR_IR_H
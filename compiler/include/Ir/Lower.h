@@ -0,0 +1,58 @@
+#ifndef IR_LOWER_H
+#define IR_LOWER_H
+
+#include "Ast/Program.h"
+#include "Ir/Ir.h"
+
+/**
+ * Lowering translates the functions of a checked (validated & typechecked) program to the IR.
+ *
+ * SSA form is constructed directly while lowering using the algorithm described in
+ * "Simple and Efficient Construction of Static Single Assignment Form" (Braun et al. 2013):
+ * every block remembers the latest value of every local variable written in it, and reading a variable
+ * looks it up recursively in the predecessors, adding phis where control flow merges.
+ * Blocks are "sealed" once all of their predecessors are known, and phis read in blocks that
+ * aren't sealed yet (loop headers) are completed when the block is sealed.
+ * Trivial phis (phis merging a single value) are removed as soon as they are complete.
+ *
+ * Local variables whose address is taken, and struct variables, are not SSA values.
+ * They live in stack slots and are accessed using loads & stores instead.
+ *
+ * Defers are run when the function returns, in the order they appear in the function
+ * (all of them, like the code generator always did.)
+ *
+ * The failure path of an expect statement starts in a cold block (see IrBlock), and expect statements
+ * without an else body report their file & line when they fail (IR_EXPECT_FAILED).
+ **/
+
+/**
+ * Lower the functions of a module to the IR.
+ *
+ * @param prog The checked program the module belongs to.
+ * @param module The module to lower.
+ * @param expectChecks Whether to check expect statements without an else body
+ *                     (if false, only their conditions are evaluated.)
+ * @return A new IrModule (owned by the caller.)
+ **/
+IrModule *irLowerModule(ASTProgram *prog, ASTModule *module, bool expectChecks);
+
+/**
+ * Lower a single function to the IR (used to check a function before the program is generated).
+ *
+ * @param m The IrModule to add the function to (its module must be the one owning the function.)
+ * @param fn The function to lower (an OBJ_FN with a body).
+ * @param expectChecks See irLowerModule().
+ * @return The new IrFunction (owned by the module.)
+ **/
+IrFunction *irLowerFunction(IrModule *m, ASTObj *fn, bool expectChecks);
+
+/**
+ * Lower all the modules of a program to the IR.
+ *
+ * @param prog The checked program to lower.
+ * @param output The IrProgram to initialize (free with irProgramFree()).
+ * @param expectChecks See irLowerModule().
+ **/
+void irLowerProgram(ASTProgram *prog, IrProgram *output, bool expectChecks);
+
+#endif // IR_LOWER_H
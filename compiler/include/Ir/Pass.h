@@ -0,0 +1,106 @@
+#ifndef IR_PASS_H
+#define IR_PASS_H
+
+#include <stdbool.h>
+#include "Array.h"
+#include "Ir/Ir.h"
+
+/**
+ * Passes transform the IR of a function (for example optimizations.)
+ * The pass manager runs a list of passes over every function of a module (in the order they were added)
+ * and can verify the IR after every pass so a broken pass is caught where it happened.
+ **/
+
+typedef struct ir_pass {
+    const char *name;
+    // Returns true if the function was changed.
+    bool (*run)(IrFunction *fn);
+} IrPass;
+
+typedef struct ir_pass_manager {
+    Array passes; // Array<const IrPass *>
+    bool verify; // Verify the IR after every pass (default: false, true when built with ILC_VERIFY_IR.)
+} IrPassManager;
+
+/**
+ * Initialize a pass manager (with no passes.)
+ *
+ * @param pm The pass manager to initialize.
+ **/
+void irPassManagerInit(IrPassManager *pm);
+
+/**
+ * Free a pass manager.
+ *
+ * @param pm The pass manager to free.
+ **/
+void irPassManagerFree(IrPassManager *pm);
+
+/**
+ * Add a pass to the end of the pass list.
+ *
+ * @param pm The pass manager.
+ * @param pass The pass to add (not copied.)
+ **/
+void irPassManagerAdd(IrPassManager *pm, const IrPass *pass);
+
+/**
+ * Add the default passes (the passes that are always run before generating code.)
+ *
+ * @param pm The pass manager.
+ **/
+void irPassManagerAddDefaultPasses(IrPassManager *pm);
+
+/**
+ * Run the passes on all the functions of a module.
+ *
+ * @param pm The pass manager.
+ * @param m The module to run the passes on.
+ **/
+void irPassManagerRunOnModule(IrPassManager *pm, IrModule *m);
+
+/**
+ * Run the passes on all the functions of a program.
+ *
+ * @param pm The pass manager.
+ * @param prog The program to run the passes on.
+ **/
+void irPassManagerRunOnProgram(IrPassManager *pm, IrProgram *prog);
+
+/**
+ * Check that the IR of a function is well formed:
+ * every block ends with a single terminator, phis are at the start of blocks and have an operand
+ * for every predecessor, the predecessor lists match the terminators, and the use lists match the operands.
+ * Errors are printed to stderr.
+ *
+ * @param fn The function to check.
+ * @return true if the function is well formed, false if not.
+ **/
+bool irVerifyFunction(IrFunction *fn);
+
+/**
+ * Find a division by a constant zero (which irPassFoldConstants leaves for runtime).
+ * Run the default passes first to also find divisors that are only known to be zero after propagating constants.
+ *
+ * @param fn The function to search.
+ * @return The first such division, or NULL if there is none.
+ **/
+IrInstr *irFindDivisionByZero(IrFunction *fn);
+
+// The default passes.
+// Fold instructions (and phis) whose operands are constants, and branches on constant conditions.
+// Since locals are SSA values, this also propagates the locals that are known to be constant.
+// Integer arithmetic wraps around like in the generated code, and divisions by zero are left unfolded
+// (the typechecker reports them, see irFindDivisionByZero()).
+extern const IrPass irPassFoldConstants;
+extern const IrPass irPassRemoveUnreachableBlocks;
+extern const IrPass irPassRemoveTrivialPhis;
+extern const IrPass irPassSimplifyCfg;
+// Replace calls of a function to itself whose value is returned right away (including through the phis of
+// an exit block without defers) with jumps to the start of the function, so they run in constant stack space.
+// Tail calls to other functions with the same signature are marked (see IrInstr::as.tail) and generated
+// as guaranteed tail calls where the C compiler supports them.
+// Nothing is changed if the address of a stack slot can escape, since calls might use it.
+extern const IrPass irPassTailCalls;
+
+#endif // IR_PASS_H
@@ -0,0 +1,98 @@
+#ifndef MODULE_INTERFACE_H
+#define MODULE_INTERFACE_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Ast/Program.h"
+
+/**
+ * Module interface files.
+ * An interface holds everything other modules need from a module: its imports, its structs
+ * (fields & method signatures), its function signatures, and the types of its variables.
+ * The build driver writes one for every module it generates, and when a module and everything
+ * it imports are unchanged, the parser loads (memory maps) its interface instead of parsing its source
+ * (see parserSetModuleInterfaces()). Function bodies & initializers are not part of an interface,
+ * so modules loaded from one are never generated again.
+ *
+ * Format (all integers are little endian u32s, strings are a length followed by the bytes):
+ *   "ILCI" version name
+ *   import count, import names
+ *   struct count, structs: name, attributes, field count, fields (name type), method count, methods (function)
+ *   function count, functions: name, attributes, parameter count, parameters (name type), return type
+ *   variable count, variables: name type
+ * Types are a tag byte (InterfaceTypeTag) followed by the tag specific data.
+ * Attributes are a count followed by the attributes: type (a byte), name, has argument (a byte), argument (low & high u32s.)
+ * Fields are in declaration order since the layout of a struct depends on it.
+ **/
+
+#define MODULE_INTERFACE_EXTENSION ".ilci"
+#define MODULE_INTERFACE_VERSION 2
+
+typedef enum interface_type_tag {
+    IFACE_TYPE_PRIMITIVE, // TypeType (a byte.)
+    IFACE_TYPE_POINTER, // pointee type.
+    IFACE_TYPE_FUNCTION, // parameter count, parameter types, return type.
+    IFACE_TYPE_STRUCT // module name, struct name.
+} InterfaceTypeTag;
+
+typedef struct module_interface {
+    const u8 *data;
+    usize size;
+    usize offset;
+    bool failed; // Set when trying to read past the end of the interface.
+} ModuleInterface;
+
+/***
+ * Write the interface of a checked module.
+ * The interface is written to a temporary file and renamed into place.
+ *
+ * @param prog The checked ASTProgram [m] belongs to.
+ * @param m The checked module.
+ * @param path The path of the interface file.
+ * @return true on success, false on failure.
+ ***/
+bool moduleInterfaceWrite(ASTProgram *prog, ASTModule *m, const char *path);
+
+/***
+ * Map an interface file and check its header.
+ *
+ * @param mi The ModuleInterface to initialize.
+ * @param path The path of the interface file.
+ * @return true on success, false if the file can't be mapped or isn't a valid interface.
+ ***/
+bool moduleInterfaceOpen(ModuleInterface *mi, const char *path);
+
+/***
+ * Unmap an interface file.
+ *
+ * @param mi The ModuleInterface to close.
+ ***/
+void moduleInterfaceClose(ModuleInterface *mi);
+
+/***
+ * Read a byte.
+ *
+ * @param mi The ModuleInterface to read from.
+ * @return The byte, or 0 if there is nothing left to read (mi.failed is set.)
+ ***/
+u8 moduleInterfaceReadByte(ModuleInterface *mi);
+
+/***
+ * Read a u32.
+ *
+ * @param mi The ModuleInterface to read from.
+ * @return The value, or 0 if there is nothing left to read (mi.failed is set.)
+ ***/
+u32 moduleInterfaceReadU32(ModuleInterface *mi);
+
+/***
+ * Read a string.
+ * NOTE: The string is NOT nul-terminated and points into the mapped file.
+ *
+ * @param mi The ModuleInterface to read from.
+ * @param length Where to store the length of the string.
+ * @return The string, or an empty string if there is nothing left to read (mi.failed is set.)
+ ***/
+const char *moduleInterfaceReadString(ModuleInterface *mi, u32 *length);
+
+#endif // MODULE_INTERFACE_H
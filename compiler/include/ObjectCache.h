@@ -0,0 +1,79 @@
+#ifndef OBJECT_CACHE_H
+#define OBJECT_CACHE_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Strings.h"
+
+/**
+ * A local on-disk cache of compiled object files.
+ * Entries are addressed by a key (a hex digest of everything that affects the object,
+ * see driverBuild()) and stored as '<dir>/<first 2 key chars>/<rest of key>.o'.
+ *
+ * Entries are written to a temporary file and then renamed into place,
+ * so concurrent ilc processes never see partially written objects.
+ * Reading an entry updates its modification time, and objectCacheTrim()
+ * evicts the least recently used entries when the cache grows too big.
+ **/
+
+#define OBJECT_CACHE_DEFAULT_MAX_SIZE ((u64)512 * 1024 * 1024)
+
+typedef struct object_cache {
+    String dir;
+    u64 maxSize; // In bytes.
+    usize hits, misses, stores;
+} ObjectCache;
+
+/***
+ * Get the default cache directory:
+ * $ILC_CACHE_DIR, $XDG_CACHE_HOME/ilc, or $HOME/.cache/ilc (in that order.)
+ *
+ * @return The default cache directory (an owned String), or NULL if none of the variables are set.
+ ***/
+String objectCacheDefaultDir(void);
+
+/***
+ * Initialize an ObjectCache, creating its directory if needed.
+ *
+ * @param c The ObjectCache to initialize.
+ * @param dir The cache directory.
+ * @param maxSize The maximum size of the cache (in bytes).
+ * @return true on success, false if the directory couldn't be created (an error is printed.)
+ ***/
+bool objectCacheInit(ObjectCache *c, const char *dir, u64 maxSize);
+
+/***
+ * Free an ObjectCache.
+ *
+ * @param c The ObjectCache to free.
+ ***/
+void objectCacheFree(ObjectCache *c);
+
+/***
+ * Look up an object and copy it to [objectPath] if found.
+ *
+ * @param c The ObjectCache to use.
+ * @param key The key of the object.
+ * @param objectPath Where to copy the object to.
+ * @return true on a hit, false on a miss.
+ ***/
+bool objectCacheLookup(ObjectCache *c, const char *key, const char *objectPath);
+
+/***
+ * Store a copy of the object at [objectPath].
+ * NOTE: Failing to store an object isn't an error (the cache is only an optimization.)
+ *
+ * @param c The ObjectCache to use.
+ * @param key The key of the object.
+ * @param objectPath The object to store.
+ ***/
+void objectCacheStore(ObjectCache *c, const char *key, const char *objectPath);
+
+/***
+ * Evict the least recently used objects until the cache is within its maximum size.
+ *
+ * @param c The ObjectCache to trim.
+ ***/
+void objectCacheTrim(ObjectCache *c);
+
+#endif // OBJECT_CACHE_H
@@ -3,11 +3,21 @@
 
 #include "common.h"
 #include "Strings.h"
+#include "Array.h"
+#include "Table.h"
 #include "Compiler.h"
 #include "Scanner.h"
 #include "Token.h"
 #include "Ast/Program.h"
 
+// A function body that was skipped (see parserSetSkipBodies()).
+typedef struct skipped_body {
+    ASTObj *fn;
+    ModuleID module;
+    Scope *parentScope; // The scope the function was declared in.
+    Location start; // The location of the '{' token.
+} SkippedBody;
+
 typedef struct parser {
     Compiler *compiler;
     Scanner *scanner;
@@ -21,12 +31,23 @@ typedef struct parser {
 
     String tmp_buffer;
 
+    Table *interfaces; // Table<char *, char *> (module name -> interface path.) NULL if not set.
+    Array pendingInterfaces; // Array<ASTString> (modules to load from their interfaces.)
+    Table *skipBodies; // Table<char *, void *> (modules whose function bodies are skipped.) NULL if not set.
+    Array skippedBodies; // Array<SkippedBody *>
+
     struct {
         Token current_token;
         Token previous_token;
         bool had_error;
         bool need_sync;
         u32 idTypeCounter;
+        // The line at [offset] in [file] (see line_of() in Parser.c.)
+        struct {
+            FileID file;
+            usize offset;
+            u32 line;
+        } lines;
     } state;
 
     // Pointers to the primitive types in the current module
@@ -75,4 +96,44 @@ bool parserParse(Parser *p, ASTProgram *prog);
  **/
 void parserSetDumpTokens(Parser *p, bool dumpTokens);
 
+/**
+ * Load imported modules from interface files instead of parsing their source (see ModuleInterface.h).
+ * The interfaces are loaded after all the source files are parsed.
+ *
+ * @param p The parser to set the interfaces in.
+ * @param interfaces Table<char *, char *> (module name -> interface path.) NOT owned by the parser.
+ **/
+void parserSetModuleInterfaces(Parser *p, Table *interfaces);
+
+/**
+ * Skip the function bodies of the modules in [modules] instead of parsing them.
+ * A skipped body is matched by braces without building any AST nodes, and the function
+ * is left with a NULL body (like functions loaded from a module interface).
+ * This is for modules that are only needed for the declarations they export,
+ * the bodies can be parsed later if needed (see parserParseSkippedBodies()).
+ *
+ * @param p The parser to set the modules in.
+ * @param modules Table<char *, void *> (the keys are module names.) NOT owned by the parser.
+ **/
+void parserSetSkipBodies(Parser *p, Table *modules);
+
+/**
+ * Check if any function bodies of a module were skipped (see parserSetSkipBodies()).
+ *
+ * @param p The parser that parsed the module.
+ * @param module The name of the module.
+ * @return true if bodies were skipped, false if not.
+ **/
+bool parserHasSkippedBodies(Parser *p, ASTString module);
+
+/**
+ * Parse the function bodies of a module that were skipped (see parserSetSkipBodies()).
+ * The bodies are added to the parsed program, which has to be checked again.
+ *
+ * @param p The parser that parsed the program (parserParse() must have succeeded.)
+ * @param module The name of the module.
+ * @return true on success or false on failure (errors are in the Compiler provided to parserInit()).
+ **/
+bool parserParseSkippedBodies(Parser *p, ASTString module);
+
 #endif // PARSER_H
@@ -0,0 +1,88 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include <stdio.h> // FILE
+#include <stdbool.h>
+#include "common.h"
+#include "Array.h"
+#include "Table.h"
+#include "Ast/Program.h"
+
+/**
+ * Reachability finds everything the entry point ('main') can reach across all the modules
+ * of a program: the functions, methods & module variables it uses (directly or through other reachable
+ * code and initializers), and the struct & function types they need.
+ * The code generator uses it to leave out everything else (see codegenGenerate()).
+ *
+ * Note: Module variable initializers are constants (see Evaluator.h), so leaving out
+ *       unused module variables doesn't change the behavior of the program.
+ **/
+
+typedef struct reachability_count {
+    usize total, reachable;
+} ReachabilityCount;
+
+typedef struct reachability {
+    ASTProgram *program;
+    Table objects; // Table<ASTObj *, void> (reachable functions, methods, structs & module variables.)
+    Table types; // Table<Type *, void> (reachable types.)
+    Array worklist; // Array<ASTObj *> (reachable objects whose uses were not visited yet.)
+    struct {
+        ReachabilityCount functions; // Including methods.
+        ReachabilityCount structs;
+        ReachabilityCount functionTypes;
+        ReachabilityCount variables; // Module variables.
+    } counts;
+} Reachability;
+
+/**
+ * Initialize a Reachability.
+ *
+ * @param r The Reachability to initialize.
+ **/
+void reachabilityInit(Reachability *r);
+
+/**
+ * Free a Reachability.
+ *
+ * @param r The Reachability to free.
+ **/
+void reachabilityFree(Reachability *r);
+
+/**
+ * Find everything reachable from the entry point of a program.
+ *
+ * @param r The Reachability to use.
+ * @param prog The ASTProgram (MUST be checked & evaluated, and have an entry point.)
+ **/
+void reachabilityAnalyze(Reachability *r, ASTProgram *prog);
+
+/**
+ * Check if an object (function, method, struct or module variable) is reachable.
+ * NOTE: Safe to call from multiple threads once reachabilityAnalyze() returns.
+ *
+ * @param r The Reachability to use (after calling reachabilityAnalyze()).
+ * @param obj The object to check.
+ * @return true if [obj] is reachable, false if not.
+ **/
+bool reachabilityHasObject(Reachability *r, ASTObj *obj);
+
+/**
+ * Check if a type is reachable.
+ * NOTE: Safe to call from multiple threads once reachabilityAnalyze() returns.
+ *
+ * @param r The Reachability to use (after calling reachabilityAnalyze()).
+ * @param ty The type to check.
+ * @return true if [ty] is reachable, false if not.
+ **/
+bool reachabilityHasType(Reachability *r, Type *ty);
+
+/**
+ * Print how much of the program is unreachable (and left out of the generated code).
+ *
+ * @param to The stream to print to.
+ * @param r The Reachability to print the counts of (after calling reachabilityAnalyze()).
+ **/
+void reachabilityPrintSummary(FILE *to, Reachability *r);
+
+#endif // REACHABILITY_H
@@ -36,4 +36,15 @@ void scannerFree(Scanner *s);
  ***/
 Token scannerNextToken(Scanner *s);
 
+/***
+ * Continue scanning from an offset in a file that was already scanned.
+ * NOTE: After the end of the file, the scanner continues with the file after it.
+ *
+ * @param s An initialized Scanner.
+ * @param file The FileID of the file.
+ * @param offset The offset in the file to scan from.
+ * @return true on success, false if the file can't be read.
+ ***/
+bool scannerSetPosition(Scanner *s, FileID file, usize offset);
+
 #endif // SCANNER_H
@@ -0,0 +1,64 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include "common.h"
+
+/**
+ * SHA-256 (FIPS 180-4) for content addressing (e.g. the object cache).
+ **/
+
+#define SHA256_DIGEST_SIZE 32
+// The size of a nul-terminated hex digest.
+#define SHA256_HEX_SIZE (SHA256_DIGEST_SIZE * 2 + 1)
+
+typedef struct sha256 {
+    u32 state[8];
+    u64 length; // Total amount of bytes hashed.
+    u8 block[64];
+    usize blockLength;
+} Sha256;
+
+/***
+ * Initialize a Sha256 context.
+ *
+ * @param h The context to initialize.
+ ***/
+void sha256Init(Sha256 *h);
+
+/***
+ * Hash more data.
+ *
+ * @param h The context to use.
+ * @param data The data to hash.
+ * @param length The length of [data].
+ ***/
+void sha256Update(Sha256 *h, const void *data, usize length);
+
+/***
+ * Hash the size and contents of a file.
+ * The content is prefixed by its size, so the boundaries between consecutive files are unambiguous.
+ *
+ * @param h The context to use.
+ * @param path The path of the file to hash.
+ * @return true on success, false if the file couldn't be read.
+ ***/
+bool sha256UpdateFile(Sha256 *h, const char *path);
+
+/***
+ * Finish hashing and get the digest.
+ * NOTE: The context must be re-initialized before it can be used again.
+ *
+ * @param h The context to use.
+ * @param digest Where to store the digest.
+ ***/
+void sha256Final(Sha256 *h, u8 digest[SHA256_DIGEST_SIZE]);
+
+/***
+ * Finish hashing and get the digest as a nul-terminated lowercase hex string.
+ *
+ * @param h The context to use.
+ * @param hex Where to store the hex digest.
+ ***/
+void sha256FinalHex(Sha256 *h, char hex[SHA256_HEX_SIZE]);
+
+#endif // SHA256_H
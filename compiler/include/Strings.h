@@ -130,4 +130,14 @@ void stringVAppend(String *dest, const char *format, va_list ap);
  ***/
 void stringAppend(String *dest, const char *format, ...);
 
+/***
+ * Append [length] characters of [src] to [dest] (no formatting, no temporary allocations).
+ * NOTE: the string might be reallocated.
+ *
+ * @param dest the destination string.
+ * @param src the characters to append.
+ * @param length the amount of characters to append.
+ ***/
+void stringNAppend(String *dest, const char *src, size_t length);
+
 #endif // STRINGS_H
@@ -96,7 +96,7 @@ void tableCopy(Table *dest, Table *src);
 void tableDelete(Table *t, void *key);
 
 /***
- * Delete all items in a table.
+ * Delete all items in a table (the storage is kept for reuse).
  *
  * @param t An initialized table.
  * @param free_item_callback The callback to call on every item before deleting it (can be NULL).
@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "common.h"
+#include "Array.h"
+
+/**
+ * A fixed size pool of worker threads running tasks from a FIFO queue.
+ * Each task is passed the index of the worker running it (0..numWorkers-1)
+ * so callers can keep per-worker state without any locking.
+ **/
+
+typedef void (*ThreadPoolTaskFn)(void *arg, usize workerIndex);
+
+typedef struct thread_pool {
+    pthread_t *workers;
+    usize numWorkers;
+    pthread_mutex_t lock;
+    pthread_cond_t hasTasks; // Signaled when tasks are added (or when shutting down.)
+    pthread_cond_t allDone; // Signaled when there are no queued or running tasks.
+    Array tasks; // Array<ThreadPoolTask *> (queued tasks start at [nextTask].)
+    usize nextTask;
+    usize unfinishedTasks; // Queued + running tasks.
+    bool shuttingDown;
+} ThreadPool;
+
+/***
+ * Initialize a ThreadPool and start its workers.
+ *
+ * @param pool The ThreadPool to initialize.
+ * @param numWorkers The amount of worker threads (MUST be at least 1).
+ ***/
+void threadPoolInit(ThreadPool *pool, usize numWorkers);
+
+/***
+ * Wait for all the tasks to finish, stop the workers, and free a ThreadPool.
+ *
+ * @param pool The ThreadPool to free.
+ ***/
+void threadPoolFree(ThreadPool *pool);
+
+/***
+ * Queue a task.
+ *
+ * @param pool The ThreadPool to run the task on.
+ * @param fn The task function.
+ * @param arg The argument to pass to [fn].
+ ***/
+void threadPoolSubmit(ThreadPool *pool, ThreadPoolTaskFn fn, void *arg);
+
+/***
+ * Wait until all the queued tasks finished running.
+ *
+ * @param pool The ThreadPool to wait on.
+ ***/
+void threadPoolWait(ThreadPool *pool);
+
+/***
+ * Get the amount of online CPU cores (a good default amount of workers.)
+ *
+ * @return The amount of online cores (at least 1.)
+ ***/
+usize threadPoolDefaultSize(void);
+
+#endif // THREAD_POOL_H
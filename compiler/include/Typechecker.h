@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include "Ast/Program.h"
 #include "Compiler.h"
+#include "Table.h"
+#include "Array.h"
 
 typedef struct typechecker {
     Compiler *compiler;
@@ -16,6 +18,14 @@ typedef struct typechecker {
         ASTObj *function; // TODO: maybe change to current.object?
         ASTModule *module;
     } current;
+
+    Array divisions; // Array<ASTObj *> (OBJ_FN) The functions dividing by a non-constant divisor.
+
+    struct {
+        bool enabled;
+        Array *errors; // Array<Error *> (NULL when not collecting errors.)
+        Table deferredErrors; // Table<ASTObj * (OBJ_FN) | ASTModule *, Array<Error *> *>
+    } fused;
 } Typechecker;
 
 /**
@@ -35,6 +45,8 @@ void typecheckerFree(Typechecker *typechecker);
 
 /**
  * Typecheck an ASTProgram.
+ * Divisions by zero are reported even if the divisor is only known to be zero after
+ * propagating constants (the functions dividing by a variable are lowered to the IR to find them.)
  * C.R.E for 'prog' to be NULL.
  *
  * @param typechecker A Typechecker instance to use.
@@ -43,5 +55,57 @@ void typecheckerFree(Typechecker *typechecker);
  **/
 bool typecheckerTypecheck(Typechecker *typechecker, ASTProgram *prog);
 
+/*** Fused validation & typechecking ***
+ * In fused mode, the Validator typechecks each checked node right after creating it
+ * (see validatorSetFusedTypechecker()) so the program is only walked once.
+ * The resulting errors are stored per function (and per module for module variables),
+ * and typecheckerTypecheck() then only walks the declarations to report them in the
+ * same order the separate typechecking pass would.
+ ***/
+
+/**
+ * Enable fused mode.
+ * Note: MUST be called before validating.
+ *
+ * @param typechecker The Typechecker to use in fused mode.
+ **/
+void typecheckerEnableFused(Typechecker *typechecker);
+
+/**
+ * Set the module and function checked nodes belong to.
+ *
+ * @param typechecker A Typechecker in fused mode.
+ * @param module The module the following nodes belong to.
+ * @param function The function the following nodes belong to (NULL for module variables).
+ **/
+void typecheckerSetFusedContext(Typechecker *typechecker, ASTModule *module, ASTObj *function);
+
+/**
+ * Get a mark to pass to typecheckerCheckExprNode() or typecheckerCheckStmtNode().
+ * Should be taken before the children of the node are created.
+ *
+ * @param typechecker A Typechecker in fused mode.
+ * @return The mark.
+ **/
+usize typecheckerFusedMark(Typechecker *typechecker);
+
+/**
+ * Typecheck a single checked expression node (its children MUST already be checked).
+ *
+ * @param typechecker A Typechecker in fused mode.
+ * @param expr The node to typecheck.
+ * @param mark The mark taken before the children of [expr] were checked.
+ **/
+void typecheckerCheckExprNode(Typechecker *typechecker, ASTExprNode *expr, usize mark);
+
+/**
+ * Typecheck a single checked statement node (its children MUST already be checked).
+ *
+ * @param typechecker A Typechecker in fused mode.
+ * @param stmt The node to typecheck.
+ * @param mark The mark taken before the children of [stmt] were checked.
+ **/
+void typecheckerCheckStmtNode(Typechecker *typechecker, ASTStmtNode *stmt, usize mark);
+
 
 #endif // TYPECHECKER_H
@@ -5,11 +5,13 @@
 #include "Compiler.h"
 #include "Ast/Scope.h"
 #include "Ast/Program.h"
+#include "Typechecker.h"
 
 typedef struct validator {
     ASTProgram *parsedProgram;
     ASTProgram *checkedProgram;
     Compiler *compiler;
+    Typechecker *fusedTypechecker; // May be NULL (see validatorSetFusedTypechecker()).
     bool hadError;
     struct {
         // TODO: add comments specifiyng if each field may be NULL or invalid and when.
@@ -35,6 +37,15 @@ void validatorInit(Validator *v, Compiler *c);
  **/
 void validatorFree(Validator *v);
 
+/**
+ * Typecheck checked nodes as they are created instead of in a separate pass.
+ * typecheckerTypecheck() MUST still be called after validating to report the errors.
+ *
+ * @param v The Validator to use.
+ * @param typechecker The Typechecker to use (it is put in fused mode.)
+ **/
+void validatorSetFusedTypechecker(Validator *v, Typechecker *typechecker);
+
 /**
  * Validate an ASTProg.
  *
@@ -0,0 +1,55 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <stdbool.h>
+#include "common.h"
+#include "Array.h"
+#include "Table.h"
+
+/**
+ * Waits for source files to change (used by '--watch').
+ * The directories containing the files are watched using inotify (and not the files themselves),
+ * so files replaced by editors that write a new file and rename it into place are still noticed.
+ **/
+
+// How long to wait for more changes after a change (so saving many files triggers one rebuild.)
+#define WATCHER_SETTLE_MS 50
+
+typedef struct watcher {
+    int fd; // The inotify instance, -1 if there is none.
+    Table directories; // Table<int, String> (watch descriptor -> directory.)
+    Table files; // Table<char *, void *> (the watched files as "<directory>/<name>".)
+} Watcher;
+
+/***
+ * Initialize a Watcher.
+ *
+ * @param w The Watcher to initialize.
+ ***/
+void watcherInit(Watcher *w);
+
+/***
+ * Free a Watcher.
+ *
+ * @param w The Watcher to free.
+ ***/
+void watcherFree(Watcher *w);
+
+/***
+ * Set the files to watch (replacing the previous files).
+ *
+ * @param w The Watcher.
+ * @param paths Array<char *> the paths of the files.
+ * @return true on success, false on failure (an error is printed.)
+ ***/
+bool watcherSetFiles(Watcher *w, Array *paths);
+
+/***
+ * Wait until any of the watched files changes (is written, replaced, created or deleted).
+ *
+ * @param w The Watcher.
+ * @return true when a file changed, false on failure (an error is printed.)
+ ***/
+bool watcherWait(Watcher *w);
+
+#endif // WATCHER_H
@@ -0,0 +1,145 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include "common.h"
+
+/**
+ * A buffered output writer.
+ * Output is collected in a large owned buffer and written to a file descriptor
+ * using write()/writev() only when the buffer fills up (or when flushed),
+ * so emitting many small fragments doesn't go through stdio.
+ * A Writer can also collect all the output in memory (see writerInitMemory()).
+ **/
+
+#define WRITER_DEFAULT_CAPACITY (256 * 1024)
+
+typedef struct writer {
+    int fd; // -1 for in-memory Writers.
+    char *buffer;
+    usize length, capacity;
+    bool hadError; // Set if a write() failed. Output written after that is dropped.
+} Writer;
+
+/***
+ * Initialize a Writer.
+ *
+ * @param w The Writer to initialize.
+ * @param fd The file descriptor to write to (not owned by the Writer).
+ * @param capacity The size of the buffer (0 for WRITER_DEFAULT_CAPACITY).
+ ***/
+void writerInit(Writer *w, int fd, usize capacity);
+
+/***
+ * Initialize an in-memory Writer.
+ * The buffer grows as needed, and the output can be accessed using writerData().
+ *
+ * @param w The Writer to initialize.
+ * @param capacity The initial size of the buffer (0 for WRITER_DEFAULT_CAPACITY).
+ ***/
+void writerInitMemory(Writer *w, usize capacity);
+
+/***
+ * Get the output of an in-memory Writer.
+ * NOTE: The data is NOT nul-terminated, and is only valid until the next write.
+ *
+ * @param w An in-memory Writer.
+ * @param length Where to store the length of the output.
+ * @return The output collected so far.
+ ***/
+const char *writerData(Writer *w, usize *length);
+
+/***
+ * Discard the output collected by an in-memory Writer (the buffer is kept for reuse).
+ *
+ * @param w An in-memory Writer.
+ ***/
+void writerClear(Writer *w);
+
+/***
+ * Flush and free a Writer.
+ * NOTE: the file descriptor is NOT closed.
+ *
+ * @param w The Writer to free.
+ * @return true if all the output was written successfully, false otherwise.
+ ***/
+bool writerFree(Writer *w);
+
+/***
+ * Write all buffered output to the file descriptor.
+ * NOTE: Does nothing for in-memory Writers.
+ *
+ * @param w The Writer to flush.
+ * @return true on success, false on failure.
+ ***/
+bool writerFlush(Writer *w);
+
+/***
+ * Append [length] bytes of [data].
+ *
+ * @param w The Writer to use.
+ * @param data The data to append.
+ * @param length The length of [data].
+ ***/
+void writerWrite(Writer *w, const char *data, usize length);
+
+/***
+ * Append a string literal (its length is known at compile time).
+ *
+ * @param w The Writer to use.
+ * @param literal A string literal.
+ ***/
+#define writerWriteLiteral(w, literal) writerWrite((w), "" literal, sizeof(literal) - 1)
+
+/***
+ * Append a single character.
+ *
+ * @param w The Writer to use.
+ * @param c The character to append.
+ ***/
+void writerWriteChar(Writer *w, char c);
+
+/***
+ * Append a nul-terminated C string.
+ *
+ * @param w The Writer to use.
+ * @param s The string to append.
+ ***/
+void writerWriteCString(Writer *w, const char *s);
+
+/***
+ * Append the decimal representation of an unsigned integer.
+ *
+ * @param w The Writer to use.
+ * @param value The value to append.
+ ***/
+void writerWriteUnsigned(Writer *w, u64 value);
+
+/***
+ * Append the decimal representation of a signed integer.
+ *
+ * @param w The Writer to use.
+ * @param value The value to append.
+ ***/
+void writerWriteSigned(Writer *w, i64 value);
+
+/***
+ * Append formatted output (printf-like).
+ * NOTE: prefer the other functions when possible since they don't parse a format string.
+ *
+ * @param w The Writer to use.
+ * @param format The format string.
+ ***/
+void writerFormat(Writer *w, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/***
+ * Append formatted output (vprintf-like).
+ *
+ * @param w The Writer to use.
+ * @param format The format string.
+ * @param ap The format arguments.
+ ***/
+void writerVFormat(Writer *w, const char *format, va_list ap);
+
+#endif // WRITER_H
@@ -57,6 +57,21 @@ static inline size_t max(size_t a, size_t b) {
     return a > b ? a : b;
 }
 
+void arenaReset(Arena *a) {
+    // Replace all the blocks with a single one as big as all of them
+    // so allocating the same amount again doesn't allocate any blocks.
+    size_t size = 0;
+    for(Block *b = a->blocks; b; b = b->prev) {
+        size += b->size;
+    }
+    if(a->blocks->prev == NULL) {
+        a->blocks->used = 0;
+        return;
+    }
+    free_blocks(a->blocks);
+    a->blocks = new_block(max(size, ARENA_DEFAULT_BLOCK_SIZE), NULL);
+}
+
 void *arenaAlloc(Arena *a, size_t size) {
     size = (size + sizeof(union align) - 1) / sizeof(union align) * sizeof(union align);
     if(a->blocks->used + size > a->blocks->size) {
@@ -86,7 +86,7 @@ void *arrayDelete(Array *a, size_t index) {
     void *value = arrayGet(a, index);
 
     for(size_t i = index; i < a->used - 1; ++i) {
-        a->data[index] = a->data[index + 1];
+        a->data[i] = a->data[i + 1];
     }
     // Set last element (that is now empty) to NULL.
     a->data[--a->used] = NULL;
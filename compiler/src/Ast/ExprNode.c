@@ -25,6 +25,8 @@ static const char *node_name_to_string(ASTExprType t) {
         case EXPR_STRING_CONSTANT:
         case EXPR_BOOLEAN_CONSTANT:
             return "ASTConstantValueExpr";
+        case EXPR_STRUCT_CONSTANT:
+            return "ASTStructConstantExpr";
         case EXPR_VARIABLE:
         case EXPR_FUNCTION:
             return "ASTObjExpr";
@@ -66,6 +68,7 @@ static const char *node_type_to_string(ASTExprType t) {
         [EXPR_NUMBER_CONSTANT]  = "EXPR_NUMBER_CONSTANT",
         [EXPR_STRING_CONSTANT]  = "EXPR_STRING_CONSTANT",
         [EXPR_BOOLEAN_CONSTANT] = "EXPR_BOOLEAN_CONSTANT",
+        [EXPR_STRUCT_CONSTANT]  = "EXPR_STRUCT_CONSTANT",
         [EXPR_VARIABLE]         = "EXPR_VARIABLE",
         [EXPR_FUNCTION]         = "EXPR_FUNCTION",
         [EXPR_MODULE]           = "EXPR_MODULE",
@@ -124,6 +127,19 @@ void astExprPrint(FILE *to, ASTExprNode *n) {
         case EXPR_BOOLEAN_CONSTANT:
             fprintf(to, ", \x1b[1mvalue: \x1b[0;34m%s\x1b[0m", NODE_AS(ASTConstantValueExpr, n)->as.boolean ? "true" : "false");
             break;
+        case EXPR_STRUCT_CONSTANT: {
+            ASTStructConstantExpr *st = NODE_AS(ASTStructConstantExpr, n);
+            fputs(", \x1b[1mfields:\x1b[0m [", to);
+            ARRAY_FOR(i, st->fields) {
+                fprintf(to, "%s: ", ARRAY_GET_AS(ASTObj *, &st->fields, i)->name);
+                astExprPrint(to, ARRAY_GET_AS(ASTExprNode *, &st->values, i));
+                if(i + 1 < arrayLength(&st->fields)) {
+                    fputs(", ", to);
+                }
+            }
+            fputs("]", to);
+            break;
+        }
         case EXPR_VARIABLE:
         case EXPR_FUNCTION:
             fputs(", \x1b[1mobj:\x1b[0m ", to);
@@ -181,6 +197,14 @@ ASTConstantValueExpr *astConstantValueExprNew(Allocator *a, ASTExprType type, Lo
     return n;
 }
 
+ASTStructConstantExpr *astStructConstantExprNew(Allocator *a, Location loc, Type *structTy, usize fieldCount) {
+    ASTStructConstantExpr *n = allocatorAllocate(a, sizeof(*n));
+    n->header = make_header(EXPR_STRUCT_CONSTANT, loc, structTy);
+    arrayInitAllocatorSized(&n->fields, *a, fieldCount);
+    arrayInitAllocatorSized(&n->values, *a, fieldCount);
+    return n;
+}
+
 ASTObjExpr *astObjExprNew(Allocator *a, ASTExprType type, Location loc, ASTObj *obj) {
     VERIFY(obj != NULL);
     ASTObjExpr *n = allocatorAllocate(a, sizeof(*n));
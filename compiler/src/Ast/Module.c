@@ -95,6 +95,24 @@ void astModuleFree(ASTModule *module) {
     FREE(module);
 }
 
+static void free_type_item_callback(TableItem *item, void *cl) {
+    UNUSED(cl);
+    typeFree((Type *)item->value);
+}
+
+void astModuleReset(ASTModule *module, ASTString name) {
+    scopeFree(module->moduleScope);
+    module->moduleScope = scopeNew(NULL, SCOPE_DEPTH_MODULE_NAMESPACE);
+    arenaReset(&module->ast_allocator.storage);
+    arrayMap(&module->objectOwner, free_object_callback, NULL);
+    arrayClear(&module->objectOwner);
+    tableClear(&module->types, free_type_item_callback, NULL);
+    arrayClear(&module->variableDecls);
+    tableClear(&module->importedModules, NULL, NULL);
+    module->name = name;
+    module->id = 0;
+}
+
 Type *astModuleGetType(ASTModule *module, const char *name) {
     TableItem *item = tableGet(&module->types, (void *)name);
     return item ? (Type *)item->value : NULL;
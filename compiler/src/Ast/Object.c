@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h> // strcmp()
 #include "common.h"
 #include "memory.h"
 #include "Ast/Ast.h"
@@ -13,6 +14,38 @@ static inline const char *obj_type_to_string(ASTObjType type) {
     return names[(int)type];
 }
 
+// Indexed by ASTAttributeType.
+static const char *attribute_names[] = {
+    [ATTR_UNKNOWN]  = NULL,
+    [ATTR_INLINE]   = "inline",
+    [ATTR_NOINLINE] = "noinline",
+    [ATTR_HOT]      = "hot",
+    [ATTR_COLD]     = "cold",
+    [ATTR_PURE]     = "pure",
+    [ATTR_CONST]    = "const",
+    [ATTR_NORETURN] = "noreturn",
+    [ATTR_ALIGNED]  = "aligned"
+};
+
+ASTAttribute *astAttributeNew(Allocator *a, ASTAttributeType type, Location loc, ASTString name) {
+    ASTAttribute *attr = allocatorAllocate(a, sizeof(*attr));
+    attr->type = type;
+    attr->location = loc;
+    attr->name = name;
+    attr->hasArgument = false;
+    attr->argument = 0;
+    return attr;
+}
+
+ASTAttributeType astAttributeTypeFromName(const char *name) {
+    for(int i = ATTR_UNKNOWN + 1; i < ATTR_TYPE_COUNT; ++i) {
+        if(strcmp(attribute_names[i], name) == 0) {
+            return (ASTAttributeType)i;
+        }
+    }
+    return ATTR_UNKNOWN;
+}
+
 void astObjectPrint(FILE *to, ASTObj *obj, bool compact) {
     if(!obj) {
         fputs("(null)", to);
@@ -69,9 +102,11 @@ ASTObj *astObjectNew(ASTObjType type, Location loc, ASTString name, Type *dataTy
             break;
         case OBJ_FN:
             arrayInit(&obj->as.fn.parameters);
+            arrayInit(&obj->attributes);
             break;
         case OBJ_STRUCT:
-            // nothing
+            arrayInit(&obj->as.structure.fields);
+            arrayInit(&obj->attributes);
             break;
         default:
             UNREACHABLE();
@@ -80,6 +115,16 @@ ASTObj *astObjectNew(ASTObjType type, Location loc, ASTString name, Type *dataTy
     return obj;
 }
 
+ASTAttribute *astObjectGetAttribute(ASTObj *obj, ASTAttributeType type) {
+    ARRAY_FOR(i, obj->attributes) {
+        ASTAttribute *attr = ARRAY_GET_AS(ASTAttribute *, &obj->attributes, i);
+        if(attr->type == type) {
+            return attr;
+        }
+    }
+    return NULL;
+}
+
 //static void free_object_callback(void *object, void *cl) {
 //    UNUSED(cl);
 //    astObjectFree((ASTObj *)object);
@@ -95,9 +140,13 @@ void astObjectFree(ASTObj *obj) {
             //      objects here we will double free OBJ_VARs refering to parameters.
             //arrayMap(&obj->as.fn.parameters, free_object_callback, NULL);
             arrayFree(&obj->as.fn.parameters);
+            // Note: the attributes themselves are owned by the allocator of the module.
+            arrayFree(&obj->attributes);
             break;
         case OBJ_STRUCT:
-            // nothing
+            // Note: the fields are owned and freed by ASTModules (like the parameters of functions.)
+            arrayFree(&obj->as.structure.fields);
+            arrayFree(&obj->attributes);
             break;
         default:
             UNREACHABLE();
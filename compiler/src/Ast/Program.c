@@ -48,18 +48,39 @@ void astProgramPrint(FILE *to, ASTProgram *prog) {
 void astProgramInit(ASTProgram *prog, StringTable *st) {
     arrayInit(&prog->modules);
     tableInit(&prog->moduleIDToIdx, hashModuleId, cmpModuleId);
+    arrayInit(&prog->unusedModules);
     prog->strings = st;
 }
 
 void astProgramFree(ASTProgram *prog) {
     arrayMap(&prog->modules, free_module_callback, NULL);
     arrayFree(&prog->modules);
+    arrayMap(&prog->unusedModules, free_module_callback, NULL);
+    arrayFree(&prog->unusedModules);
     // nothing to free here
     tableFree(&prog->moduleIDToIdx);
 }
 
+void astProgramClear(ASTProgram *prog) {
+    ARRAY_FOR(i, prog->modules) {
+        arrayPush(&prog->unusedModules, arrayGet(&prog->modules, i));
+    }
+    arrayClear(&prog->modules);
+    tableClear(&prog->moduleIDToIdx, NULL, NULL);
+}
+
+// Create a module, reusing a module removed by astProgramClear() if there is one.
+static ASTModule *new_module(ASTProgram *prog, ASTString name) {
+    if(arrayLength(&prog->unusedModules) > 0) {
+        ASTModule *m = ARRAY_POP_AS(ASTModule *, &prog->unusedModules);
+        astModuleReset(m, name);
+        return m;
+    }
+    return astModuleNew(name);
+}
+
 ModuleID astProgramNewModule(ASTProgram *prog, ASTString name) {
-    ASTModule *m = astModuleNew(name);
+    ASTModule *m = new_module(prog, name);
     usize actualIdx = arrayPush(&prog->modules, (void *)m);
     tableSet(&prog->moduleIDToIdx, (void *)actualIdx, (void *)actualIdx);
     m->id = actualIdx;
@@ -69,7 +90,7 @@ ModuleID astProgramNewModule(ASTProgram *prog, ASTString name) {
 }
 
 void astProgramNewModuleWithID(ASTProgram *prog, ModuleID id, ASTString name) {
-    ASTModule *m = astModuleNew(name);
+    ASTModule *m = new_module(prog, name);
     m->id = id;
     usize actualIdx = arrayPush(&prog->modules, (void *)m);
     tableSet(&prog->moduleIDToIdx, (void *)id, (void *)actualIdx);
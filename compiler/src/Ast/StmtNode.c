@@ -149,6 +149,8 @@ ASTConditionalStmt *astConditionalStmtNew(Allocator *a, ASTStmtType type, Locati
     n->condition = cond;
     n->then = then;
     n->else_ = else_;
+    n->file = NULL;
+    n->line = 0;
     return n;
 }
 
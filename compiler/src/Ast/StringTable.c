@@ -1,35 +1,107 @@
 #include <stdarg.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "common.h"
-#include "Table.h"
+#include "memory.h"
 #include "Strings.h"
 #include "Ast/StringTable.h"
 
 /* Helper functions */
 
-static void free_string_callback(TableItem *item, bool is_last, void *cl) {
-    UNUSED(is_last);
-    UNUSED(cl);
-    stringFree((String)item->key);
+// FNV-1a hashing algorithm (like the one Table uses.)
+static unsigned hash_string(const char *s, usize length) {
+    unsigned hash = 2166136261u;
+    for(usize i = 0; i < length; ++i) {
+        hash ^= (char)s[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+// The low bits of the hash pick the slot, so the high bits pick the shard.
+static inline StringTableShard *shard_for(StringTable *st, unsigned hash) {
+    return &st->shards[(hash >> 24) % STRING_TABLE_SHARDS];
+}
+
+static StringTableSlots *new_slots(usize capacity, StringTableSlots *previous) {
+    StringTableSlots *slots = CALLOC(1, sizeof(*slots) + sizeof(StringTableSlot) * capacity);
+    slots->capacity = capacity;
+    slots->previous = previous;
+    for(usize i = 0; i < capacity; ++i) {
+        atomic_init(&slots->slots[i].string, NULL);
+    }
+    return slots;
+}
+
+// Lock-free: the slots are only read after their string is published.
+static ASTString find(StringTableSlots *slots, const char *s, usize length, unsigned hash) {
+    usize mask = slots->capacity - 1;
+    for(usize i = hash & mask;; i = (i + 1) & mask) {
+        StringTableSlot *slot = &slots->slots[i];
+        ASTString string = atomic_load_explicit(&slot->string, memory_order_acquire);
+        if(string == NULL) {
+            return NULL;
+        }
+        if(slot->hash == hash && stringLength(string) == length && memcmp(string, s, length) == 0) {
+            return string;
+        }
+    }
+}
+
+// Must be called with the lock of the shard the slots belong to held.
+static void insert(StringTableSlots *slots, ASTString string, unsigned hash) {
+    usize mask = slots->capacity - 1;
+    usize i = hash & mask;
+    while(atomic_load_explicit(&slots->slots[i].string, memory_order_relaxed) != NULL) {
+        i = (i + 1) & mask;
+    }
+    slots->slots[i].hash = hash;
+    // Publish the string only after the hash is set.
+    atomic_store_explicit(&slots->slots[i].string, string, memory_order_release);
 }
 
-static void print_string_callback(TableItem *item, bool is_last, void *stream) {
-    FILE *to = (FILE *)stream;
-    fprintf(to, "\"%s\"", (char *)item->key);
-    if(!is_last) {
-        fputs(", ", to);
+// Must be called with the lock of [shard] held.
+static void grow(StringTableShard *shard) {
+    StringTableSlots *old = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+    StringTableSlots *slots = new_slots(old->capacity * 2, old);
+    for(usize i = 0; i < old->capacity; ++i) {
+        StringTableSlot *slot = &old->slots[i];
+        ASTString string = atomic_load_explicit(&slot->string, memory_order_relaxed);
+        if(string != NULL) {
+            insert(slots, string, slot->hash);
+        }
     }
+    atomic_store_explicit(&shard->slots, slots, memory_order_release);
 }
 
-// Note: takes ownership of [str].
-static ASTString add_string(Table *strings, String str) {
-    TableItem *item;
-    if((item = tableGet(strings, (void *)str)) != NULL) {
-        stringFree(str);
-        return (ASTString)item->key;
+// Find [s] or add it. If [owned] isn't NULL it is the String to add ([s] itself), and it is freed if it isn't needed.
+static ASTString intern(StringTable *st, const char *s, usize length, String owned) {
+    unsigned hash = hash_string(s, length);
+    StringTableShard *shard = shard_for(st, hash);
+    ASTString string = find(atomic_load_explicit(&shard->slots, memory_order_acquire), s, length, hash);
+    if(string == NULL) {
+        pthread_mutex_lock(&shard->lock);
+        // Another thread might have added it (or grown the shard) since it was looked up.
+        StringTableSlots *slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+        string = find(slots, s, length, hash);
+        if(string == NULL) {
+            // Keep the load factor at most 0.5 so probing always finds an empty slot quickly.
+            if((shard->used + 1) * 2 > slots->capacity) {
+                grow(shard);
+                slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+            }
+            string = owned ? (ASTString)owned : (ASTString)stringNCopy(s, length);
+            owned = NULL;
+            insert(slots, string, hash);
+            shard->used++;
+        }
+        pthread_mutex_unlock(&shard->lock);
     }
-    tableSet(strings, (void *)str, NULL);
-    return (ASTString)str; // cast is uneccesary, only used to signify that from now on the string is an ASTString.
+    if(owned) {
+        stringFree(owned);
+    }
+    return string;
 }
 
 
@@ -42,22 +114,58 @@ void stringTablePrint(FILE *to, StringTable *st) {
     }
 
     fputs("StringTable{", to);
-    tableMap(&st->strings, print_string_callback, (void *)to);
+    bool first = true;
+    for(usize i = 0; i < STRING_TABLE_SHARDS; ++i) {
+        StringTableSlots *slots = atomic_load_explicit(&st->shards[i].slots, memory_order_acquire);
+        for(usize j = 0; j < slots->capacity; ++j) {
+            ASTString string = atomic_load_explicit(&slots->slots[j].string, memory_order_acquire);
+            if(string == NULL) {
+                continue;
+            }
+            if(!first) {
+                fputs(", ", to);
+            }
+            fprintf(to, "\"%s\"", string);
+            first = false;
+        }
+    }
     fputc('}', to);
 }
 
 void stringTableInit(StringTable *st) {
-    tableInit(&st->strings, NULL, NULL);
+    for(usize i = 0; i < STRING_TABLE_SHARDS; ++i) {
+        StringTableShard *shard = &st->shards[i];
+        atomic_init(&shard->slots, new_slots(STRING_TABLE_SHARD_INITIAL_CAPACITY, NULL));
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->used = 0;
+    }
 }
 
 void stringTableFree(StringTable *st) {
-    tableMap(&st->strings, free_string_callback, NULL);
-    tableFree(&st->strings);
+    for(usize i = 0; i < STRING_TABLE_SHARDS; ++i) {
+        StringTableShard *shard = &st->shards[i];
+        StringTableSlots *slots = atomic_load_explicit(&shard->slots, memory_order_relaxed);
+        // Only the current slots own the strings (the previous ones have the same strings.)
+        for(usize j = 0; j < slots->capacity; ++j) {
+            ASTString string = atomic_load_explicit(&slots->slots[j].string, memory_order_relaxed);
+            if(string != NULL) {
+                stringFree(string);
+            }
+        }
+        while(slots) {
+            StringTableSlots *previous = slots->previous;
+            FREE(slots);
+            slots = previous;
+        }
+        atomic_store_explicit(&shard->slots, NULL, memory_order_relaxed);
+        pthread_mutex_destroy(&shard->lock);
+        shard->used = 0;
+    }
 }
 
 ASTString stringTableString(StringTable *st, char *str) {
-    String s = stringNCopy(str, strlen(str));
-    return add_string(&st->strings, s);
+    // The string is only copied if it has to be added.
+    return intern(st, str, strlen(str), NULL);
 }
 
 ASTString stringTableFormat(StringTable *st, const char *format, ...) {
@@ -66,5 +174,5 @@ ASTString stringTableFormat(StringTable *st, const char *format, ...) {
     String str = stringVFormat(format, ap);
     va_end(ap);
 
-    return add_string(&st->strings, str);
+    return intern(st, str, stringLength(str), str);
 }
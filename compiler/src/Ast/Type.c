@@ -93,6 +93,7 @@ Type *typeNew(TypeType type, ASTString name, Location declLocation, ModuleID dec
             break;
         case TY_STRUCT:
             arrayInit(&ty->as.structure.fieldTypes);
+            ty->as.structure.alignment = 0;
             break;
         case TY_SCOPE_RESOLUTION:
             arrayInit(&ty->as.scopeResolution.path);
@@ -191,3 +192,14 @@ bool typeIsPrimitive(Type *ty) {
     }
     return false;
 }
+
+u64 typeWrapInteger(Type *ty, u64 value) {
+    switch(ty->type) {
+        case TY_I32:
+            return (u64)(i64)(i32)(u32)value;
+        case TY_U32:
+            return (u64)(u32)value;
+        default:
+            UNREACHABLE();
+    }
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <string.h> // strlen(), strcmp(), strspn(), strcspn()
+#include <unistd.h> // unlink()
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Strings.h"
+#include "Sha256.h"
+#include "BuildState.h"
+
+#define BUILD_STATE_MAGIC "ilc-build-state 1"
+
+void buildStateInit(BuildState *s) {
+    s->config[0] = '\0';
+    arrayInit(&s->modules);
+    tableInit(&s->moduleIndex, NULL, NULL);
+}
+
+static void free_module_state(ModuleState *m) {
+    ARRAY_FOR(i, m->imports) {
+        ImportState *import = ARRAY_GET_AS(ImportState *, &m->imports, i);
+        stringFree(import->name);
+        FREE(import);
+    }
+    arrayFree(&m->imports);
+    stringFree(m->name);
+    stringFree(m->path);
+    FREE(m);
+}
+
+void buildStateFree(BuildState *s) {
+    tableFree(&s->moduleIndex);
+    ARRAY_FOR(i, s->modules) {
+        free_module_state(ARRAY_GET_AS(ModuleState *, &s->modules, i));
+    }
+    arrayFree(&s->modules);
+}
+
+ModuleState *buildStateAddModule(BuildState *s, const char *name, const char *path) {
+    VERIFY(buildStateGetModule(s, name) == NULL);
+    ModuleState *m;
+    NEW0(m);
+    m->name = stringCopy(name);
+    m->path = stringCopy(path);
+    m->sourceHash[0] = '\0';
+    m->interfaceHash[0] = '\0';
+    arrayInit(&m->imports);
+    arrayPush(&s->modules, (void *)m);
+    tableSet(&s->moduleIndex, (void *)m->name, (void *)m);
+    return m;
+}
+
+void moduleStateAddImport(ModuleState *m, const char *name, const char *interfaceHash) {
+    ImportState *import;
+    NEW0(import);
+    import->name = stringCopy(name);
+    VERIFY(strlen(interfaceHash) < SHA256_HEX_SIZE);
+    strcpy(import->interfaceHash, interfaceHash);
+    arrayPush(&m->imports, (void *)import);
+}
+
+ModuleState *buildStateGetModule(BuildState *s, const char *name) {
+    TableItem *item = tableGet(&s->moduleIndex, (void *)name);
+    return item ? (ModuleState *)item->value : NULL;
+}
+
+// Split the next space-separated field off [*line].
+// Returns NULL if there are no more fields.
+static char *next_field(char **line) {
+    char *field = *line + strspn(*line, " ");
+    if(*field == '\0') {
+        return NULL;
+    }
+    usize length = strcspn(field, " ");
+    *line = field + length;
+    if(**line != '\0') {
+        *(*line)++ = '\0';
+    }
+    return field;
+}
+
+static bool is_hash(const char *s) {
+    return s && strlen(s) == SHA256_HEX_SIZE - 1;
+}
+
+// Parse a state file. On failure, [s] may be partially filled.
+static bool parse_state_file(BuildState *s, FILE *fp) {
+    char *line = NULL;
+    usize capacity = 0;
+    isize length;
+    bool success = true, first = true;
+    ModuleState *current = NULL;
+    while(success && (length = getline(&line, &capacity, fp)) >= 0) {
+        if(length > 0 && line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+        if(first) {
+            success = strcmp(line, BUILD_STATE_MAGIC) == 0;
+            first = false;
+            continue;
+        }
+        char *rest = line;
+        char *kind = next_field(&rest);
+        if(kind == NULL) {
+            continue;
+        } else if(strcmp(kind, "config") == 0) {
+            char *config = next_field(&rest);
+            success = is_hash(config);
+            if(success) {
+                strcpy(s->config, config);
+            }
+        } else if(strcmp(kind, "module") == 0) {
+            // module <name> <source hash> <interface hash> <path (the rest of the line)>
+            char *name = next_field(&rest);
+            char *sourceHash = next_field(&rest);
+            char *interfaceHash = next_field(&rest);
+            success = name && is_hash(sourceHash) && is_hash(interfaceHash) && *rest != '\0' && buildStateGetModule(s, name) == NULL;
+            if(success) {
+                current = buildStateAddModule(s, name, rest);
+                strcpy(current->sourceHash, sourceHash);
+                strcpy(current->interfaceHash, interfaceHash);
+            }
+        } else if(strcmp(kind, "import") == 0) {
+            // import <name> <interface hash>
+            char *name = next_field(&rest);
+            char *interfaceHash = next_field(&rest);
+            success = current && name && is_hash(interfaceHash);
+            if(success) {
+                moduleStateAddImport(current, name, interfaceHash);
+            }
+        } else {
+            success = false;
+        }
+    }
+    free(line);
+    return success && !first && !ferror(fp);
+}
+
+bool buildStateLoad(BuildState *s, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if(!fp) {
+        return false;
+    }
+    bool success = parse_state_file(s, fp);
+    fclose(fp);
+    if(!success) {
+        buildStateFree(s);
+        buildStateInit(s);
+    }
+    return success;
+}
+
+bool buildStateSave(BuildState *s, const char *path) {
+    String tmp = stringFormat("%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if(!fp) {
+        stringFree(tmp);
+        return false;
+    }
+    fprintf(fp, BUILD_STATE_MAGIC "\n");
+    fprintf(fp, "config %s\n", s->config);
+    ARRAY_FOR(i, s->modules) {
+        ModuleState *m = ARRAY_GET_AS(ModuleState *, &s->modules, i);
+        fprintf(fp, "module %s %s %s %s\n", m->name, m->sourceHash, m->interfaceHash, m->path);
+        ARRAY_FOR(j, m->imports) {
+            ImportState *import = ARRAY_GET_AS(ImportState *, &m->imports, j);
+            fprintf(fp, "import %s %s\n", import->name, import->interfaceHash);
+        }
+    }
+    bool success = !ferror(fp);
+    success = fclose(fp) == 0 && success;
+    success = success && rename(tmp, path) == 0;
+    if(!success) {
+        unlink(tmp);
+    }
+    stringFree(tmp);
+    return success;
+}
+
+bool buildStateHashSource(const char *path, char hash[SHA256_HEX_SIZE]) {
+    Sha256 h;
+    sha256Init(&h);
+    if(!sha256UpdateFile(&h, path)) {
+        return false;
+    }
+    sha256FinalHex(&h, hash);
+    return true;
+}
+
+bool buildStateSourcesUnchanged(BuildState *s) {
+    if(arrayLength(&s->modules) == 0) {
+        return false;
+    }
+    ARRAY_FOR(i, s->modules) {
+        ModuleState *m = ARRAY_GET_AS(ModuleState *, &s->modules, i);
+        char hash[SHA256_HEX_SIZE];
+        if(!buildStateHashSource(m->path, hash) || strcmp(hash, m->sourceHash) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -1,5 +1,9 @@
 #include <stdio.h> // FILE
-#include <stdarg.h>
+#include <string.h> // strerror(), memcmp()
+#include <errno.h>
+#include <fcntl.h> // open()
+#include <unistd.h> // read(), close()
+#include <sys/stat.h> // mkdir(), fstat()
 #include "Array.h"
 #include "Ast/ExprNode.h"
 #include "Ast/Object.h"
@@ -11,6 +15,12 @@
 #include "Strings.h"
 #include "Ast/Ast.h"
 #include "memory.h"
+#include "Writer.h"
+#include "ThreadPool.h"
+#include "Sha256.h"
+#include "Ir/Ir.h"
+#include "Ir/Lower.h"
+#include "Ir/Pass.h"
 #include "Codegen.h"
 
 /**
@@ -19,6 +29,7 @@
  * like this for example:
  * | typedef void (*fn0)(int, int);
  * would declare 'fn0' as the type for 'fn(i32, i32) -> void'
+ * The actual typenames are derived from a hash of the type's signature (see nameFunctionTypes()).
  *
  * All module scope ("global") IDs are a bit tricky since C doesn't have different namespaces per "module".
  * To work around this, "global" IDs are mangled.
@@ -29,36 +40,49 @@
  *  2) Bound functions (methods): moduleXX_struct_<typename>_method_<name>
  * The mangled IDs are cached in a ModuleID-indexed array named "CNames" which contains structs with 2 tables:
  * one for module scope objects, and one for methods.
+ *
+ * Modules can be generated in parallel (see runModuleTasks()). Every worker has its own Codegen
+ * (so its own buffers and CNames cache), and the output of each module is collected separately
+ * and written in module order so the output doesn't depend on the amount of workers.
+ * Function typenames are the only names shared between the workers. They are assigned
+ * before any code is generated (see nameFunctionTypes()) and are read-only afterwards.
  **/
 
 typedef struct codegen {
-    FILE *output;
+    Writer *output; // The Writer for the file currently being generated.
     ASTProgram *program;
-    Table fnTypes; // Table<ASTString, ASTString> (typename, C typename)
-    unsigned fnTypenameCounter;
+    Table *fnTypes; // ModuleID-indexed array of Table<ASTString, ASTString> (typename, C typename). Shared & read-only.
     String idBuffer;
     bool isInCall; // For proper method call generation.
     ASTObj *currentFn;
     ASTModule *currentModule;
-    Array defersInCurrentFn; // Array<ASTStmtNode *>
+    IrModule *ir; // The IR of the current module.
     struct {
-        Table globals; // Table<ASTString, ASTString> (name->CName)
-        Table methods; // Table<ASTString, ASTString> (name->CName)
+        Table globals; // Table<ASTString, String> (name->CName)
+        Table methods; // Table<ASTString, String> (name->CName)
     } *CNames;
     size_t numCNames;
     ASTObj *mainFn;
+    Reachability *reachable; // NULL if everything is generated. Shared & read-only.
+    bool wholeProgram; // Generating the whole program as a single translation unit (see genFunctionSpecifiers()).
+    bool expectChecks; // See irLowerModule().
 } Codegen;
 
-static void print(Codegen *cg, const char *format, ...) {
-    va_list ap;
-    va_start(ap, format);
-    vfprintf(cg->output, format, ap);
-    va_end(ap);
+// Output helpers. Note: no format string parsing is done, so there is no print().
+#define printLiteral(cg, literal) writerWriteLiteral((cg)->output, literal)
+
+static inline void printString(Codegen *cg, String s) {
+    writerWrite(cg->output, s, stringLength(s));
 }
 
-// Note: [prefix] & [postfix] can be NULL if not needed.
-static void genInternalID(Codegen *cg, const char *name, const char *prefix, const char *postfix) {
-    print(cg, "%s___ilc_internal__%s%s", prefix ? prefix : "", name, postfix ? postfix : "");
+// Generates '___ilc_internal__<name><id><postfix>'. Note: [postfix] can be NULL if not needed.
+static void genInternalID(Codegen *cg, const char *name, u32 id, const char *postfix) {
+    printLiteral(cg, "___ilc_internal__");
+    writerWriteCString(cg->output, name);
+    writerWriteUnsigned(cg->output, id);
+    if(postfix) {
+        writerWriteCString(cg->output, postfix);
+    }
 }
 
 /**
@@ -68,30 +92,33 @@ static void genInternalID(Codegen *cg, const char *name, const char *prefix, con
 static void genModuleScopeID(Codegen *cg, ModuleID module, ASTObjType type, ASTString name) {
     TableItem *item = NULL;
     if((item = tableGet(&cg->CNames[module].globals, (void *)name)) != NULL) {
-        print(cg, "%s", item->value);
+        printString(cg, (String)item->value);
         return;
     }
     // format: moduleXX_{var/fn/struct}_<name>
     ASTModule *m = astProgramGetModule(cg->program, module);
     stringClear(cg->idBuffer);
-    stringAppend(&cg->idBuffer, "module%s_", m->name);
+    #define APPEND_LITERAL(literal) stringNAppend(&cg->idBuffer, literal, sizeof(literal) - 1)
+    APPEND_LITERAL("module");
+    stringNAppend(&cg->idBuffer, m->name, stringLength(m->name));
     switch(type) {
         case OBJ_VAR:
-            stringAppend(&cg->idBuffer, "var");
+            APPEND_LITERAL("_var_");
             break;
         case OBJ_FN:
-            stringAppend(&cg->idBuffer, "fn");
+            APPEND_LITERAL("_fn_");
             break;
         case OBJ_STRUCT:
-            stringAppend(&cg->idBuffer, "struct");
+            APPEND_LITERAL("_struct_");
             break;
         default:
             UNREACHABLE();
     }
-    stringAppend(&cg->idBuffer, "_%s", name);
-    // FIXME: stringTableString() uses normal strlen(), which is unnecessary since String keeps track of length in its header.
-    tableSet(&cg->CNames[module].globals, (void *)name, (void *)stringTableString(cg->program->strings, cg->idBuffer));
-    print(cg, "%s", cg->idBuffer);
+    #undef APPEND_LITERAL
+    stringNAppend(&cg->idBuffer, name, stringLength(name));
+    // Note: The StringTable isn't used since it is shared between the workers.
+    tableSet(&cg->CNames[module].globals, (void *)name, (void *)stringDuplicate(cg->idBuffer));
+    printString(cg, cg->idBuffer);
 }
 
 static void genMethodID(Codegen *cg, ASTObj *obj) {
@@ -99,17 +126,33 @@ static void genMethodID(Codegen *cg, ASTObj *obj) {
     VERIFY(obj->parent != NULL);
     TableItem *item = NULL;
     if((item = tableGet(&cg->CNames[obj->ownerModule].methods, (void *)obj->name)) != NULL) {
-        print(cg, "%s", item->value);
+        printString(cg, (String)item->value);
         return;
     }
     // format: moduleXX_{struct/type}_<typename>_method_<name>
     ASTModule *m = astProgramGetModule(cg->program, obj->ownerModule);
     ASTObj *parent = obj->parent;
     stringClear(cg->idBuffer);
-    stringAppend(&cg->idBuffer, "module%s_struct_%s_method_%s", m->name, parent->name, obj->name);
-    // FIXME: stringTableString() uses normal strlen(), which is unnecessary since String keeps track of length in its header.
-    tableSet(&cg->CNames[obj->ownerModule].methods, (void *)obj->name, (void *)stringTableString(cg->program->strings, cg->idBuffer));
-    print(cg, "%s", cg->idBuffer);
+    #define APPEND_LITERAL(literal) stringNAppend(&cg->idBuffer, literal, sizeof(literal) - 1)
+    APPEND_LITERAL("module");
+    stringNAppend(&cg->idBuffer, m->name, stringLength(m->name));
+    APPEND_LITERAL("_struct_");
+    stringNAppend(&cg->idBuffer, parent->name, stringLength(parent->name));
+    APPEND_LITERAL("_method_");
+    stringNAppend(&cg->idBuffer, obj->name, stringLength(obj->name));
+    #undef APPEND_LITERAL
+    // Note: The StringTable isn't used since it is shared between the workers.
+    tableSet(&cg->CNames[obj->ownerModule].methods, (void *)obj->name, (void *)stringDuplicate(cg->idBuffer));
+    printString(cg, cg->idBuffer);
+}
+
+// Objects (and types) that can't be reached from the entry point aren't generated (see Reachability.h).
+static inline bool isReachable(Codegen *cg, ASTObj *obj) {
+    return cg->reachable == NULL || reachabilityHasObject(cg->reachable, obj);
+}
+
+static inline bool isTypeReachable(Codegen *cg, Type *ty) {
+    return cg->reachable == NULL || reachabilityHasType(cg->reachable, ty);
 }
 
 static void genType(Codegen *cg, Type *ty) {
@@ -119,16 +162,18 @@ static void genType(Codegen *cg, Type *ty) {
         case TY_U32:
         case TY_STR:
         case TY_BOOL:
-            print(cg, "%s", ty->name);
+            printString(cg, ty->name);
             break;
         case TY_POINTER:
             genType(cg, ty->as.ptr.innerType);
-            print(cg, "*");
+            printLiteral(cg, "*");
             break;
             case TY_FUNCTION: {
-                TableItem *item = tableGet(&cg->fnTypes, (void *)ty->name);
+                // Note: Function types are declared by the module owning them so they are
+                //       visible wherever the module's declarations are (see codegenGenerateModules()).
+                TableItem *item = tableGet(&cg->fnTypes[ty->declModule], (void *)ty->name);
                 VERIFY(item);
-                print(cg, "%s", (ASTString)item->value);
+                printString(cg, (ASTString)item->value);
                 break;
             }
         case TY_STRUCT: {
@@ -142,6 +187,37 @@ static void genType(Codegen *cg, Type *ty) {
     }
 }
 
+// The length of the C string literal [s] once its escape sequences are replaced by the characters they stand for.
+static usize stringLiteralLength(ASTString s) {
+    usize length = 0;
+    for(usize i = 0; s[i] != '\0'; ++i, ++length) {
+        if(s[i] != '\\' || s[i + 1] == '\0') {
+            continue;
+        }
+        i++;
+        if(s[i] == 'x') {
+            while((s[i + 1] >= '0' && s[i + 1] <= '9') || (s[i + 1] >= 'a' && s[i + 1] <= 'f') || (s[i + 1] >= 'A' && s[i + 1] <= 'F')) {
+                i++;
+            }
+        } else if(s[i] >= '0' && s[i] <= '7') {
+            for(int digits = 1; digits < 3 && s[i + 1] >= '0' && s[i + 1] <= '7'; ++digits) {
+                i++;
+            }
+        }
+    }
+    return length;
+}
+
+// Generates the initializer of a str (see genPrelude()) holding the string literal [s].
+// The length is known at compile time, so it never has to be computed at runtime.
+static void genStringInitializer(Codegen *cg, ASTString s) {
+    printLiteral(cg, "{\"");
+    printString(cg, s);
+    printLiteral(cg, "\", ");
+    writerWriteUnsigned(cg->output, stringLiteralLength(s));
+    printLiteral(cg, "}");
+}
+
 static void genExpr(Codegen *cg, ASTExprNode *expr);
 static void genPropertyAccessExpr(Codegen *cg, ASTExprNode *expr) {
     Array stack;
@@ -156,7 +232,7 @@ static void genPropertyAccessExpr(Codegen *cg, ASTExprNode *expr) {
         ASTExprNode *n = ARRAY_POP_AS(ASTExprNode *, &stack);
         genExpr(cg, n);
         if(arrayLength(&stack) > 0) {
-            print(cg, ".");
+            printLiteral(cg, ".");
         }
     }
     arrayFree(&stack);
@@ -186,14 +262,39 @@ static void genExpr(Codegen *cg, ASTExprNode *expr) {
     switch(expr->type) {
         // Constant value nodes.
         case EXPR_NUMBER_CONSTANT:
-            print(cg, "%lu", NODE_AS(ASTConstantValueExpr, expr)->as.number);
+            if(expr->dataType->type == TY_I32) {
+                // Evaluated constants are sign-extended (see typeWrapInteger()).
+                writerWriteSigned(cg->output, (i64)NODE_AS(ASTConstantValueExpr, expr)->as.number);
+            } else {
+                writerWriteUnsigned(cg->output, NODE_AS(ASTConstantValueExpr, expr)->as.number);
+            }
             break;
         case EXPR_STRING_CONSTANT:
-            print(cg, "\"%s\"", NODE_AS(ASTConstantValueExpr, expr)->as.string);
+            // Only generated as initializers (of module variables & struct constants.)
+            genStringInitializer(cg, NODE_AS(ASTConstantValueExpr, expr)->as.string);
             break;
         case EXPR_BOOLEAN_CONSTANT:
-            print(cg, "%s", NODE_AS(ASTConstantValueExpr, expr)->as.boolean ? "true" : "false");
+            if(NODE_AS(ASTConstantValueExpr, expr)->as.boolean) {
+                printLiteral(cg, "true");
+            } else {
+                printLiteral(cg, "false");
+            }
             break;
+        case EXPR_STRUCT_CONSTANT: {
+            ASTStructConstantExpr *st = NODE_AS(ASTStructConstantExpr, expr);
+            printLiteral(cg, "{");
+            ARRAY_FOR(i, st->fields) {
+                printLiteral(cg, ".");
+                printString(cg, ARRAY_GET_AS(ASTObj *, &st->fields, i)->name);
+                printLiteral(cg, " = ");
+                genExpr(cg, ARRAY_GET_AS(ASTExprNode *, &st->values, i));
+                if(i + 1 < arrayLength(&st->fields)) {
+                    printLiteral(cg, ", ");
+                }
+            }
+            printLiteral(cg, "}");
+            break;
+        }
         // Obj nodes
         case EXPR_VARIABLE:
         case EXPR_FUNCTION: {
@@ -217,7 +318,7 @@ static void genExpr(Codegen *cg, ASTExprNode *expr) {
                     // is module scope.
                     genModuleScopeID(cg, obj->ownerModule, obj->type, obj->name);
                 } else {
-                    print(cg, "%s", obj->name);
+                    printString(cg, obj->name);
                 }
             }
             break;
@@ -246,48 +347,50 @@ static void genExpr(Codegen *cg, ASTExprNode *expr) {
         case EXPR_GE:
         case EXPR_LOGICAL_AND:
         case EXPR_LOGICAL_OR:
-            print(cg, "(");
+            printLiteral(cg, "(");
             genExpr(cg, NODE_AS(ASTBinaryExpr, expr)->lhs);
-            print(cg, ")");
-            print(cg, " %s ", binaryOperatorToString(expr->type));
-            print(cg, "(");
+            printLiteral(cg, ")");
+            writerWriteChar(cg->output, ' ');
+            writerWriteCString(cg->output, binaryOperatorToString(expr->type));
+            writerWriteChar(cg->output, ' ');
+            printLiteral(cg, "(");
             genExpr(cg, NODE_AS(ASTBinaryExpr, expr)->rhs);
-            print(cg, ")");
+            printLiteral(cg, ")");
             break;
         // Unary nodes
         case EXPR_NEGATE:
-            print(cg, "-(");
+            printLiteral(cg, "-(");
             genExpr(cg, NODE_AS(ASTUnaryExpr, expr)->operand);
-            print(cg, ")");
+            printLiteral(cg, ")");
             break;
         case EXPR_LOGICAL_NOT:
-            print(cg, "!(");
+            printLiteral(cg, "!(");
             genExpr(cg, NODE_AS(ASTUnaryExpr, expr)->operand);
-            print(cg, ")");
+            printLiteral(cg, ")");
             break;
         case EXPR_ADDROF:
-            print(cg, "&(");
+            printLiteral(cg, "&(");
             genExpr(cg, NODE_AS(ASTUnaryExpr, expr)->operand);
-            print(cg, ")");
+            printLiteral(cg, ")");
             break;
         case EXPR_DEREF:
-            print(cg, "(*");
+            printLiteral(cg, "(*");
             genExpr(cg, NODE_AS(ASTUnaryExpr, expr)->operand);
-            print(cg, ")");
+            printLiteral(cg, ")");
             break;
         // Call nodes
         case EXPR_CALL:
             cg->isInCall = true;
             genExpr(cg, NODE_AS(ASTCallExpr, expr)->callee);
-            print(cg, "(");
+            printLiteral(cg, "(");
             for(usize i = 0; i < arrayLength(&NODE_AS(ASTCallExpr, expr)->arguments); ++i) {
                 ASTExprNode *arg = ARRAY_GET_AS(ASTExprNode *, &NODE_AS(ASTCallExpr, expr)->arguments, i);
                 genExpr(cg, arg);
                 if(i + 1 < arrayLength(&NODE_AS(ASTCallExpr, expr)->arguments)) {
-                    print(cg, ", ");
+                    printLiteral(cg, ", ");
                 }
             }
-            print(cg, ")");
+            printLiteral(cg, ")");
             cg->isInCall = false;
             break;
         // Other nodes
@@ -297,140 +400,569 @@ static void genExpr(Codegen *cg, ASTExprNode *expr) {
     }
 }
 
-static void genVarDecl(Codegen *cg, ASTVarDeclStmt *vdecl, bool isModuleScope) {
-    genType(cg, vdecl->variable->dataType);
-    if(isModuleScope) {
-        genModuleScopeID(cg, vdecl->variable->ownerModule, vdecl->variable->type, vdecl->variable->name);
+// Note: When generating the whole program, module variables are static (see genFunctionSpecifiers()),
+//       and this is a tentative definition.
+static void genModuleVarPredeclaration(Codegen *cg, ASTVarDeclStmt *vdecl) {
+    if(cg->wholeProgram) {
+        printLiteral(cg, "static ");
     } else {
-        print(cg, " %s", vdecl->variable->name);
+        printLiteral(cg, "extern ");
     }
+    genType(cg, vdecl->variable->dataType);
+    printLiteral(cg, " ");
+    genModuleScopeID(cg, vdecl->variable->ownerModule, vdecl->variable->type, vdecl->variable->name);
+    printLiteral(cg, ";\n");
+}
+
+static void genModuleVarDecl(Codegen *cg, ASTVarDeclStmt *vdecl) {
+    if(cg->wholeProgram) {
+        printLiteral(cg, "static ");
+    }
+    genType(cg, vdecl->variable->dataType);
+    printLiteral(cg, " ");
+    genModuleScopeID(cg, vdecl->variable->ownerModule, vdecl->variable->type, vdecl->variable->name);
     if(vdecl->initializer) {
-        print(cg, " = ");
+        // Initializers are evaluated to constants (see Evaluator.h).
+        VERIFY(NODE_IS(vdecl->initializer, EXPR_NUMBER_CONSTANT) ||
+               NODE_IS(vdecl->initializer, EXPR_STRING_CONSTANT) ||
+               NODE_IS(vdecl->initializer, EXPR_BOOLEAN_CONSTANT) ||
+               NODE_IS(vdecl->initializer, EXPR_STRUCT_CONSTANT) ||
+               NODE_IS(vdecl->initializer, EXPR_FUNCTION));
+        printLiteral(cg, " = ");
         genExpr(cg, vdecl->initializer);
     }
-    print(cg, ";\n");
+    printLiteral(cg, ";\n");
 }
 
-static void genStmt(Codegen *cg, ASTStmtNode *stmt) {
-    switch(stmt->type) {
-        // VarDecl nodes
-        case STMT_VAR_DECL:
-            genVarDecl(cg, NODE_AS(ASTVarDeclStmt, stmt), false);
+/* Function bodies (generated from the IR) */
+
+static void genFunctionName(Codegen *cg, ASTObj *fn) {
+    if(fn->parent != NULL) {
+        genMethodID(cg, fn);
+    } else {
+        genModuleScopeID(cg, fn->ownerModule, fn->type, fn->name);
+    }
+}
+
+// Addresses computed by allocas & field addresses aren't stored anywhere, they are used as lvalues directly.
+static bool isInlinedAddress(IrValue *value) {
+    return IR_VALUE_IS(value, IR_VALUE_GLOBAL) || IR_IS_INSTR(value, IR_ALLOCA) || IR_IS_INSTR(value, IR_FIELD_ADDRESS);
+}
+
+/*
+ * Structs passed by pointer (see irTypeIsPassedByPointer()).
+ * Functions get them as 'const T *' parameters, and return them through a 'T *' parameter before the others.
+ * Copies are avoided where the IR shows they can't be observed:
+ *  - A parameter that is never modified is used through its pointer instead of being copied to its stack slot.
+ *  - A struct loaded from a stack slot that can't be accessed through pointers is passed to a call
+ *    (or returned) directly from the slot instead of from a copy.
+ *  - A call whose value is stored to such a slot right away returns into the slot directly.
+ */
+
+#define RETURN_POINTER_NAME "___ilc_internal__return"
+
+// The stack slot an address (of the slot, or of a field in it) points into, NULL if it isn't in a stack slot.
+static IrInstr *rootSlot(IrValue *address) {
+    while(IR_IS_INSTR(address, IR_FIELD_ADDRESS)) {
+        address = IR_OPERAND((IrInstr *)address, 0);
+    }
+    return IR_IS_INSTR(address, IR_ALLOCA) ? (IrInstr *)address : NULL;
+}
+
+// Check if an address (of a stack slot, or of a field in it) is only loaded from, ignoring the store [ignored].
+static bool isOnlyLoaded(IrValue *address, IrInstr *ignored) {
+    ARRAY_FOR(i, address->uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &address->uses, i);
+        if(user == ignored || user->op == IR_LOAD) {
+            continue;
+        }
+        if(user->op != IR_FIELD_ADDRESS || !isOnlyLoaded((IrValue *)user, ignored)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// If [slot] is the stack slot of a parameter passed by pointer that is never modified, return the store
+// copying the parameter to it (the slot is replaced by the object the parameter points to.) Otherwise, return NULL.
+static IrInstr *parameterStore(IrInstr *slot) {
+    ASTObj *var = slot->as.variable;
+    if(!irTypeIsPassedByPointer(var->dataType)) {
+        return NULL;
+    }
+    IrInstr *store = NULL;
+    ARRAY_FOR(i, slot->header.uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &slot->header.uses, i);
+        if(user->op == IR_STORE && IR_OPERAND(user, 0) == (IrValue *)slot) {
+            if(store != NULL) {
+                return NULL;
+            }
+            store = user;
+        }
+    }
+    if(store == NULL) {
+        return NULL;
+    }
+    IrValue *value = IR_OPERAND(store, 1);
+    if(!IR_VALUE_IS(value, IR_VALUE_PARAMETER) || ((IrObjectValue *)value)->obj != var) {
+        return NULL;
+    }
+    return isOnlyLoaded((IrValue *)slot, store) ? store : NULL;
+}
+
+// Check if [load] (of a struct passed by pointer) isn't generated, and the object it loads is used directly by
+// the call or return using it instead. Nothing between them may modify the object, and a callee
+// can't see the object if it is a stack slot whose address doesn't escape.
+static bool isForwardedLoad(IrInstr *load) {
+    if(load->op != IR_LOAD || !irTypeIsPassedByPointer(load->header.type) || arrayLength(&load->header.uses) != 1) {
+        return false;
+    }
+    IrInstr *user = ARRAY_GET_AS(IrInstr *, &load->header.uses, 0);
+    if(user->block != load->block) {
+        return false;
+    }
+    if(user->op == IR_CALL) {
+        IrInstr *slot = rootSlot(IR_OPERAND(load, 0));
+        if(slot == NULL || irAddressEscapes((IrValue *)slot) || IR_OPERAND(user, 0) == (IrValue *)load) {
+            return false;
+        }
+    } else if(user->op != IR_RETURN) {
+        return false;
+    }
+    bool between = false;
+    ARRAY_FOR(i, load->block->instructions) {
+        IrInstr *instr = ARRAY_GET_AS(IrInstr *, &load->block->instructions, i);
+        if(instr == user) {
+            break;
+        }
+        if(between && (instr->op == IR_STORE || instr->op == IR_CALL)) {
+            return false;
+        }
+        between = between || instr == load;
+    }
+    return true;
+}
+
+// If the value of [call] (a struct passed by pointer) is only stored to a stack slot (whose address doesn't escape)
+// right after the call, return the store: the call returns into the slot directly. Otherwise, return NULL.
+static IrInstr *returnStore(IrInstr *call) {
+    if(call->header.type == NULL || !irTypeIsPassedByPointer(call->header.type) || arrayLength(&call->header.uses) != 1) {
+        return NULL;
+    }
+    IrInstr *store = ARRAY_GET_AS(IrInstr *, &call->header.uses, 0);
+    if(store->op != IR_STORE || IR_OPERAND(store, 1) != (IrValue *)call || store->block != call->block) {
+        return NULL;
+    }
+    Array *instructions = &call->block->instructions;
+    usize index = 0;
+    while(ARRAY_GET_AS(IrInstr *, instructions, index) != call) {
+        index++;
+    }
+    if(index + 1 >= arrayLength(instructions) || ARRAY_GET_AS(IrInstr *, instructions, index + 1) != store) {
+        return NULL;
+    }
+    IrInstr *slot = rootSlot(IR_OPERAND(store, 0));
+    if(slot == NULL || irAddressEscapes((IrValue *)slot)) {
+        return NULL;
+    }
+    // The callee can't read the slot it returns into.
+    for(usize i = 1; i < arrayLength(&call->operands); ++i) {
+        IrValue *argument = IR_OPERAND(call, i);
+        if(IR_VALUE_IS(argument, IR_VALUE_INSTRUCTION) && isForwardedLoad((IrInstr *)argument)
+           && rootSlot(IR_OPERAND((IrInstr *)argument, 0)) == slot) {
+            return NULL;
+        }
+    }
+    return store;
+}
+
+static void genIrValue(Codegen *cg, IrValue *value);
+
+// Generate the object (an lvalue) at [address].
+static void genLvalue(Codegen *cg, IrValue *address) {
+    if(IR_VALUE_IS(address, IR_VALUE_GLOBAL)) {
+        ASTObj *var = ((IrObjectValue *)address)->obj;
+        genModuleScopeID(cg, var->ownerModule, var->type, var->name);
+    } else if(IR_IS_INSTR(address, IR_ALLOCA)) {
+        IrInstr *store = parameterStore((IrInstr *)address);
+        if(store) {
+            genIrValue(cg, IR_OPERAND(store, 1));
+            return;
+        }
+        genInternalID(cg, "s", ((IrInstr *)address)->id, NULL);
+    } else if(IR_IS_INSTR(address, IR_FIELD_ADDRESS)) {
+        printLiteral(cg, "(");
+        genLvalue(cg, IR_OPERAND((IrInstr *)address, 0));
+        printLiteral(cg, ").");
+        printString(cg, ((IrInstr *)address)->as.field->name);
+    } else {
+        printLiteral(cg, "(*");
+        genIrValue(cg, address);
+        printLiteral(cg, ")");
+    }
+}
+
+static void genIrValue(Codegen *cg, IrValue *value) {
+    switch(value->kind) {
+        case IR_VALUE_CONSTANT: {
+            IrConstant *c = (IrConstant *)value;
+            switch(value->type->type) {
+                case TY_BOOL:
+                    if(c->as.boolean) {
+                        printLiteral(cg, "true");
+                    } else {
+                        printLiteral(cg, "false");
+                    }
+                    break;
+                case TY_STR:
+                    printLiteral(cg, "((str)");
+                    genStringInitializer(cg, c->as.string);
+                    printLiteral(cg, ")");
+                    break;
+                case TY_I32:
+                    // Folded constants are sign-extended (see typeWrapInteger()).
+                    writerWriteSigned(cg->output, (i64)c->as.number);
+                    break;
+                default:
+                    writerWriteUnsigned(cg->output, c->as.number);
+                    break;
+            }
+            break;
+        }
+        case IR_VALUE_UNDEFINED:
+            printLiteral(cg, "(");
+            genType(cg, value->type);
+            printLiteral(cg, "){0}");
             break;
-        // Block nodes
-        case STMT_BLOCK:{
-            print(cg, "{\n");
-            Scope *scope = NODE_AS(ASTBlockStmt, stmt)->scope;
-            // SCOPE_DEPTH_BLOCK == root of function scope tree.
-            bool isFunctionScope = scope->depth == SCOPE_DEPTH_BLOCK;
-            if(isFunctionScope && cg->currentFn->as.fn.returnType->type != TY_VOID) {
-                genType(cg, cg->currentFn->as.fn.returnType);
-                genInternalID(cg, "return_value", " ", ";\n\n");
+        case IR_VALUE_PARAMETER:
+            if(irTypeIsPassedByPointer(value->type)) {
+                printLiteral(cg, "(*");
+                printString(cg, ((IrObjectValue *)value)->obj->name);
+                printLiteral(cg, ")");
+            } else {
+                printString(cg, ((IrObjectValue *)value)->obj->name);
             }
-            print(cg, "// start block\n");
-            for(usize i = 0; i < arrayLength(&NODE_AS(ASTBlockStmt, stmt)->nodes); ++i) {
-                ASTStmtNode *node = ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i);
-                genStmt(cg, node);
+            break;
+        case IR_VALUE_FUNCTION:
+            genFunctionName(cg, ((IrObjectValue *)value)->obj);
+            break;
+        case IR_VALUE_GLOBAL:
+        case IR_VALUE_INSTRUCTION:
+            if(isInlinedAddress(value)) {
+                printLiteral(cg, "&");
+                genLvalue(cg, value);
+            } else {
+                genInternalID(cg, "v", ((IrInstr *)value)->id, NULL);
             }
-            print(cg, "// end block\n\n");
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
 
+static void genBlockLabel(Codegen *cg, IrBlock *block) {
+    genInternalID(cg, "b", block->id, NULL);
+}
 
-            if(isFunctionScope) {
-                print(cg, "_fn_%s_end:\n// start defers\n", cg->currentFn->name, cg->currentFn->name);
-                for(usize i = 0; i < arrayLength(&cg->defersInCurrentFn); ++i) {
-                    ASTStmtNode *defer = ARRAY_GET_AS(ASTStmtNode *, &cg->defersInCurrentFn, i);
-                    genStmt(cg, NODE_AS(ASTDeferStmt, defer)->body);
-                }
-                print(cg, "// end defers\n");
-                print(cg, "return");
-                if(cg->currentFn->as.fn.returnType->type != TY_VOID) {
-                    genInternalID(cg, "return_value", " ", NULL);
-                }
-                print(cg, ";\n");
+// Phis are generated as copies: every predecessor copies the value it passes to '<phi>_in' before jumping,
+// and the block copies them to the phis when it starts (so phis using each other get the previous values.)
+static void genJumpTo(Codegen *cg, IrBlock *from, IrBlock *to) {
+    usize index = irBlockPredecessorIndex(to, from);
+    ARRAY_FOR(i, to->instructions) {
+        IrInstr *phi = ARRAY_GET_AS(IrInstr *, &to->instructions, i);
+        if(phi->op != IR_PHI) {
+            break;
+        }
+        genInternalID(cg, "v", phi->id, "_in = ");
+        genIrValue(cg, IR_OPERAND(phi, index));
+        printLiteral(cg, ";\n");
+    }
+    printLiteral(cg, "goto ");
+    genBlockLabel(cg, to);
+    printLiteral(cg, ";\n");
+}
+
+static const char *irBinaryOperatorToString(IrOp op) {
+    switch(op) {
+        case IR_ADD: return "+";
+        case IR_SUBTRACT: return "-";
+        case IR_MULTIPLY: return "*";
+        case IR_DIVIDE: return "/";
+        case IR_EQ: return "==";
+        case IR_NE: return "!=";
+        case IR_LT: return "<";
+        case IR_LE: return "<=";
+        case IR_GT: return ">";
+        case IR_GE: return ">=";
+        default:
+            UNREACHABLE();
+    }
+}
+
+// Generate a value passed to a function or returned from one (see isForwardedLoad()).
+static void genForwardedValue(Codegen *cg, IrValue *value) {
+    if(IR_VALUE_IS(value, IR_VALUE_INSTRUCTION) && isForwardedLoad((IrInstr *)value)) {
+        genLvalue(cg, IR_OPERAND((IrInstr *)value, 0));
+    } else {
+        genIrValue(cg, value);
+    }
+}
+
+static void genCall(Codegen *cg, IrInstr *call) {
+    genIrValue(cg, IR_OPERAND(call, 0));
+    printLiteral(cg, "(");
+    if(call->header.type && irTypeIsPassedByPointer(call->header.type)) {
+        printLiteral(cg, "&");
+        IrInstr *store = returnStore(call);
+        if(store) {
+            genLvalue(cg, IR_OPERAND(store, 0));
+        } else {
+            genInternalID(cg, "v", call->id, NULL);
+        }
+        if(arrayLength(&call->operands) > 1) {
+            printLiteral(cg, ", ");
+        }
+    }
+    for(usize i = 1; i < arrayLength(&call->operands); ++i) {
+        IrValue *argument = IR_OPERAND(call, i);
+        if(irTypeIsPassedByPointer(argument->type)) {
+            printLiteral(cg, "&");
+            genForwardedValue(cg, argument);
+        } else {
+            genIrValue(cg, argument);
+        }
+        if(i + 1 < arrayLength(&call->operands)) {
+            printLiteral(cg, ", ");
+        }
+    }
+    printLiteral(cg, ")");
+}
+
+static void genInstruction(Codegen *cg, IrInstr *instr) {
+    switch(instr->op) {
+        case IR_ALLOCA:
+        case IR_FIELD_ADDRESS:
+            // Used as lvalues directly (see genLvalue()).
+            return;
+        case IR_PHI:
+            genInternalID(cg, "v", instr->id, " = ");
+            genInternalID(cg, "v", instr->id, "_in;\n");
+            return;
+        case IR_STORE: {
+            // Stores replaced by passing pointers.
+            IrValue *value = IR_OPERAND(instr, 1);
+            IrInstr *slot = rootSlot(IR_OPERAND(instr, 0));
+            if((IR_IS_INSTR(value, IR_CALL) && returnStore((IrInstr *)value) == instr)
+               || (slot && parameterStore(slot) == instr)) {
+                return;
             }
-            print(cg, "}\n");
-            break;
-        }
-        // Conditional nodes
-        case STMT_EXPECT:
-            if(NODE_AS(ASTConditionalStmt, stmt)->then == NULL) {
-                print(cg, "if(");
-                genExpr(cg, NODE_AS(ASTConditionalStmt, stmt)->condition);
-                print(cg, ") {\n");
-                // TODO: provide location info.
-                print(cg, "fprintf(stderr, \"Failed expect!\\n\");\n");
-                print(cg, "exit(1);\n");
-                print(cg, "}\n");
-                break;
+            genLvalue(cg, IR_OPERAND(instr, 0));
+            printLiteral(cg, " = ");
+            genIrValue(cg, IR_OPERAND(instr, 1));
+            printLiteral(cg, ";\n");
+            return;
+        }
+        case IR_LOAD:
+            if(isForwardedLoad(instr)) {
+                return;
             }
-            // fallthrough
-        case STMT_IF:
-            print(cg, "if(");
-            genExpr(cg, NODE_AS(ASTConditionalStmt, stmt)->condition);
-            print(cg, ") ");
-            genStmt(cg, NODE_AS(ASTConditionalStmt, stmt)->then);
-            if(NODE_AS(ASTConditionalStmt, stmt)->else_) {
-                print(cg, "else ");
-                genStmt(cg, NODE_AS(ASTConditionalStmt, stmt)->else_);
+            break;
+        case IR_CALL:
+            if(instr->header.type && irTypeIsPassedByPointer(instr->header.type)) {
+                // Returns through a pointer (see genCall()).
+                genCall(cg, instr);
+                printLiteral(cg, ";\n");
+                return;
             }
             break;
-        // Loop nodes
-        case STMT_LOOP:
-            print(cg, "for(");
-            if(NODE_AS(ASTLoopStmt, stmt)->initializer) {
-                genStmt(cg, NODE_AS(ASTLoopStmt, stmt)->initializer);
+        case IR_JUMP:
+            genJumpTo(cg, instr->block, instr->as.targets[0]);
+            return;
+        case IR_BRANCH:
+            // Tell the C compiler which way a branch to a cold block (an expect failing) is unlikely to go.
+            if(instr->as.targets[0]->cold != instr->as.targets[1]->cold) {
+                printLiteral(cg, "if(__builtin_expect(");
+                genIrValue(cg, IR_OPERAND(instr, 0));
+                if(instr->as.targets[0]->cold) {
+                    printLiteral(cg, ", 0)) {\n");
+                } else {
+                    printLiteral(cg, ", 1)) {\n");
+                }
             } else {
-                print(cg, ";");
+                printLiteral(cg, "if(");
+                genIrValue(cg, IR_OPERAND(instr, 0));
+                printLiteral(cg, ") {\n");
+            }
+            genJumpTo(cg, instr->block, instr->as.targets[0]);
+            printLiteral(cg, "} else {\n");
+            genJumpTo(cg, instr->block, instr->as.targets[1]);
+            printLiteral(cg, "}\n");
+            return;
+        case IR_RETURN:
+            if(astObjectGetAttribute(cg->currentFn, ATTR_NORETURN)) {
+                // Reached the end of a noreturn function (the Validator doesn't allow return statements in them.)
+                // Returning from it is undefined behavior in C, so stop the program instead.
+                printLiteral(cg, "abort();\n");
+                return;
             }
-            genExpr(cg, NODE_AS(ASTLoopStmt, stmt)->condition);
-            print(cg, ";");
-            if(NODE_AS(ASTLoopStmt, stmt)->increment) {
-                genExpr(cg, NODE_AS(ASTLoopStmt, stmt)->increment);
+            if(arrayLength(&instr->operands) > 0 && irTypeIsPassedByPointer(IR_OPERAND(instr, 0)->type)) {
+                printLiteral(cg, "*" RETURN_POINTER_NAME " = ");
+                genForwardedValue(cg, IR_OPERAND(instr, 0));
+                printLiteral(cg, ";\nreturn;\n");
+                return;
             }
-            print(cg, ") ");
-            genStmt(cg, NODE_AS(ASTStmtNode, NODE_AS(ASTLoopStmt, stmt)->body));
-            break;
-        // Expr nodes
-        case STMT_RETURN:
-            if(NODE_AS(ASTExprStmt, stmt)->expression) {
-                genInternalID(cg, "return_value", NULL, " = ");
-                genExpr(cg, NODE_AS(ASTExprStmt, stmt)->expression);
-                print(cg, ";\n");
+            printLiteral(cg, "return");
+            if(arrayLength(&instr->operands) > 0) {
+                printLiteral(cg, " ");
+                genIrValue(cg, IR_OPERAND(instr, 0));
             }
-            print(cg, "goto _fn_%s_end;\n", cg->currentFn->name);
+            printLiteral(cg, ";\n");
+            return;
+        case IR_EXPECT_FAILED:
+            printLiteral(cg, "___ilc_internal__expect_failed(");
+            genIrValue(cg, IR_OPERAND(instr, 0));
+            printLiteral(cg, ", ");
+            genIrValue(cg, IR_OPERAND(instr, 1));
+            printLiteral(cg, ");\n");
+            return;
+        default:
             break;
-        case STMT_EXPR:
-            genExpr(cg, NODE_AS(ASTExprStmt, stmt)->expression);
-            print(cg, ";\n");
+    }
+    // Instructions computing a value.
+    if(instr->header.type) {
+        genInternalID(cg, "v", instr->id, " = ");
+    }
+    switch(instr->op) {
+        case IR_LOAD:
+            genLvalue(cg, IR_OPERAND(instr, 0));
             break;
-        // Defer nodes
-        case STMT_DEFER:
-            // Defers are generated at the end of the function body.
-            arrayPush(&cg->defersInCurrentFn, (void *)stmt);
+        case IR_EQ:
+        case IR_NE:
+            if(IR_OPERAND(instr, 0)->type->type == TY_STR) {
+                // Compares the contents (see genPrelude()).
+                if(instr->op == IR_NE) {
+                    printLiteral(cg, "!");
+                }
+                printLiteral(cg, "___ilc_internal__str_equal(");
+                genIrValue(cg, IR_OPERAND(instr, 0));
+                printLiteral(cg, ", ");
+                genIrValue(cg, IR_OPERAND(instr, 1));
+                printLiteral(cg, ")");
+                break;
+            }
+            // fallthrough
+        case IR_ADD:
+        case IR_SUBTRACT:
+        case IR_MULTIPLY:
+        case IR_DIVIDE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+            printLiteral(cg, "(");
+            genIrValue(cg, IR_OPERAND(instr, 0));
+            printLiteral(cg, ") ");
+            writerWriteCString(cg->output, irBinaryOperatorToString(instr->op));
+            printLiteral(cg, " (");
+            genIrValue(cg, IR_OPERAND(instr, 1));
+            printLiteral(cg, ")");
+            break;
+        case IR_NEGATE:
+            printLiteral(cg, "-(");
+            genIrValue(cg, IR_OPERAND(instr, 0));
+            printLiteral(cg, ")");
+            break;
+        case IR_NOT:
+            printLiteral(cg, "!(");
+            genIrValue(cg, IR_OPERAND(instr, 0));
+            printLiteral(cg, ")");
+            break;
+        case IR_CALL:
+            genCall(cg, instr);
             break;
         default:
             UNREACHABLE();
     }
+    printLiteral(cg, ";\n");
 }
 
-static void genScope(Codegen *cg, Scope *sc, Table *moduleTypeTable);
-static void genStruct(Codegen *cg, ASTObj *st) {
+static void genFunctionBody(Codegen *cg, IrFunction *fn) {
+    printLiteral(cg, "{\n");
+    // All the values & stack slots are declared at the start of the function (the blocks are jumped between.)
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(instr->op == IR_ALLOCA) {
+                if(parameterStore(instr)) {
+                    continue;
+                }
+                genType(cg, instr->header.type->as.ptr.innerType);
+                printLiteral(cg, " ");
+                genInternalID(cg, "s", instr->id, ";\n");
+            } else if(isForwardedLoad(instr) || (instr->op == IR_CALL && returnStore(instr))) {
+                continue;
+            } else if(instr->header.type && instr->op != IR_FIELD_ADDRESS) {
+                genType(cg, instr->header.type);
+                printLiteral(cg, " ");
+                genInternalID(cg, "v", instr->id, ";\n");
+                if(instr->op == IR_PHI) {
+                    genType(cg, instr->header.type);
+                    printLiteral(cg, " ");
+                    genInternalID(cg, "v", instr->id, "_in;\n");
+                }
+            }
+        }
+    }
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        // Only blocks that are jumped to get a label (unused labels warn with -Wall.)
+        if(arrayLength(&block->predecessors) > 0) {
+            genBlockLabel(cg, block);
+            printLiteral(cg, ":\n");
+        }
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(instr->op == IR_CALL && instr->as.tail) {
+                // The call is returned directly, so the return after it (the last instruction) isn't needed.
+                printLiteral(cg, "___ilc_internal__musttail return ");
+                genCall(cg, instr);
+                printLiteral(cg, ";\n");
+                break;
+            }
+            genInstruction(cg, instr);
+        }
+    }
+    printLiteral(cg, "}\n");
+}
+
+// Generates the struct definition only (without the methods).
+static void genStructDefinition(Codegen *cg, ASTObj *st) {
     // Note: typedef is done in predecl.
-    print(cg, "struct ");
+    printLiteral(cg, "struct ");
     genModuleScopeID(cg, st->ownerModule, st->type, st->name);
-    print(cg, " {\n");
-    Array objects; // Array<ASTObj *>
-    arrayInitSized(&objects, scopeGetNumObjects(st->as.structure.scope));
-    scopeGetAllObjects(st->as.structure.scope, &objects);
-    ARRAY_FOR(i, objects) {
-        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
-        if(obj->type == OBJ_VAR) {
-            genType(cg, obj->dataType);
-            print(cg, " %s;\n", obj->name);
-        }
+    printLiteral(cg, " {\n");
+    // Fields are generated in declaration order, so the layout only depends on the declaration.
+    ARRAY_FOR(i, st->as.structure.fields) {
+        ASTObj *field = ARRAY_GET_AS(ASTObj *, &st->as.structure.fields, i);
+        genType(cg, field->dataType);
+        printLiteral(cg, " ");
+        printString(cg, field->name);
+        printLiteral(cg, ";\n");
     }
-    arrayFree(&objects);
-    print(cg, "};\n");
+    printLiteral(cg, "}");
+    ASTAttribute *aligned = astObjectGetAttribute(st, ATTR_ALIGNED);
+    if(aligned) {
+        printLiteral(cg, " __attribute__((aligned(");
+        writerWriteUnsigned(cg->output, aligned->argument);
+        printLiteral(cg, ")))");
+    }
+    printLiteral(cg, ";\n");
+}
+
+static void genScope(Codegen *cg, Scope *sc, Table *moduleTypeTable);
+static void genStruct(Codegen *cg, ASTObj *st) {
+    genStructDefinition(cg, st);
     genScope(cg, st->as.structure.scope, NULL);
 }
 
@@ -442,6 +974,14 @@ static void collect_type_callback(TableItem *item, bool is_last, void *type_arra
     }
 }
 
+static void collect_fn_type_callback(TableItem *item, bool is_last, void *type_array) {
+    UNUSED(is_last);
+    Type *ty = (Type *)item->value;
+    if(ty->type == TY_FUNCTION) {
+        arrayPush((Array *)type_array, (void *)ty);
+    }
+}
+
 // typeTable: Table<ASTString, Type *>
 // output: Array<Type *>
 static void topologicallySortTypes(Table *typeTable, Array *output) {
@@ -511,93 +1051,245 @@ static void topologicallySortTypes(Table *typeTable, Array *output) {
     arrayFree(&types);
 }
 
-// moduleTypeTable: for module scope ONLY. NULL otherwise
-static void genScope(Codegen *cg, Scope *sc, Table *moduleTypeTable) {
-    VERIFY(sc->depth == SCOPE_DEPTH_MODULE_NAMESPACE || sc->depth == SCOPE_DEPTH_STRUCT);
-    print(cg, "/* scope, depth: %d */\n", sc->depth);
-    if(moduleTypeTable) {
-        print(cg, "// structs:\n");
-        Array sortedStructTypes; // Array<Type *> (TY_STRUCT)
-        arrayInit(&sortedStructTypes);
-        topologicallySortTypes(moduleTypeTable, &sortedStructTypes);
-        ARRAY_FOR(i, sortedStructTypes) {
-            Type *ty = ARRAY_GET_AS(Type *, &sortedStructTypes, i);
-            ASTObj *st = scopeGetObject(sc, OBJ_STRUCT, ty->name);
-            VERIFY(st);
-            genStruct(cg, st);
-            print(cg, "\n");
-        }
-        arrayFree(&sortedStructTypes);
-    }
-    // Note: The newline before is printed by the loop, or if no structs exist by the print() before the loop.
-    print(cg, "// predeclarations:\n");
-    Array objects; // Array<ASTObj *>
-    arrayInit(&objects);
-    scopeGetAllObjects(sc, &objects);
-    ARRAY_FOR(i, objects) {
-        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
-        if(obj->type == OBJ_FN) {
-            // function predecl:
-            // * Return type.
-            genType(cg, obj->as.fn.returnType);
-            print(cg, " ");
-            // * Name (mangled).
-            if(sc->depth == SCOPE_DEPTH_STRUCT) {
-                genMethodID(cg, obj);
-            } else {
-                genModuleScopeID(cg, obj->ownerModule, obj->type, obj->name);
-            }
-            // * Parameter types.
-            print(cg, "(");
-            ARRAY_FOR(i, obj->as.fn.parameters) {
-                ASTObj *param = ARRAY_GET_AS(ASTObj *, &obj->as.fn.parameters, i);
-                genType(cg, param->dataType);
-                if(i + 1 < arrayLength(&obj->as.fn.parameters)) {
-                    print(cg, ", ");
-                }
+// Functions that don't call other functions and have at most this many IR instructions
+// are defined in the module header so the modules importing them can inline them.
+#define CODEGEN_INLINE_MAX_INSTRUCTIONS 16
+
+// Should [fn] be defined in the module header (as a C99 inline function)?
+// '#[inline]' functions always are. '#[noinline]' functions never are, and neither are '#[cold]' ones (unless also '#[inline]').
+// Note: When generating the whole program, the C compiler sees every function anyway.
+static bool isInlineCandidate(Codegen *cg, ASTObj *fn) {
+    if(cg->wholeProgram || astObjectGetAttribute(fn, ATTR_NOINLINE)) {
+        return false;
+    }
+    if(astObjectGetAttribute(fn, ATTR_INLINE)) {
+        return true;
+    }
+    if(astObjectGetAttribute(fn, ATTR_COLD)) {
+        return false;
+    }
+    IrFunction *irFn = irModuleGetFunction(cg->ir, fn);
+    VERIFY(irFn);
+    usize numInstructions = 0;
+    ARRAY_FOR(i, irFn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &irFn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            if(ARRAY_GET_AS(IrInstr *, &block->instructions, j)->op == IR_CALL) {
+                return false;
             }
-            print(cg, ");\n");
         }
+        numInstructions += arrayLength(&block->instructions);
     }
+    return numInstructions <= CODEGEN_INLINE_MAX_INSTRUCTIONS;
+}
 
-    // Actually generate the rest of the objects (actually only functions).
-    print(cg, "// declarations: \n");
-    ARRAY_FOR(i, objects) {
-        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
-        if(obj->type == OBJ_FN) {
-            cg->currentFn = obj;
-            arrayClear(&cg->defersInCurrentFn);
+// Generates the C return type of a function returning [returnType] (see irTypeIsPassedByPointer()).
+static void genReturnType(Codegen *cg, Type *returnType) {
+    if(returnType && irTypeIsPassedByPointer(returnType)) {
+        printLiteral(cg, "void");
+    } else {
+        genType(cg, returnType);
+    }
+}
+
+// Generates the C type of a parameter of type [ty] (see irTypeIsPassedByPointer()).
+static void genParameterType(Codegen *cg, Type *ty) {
+    if(irTypeIsPassedByPointer(ty)) {
+        printLiteral(cg, "const ");
+        genType(cg, ty);
+        printLiteral(cg, " *");
+    } else {
+        genType(cg, ty);
+    }
+}
+
+// Generates the pointer parameter a function returning [returnType] returns through (if it has one),
+// followed by a comma if [hasParameters].
+static void genReturnParameter(Codegen *cg, Type *returnType, bool parameterName, bool hasParameters) {
+    if(returnType == NULL || !irTypeIsPassedByPointer(returnType)) {
+        return;
+    }
+    genType(cg, returnType);
+    printLiteral(cg, " *");
+    if(parameterName) {
+        printLiteral(cg, RETURN_POINTER_NAME);
+    }
+    if(hasParameters) {
+        printLiteral(cg, ", ");
+    }
+}
+
+// Generates the return type, (mangled) name and parameters of the function [fn] (which belongs to [sc]).
+static void genFunctionSignature(Codegen *cg, Scope *sc, ASTObj *fn, bool parameterNames) {
+    genReturnType(cg, fn->as.fn.returnType);
+    printLiteral(cg, " ");
+    if(sc->depth == SCOPE_DEPTH_STRUCT) {
+        genMethodID(cg, fn);
+    } else {
+        genModuleScopeID(cg, fn->ownerModule, fn->type, fn->name);
+    }
+    printLiteral(cg, "(");
+    genReturnParameter(cg, fn->as.fn.returnType, parameterNames, arrayLength(&fn->as.fn.parameters) > 0);
+    ARRAY_FOR(i, fn->as.fn.parameters) {
+        ASTObj *param = ARRAY_GET_AS(ASTObj *, &fn->as.fn.parameters, i);
+        genParameterType(cg, param->dataType);
+        if(parameterNames) {
+            printLiteral(cg, " ");
+            printString(cg, param->name);
+        }
+        if(i + 1 < arrayLength(&fn->as.fn.parameters)) {
+            printLiteral(cg, ", ");
+        }
+    }
+    printLiteral(cg, ")");
+}
+
+// Indexed by ASTAttributeType (function attributes only.)
+static const char *functionAttributeNames[ATTR_TYPE_COUNT] = {
+    [ATTR_INLINE]   = "always_inline",
+    [ATTR_NOINLINE] = "noinline",
+    [ATTR_HOT]      = "hot",
+    [ATTR_COLD]     = "cold",
+    [ATTR_PURE]     = "pure",
+    [ATTR_CONST]    = "const",
+    [ATTR_NORETURN] = "noreturn"
+};
+
+// Generates the GCC/Clang attributes the attributes of the function [fn] are lowered to.
+static void genFunctionAttributes(Codegen *cg, ASTObj *fn) {
+    if(arrayLength(&fn->attributes) == 0) {
+        return;
+    }
+    printLiteral(cg, "__attribute__((");
+    ARRAY_FOR(i, fn->attributes) {
+        ASTAttribute *attr = ARRAY_GET_AS(ASTAttribute *, &fn->attributes, i);
+        VERIFY(functionAttributeNames[attr->type]);
+        writerWriteCString(cg->output, functionAttributeNames[attr->type]);
+        if(i + 1 < arrayLength(&fn->attributes)) {
+            printLiteral(cg, ", ");
+        }
+    }
+    printLiteral(cg, ")) ");
+}
+
+// Generates the linkage & inline specifiers (and the attributes) of the function [fn].
+// When generating the whole program there is a single translation unit, so all the functions are static.
+// Otherwise, functions can be used by other modules so they have external linkage.
+// Note: All the (file scope) declarations of inline functions that other modules see are 'inline'
+//       (C99 inline definitions), and the module's own unit provides the external definition (see genFunctionDeclarations()).
+static void genFunctionSpecifiers(Codegen *cg, ASTObj *fn) {
+    if(cg->wholeProgram) {
+        printLiteral(cg, "static ");
+        if(astObjectGetAttribute(fn, ATTR_INLINE)) {
+            printLiteral(cg, "inline ");
+        }
+    } else if(isInlineCandidate(cg, fn)) {
+        printLiteral(cg, "inline ");
+    }
+    genFunctionAttributes(cg, fn);
+}
+
+// Generates the prototypes of the functions in [objects] (which belong to [sc]).
+static void genFunctionPredeclarations(Codegen *cg, Scope *sc, Array *objects) {
+    ARRAY_FOR(i, *objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, objects, i);
+        if(obj->type == OBJ_FN && isReachable(cg, obj)) {
+            genFunctionSpecifiers(cg, obj);
+            genFunctionSignature(cg, sc, obj, false);
+            printLiteral(cg, ";\n");
+        }
+    }
+}
+
+static void genFunctionDefinition(Codegen *cg, Scope *sc, ASTObj *fn) {
+    cg->currentFn = fn;
+    genFunctionSpecifiers(cg, fn);
+    genFunctionSignature(cg, sc, fn, true);
+    printLiteral(cg, " ");
+    IrFunction *irFn = irModuleGetFunction(cg->ir, fn);
+    VERIFY(irFn);
+    genFunctionBody(cg, irFn);
+    cg->currentFn = NULL;
+}
+
+// Generates the definitions of the functions in [objects] (which belong to [sc]).
+static void genFunctionDeclarations(Codegen *cg, Scope *sc, Array *objects) {
+    ARRAY_FOR(i, *objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, objects, i);
+        if(obj->type == OBJ_FN && isReachable(cg, obj)) {
             if(stringEqual(obj->name, "main")) {
                 VERIFY(cg->mainFn == NULL);
                 cg->mainFn = obj;
             }
-
-            // Return type.
-            genType(cg, obj->as.fn.returnType);
-            print(cg, " ");
-            // Name (mangled).
-            if(sc->depth == SCOPE_DEPTH_STRUCT) {
-                genMethodID(cg, obj);
+            if(isInlineCandidate(cg, obj)) {
+                // Defined in the module header (see genInlineFunctionDefinitions()).
+                // Declaring it 'extern' makes this unit provide the external definition.
+                printLiteral(cg, "extern inline ");
+                genFunctionSignature(cg, sc, obj, false);
+                printLiteral(cg, ";\n");
             } else {
-                genModuleScopeID(cg, obj->ownerModule, obj->type, obj->name);
+                genFunctionDefinition(cg, sc, obj);
             }
+        }
+    }
+}
 
-            // Parameters.
-            print(cg, "(");
-            ARRAY_FOR(i, obj->as.fn.parameters) {
-                ASTObj *param = ARRAY_GET_AS(ASTObj *, &obj->as.fn.parameters, i);
-                genType(cg, param->dataType);
-                print(cg, " %s", param->name);
-                if(i + 1 < arrayLength(&obj->as.fn.parameters)) {
-                    print(cg, ", ");
-                }
+// Generates the definitions of the functions in [objects] (which belong to [sc]) that are defined in the module header.
+static void genInlineFunctionDefinitions(Codegen *cg, Scope *sc, Array *objects) {
+    ARRAY_FOR(i, *objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, objects, i);
+        if(obj->type == OBJ_FN && isInlineCandidate(cg, obj)) {
+            genFunctionDefinition(cg, sc, obj);
+        }
+    }
+}
+
+// Collects the module scope structs in definition order (see topologicallySortTypes()).
+// output: Array<ASTObj *> (OBJ_STRUCT)
+static void collectSortedStructs(Scope *moduleScope, Table *moduleTypeTable, Array *output) {
+    Array sortedStructTypes; // Array<Type *> (TY_STRUCT)
+    arrayInit(&sortedStructTypes);
+    topologicallySortTypes(moduleTypeTable, &sortedStructTypes);
+    ARRAY_FOR(i, sortedStructTypes) {
+        Type *ty = ARRAY_GET_AS(Type *, &sortedStructTypes, i);
+        ASTObj *st = scopeGetObject(moduleScope, OBJ_STRUCT, ty->name);
+        VERIFY(st);
+        arrayPush(output, (void *)st);
+    }
+    arrayFree(&sortedStructTypes);
+}
+
+// moduleTypeTable: for module scope ONLY. NULL otherwise
+static void genScope(Codegen *cg, Scope *sc, Table *moduleTypeTable) {
+    VERIFY(sc->depth == SCOPE_DEPTH_MODULE_NAMESPACE || sc->depth == SCOPE_DEPTH_STRUCT);
+    printLiteral(cg, "/* scope, depth: ");
+    writerWriteSigned(cg->output, sc->depth);
+    printLiteral(cg, " */\n");
+    if(moduleTypeTable) {
+        printLiteral(cg, "// structs:\n");
+        Array structs; // Array<ASTObj *>
+        arrayInit(&structs);
+        collectSortedStructs(sc, moduleTypeTable, &structs);
+        ARRAY_FOR(i, structs) {
+            ASTObj *st = ARRAY_GET_AS(ASTObj *, &structs, i);
+            if(isReachable(cg, st)) {
+                genStruct(cg, st);
+                printLiteral(cg, "\n");
             }
-            print(cg, ") ");
-            genStmt(cg, NODE_AS(ASTStmtNode, obj->as.fn.body));
-            cg->currentFn = NULL;
         }
+        arrayFree(&structs);
     }
-    print(cg, "/* end scope */\n");
+    // Note: The newline before is printed by the loop, or if no structs exist by the printLiteral() before the loop.
+    printLiteral(cg, "// predeclarations:\n");
+    Array objects; // Array<ASTObj *>
+    arrayInit(&objects);
+    scopeGetAllObjects(sc, &objects);
+    genFunctionPredeclarations(cg, sc, &objects);
+
+    // Actually generate the rest of the objects (actually only functions).
+    printLiteral(cg, "// declarations: \n");
+    genFunctionDeclarations(cg, sc, &objects);
+    printLiteral(cg, "/* end scope */\n");
     arrayFree(&objects);
 }
 
@@ -605,109 +1297,632 @@ static void predecl_struct_types_cb(TableItem *item, bool isLast, void *cl) {
     UNUSED(isLast);
     Codegen *cg = (Codegen *)cl;
     Type *ty = (Type *)item->value;
-    if(ty->type == TY_STRUCT) {
-        print(cg, "typedef struct ");
+    if(ty->type == TY_STRUCT && isTypeReachable(cg, ty)) {
+        printLiteral(cg, "typedef struct ");
         genModuleScopeID(cg, ty->declModule, OBJ_STRUCT, ty->name);
-        print(cg, " ");
+        printLiteral(cg, " ");
         genModuleScopeID(cg, ty->declModule, OBJ_STRUCT, ty->name);
-        print(cg, ";\n");
+        printLiteral(cg, ";\n");
     }
 }
-static void predecl_fn_types_cb(TableItem *item, bool isLast, void *cl) {
-    UNUSED(isLast);
-    Codegen *cg = (Codegen *)cl;
-    Type *ty = (Type *)item->value;
-    if(ty->type == TY_FUNCTION) {
-        ASTModule *m = astProgramGetModule(cg->program, ty->declModule);
-        ASTString fnCTypename = stringTableFormat(cg->program->strings, "module%s_fn%u", m->name, cg->fnTypenameCounter++);
-        tableSet(&cg->fnTypes, (void *)ty->name, (void *)fnCTypename);
-        print(cg, "typedef ");
-        genType(cg, ty->as.fn.returnType);
-        print(cg, " (*%s)(", fnCTypename);
-        ARRAY_FOR(i, ty->as.fn.parameterTypes) {
-            Type *paramTy = ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i);
-            genType(cg, paramTy);
-            if(i + 1 < arrayLength(&ty->as.fn.parameterTypes)) {
-                print(cg, ", ");
-            }
+// Declare the function type [ty] after the function types it uses (a function type
+// returning or taking a function has to be declared after the function type it uses.)
+// declared: Table<ASTString, void> (the C typenames declared so far.)
+static void predeclFunctionType(Codegen *cg, Type *ty, Table *declared) {
+    while(ty->type == TY_POINTER) {
+        ty = ty->as.ptr.innerType;
+    }
+    if(ty->type != TY_FUNCTION) {
+        return;
+    }
+    TableItem *item = tableGet(&cg->fnTypes[ty->declModule], (void *)ty->name);
+    VERIFY(item);
+    ASTString fnCTypename = (ASTString)item->value;
+    // Note: different function types can have the same C typename (see nameFunctionTypes()).
+    if(tableGet(declared, (void *)fnCTypename) != NULL) {
+        return;
+    }
+    tableSet(declared, (void *)fnCTypename, NULL);
+    predeclFunctionType(cg, ty->as.fn.returnType, declared);
+    ARRAY_FOR(i, ty->as.fn.parameterTypes) {
+        predeclFunctionType(cg, ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i), declared);
+    }
+    printLiteral(cg, "typedef ");
+    genReturnType(cg, ty->as.fn.returnType);
+    printLiteral(cg, " (*");
+    printString(cg, fnCTypename);
+    printLiteral(cg, ")(");
+    genReturnParameter(cg, ty->as.fn.returnType, false, arrayLength(&ty->as.fn.parameterTypes) > 0);
+    ARRAY_FOR(i, ty->as.fn.parameterTypes) {
+        Type *paramTy = ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i);
+        genParameterType(cg, paramTy);
+        if(i + 1 < arrayLength(&ty->as.fn.parameterTypes)) {
+            printLiteral(cg, ", ");
         }
-        print(cg, ");\n");
     }
+    printLiteral(cg, ");\n");
+}
+
+// Declare all the function types of [m].
+static void predeclFunctionTypes(Codegen *cg, ASTModule *m) {
+    Array types; // Array<Type *>
+    arrayInitSized(&types, tableSize(&m->types));
+    tableMap(&m->types, collect_fn_type_callback, (void *)&types);
+    Table declared; // Table<ASTString, void>
+    tableInit(&declared, NULL, NULL);
+    ARRAY_FOR(i, types) {
+        Type *ty = ARRAY_GET_AS(Type *, &types, i);
+        // Note: The function types a reachable function type uses are reachable as well.
+        if(isTypeReachable(cg, ty)) {
+            predeclFunctionType(cg, ty, &declared);
+        }
+    }
+    tableFree(&declared);
+    arrayFree(&types);
 }
 
 static void genModule(Codegen *cg, ASTModule *m) {
-    print(cg, "/* Module '%s' */\n", m->name);
-    print(cg, "// Module variables:\n");
+    printLiteral(cg, "/* Module '");
+    printString(cg, m->name);
+    printLiteral(cg, "' */\n");
+    // Declare function and struct types. See block comment at top of this file.
+    printLiteral(cg, "// Struct & Function predeclarations:\n");
+    tableMap(&m->types, predecl_struct_types_cb, (void *)cg);
+    predeclFunctionTypes(cg, m);
+    // The variables are defined after the module scope since their (constant) initializers
+    // may need complete struct types and functions (see Evaluator.h).
+    printLiteral(cg, "// Module variable declarations:\n");
     ARRAY_FOR(i, m->variableDecls) {
         ASTVarDeclStmt *vdecl = ARRAY_GET_AS(ASTVarDeclStmt *, &m->variableDecls, i);
-        genVarDecl(cg, vdecl, true);
+        if(isReachable(cg, vdecl->variable)) {
+            genModuleVarPredeclaration(cg, vdecl);
+        }
     }
-    // Declare function and struct types. See block comment at top of this file.
-    print(cg, "// Struct & Function predeclarations:\n");
-    tableMap(&m->types, predecl_struct_types_cb, (void *)cg);
-    tableMap(&m->types, predecl_fn_types_cb, (void *)cg);
-    print(cg, "// Module scope:\n");
+    printLiteral(cg, "// Module scope:\n");
     genScope(cg, m->moduleScope, &m->types);
+    printLiteral(cg, "// Module variables:\n");
+    ARRAY_FOR(i, m->variableDecls) {
+        ASTVarDeclStmt *vdecl = ARRAY_GET_AS(ASTVarDeclStmt *, &m->variableDecls, i);
+        if(isReachable(cg, vdecl->variable)) {
+            genModuleVarDecl(cg, vdecl);
+        }
+    }
 }
 
-static void genHeader(Codegen *cg) {
-    print(cg, "// File generated by ilc\n\n");
-    print(cg, "#include<stdio.h>\n#include<stdlib.h>\n#include <stdint.h>\n#include <stdbool.h>\n\n"); // bool included here.
-    print(cg, "// primitive types:\n");
+// A single out of line handler for all failing expect statements keeps their code out of the hot paths.
+static void genExpectFailedHandler(Codegen *cg) {
+    printLiteral(cg, "__attribute__((noreturn, cold, noinline, unused)) ");
+    if(cg->wholeProgram) {
+        printLiteral(cg, "static ");
+    }
+    printLiteral(cg, "void ___ilc_internal__expect_failed(str file, u32 line) {\n");
+    printLiteral(cg, "fprintf(stderr, \"%.*s:%u: Failed expect!\\n\", (int)file.len, file.ptr, line);\n");
+    printLiteral(cg, "exit(1);\n");
+    printLiteral(cg, "}\n");
+}
+
+// Includes and primitive types. Used by all generated code.
+static void genPrelude(Codegen *cg) {
+    printLiteral(cg, "#include<stdio.h>\n#include<stdlib.h>\n#include<string.h>\n#include <stdint.h>\n#include <stdbool.h>\n\n"); // bool included here.
+    printLiteral(cg, "// primitive types:\n");
     // TODO: do this for the types stored in each module.
-    //       - This would mean making different files for each module.
-    print(cg, "typedef int32_t i32;\ntypedef uint32_t u32;\ntypedef const char *str;\n\n");
+    printLiteral(cg, "typedef int32_t i32;\ntypedef uint32_t u32;\n");
+    // Strings carry their length (string literals get it at compile time), so getting it never needs strlen().
+    // Note: The characters aren't NUL terminated in general, so passing a str to C code means passing both fields.
+    printLiteral(cg, "typedef struct str {\nconst char *ptr;\nsize_t len;\n} str;\n\n");
+    printLiteral(cg, "// runtime:\n");
+    // Tail calls are only guaranteed by C compilers supporting 'musttail' (others still optimize them when optimizing.)
+    printLiteral(cg, "#if defined(__has_attribute)\n#if __has_attribute(musttail)\n#define ___ilc_internal__musttail __attribute__((musttail))\n#endif\n#endif\n");
+    printLiteral(cg, "#ifndef ___ilc_internal__musttail\n#define ___ilc_internal__musttail\n#endif\n");
+    // The runtime functions are used by the inline functions of every module, which can't use static functions
+    // when modules are generated separately. The unit with the entry point defines them then (see genRuntimeDefinitions()).
+    if(cg->wholeProgram) {
+        genExpectFailedHandler(cg);
+        printLiteral(cg, "__attribute__((unused)) static ");
+    } else {
+        printLiteral(cg, "__attribute__((noreturn, cold)) void ___ilc_internal__expect_failed(str file, u32 line);\n");
+        printLiteral(cg, "inline ");
+    }
+    // Strings of different lengths are never equal, so most comparisons don't look at the characters.
+    printLiteral(cg, "bool ___ilc_internal__str_equal(str a, str b) {\n");
+    printLiteral(cg, "return a.len == b.len && (a.len == 0 || memcmp(a.ptr, b.ptr, a.len) == 0);\n");
+    printLiteral(cg, "}\n\n");
 }
 
-void codegenGenerate(FILE *output, ASTProgram *prog) {
-    VERIFY(output);
-    VERIFY(prog);
-    Codegen cg = {
-        .output = output,
-        .program = prog,
-        .fnTypenameCounter = 0,
-        .currentFn = NULL,
-        .isInCall = false,
-        .currentModule = NULL,
-        .mainFn = NULL,
-        .idBuffer = stringNew(64) // random length that seems enough for most short ids.
-    };
-    tableInit(&cg.fnTypes, NULL, NULL);
-    arrayInit(&cg.defersInCurrentFn);
-    cg.numCNames = arrayLength(&prog->modules);
-    cg.CNames = CALLOC(cg.numCNames, sizeof(*cg.CNames));
-    for(size_t i = 0; i < cg.numCNames; ++i) {
-        tableInit(&cg.CNames[i].globals, NULL, NULL);
-        tableInit(&cg.CNames[i].methods, NULL, NULL);
-    }
-    genHeader(&cg);
+// The definitions of the runtime functions (see genPrelude()) when modules are generated separately.
+static void genRuntimeDefinitions(Codegen *cg) {
+    printLiteral(cg, "// runtime:\n");
+    genExpectFailedHandler(cg);
+    printLiteral(cg, "extern inline bool ___ilc_internal__str_equal(str a, str b);\n");
+}
+
+static void genHeader(Codegen *cg) {
+    printLiteral(cg, "// File generated by ilc\n\n");
+    genPrelude(cg);
+}
+
+static void genEntryPoint(Codegen *cg) {
+    VERIFY(cg->mainFn);
+    printLiteral(cg, "// entry point:\n");
+    printLiteral(cg, "int main(void) {\n");
+    if(cg->mainFn->dataType->as.fn.returnType->type != TY_VOID) {
+        printLiteral(cg, "return ");
+        genModuleScopeID(cg, cg->mainFn->ownerModule, cg->mainFn->type, cg->mainFn->name);
+        printLiteral(cg, "();\n");
+    } else {
+        genModuleScopeID(cg, cg->mainFn->ownerModule, cg->mainFn->type, cg->mainFn->name);
+        printLiteral(cg, "();\n");
+        printLiteral(cg, "return 0;\n");
+    }
+    printLiteral(cg, "}\n");
+}
+
+// Append a description of [ty] that only depends on what the type is, and not on
+// how it was written (parsed typenames contain numbered identifier types, see parseIdentifierType()).
+static void append_type_signature(ASTProgram *prog, Type *ty, String *s) {
+    switch(ty->type) {
+        case TY_VOID:
+        case TY_I32:
+        case TY_U32:
+        case TY_STR:
+        case TY_BOOL:
+            stringAppend(s, "%s", ty->name);
+            break;
+        case TY_POINTER:
+            stringAppend(s, "&");
+            append_type_signature(prog, ty->as.ptr.innerType, s);
+            break;
+        case TY_FUNCTION:
+            stringAppend(s, "fn(");
+            ARRAY_FOR(i, ty->as.fn.parameterTypes) {
+                append_type_signature(prog, ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i), s);
+                if(i + 1 < arrayLength(&ty->as.fn.parameterTypes)) {
+                    stringAppend(s, ", ");
+                }
+            }
+            stringAppend(s, ")->");
+            append_type_signature(prog, ty->as.fn.returnType, s);
+            break;
+        case TY_STRUCT:
+            stringAppend(s, "%s::%s", astProgramGetModule(prog, ty->declModule)->name, ty->name);
+            break;
+        case TY_IDENTIFIER:
+        case TY_SCOPE_RESOLUTION:
+        default:
+            UNREACHABLE();
+    }
+}
+
+// Assign C typenames to the function types of all the modules (see block comment at top of this file.)
+// Returns a ModuleID-indexed array of Table<ASTString, ASTString> (typename, C typename).
+static Table *nameFunctionTypes(ASTProgram *prog) {
+    usize numModules = arrayLength(&prog->modules);
+    Table *fnTypes = CALLOC(numModules, sizeof(*fnTypes));
+    String signature = stringNew(32);
     ARRAY_FOR(i, prog->modules) {
         ASTModule *m = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
-        cg.currentModule = m;
-        // Reset the function typename counter (used for fn type CNames) before every module
-        // since every module has a different name, which means that function typenames
-        // have different prefixes in each modules, so there is no need to keep the counter between modules.
-        cg.fnTypenameCounter = 0;
-        genModule(&cg, m);
-    }
-    print(&cg, "// entry point:\n");
-    print(&cg, "int main(void) {\n");
-    if(cg.mainFn->dataType->as.fn.returnType->type != TY_VOID) {
-        print(&cg, "return ");
-        genModuleScopeID(&cg, cg.mainFn->ownerModule, cg.mainFn->type, cg.mainFn->name);
-        print(&cg, "();\n");
+        tableInit(&fnTypes[m->id], NULL, NULL);
+        Array types; // Array<Type *>
+        arrayInitSized(&types, tableSize(&m->types));
+        tableMap(&m->types, collect_fn_type_callback, (void *)&types);
+        // The C typename is derived from the signature so it is the same in every build
+        // (modules generated in previous builds refer to it, see driverBuild()).
+        // Every module has a different name, so the module name prefix makes the typenames unique.
+        ARRAY_FOR(j, types) {
+            Type *ty = ARRAY_GET_AS(Type *, &types, j);
+            VERIFY(ty->declModule == m->id);
+            stringClear(signature);
+            append_type_signature(prog, ty, &signature);
+            Sha256 h;
+            sha256Init(&h);
+            sha256Update(&h, signature, stringLength(signature));
+            char hash[SHA256_HEX_SIZE];
+            sha256FinalHex(&h, hash);
+            ASTString fnCTypename = stringTableFormat(prog->strings, "module%s_fn%.16s", m->name, hash);
+            tableSet(&fnTypes[m->id], (void *)ty->name, (void *)fnCTypename);
+        }
+        arrayFree(&types);
+    }
+    stringFree(signature);
+    return fnTypes;
+}
+
+static void freeFunctionTypeNames(Table *fnTypes, usize numModules) {
+    for(usize i = 0; i < numModules; ++i) {
+        tableFree(&fnTypes[i]);
+    }
+    FREE(fnTypes);
+}
+
+static void codegen_init_internal(Codegen *cg, ASTProgram *prog, Table *fnTypes) {
+    cg->output = NULL;
+    cg->program = prog;
+    cg->fnTypes = fnTypes;
+    cg->currentFn = NULL;
+    cg->isInCall = false;
+    cg->currentModule = NULL;
+    cg->mainFn = NULL;
+    cg->reachable = NULL;
+    cg->wholeProgram = false;
+    cg->expectChecks = true;
+    cg->idBuffer = stringNew(64); // random length that seems enough for most short ids.
+    cg->ir = NULL;
+    cg->numCNames = arrayLength(&prog->modules);
+    cg->CNames = CALLOC(cg->numCNames, sizeof(*cg->CNames));
+    for(size_t i = 0; i < cg->numCNames; ++i) {
+        tableInit(&cg->CNames[i].globals, NULL, NULL);
+        tableInit(&cg->CNames[i].methods, NULL, NULL);
+    }
+}
+
+static void free_cname_callback(TableItem *item, bool is_last, void *cl) {
+    UNUSED(is_last);
+    UNUSED(cl);
+    stringFree((String)item->value);
+}
+
+static void codegen_free_internal(Codegen *cg) {
+    for(size_t i = 0; i < cg->numCNames; ++i) {
+        tableMap(&cg->CNames[i].methods, free_cname_callback, NULL);
+        tableFree(&cg->CNames[i].methods);
+        tableMap(&cg->CNames[i].globals, free_cname_callback, NULL);
+        tableFree(&cg->CNames[i].globals);
+    }
+    FREE(cg->CNames);
+    stringFree(cg->idBuffer);
+}
+
+static void genModuleHeader(Codegen *cg, ASTModule *m, Array *structs);
+static void genModuleSource(Codegen *cg, ASTModule *m, Array *structs);
+
+typedef struct module_task {
+    Codegen *workers; // The Codegen of every worker (indexed by worker index.)
+    ASTModule *module;
+    bool split; // Generate a header & source (for codegenGenerateModules()) instead of a part of a single stream.
+    Writer *header, *source; // header is only used if [split] is true.
+} ModuleTask;
+
+static void gen_module_task(void *arg, usize workerIndex) {
+    ModuleTask *task = (ModuleTask *)arg;
+    Codegen *cg = &task->workers[workerIndex];
+    cg->currentModule = task->module;
+    cg->wholeProgram = !task->split;
+    cg->ir = irLowerModule(cg->program, task->module, cg->expectChecks);
+    IrPassManager pm;
+    irPassManagerInit(&pm);
+    irPassManagerAddDefaultPasses(&pm);
+    irPassManagerRunOnModule(&pm, cg->ir);
+    irPassManagerFree(&pm);
+    if(task->split) {
+        Array structs; // Array<ASTObj *>
+        arrayInit(&structs);
+        collectSortedStructs(task->module->moduleScope, &task->module->types, &structs);
+        cg->output = task->header;
+        genModuleHeader(cg, task->module, &structs);
+        cg->output = task->source;
+        genModuleSource(cg, task->module, &structs);
+        arrayFree(&structs);
+    } else {
+        cg->output = task->source;
+        genModule(cg, task->module);
+    }
+    irModuleFree(cg->ir);
+    cg->ir = NULL;
+    cg->output = NULL;
+    cg->currentModule = NULL;
+}
+
+// Run [tasks] (one per module) using [numWorkers] workers (the size of [workers]).
+// Returns the main function (found by one of the workers.)
+static ASTObj *runModuleTasks(ModuleTask *tasks, usize numTasks, Codegen *workers, usize numWorkers) {
+    if(numWorkers <= 1) {
+        for(usize i = 0; i < numTasks; ++i) {
+            gen_module_task((void *)&tasks[i], 0);
+        }
     } else {
-        genModuleScopeID(&cg, cg.mainFn->ownerModule, cg.mainFn->type, cg.mainFn->name);
-        print(&cg, "();\n");
-        print(&cg, "return 0;\n");
-    }
-    print(&cg, "}\n");
-    for(size_t i = 0; i < cg.numCNames; ++i) {
-        tableFree(&cg.CNames[i].methods);
-        tableFree(&cg.CNames[i].globals);
-    }
-    FREE(cg.CNames);
-    arrayFree(&cg.defersInCurrentFn);
-    tableFree(&cg.fnTypes);
-    stringFree(cg.idBuffer);
+        ThreadPool pool;
+        threadPoolInit(&pool, numWorkers);
+        for(usize i = 0; i < numTasks; ++i) {
+            threadPoolSubmit(&pool, gen_module_task, (void *)&tasks[i]);
+        }
+        threadPoolWait(&pool);
+        threadPoolFree(&pool);
+    }
+    ASTObj *mainFn = NULL;
+    for(usize i = 0; i < numWorkers; ++i) {
+        if(workers[i].mainFn) {
+            VERIFY(mainFn == NULL);
+            mainFn = workers[i].mainFn;
+        }
+    }
+    return mainFn;
+}
+
+// Note: There is no point in having more workers than modules.
+static usize workerCount(ASTProgram *prog, usize jobs) {
+    usize numModules = arrayLength(&prog->modules);
+    if(jobs > numModules) {
+        jobs = numModules;
+    }
+    return jobs > 0 ? jobs : 1;
+}
+
+bool codegenGenerateToWriter(Writer *output, ASTProgram *prog, usize jobs, Reachability *reachable, bool expectChecks) {
+    VERIFY(output);
+    VERIFY(prog);
+    usize numModules = arrayLength(&prog->modules);
+    usize numWorkers = workerCount(prog, jobs);
+    Table *fnTypes = nameFunctionTypes(prog);
+    Codegen *workers = CALLOC(numWorkers, sizeof(*workers));
+    for(usize i = 0; i < numWorkers; ++i) {
+        codegen_init_internal(&workers[i], prog, fnTypes);
+        workers[i].reachable = reachable;
+        workers[i].expectChecks = expectChecks;
+    }
+
+    // With a single worker, modules are generated directly into the output in order.
+    // Otherwise, each module is collected separately and written in order when all are done.
+    Writer *moduleOutputs = NULL;
+    ModuleTask *tasks = CALLOC(numModules, sizeof(*tasks));
+    if(numWorkers > 1) {
+        moduleOutputs = CALLOC(numModules, sizeof(*moduleOutputs));
+    }
+    for(usize i = 0; i < numModules; ++i) {
+        tasks[i].workers = workers;
+        tasks[i].module = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        tasks[i].split = false;
+        tasks[i].header = NULL;
+        if(moduleOutputs) {
+            writerInitMemory(&moduleOutputs[i], 0);
+            tasks[i].source = &moduleOutputs[i];
+        } else {
+            tasks[i].source = output;
+        }
+    }
+
+    Codegen *cg = &workers[0];
+    cg->output = output;
+    cg->wholeProgram = true;
+    genHeader(cg);
+    ASTObj *mainFn = runModuleTasks(tasks, numModules, workers, numWorkers);
+    if(moduleOutputs) {
+        for(usize i = 0; i < numModules; ++i) {
+            usize length;
+            const char *data = writerData(&moduleOutputs[i], &length);
+            writerWrite(output, data, length);
+            writerFree(&moduleOutputs[i]);
+        }
+        FREE(moduleOutputs);
+    }
+    cg->output = output;
+    cg->mainFn = mainFn;
+    genEntryPoint(cg);
+
+    FREE(tasks);
+    for(usize i = 0; i < numWorkers; ++i) {
+        codegen_free_internal(&workers[i]);
+    }
+    FREE(workers);
+    freeFunctionTypeNames(fnTypes, numModules);
+    return writerFlush(output);
+}
+
+bool codegenGenerate(FILE *output, ASTProgram *prog, usize jobs, Reachability *reachable, bool expectChecks) {
+    VERIFY(output);
+    // Anything already written to [output] has to be written before the generated code.
+    fflush(output);
+    Writer writer;
+    writerInit(&writer, fileno(output), 0);
+    codegenGenerateToWriter(&writer, prog, jobs, reachable, expectChecks);
+    return writerFree(&writer);
+}
+
+/* Per-module output */
+
+// Write [length] bytes of [data] to [path] unless the file already contains exactly that.
+// Not touching unchanged files means build tools won't recompile them.
+static bool write_file_if_changed(const char *path, const char *data, usize length) {
+    int fd = open(path, O_RDONLY);
+    if(fd >= 0) {
+        struct stat st;
+        bool unchanged = false;
+        if(fstat(fd, &st) == 0 && (usize)st.st_size == length) {
+            char *existing = ALLOC(length + 1);
+            isize bytesRead = read(fd, existing, length + 1);
+            unchanged = bytesRead >= 0 && (usize)bytesRead == length && memcmp(existing, data, length) == 0;
+            FREE(existing);
+        }
+        close(fd);
+        if(unchanged) {
+            return true;
+        }
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        LOG_ERR("Failed to open '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    Writer writer;
+    writerInit(&writer, fd, 1);
+    writerWrite(&writer, data, length);
+    bool success = writerFree(&writer);
+    if(close(fd) < 0 || !success) {
+        LOG_ERR("Failed to write '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Write the output collected by the in-memory Writer [w] to '<outputDir>/<name><extension>'.
+static bool write_output_file(Writer *w, const char *outputDir, const char *name, const char *extension) {
+    String path = stringFormat("%s/%s%s", outputDir, name, extension);
+    usize length;
+    const char *data = writerData(w, &length);
+    bool success = write_file_if_changed(path, data, length);
+    stringFree(path);
+    return success;
+}
+
+static void collect_module_ids_callback(TableItem *item, bool is_last, void *id_array) {
+    UNUSED(is_last);
+    arrayPush((Array *)id_array, item->value);
+}
+
+static int compare_module_ids(const void *a, const void *b) {
+    ModuleID idA = *(ModuleID *)a, idB = *(ModuleID *)b;
+    return idA < idB ? -1 : idA > idB;
+}
+
+static void genModuleHeader(Codegen *cg, ASTModule *m, Array *structs) {
+    printLiteral(cg, "// File generated by ilc\n\n");
+    printLiteral(cg, "#ifndef ILC_module");
+    printString(cg, m->name);
+    printLiteral(cg, "_H\n#define ILC_module");
+    printString(cg, m->name);
+    printLiteral(cg, "_H\n\n");
+    printLiteral(cg, "#include \"" PRELUDE_HEADER_NAME "\"\n");
+    // Imported modules (sorted by ID so the output doesn't depend on the import table layout.)
+    Array imports; // Array<ModuleID>
+    arrayInit(&imports);
+    tableMap(&m->importedModules, collect_module_ids_callback, (void *)&imports);
+    qsort(imports.data, arrayLength(&imports), sizeof(*imports.data), compare_module_ids);
+    ARRAY_FOR(i, imports) {
+        ASTModule *imported = astProgramGetModule(cg->program, ARRAY_GET_AS(ModuleID, &imports, i));
+        printLiteral(cg, "#include \"");
+        printString(cg, imported->name);
+        printLiteral(cg, ".h\"\n");
+    }
+    arrayFree(&imports);
+    printLiteral(cg, "\n");
+
+    // Declare function and struct types. See block comment at top of this file.
+    printLiteral(cg, "// Struct & Function predeclarations:\n");
+    tableMap(&m->types, predecl_struct_types_cb, (void *)cg);
+    predeclFunctionTypes(cg, m);
+    printLiteral(cg, "// structs:\n");
+    ARRAY_FOR(i, *structs) {
+        genStructDefinition(cg, ARRAY_GET_AS(ASTObj *, structs, i));
+    }
+    printLiteral(cg, "// Module variables:\n");
+    ARRAY_FOR(i, m->variableDecls) {
+        genModuleVarPredeclaration(cg, ARRAY_GET_AS(ASTVarDeclStmt *, &m->variableDecls, i));
+    }
+    printLiteral(cg, "// predeclarations:\n");
+    Array objects; // Array<ASTObj *>
+    arrayInit(&objects);
+    scopeGetAllObjects(m->moduleScope, &objects);
+    genFunctionPredeclarations(cg, m->moduleScope, &objects);
+    ARRAY_FOR(i, *structs) {
+        ASTObj *st = ARRAY_GET_AS(ASTObj *, structs, i);
+        arrayClear(&objects);
+        scopeGetAllObjects(st->as.structure.scope, &objects);
+        genFunctionPredeclarations(cg, st->as.structure.scope, &objects);
+    }
+    printLiteral(cg, "// inline functions:\n");
+    arrayClear(&objects);
+    scopeGetAllObjects(m->moduleScope, &objects);
+    genInlineFunctionDefinitions(cg, m->moduleScope, &objects);
+    ARRAY_FOR(i, *structs) {
+        ASTObj *st = ARRAY_GET_AS(ASTObj *, structs, i);
+        arrayClear(&objects);
+        scopeGetAllObjects(st->as.structure.scope, &objects);
+        genInlineFunctionDefinitions(cg, st->as.structure.scope, &objects);
+    }
+    arrayFree(&objects);
+    printLiteral(cg, "\n#endif\n");
+}
+
+static void genModuleSource(Codegen *cg, ASTModule *m, Array *structs) {
+    printLiteral(cg, "// File generated by ilc\n\n");
+    printLiteral(cg, "#include \"");
+    printString(cg, m->name);
+    printLiteral(cg, ".h\"\n\n");
+    printLiteral(cg, "// Module variables:\n");
+    ARRAY_FOR(i, m->variableDecls) {
+        ASTVarDeclStmt *vdecl = ARRAY_GET_AS(ASTVarDeclStmt *, &m->variableDecls, i);
+        genModuleVarDecl(cg, vdecl);
+    }
+    printLiteral(cg, "// declarations:\n");
+    Array objects; // Array<ASTObj *>
+    arrayInit(&objects);
+    scopeGetAllObjects(m->moduleScope, &objects);
+    genFunctionDeclarations(cg, m->moduleScope, &objects);
+    ARRAY_FOR(i, *structs) {
+        ASTObj *st = ARRAY_GET_AS(ASTObj *, structs, i);
+        arrayClear(&objects);
+        scopeGetAllObjects(st->as.structure.scope, &objects);
+        genFunctionDeclarations(cg, st->as.structure.scope, &objects);
+    }
+    arrayFree(&objects);
+    if(cg->mainFn && cg->mainFn->ownerModule == m->id) {
+        genRuntimeDefinitions(cg);
+        genEntryPoint(cg);
+    }
+}
+
+bool codegenGenerateModules(const char *outputDir, ASTProgram *prog, usize jobs, const bool *generate, bool expectChecks) {
+    VERIFY(outputDir);
+    VERIFY(prog);
+    if(mkdir(outputDir, 0755) < 0 && errno != EEXIST) {
+        LOG_ERR("Failed to create directory '%s': %s\n", outputDir, strerror(errno));
+        return false;
+    }
+    usize numModules = arrayLength(&prog->modules);
+    usize numWorkers = workerCount(prog, jobs);
+    Table *fnTypes = nameFunctionTypes(prog);
+    Codegen *workers = CALLOC(numWorkers, sizeof(*workers));
+    for(usize i = 0; i < numWorkers; ++i) {
+        codegen_init_internal(&workers[i], prog, fnTypes);
+        workers[i].expectChecks = expectChecks;
+    }
+    // Writer<header, source> for every generated module.
+    Writer *moduleOutputs = CALLOC(numModules * 2, sizeof(*moduleOutputs));
+    ModuleTask *tasks = CALLOC(numModules, sizeof(*tasks));
+    usize numTasks = 0;
+    for(usize i = 0; i < numModules; ++i) {
+        ASTModule *m = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        if(generate && !generate[m->id]) {
+            continue;
+        }
+        ModuleTask *task = &tasks[numTasks];
+        writerInitMemory(&moduleOutputs[numTasks * 2], 0);
+        writerInitMemory(&moduleOutputs[numTasks * 2 + 1], 0);
+        task->workers = workers;
+        task->module = m;
+        task->split = true;
+        task->header = &moduleOutputs[numTasks * 2];
+        task->source = &moduleOutputs[numTasks * 2 + 1];
+        numTasks++;
+    }
+    runModuleTasks(tasks, numTasks, workers, numWorkers);
+
+    Writer prelude;
+    writerInitMemory(&prelude, 0);
+    Codegen *cg = &workers[0];
+    cg->output = &prelude;
+    cg->wholeProgram = false;
+    printLiteral(cg, "// File generated by ilc\n\n");
+    printLiteral(cg, "#ifndef ILC_PRELUDE_H\n#define ILC_PRELUDE_H\n\n");
+    genPrelude(cg);
+    printLiteral(cg, "#endif\n");
+    cg->output = NULL;
+    bool success = write_output_file(&prelude, outputDir, PRELUDE_HEADER_NAME, "");
+    writerFree(&prelude);
+
+    for(usize i = 0; success && i < numTasks; ++i) {
+        success = write_output_file(tasks[i].header, outputDir, tasks[i].module->name, ".h") &&
+                  write_output_file(tasks[i].source, outputDir, tasks[i].module->name, ".c");
+    }
+
+    for(usize i = 0; i < numTasks * 2; ++i) {
+        writerFree(&moduleOutputs[i]);
+    }
+    FREE(moduleOutputs);
+    FREE(tasks);
+    for(usize i = 0; i < numWorkers; ++i) {
+        codegen_free_internal(&workers[i]);
+    }
+    FREE(workers);
+    freeFunctionTypeNames(fnTypes, numModules);
+    return success;
 }
@@ -83,6 +83,7 @@ void compilerInit(Compiler *c) {
     c->current_file = 0; // 0 is a valid FileID, but initialize with it so current_file is a known value.
     arrayInit(&c->files);
     arrayInit(&c->errors);
+    c->sources = NULL;
 }
 
 static void free_file_callback(void *f, void *cl) {
@@ -106,10 +107,36 @@ void compilerFree(Compiler *c) {
     arrayFree(&c->errors);
 }
 
+void compilerClear(Compiler *c) {
+    c->current_file_initialized = false;
+    c->current_file = 0; // see comment in compilerInit().
+    arrayMap(&c->files, free_file_callback, NULL);
+    arrayClear(&c->files);
+    arrayMap(&c->errors, free_error_callback, NULL);
+    arrayClear(&c->errors);
+}
+
+void compilerSetSources(Compiler *c, Table *sources) {
+    c->sources = sources;
+}
+
+bool compilerHasFile(Compiler *c, const char *path) {
+    if(c->sources && tableGet(c->sources, (void *)path) != NULL) {
+        return true;
+    }
+    return doesFileExist(".", path);
+}
+
 FileID compilerAddFile(Compiler *c, const char *path) {
     File *f;
     NEW0(f);
     fileInit(f, path);
+    TableItem *source = c->sources ? tableGet(c->sources, (void *)path) : NULL;
+    if(source) {
+        // Including the nul terminator like fileRead().
+        String contents = (String)source->value;
+        f->contents = stringNCopy(contents, stringLength(contents) + 1);
+    }
     return (FileID)arrayPush(&c->files, (void *)f);
 }
 
@@ -133,6 +160,12 @@ FileID compilerNextFile(Compiler *c) {
     return c->current_file;
 }
 
+void compilerSetCurrentFile(Compiler *c, FileID id) {
+    VERIFY(id < c->files.used);
+    c->current_file = id;
+    c->current_file_initialized = true;
+}
+
 File *compilerGetFile(Compiler *c, FileID id) {
     // arrayGet() will return NULL if the index is out of the array bounds.
     return ARRAY_GET_AS(File *, &c->files, (int)id);
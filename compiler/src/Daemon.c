@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <string.h> // strlen(), strerror(), memcpy()
+#include <errno.h>
+#include <signal.h> // sigaction()
+#include <fcntl.h> // fcntl()
+#include <unistd.h> // read(), write(), close(), dup(), dup2(), chdir(), getcwd(), unlink()
+#include <sys/socket.h> // socket(), bind(), listen(), accept(), connect(), sendmsg(), recvmsg(), setsockopt()
+#include <sys/un.h> // struct sockaddr_un
+#include <sys/time.h> // struct timeval
+#include "common.h"
+#include "memory.h"
+#include "Strings.h"
+#include "Daemon.h"
+
+extern char **environ;
+
+// The amount of files passed with a request (stdin, stdout & stderr.)
+#define REQUEST_FILES 3
+// Requests bigger than this are rejected.
+#define MAX_REQUEST_SIZE ((u32)16 * 1024 * 1024)
+// Clients that don't send their request (or read the reply) in this time are dropped, so they can't stall the daemon.
+#define CLIENT_TIMEOUT_SECONDS 5
+
+/* Protocol
+ * request: u32 payload length (sent with the files), payload
+ *          payload: u32 argc, u32 envc, cwd, argv[0..argc), environ[0..envc) (all strings are nul-terminated.)
+ * reply:   u32 exit status
+ * All integers are little endian.
+ */
+
+static void put_u32(char bytes[4], u32 value) {
+    bytes[0] = (char)value;
+    bytes[1] = (char)(value >> 8);
+    bytes[2] = (char)(value >> 16);
+    bytes[3] = (char)(value >> 24);
+}
+
+static u32 get_u32(const char bytes[4]) {
+    const u8 *b = (const u8 *)bytes;
+    return (u32)b[0] | (u32)b[1] << 8 | (u32)b[2] << 16 | (u32)b[3] << 24;
+}
+
+static bool write_all(int fd, const char *data, usize length) {
+    while(length > 0) {
+        isize written = send(fd, data, length, MSG_NOSIGNAL);
+        if(written < 0 && errno == EINTR) {
+            continue;
+        } else if(written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= (usize)written;
+    }
+    return true;
+}
+
+static bool read_all(int fd, char *data, usize length) {
+    while(length > 0) {
+        isize got = read(fd, data, length);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        } else if(got <= 0) {
+            return false;
+        }
+        data += got;
+        length -= (usize)got;
+    }
+    return true;
+}
+
+static void append_u32(String *payload, u32 value) {
+    char bytes[4];
+    put_u32(bytes, value);
+    stringNAppend(payload, bytes, sizeof(bytes));
+}
+
+static void append_string(String *payload, const char *s) {
+    // Including the nul terminator.
+    stringNAppend(payload, s, strlen(s) + 1);
+}
+
+/* Client */
+
+bool daemonForward(const char *socketPath, int argc, char **argv, int *status) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        return false;
+    }
+    if(connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return false;
+    }
+    char cwd[4096];
+    if(getcwd(cwd, sizeof(cwd)) == NULL) {
+        close(fd);
+        return false;
+    }
+
+    usize envc = 0;
+    while(environ && environ[envc]) {
+        envc++;
+    }
+    String payload = stringNew(256);
+    append_u32(&payload, (u32)argc);
+    append_u32(&payload, (u32)envc);
+    append_string(&payload, cwd);
+    for(int i = 0; i < argc; ++i) {
+        append_string(&payload, argv[i]);
+    }
+    for(usize i = 0; i < envc; ++i) {
+        append_string(&payload, environ[i]);
+    }
+
+    // The length is sent together with the files.
+    char header[4];
+    put_u32(header, (u32)stringLength(payload));
+    struct iovec iov = {.iov_base = header, .iov_len = sizeof(header)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FILES)];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * REQUEST_FILES);
+    int files[REQUEST_FILES] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    memcpy(CMSG_DATA(cmsg), files, sizeof(files));
+
+    // Anything buffered has to be written before the daemon writes to the same files.
+    fflush(stdout);
+    fflush(stderr);
+    bool success = sendmsg(fd, &msg, MSG_NOSIGNAL) == (isize)sizeof(header) &&
+                   write_all(fd, payload, stringLength(payload));
+    stringFree(payload);
+    char reply[4];
+    success = success && read_all(fd, reply, sizeof(reply));
+    close(fd);
+    if(success) {
+        *status = (int)get_u32(reply);
+    }
+    return success;
+}
+
+/* Server */
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void stop_signal_handler(int signal) {
+    UNUSED(signal);
+    stop_requested = 1;
+}
+
+typedef struct request {
+    int files[REQUEST_FILES];
+    char *payload;
+    const char *cwd;
+    int argc;
+    char **argv; // NULL-terminated.
+    char **environ; // NULL-terminated.
+} Request;
+
+static void free_request(Request *r) {
+    for(int i = 0; i < REQUEST_FILES; ++i) {
+        if(r->files[i] >= 0) {
+            close(r->files[i]);
+        }
+    }
+    FREE(r->payload);
+    FREE(r->argv);
+    FREE(r->environ);
+}
+
+// Split [count] nul-terminated strings off the payload into a NULL-terminated array.
+static char **split_strings(char **next, char *end, u32 count) {
+    char **strings = CALLOC((usize)count + 1, sizeof(*strings));
+    for(u32 i = 0; i < count; ++i) {
+        char *terminator = memchr(*next, '\0', (usize)(end - *next));
+        if(terminator == NULL) {
+            FREE(strings);
+            return NULL;
+        }
+        strings[i] = *next;
+        *next = terminator + 1;
+    }
+    return strings;
+}
+
+static bool receive_request(int connection, Request *r) {
+    for(int i = 0; i < REQUEST_FILES; ++i) {
+        r->files[i] = -1;
+    }
+    r->payload = NULL;
+    r->argv = r->environ = NULL;
+
+    char header[4];
+    struct iovec iov = {.iov_base = header, .iov_len = sizeof(header)};
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int) * REQUEST_FILES)];
+    } control;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    isize got;
+    while((got = recvmsg(connection, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) {}
+    struct cmsghdr *cmsg = got > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if(cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(r->files))) {
+        memcpy(r->files, CMSG_DATA(cmsg), sizeof(r->files));
+    }
+    // The rest of the header (if it was split) is read without any files.
+    if(r->files[0] < 0 || !read_all(connection, header + got, sizeof(header) - (usize)got)) {
+        return false;
+    }
+
+    u32 length = get_u32(header);
+    if(length < 8 || length > MAX_REQUEST_SIZE) {
+        return false;
+    }
+    r->payload = ALLOC(length);
+    if(!read_all(connection, r->payload, length)) {
+        return false;
+    }
+    u32 argc = get_u32(r->payload);
+    u32 envc = get_u32(r->payload + 4);
+    // Every string is at least one byte, so the counts can't be bigger than the payload.
+    if(argc == 0 || argc > length || envc > length) {
+        return false;
+    }
+    char *next = r->payload + 8, *end = r->payload + length;
+    r->cwd = next;
+    next = memchr(next, '\0', (usize)(end - next));
+    if(next++ == NULL) {
+        return false;
+    }
+    r->argc = (int)argc;
+    r->argv = split_strings(&next, end, argc);
+    r->environ = r->argv ? split_strings(&next, end, envc) : NULL;
+    return r->environ != NULL;
+}
+
+// Run a request with the files, directory & environment of the client.
+static int run_request(Request *r, DaemonHandler handler, void *context) {
+    if(chdir(r->cwd) < 0) {
+        dprintf(r->files[2], "ilc daemon: Failed to change directory to '%s': %s\n", r->cwd, strerror(errno));
+        return 1;
+    }
+    int saved[REQUEST_FILES];
+    fflush(stdout);
+    fflush(stderr);
+    // The files redirected so far are restored even if redirecting the rest fails.
+    int redirected = 0, error = 0;
+    for(; redirected < REQUEST_FILES; ++redirected) {
+        saved[redirected] = dup(redirected);
+        if(saved[redirected] < 0) {
+            error = errno;
+            break;
+        }
+        if(dup2(r->files[redirected], redirected) < 0) {
+            error = errno;
+            close(saved[redirected]);
+            break;
+        }
+    }
+    int status = 1;
+    if(redirected == REQUEST_FILES) {
+        char **savedEnviron = environ;
+        environ = r->environ;
+        status = handler(r->argc, r->argv, context);
+        environ = savedEnviron;
+        fflush(stdout);
+        fflush(stderr);
+    }
+    for(int i = 0; i < redirected; ++i) {
+        if(dup2(saved[i], i) < 0 && error == 0) {
+            error = errno;
+        }
+        close(saved[i]);
+    }
+    if(error != 0) {
+        dprintf(r->files[2], "ilc daemon: Failed to redirect the standard files: %s\n", strerror(error));
+        status = 1;
+    }
+    return status;
+}
+
+static int listen_on(const char *socketPath) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        LOG_ERR("The socket path '%s' is too long.\n", socketPath);
+        return -1;
+    }
+    strcpy(address.sun_path, socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        LOG_ERR("Failed to create a socket: %s\n", strerror(errno));
+        return -1;
+    }
+    // Replace the socket of a daemon that didn't stop cleanly.
+    unlink(socketPath);
+    if(bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+        LOG_ERR("Failed to listen on '%s': %s\n", socketPath, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool daemonServe(const char *socketPath, DaemonHandler handler, void *context) {
+    int fd = listen_on(socketPath);
+    if(fd < 0) {
+        return false;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    // No SA_RESTART so accept() is interrupted.
+    action.sa_handler = stop_signal_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // Clients that go away must not kill the daemon.
+    signal(SIGPIPE, SIG_IGN);
+
+    while(!stop_requested) {
+        int connection = accept(fd, NULL, NULL);
+        if(connection < 0) {
+            if(errno != EINTR) {
+                LOG_ERR("Failed to accept a connection: %s\n", strerror(errno));
+            }
+            continue;
+        }
+        // The C compiler processes started by requests don't need the connection.
+        fcntl(connection, F_SETFD, FD_CLOEXEC);
+        struct timeval timeout = {.tv_sec = CLIENT_TIMEOUT_SECONDS};
+        if(setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0
+           || setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+            LOG_ERR("Failed to set the timeout of a connection: %s\n", strerror(errno));
+            close(connection);
+            continue;
+        }
+        Request r;
+        if(receive_request(connection, &r)) {
+            char reply[4];
+            put_u32(reply, (u32)run_request(&r, handler, context));
+            write_all(connection, reply, sizeof(reply));
+        }
+        free_request(&r);
+        close(connection);
+    }
+    close(fd);
+    unlink(socketPath);
+    return true;
+}
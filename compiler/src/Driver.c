@@ -0,0 +1,692 @@
+#include <stdio.h>
+#include <string.h> // strerror()
+#include <ctype.h> // isspace()
+#include <errno.h>
+#include <time.h> // clock_gettime()
+#include <unistd.h> // access(), unlink()
+#include <sys/stat.h> // stat()
+#include <spawn.h> // posix_spawnp()
+#include <sys/wait.h> // waitpid()
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Strings.h"
+#include "Table.h"
+#include "Sha256.h"
+#include "ObjectCache.h"
+#include "BuildState.h"
+#include "Compiler.h"
+#include "Codegen.h"
+#include "Reachability.h"
+#include "ModuleInterface.h"
+#include "Ast/Program.h"
+#include "Driver.h"
+
+extern char **environ;
+
+typedef struct compile_unit {
+    String source, object;
+    char key[SHA256_HEX_SIZE]; // The object cache key (empty if not available.)
+    bool upToDate; // The object from the previous build can be used as is.
+    pid_t pid; // -1 when not running.
+    struct timespec start;
+} CompileUnit;
+
+static f64 milliseconds_since(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)(now.tv_sec - start->tv_sec) * 1000.0 + (f64)(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+// Split [command] on whitespace and push the pieces (owned Strings) to [args].
+static void push_command(Array *args, const char *command) {
+    const char *p = command;
+    while(*p) {
+        while(*p && isspace((unsigned char)*p)) {
+            p++;
+        }
+        const char *start = p;
+        while(*p && !isspace((unsigned char)*p)) {
+            p++;
+        }
+        if(p > start) {
+            arrayPush(args, (void *)stringNCopy(start, (usize)(p - start)));
+        }
+    }
+}
+
+static void free_string_callback(void *s, void *cl) {
+    UNUSED(cl);
+    stringFree((String)s);
+}
+
+static void free_args(Array *args) {
+    arrayMap(args, free_string_callback, NULL);
+    arrayFree(args);
+}
+
+// Start [args] (Array<String>) without waiting for it.
+// Returns the pid of the new process, or -1 on failure (an error is printed.)
+static pid_t spawn(Array *args) {
+    // posix_spawnp() expects a NULL terminated argv.
+    char **argv = CALLOC(arrayLength(args) + 1, sizeof(*argv));
+    ARRAY_FOR(i, *args) {
+        argv[i] = ARRAY_GET_AS(char *, args, i);
+    }
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+    FREE(argv);
+    if(err != 0) {
+        LOG_ERR("Failed to run '%s': %s\n", ARRAY_GET_AS(char *, args, 0), strerror(err));
+        return -1;
+    }
+    return pid;
+}
+
+// Wait for any child process to exit.
+// Returns its pid (or -1 on failure) and stores whether it exited successfully in [success].
+static pid_t wait_any(bool *success) {
+    int status;
+    pid_t pid;
+    while((pid = waitpid(-1, &status, 0)) < 0 && errno == EINTR) {
+        // Interrupted, try again.
+    }
+    *success = pid >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return pid;
+}
+
+// Wait for the child process [pid] to exit (ignoring its status.)
+static void wait_for(pid_t pid) {
+    while(waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+        // Interrupted, try again.
+    }
+}
+
+static void collect_import_callback(TableItem *item, bool is_last, void *imports) {
+    UNUSED(is_last);
+    arrayPush((Array *)imports, item->value);
+}
+
+// Mark [id] and all the modules it (transitively) imports in [included].
+static void mark_included_modules(ASTProgram *prog, ModuleID id, bool *included) {
+    if(included[id]) {
+        return;
+    }
+    included[id] = true;
+    Array imports; // Array<ModuleID>
+    arrayInit(&imports);
+    tableMap(&astProgramGetModule(prog, id)->importedModules, collect_import_callback, (void *)&imports);
+    ARRAY_FOR(i, imports) {
+        mark_included_modules(prog, ARRAY_GET_AS(ModuleID, &imports, i), included);
+    }
+    arrayFree(&imports);
+}
+
+// Compute the object cache key of the unit of module [id].
+// The key covers everything the object depends on: the C compiler command,
+// the source, and every generated header the source includes.
+static bool compute_unit_key(BuildOptions *opts, ASTProgram *prog, ModuleID id, CompileUnit *unit) {
+    Sha256 h;
+    sha256Init(&h);
+    // Hashed with the nul terminator to separate it from the files.
+    sha256Update(&h, opts->cc, strlen(opts->cc) + 1);
+    bool success = sha256UpdateFile(&h, unit->source);
+    String prelude = stringFormat("%s/" PRELUDE_HEADER_NAME, opts->buildDir);
+    success = success && sha256UpdateFile(&h, prelude);
+    stringFree(prelude);
+    usize numModules = arrayLength(&prog->modules);
+    bool *included = CALLOC(numModules, sizeof(*included));
+    mark_included_modules(prog, id, included);
+    for(usize i = 0; i < numModules && success; ++i) {
+        if(!included[i]) {
+            continue;
+        }
+        ASTModule *m = astProgramGetModule(prog, (ModuleID)i);
+        // The name is hashed as well since the headers are included by name.
+        sha256Update(&h, m->name, stringLength(m->name) + 1);
+        String header = stringFormat("%s/%s.h", opts->buildDir, m->name);
+        success = sha256UpdateFile(&h, header);
+        stringFree(header);
+    }
+    FREE(included);
+    if(success) {
+        sha256FinalHex(&h, unit->key);
+    }
+    return success;
+}
+
+static bool start_compile_unit(BuildOptions *opts, CompileUnit *unit) {
+    Array args; // Array<String>
+    arrayInit(&args);
+    push_command(&args, opts->cc);
+    arrayPush(&args, (void *)stringCopy("-c"));
+    arrayPush(&args, (void *)stringDuplicate(unit->source));
+    arrayPush(&args, (void *)stringCopy("-o"));
+    arrayPush(&args, (void *)stringDuplicate(unit->object));
+    clock_gettime(CLOCK_MONOTONIC, &unit->start);
+    unit->pid = spawn(&args);
+    free_args(&args);
+    return unit->pid >= 0;
+}
+
+// Compile all the [units] running up to [opts->jobs] compilers at once.
+// On failure, no new compilers are started, but the running ones are waited for
+// (by pid if waiting for any of them failed, so none is left running.)
+static bool compile_units(BuildOptions *opts, CompileUnit *units, usize numUnits) {
+    usize jobs = opts->jobs > 0 ? opts->jobs : 1;
+    usize next = 0, running = 0, done = 0;
+    bool failed = false;
+    while(running > 0 || (!failed && next < numUnits)) {
+        while(!failed && next < numUnits && running < jobs) {
+            CompileUnit *unit = &units[next++];
+            if(unit->upToDate) {
+                done++;
+                if(opts->printTimes) {
+                    LOG_MSG("[%zu/%zu] '%s' is up to date.\n", done, numUnits, unit->source);
+                }
+                continue;
+            }
+            if(opts->cache && unit->key[0] != '\0' && objectCacheLookup(opts->cache, unit->key, unit->object)) {
+                done++;
+                if(opts->printTimes) {
+                    LOG_MSG("[%zu/%zu] Found '%s' in the object cache.\n", done, numUnits, unit->source);
+                }
+                continue;
+            }
+            if(start_compile_unit(opts, unit)) {
+                running++;
+            } else {
+                failed = true;
+            }
+        }
+        if(running == 0) {
+            break;
+        }
+        bool success;
+        pid_t pid = wait_any(&success);
+        if(pid < 0) {
+            LOG_ERR("Failed to wait for the C compiler: %s\n", strerror(errno));
+            failed = true;
+            for(usize i = 0; i < numUnits; ++i) {
+                if(units[i].pid >= 0) {
+                    wait_for(units[i].pid);
+                    units[i].pid = -1;
+                }
+            }
+            break;
+        }
+        CompileUnit *unit = NULL;
+        for(usize i = 0; i < numUnits; ++i) {
+            if(units[i].pid == pid) {
+                unit = &units[i];
+                break;
+            }
+        }
+        if(unit == NULL) {
+            // Not one of ours.
+            continue;
+        }
+        unit->pid = -1;
+        running--;
+        done++;
+        if(!success) {
+            LOG_ERR("Failed to compile '%s'.\n", unit->source);
+            failed = true;
+            continue;
+        }
+        if(opts->printTimes) {
+            LOG_MSG("[%zu/%zu] Compiled '%s' in %.2f ms.\n", done, numUnits, unit->source, milliseconds_since(&unit->start));
+        }
+        if(opts->cache && unit->key[0] != '\0') {
+            objectCacheStore(opts->cache, unit->key, unit->object);
+        }
+    }
+    return !failed;
+}
+
+static bool link_units(BuildOptions *opts, CompileUnit *units, usize numUnits) {
+    Array args; // Array<String>
+    arrayInit(&args);
+    push_command(&args, opts->cc);
+    arrayPush(&args, (void *)stringCopy("-o"));
+    arrayPush(&args, (void *)stringCopy(opts->output));
+    for(usize i = 0; i < numUnits; ++i) {
+        arrayPush(&args, (void *)stringDuplicate(units[i].object));
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = spawn(&args);
+    free_args(&args);
+    if(pid < 0) {
+        return false;
+    }
+    bool success;
+    if(wait_any(&success) != pid || !success) {
+        LOG_ERR("Failed to link '%s'.\n", opts->output);
+        return false;
+    }
+    if(opts->printTimes) {
+        LOG_MSG("Linked '%s' in %.2f ms.\n", opts->output, milliseconds_since(&start));
+    }
+    return true;
+}
+
+/* Incremental builds */
+
+// Hash everything other than the sources that the build output depends on:
+// the C compiler command, the main file, the code generation options, and the ilc executable itself.
+static void compute_config_hash(BuildOptions *opts, char hash[SHA256_HEX_SIZE]) {
+    Sha256 h;
+    sha256Init(&h);
+    sha256Update(&h, opts->cc, strlen(opts->cc) + 1);
+    sha256Update(&h, opts->mainFile, strlen(opts->mainFile) + 1);
+    sha256Update(&h, &opts->unity, sizeof(opts->unity));
+    sha256Update(&h, &opts->expectChecks, sizeof(opts->expectChecks));
+    struct stat st;
+    if(stat("/proc/self/exe", &st) == 0) {
+        u64 identity[3] = {(u64)st.st_size, (u64)st.st_mtim.tv_sec, (u64)st.st_mtim.tv_nsec};
+        sha256Update(&h, identity, sizeof(identity));
+    }
+    sha256FinalHex(&h, hash);
+}
+
+static String state_path(BuildOptions *opts) {
+    return stringFormat("%s/" BUILD_STATE_FILE_NAME, opts->buildDir);
+}
+
+static bool file_exists(const char *path) {
+    return access(path, F_OK) == 0;
+}
+
+bool driverIsUpToDate(BuildOptions *opts) {
+    if(!file_exists(opts->output)) {
+        return false;
+    }
+    BuildState state;
+    buildStateInit(&state);
+    String path = state_path(opts);
+    char config[SHA256_HEX_SIZE];
+    compute_config_hash(opts, config);
+    bool upToDate = buildStateLoad(&state, path) && strcmp(state.config, config) == 0 && buildStateSourcesUnchanged(&state);
+    stringFree(path);
+    buildStateFree(&state);
+    return upToDate;
+}
+
+static String interface_path(BuildOptions *opts, const char *name) {
+    return stringFormat("%s/%s" MODULE_INTERFACE_EXTENSION, opts->buildDir, name);
+}
+
+// Check if the generated files of the module [name] (including its interface) exist.
+static bool module_outputs_exist(BuildOptions *opts, const char *name) {
+    static const char *const extensions[] = {".c", ".h", ".o", MODULE_INTERFACE_EXTENSION};
+    bool exist = true;
+    for(usize i = 0; exist && i < sizeof(extensions) / sizeof(extensions[0]); ++i) {
+        String path = stringFormat("%s/%s%s", opts->buildDir, name, extensions[i]);
+        exist = file_exists(path);
+        stringFree(path);
+    }
+    return exist;
+}
+
+#define INTERFACE_USABLE ((void *)1)
+#define INTERFACE_UNUSABLE ((void *)2)
+
+// Check if the source of [m] is unchanged since the previous build, and all its generated files exist.
+static bool module_unchanged(BuildOptions *opts, ModuleState *m) {
+    char hash[SHA256_HEX_SIZE];
+    return buildStateHashSource(m->path, hash) && strcmp(hash, m->sourceHash) == 0 && module_outputs_exist(opts, m->name);
+}
+
+// Check if the interface of [m] can be used: the source of [m] and of every
+// module it (transitively) imports must be unchanged since the previous build.
+// checked: Table<char *, void *> (module name -> INTERFACE_USABLE/INTERFACE_UNUSABLE.)
+static bool can_use_interface(BuildOptions *opts, BuildState *previous, ModuleState *m, Table *checked) {
+    TableItem *item = tableGet(checked, (void *)m->name);
+    if(item) {
+        return item->value == INTERFACE_USABLE;
+    }
+    // Marked as unusable while it's being checked in case of cyclic imports.
+    tableSet(checked, (void *)m->name, INTERFACE_UNUSABLE);
+    bool usable = module_unchanged(opts, m);
+    for(usize i = 0; usable && i < arrayLength(&m->imports); ++i) {
+        ImportState *import = ARRAY_GET_AS(ImportState *, &m->imports, i);
+        ModuleState *imported = buildStateGetModule(previous, import->name);
+        usable = imported && can_use_interface(opts, previous, imported, checked);
+    }
+    tableSet(checked, (void *)m->name, usable ? INTERFACE_USABLE : INTERFACE_UNUSABLE);
+    return usable;
+}
+
+void driverFindModuleInterfaces(BuildOptions *opts, Table *interfaces, Table *skipBodies) {
+    if(opts->unity) {
+        // The whole program is generated, so all the modules have to be parsed.
+        return;
+    }
+    BuildState previous;
+    buildStateInit(&previous);
+    String path = state_path(opts);
+    char config[SHA256_HEX_SIZE];
+    compute_config_hash(opts, config);
+    if(buildStateLoad(&previous, path) && strcmp(previous.config, config) == 0) {
+        Table checked;
+        tableInit(&checked, NULL, NULL);
+        ARRAY_FOR(i, previous.modules) {
+            ModuleState *m = ARRAY_GET_AS(ModuleState *, &previous.modules, i);
+            // The main module is never imported.
+            if(strcmp(m->path, opts->mainFile) == 0) {
+                continue;
+            }
+            if(can_use_interface(opts, &previous, m, &checked)) {
+                tableSet(interfaces, (void *)stringCopy(m->name), (void *)interface_path(opts, m->name));
+            } else if(module_unchanged(opts, m)) {
+                tableSet(skipBodies, (void *)stringCopy(m->name), (void *)stringCopy(m->path));
+            }
+        }
+        tableFree(&checked);
+    }
+    stringFree(path);
+    buildStateFree(&previous);
+}
+
+static void free_interface_callback(TableItem *item, bool is_last, void *cl) {
+    UNUSED(is_last);
+    UNUSED(cl);
+    stringFree((String)item->key);
+    stringFree((String)item->value);
+}
+
+void driverFreeModuleInterfaces(Table *interfaces) {
+    tableMap(interfaces, free_interface_callback, NULL);
+    tableFree(interfaces);
+}
+
+static const char *module_source_path(Compiler *c, BuildState *previous, ASTString name) {
+    ARRAY_FOR(i, c->files) {
+        File *f = ARRAY_GET_AS(File *, &c->files, i);
+        if(strcmp(f->fileNameNoExtension, name) == 0) {
+            return f->path;
+        }
+    }
+    // Modules loaded from their interface aren't parsed, so they don't have a File.
+    ModuleState *m = buildStateGetModule(previous, name);
+    VERIFY(m);
+    return m->path;
+}
+
+typedef struct incremental_state {
+    BuildState previous; // Empty if there is no usable previous state.
+    Table moduleIDs; // Table<char *, ModuleID> (module name -> id in the current program.)
+    bool *generate; // Modules that have to be generated (indexed by ModuleID.)
+    bool *generated; // Modules that were generated already.
+    char (*sourceHashes)[SHA256_HEX_SIZE];
+    char (*interfaceHashes)[SHA256_HEX_SIZE];
+} IncrementalState;
+
+// Check if the interface of any module imported by [m] changed since [m] was last generated.
+static bool imported_interface_changed(IncrementalState *s, ModuleState *m) {
+    ARRAY_FOR(i, m->imports) {
+        ImportState *import = ARRAY_GET_AS(ImportState *, &m->imports, i);
+        TableItem *item = tableGet(&s->moduleIDs, (void *)import->name);
+        if(item == NULL || strcmp(s->interfaceHashes[(ModuleID)item->value], import->interfaceHash) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Generate all the modules that changed, and then (in "waves") the modules importing
+// modules whose interface changed, until no more interfaces change.
+// Modules in the same wave are generated in parallel.
+static bool generate_changed_modules(BuildOptions *opts, IncrementalState *s, ASTProgram *prog) {
+    usize numModules = arrayLength(&prog->modules);
+    bool *wave = CALLOC(numModules, sizeof(*wave));
+    bool success = true;
+    while(success) {
+        bool waveIsEmpty = true;
+        for(usize i = 0; i < numModules; ++i) {
+            wave[i] = s->generate[i] && !s->generated[i];
+            waveIsEmpty = waveIsEmpty && !wave[i];
+        }
+        if(waveIsEmpty) {
+            break;
+        }
+        if(opts->beforeGenerate && !opts->beforeGenerate(opts->beforeGenerateContext, prog, wave)) {
+            success = false;
+            break;
+        }
+        if(!codegenGenerateModules(opts->buildDir, prog, opts->jobs, wave, opts->expectChecks)) {
+            success = false;
+            break;
+        }
+        for(usize i = 0; success && i < numModules; ++i) {
+            if(!wave[i]) {
+                continue;
+            }
+            s->generated[i] = true;
+            // The interface of a module is its generated header.
+            String header = stringFormat("%s/%s.h", opts->buildDir, astProgramGetModule(prog, (ModuleID)i)->name);
+            if(!buildStateHashSource(header, s->interfaceHashes[i])) {
+                LOG_ERR("Failed to read '%s'.\n", header);
+                success = false;
+            }
+            stringFree(header);
+        }
+        for(usize i = 0; i < numModules; ++i) {
+            if(!s->generate[i]) {
+                ModuleState *m = buildStateGetModule(&s->previous, astProgramGetModule(prog, (ModuleID)i)->name);
+                s->generate[i] = imported_interface_changed(s, m);
+            }
+        }
+    }
+    FREE(wave);
+    return success;
+}
+
+static void collect_import_ids_callback(TableItem *item, bool is_last, void *ids) {
+    UNUSED(is_last);
+    arrayPush((Array *)ids, item->value);
+}
+
+static bool save_state(BuildOptions *opts, IncrementalState *s, Compiler *c, ASTProgram *prog) {
+    BuildState state;
+    buildStateInit(&state);
+    compute_config_hash(opts, state.config);
+    // Note: the per-module arrays are indexed by ModuleID (not the index in prog->modules.)
+    ARRAY_FOR(i, prog->modules) {
+        ASTModule *m = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        ModuleState *ms = buildStateAddModule(&state, m->name, module_source_path(c, &s->previous, m->name));
+        strcpy(ms->sourceHash, s->sourceHashes[m->id]);
+        strcpy(ms->interfaceHash, s->interfaceHashes[m->id]);
+        Array imports; // Array<ModuleID>
+        arrayInit(&imports);
+        tableMap(&m->importedModules, collect_import_ids_callback, (void *)&imports);
+        ARRAY_FOR(j, imports) {
+            ModuleID id = ARRAY_GET_AS(ModuleID, &imports, j);
+            moduleStateAddImport(ms, astProgramGetModule(prog, id)->name, s->interfaceHashes[id]);
+        }
+        arrayFree(&imports);
+    }
+    String path = state_path(opts);
+    bool success = buildStateSave(&state, path);
+    stringFree(path);
+    buildStateFree(&state);
+    return success;
+}
+
+// The name (without an extension) of the translation unit of a unity build.
+#define UNITY_UNIT_NAME "ilc_unity"
+
+static bool build_unity(BuildOptions *opts, Compiler *c, ASTProgram *prog) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    usize numModules = arrayLength(&prog->modules);
+    String statePath = state_path(opts);
+    // If this build fails, the build directory won't match the previous state anymore.
+    unlink(statePath);
+    stringFree(statePath);
+    if(mkdir(opts->buildDir, 0755) < 0 && errno != EEXIST) {
+        LOG_ERR("Failed to create directory '%s': %s\n", opts->buildDir, strerror(errno));
+        return false;
+    }
+
+    CompileUnit unit;
+    unit.source = stringFormat("%s/" UNITY_UNIT_NAME ".c", opts->buildDir);
+    unit.object = stringFormat("%s/" UNITY_UNIT_NAME ".o", opts->buildDir);
+    unit.key[0] = '\0';
+    unit.upToDate = false;
+    unit.pid = -1;
+    FILE *output = fopen(unit.source, "w");
+    bool success = output != NULL;
+    if(success) {
+        Reachability reachable;
+        reachabilityInit(&reachable);
+        reachabilityAnalyze(&reachable, prog);
+        success = codegenGenerate(output, prog, opts->jobs, &reachable, opts->expectChecks);
+        reachabilityFree(&reachable);
+        success = fclose(output) == 0 && success;
+    }
+    if(!success) {
+        LOG_ERR("Failed to write '%s'.\n", unit.source);
+    }
+    if(success && opts->cache) {
+        // The unit doesn't include any generated headers.
+        Sha256 h;
+        sha256Init(&h);
+        sha256Update(&h, opts->cc, strlen(opts->cc) + 1);
+        if(sha256UpdateFile(&h, unit.source)) {
+            sha256FinalHex(&h, unit.key);
+        }
+    }
+    success = success && compile_units(opts, &unit, 1) && link_units(opts, &unit, 1);
+
+    // Only the sources are needed to know if the next build is up to date (see driverIsUpToDate()).
+    IncrementalState s;
+    buildStateInit(&s.previous);
+    s.sourceHashes = CALLOC(numModules, sizeof(*s.sourceHashes));
+    s.interfaceHashes = CALLOC(numModules, sizeof(*s.interfaceHashes));
+    for(usize i = 0; success && i < numModules; ++i) {
+        ASTModule *m = astProgramGetModule(prog, (ModuleID)i);
+        success = buildStateHashSource(module_source_path(c, &s.previous, m->name), s.sourceHashes[i]);
+        // There are no interfaces in a unity build, the source stands for the interface.
+        strcpy(s.interfaceHashes[i], s.sourceHashes[i]);
+    }
+    if(success && !save_state(opts, &s, c, prog)) {
+        // Not fatal, the next build will just have to build everything.
+        LOG_ERR("Failed to save the build state in '%s'.\n", opts->buildDir);
+    }
+    if(opts->cache && opts->cache->stores > 0) {
+        objectCacheTrim(opts->cache);
+    }
+    if(opts->printTimes && opts->cache) {
+        LOG_MSG("Object cache: %zu hits, %zu misses.\n", opts->cache->hits, opts->cache->misses);
+    }
+    if(success && opts->printTimes) {
+        LOG_MSG("Built '%s' (unity build) in %.2f ms.\n", opts->output, milliseconds_since(&start));
+    }
+    FREE(s.sourceHashes);
+    FREE(s.interfaceHashes);
+    buildStateFree(&s.previous);
+    stringFree(unit.source);
+    stringFree(unit.object);
+    return success;
+}
+
+bool driverBuild(BuildOptions *opts, Compiler *c, ASTProgram *prog) {
+    VERIFY(opts->cc && opts->buildDir && opts->output && opts->mainFile);
+    if(opts->unity) {
+        return build_unity(opts, c, prog);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    usize numUnits = arrayLength(&prog->modules);
+
+    IncrementalState s;
+    buildStateInit(&s.previous);
+    tableInit(&s.moduleIDs, NULL, NULL);
+    s.generate = CALLOC(numUnits, sizeof(*s.generate));
+    s.generated = CALLOC(numUnits, sizeof(*s.generated));
+    s.sourceHashes = CALLOC(numUnits, sizeof(*s.sourceHashes));
+    s.interfaceHashes = CALLOC(numUnits, sizeof(*s.interfaceHashes));
+    String statePath = state_path(opts);
+    char config[SHA256_HEX_SIZE];
+    compute_config_hash(opts, config);
+    if(buildStateLoad(&s.previous, statePath) && strcmp(s.previous.config, config) != 0) {
+        buildStateFree(&s.previous);
+        buildStateInit(&s.previous);
+    }
+    // If this build fails, the build directory won't match the previous state anymore.
+    unlink(statePath);
+    stringFree(statePath);
+
+    CompileUnit *units = CALLOC(numUnits, sizeof(*units));
+    for(usize i = 0; i < numUnits; ++i) {
+        ASTModule *m = astProgramGetModule(prog, (ModuleID)i);
+        units[i].source = stringFormat("%s/%s.c", opts->buildDir, m->name);
+        units[i].object = stringFormat("%s/%s.o", opts->buildDir, m->name);
+        units[i].pid = -1;
+        units[i].key[0] = '\0';
+        tableSet(&s.moduleIDs, (void *)m->name, (void *)(ModuleID)i);
+        String header = stringFormat("%s/%s.h", opts->buildDir, m->name);
+        ModuleState *previous = buildStateGetModule(&s.previous, m->name);
+        bool sourceHashed = buildStateHashSource(module_source_path(c, &s.previous, m->name), s.sourceHashes[i]);
+        s.generate[i] = !sourceHashed || previous == NULL || strcmp(previous->sourceHash, s.sourceHashes[i]) != 0 ||
+                        !file_exists(units[i].source) || !file_exists(header) || !file_exists(units[i].object);
+        if(!s.generate[i]) {
+            strcpy(s.interfaceHashes[i], previous->interfaceHash);
+        }
+        stringFree(header);
+    }
+    bool success = generate_changed_modules(opts, &s, prog);
+    for(usize i = 0; success && i < numUnits; ++i) {
+        ASTModule *m = astProgramGetModule(prog, (ModuleID)i);
+        String interface = interface_path(opts, m->name);
+        // Modules that weren't generated keep their interface (unless it's missing.)
+        if((s.generated[i] || !file_exists(interface)) && !moduleInterfaceWrite(prog, m, interface)) {
+            // Not fatal, the module will be parsed in the next build. But an outdated interface must not be used.
+            unlink(interface);
+            LOG_ERR("Failed to write '%s'.\n", interface);
+        }
+        stringFree(interface);
+    }
+    usize numGenerated = 0;
+    for(usize i = 0; success && i < numUnits; ++i) {
+        units[i].upToDate = !s.generated[i];
+        if(s.generated[i]) {
+            numGenerated++;
+            if(opts->cache) {
+                // Units without a key are simply not cached.
+                compute_unit_key(opts, prog, (ModuleID)i, &units[i]);
+            }
+        }
+    }
+    if(success && opts->printTimes) {
+        LOG_MSG("Generated %zu of %zu modules.\n", numGenerated, numUnits);
+    }
+    success = success && compile_units(opts, units, numUnits) && link_units(opts, units, numUnits);
+    if(success && !save_state(opts, &s, c, prog)) {
+        // Not fatal, the next build will just have to build everything.
+        LOG_ERR("Failed to save the build state in '%s'.\n", opts->buildDir);
+    }
+    if(opts->cache && opts->cache->stores > 0) {
+        objectCacheTrim(opts->cache);
+    }
+    if(opts->printTimes && opts->cache) {
+        LOG_MSG("Object cache: %zu hits, %zu misses.\n", opts->cache->hits, opts->cache->misses);
+    }
+    if(success && opts->printTimes) {
+        LOG_MSG("Built '%s' in %.2f ms.\n", opts->output, milliseconds_since(&start));
+    }
+    for(usize i = 0; i < numUnits; ++i) {
+        stringFree(units[i].source);
+        stringFree(units[i].object);
+    }
+    FREE(units);
+    FREE(s.generate);
+    FREE(s.generated);
+    FREE(s.sourceHashes);
+    FREE(s.interfaceHashes);
+    tableFree(&s.moduleIDs);
+    buildStateFree(&s.previous);
+    return success;
+}
@@ -173,14 +173,16 @@ Error/Hint: reason
  3 |     abc *= 2;
 */
 void errorPrint(Error *err, Compiler *c, FILE *to) {
-    if(!err->has_location) {
+    // Errors at tokens without a location (e.g. the end of a file) have no file.
+    File *file = err->has_location ? compilerGetFile(c, err->location.file) : NULL;
+    if(file == NULL) {
         fprintf(to, "%s: \x1b[1m%s\x1b[0m\n", error_type_to_string(err->type), err->message);
         return;
     }
 
-    String file_contents = fileRead(compilerGetFile(c, err->location.file));
+    String file_contents = fileRead(file);
     if(file_contents == NULL) {
-        LOG_ERR("Failed to read file '%s'!\n", compilerGetFile(c, err->location.file)->path);
+        LOG_ERR("Failed to read file '%s'!\n", file->path);
         return;
     }
     struct line_array lines = {0};
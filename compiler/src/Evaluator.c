@@ -0,0 +1,748 @@
+#include <stdarg.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Strings.h"
+#include "Error.h"
+#include "Ast/Ast.h"
+#include "Compiler.h"
+#include "Evaluator.h"
+
+typedef struct value {
+    Type *type; // NULL for the value of a call to a function returning nothing.
+    union {
+        u64 number; // Wrapped to the type (see typeWrapInteger()).
+        bool boolean;
+        ASTString string; // NULL for zero strings.
+        struct value *fields; // TY_STRUCT (in the order of struct_fields().)
+        struct {
+            struct value *target; // A variable slot or a field in one.
+            bool readOnly; // Points into a module variable.
+        } pointer; // TY_POINTER
+        ASTObj *function; // TY_FUNCTION
+    } as;
+} Value;
+
+typedef enum eval_variable_state {
+    VAR_NOT_EVALUATED,
+    VAR_EVALUATING,
+    VAR_EVALUATED,
+    VAR_FAILED,
+    VAR_SKIPPED // Needs a function body that was skipped by the parser.
+} EvalVariableState;
+
+typedef struct eval_variable {
+    ASTVarDeclStmt *decl;
+    EvalVariableState state;
+    Value value;
+} EvalVariable;
+
+struct eval_frame {
+    ASTObj *function;
+    Table locals; // Table<ASTObj *, Value *>
+    Value returnValue;
+};
+
+typedef enum exec_result {
+    EXEC_NEXT,
+    EXEC_RETURN,
+    EXEC_FAILED
+} ExecResult;
+
+static unsigned hashPointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool cmpPointer(void *a, void *b) {
+    return a == b;
+}
+
+static void evaluator_init_internal(Evaluator *e, Compiler *c) {
+    e->compiler = c;
+    e->program = NULL; // set in evaluatorEvaluate()
+    e->hadError = false;
+    e->current.module = NULL;
+    e->current.frame = NULL;
+    e->current.steps = 0;
+    e->current.callDepth = 0;
+    e->failure.failed = false;
+    e->failure.skippedBody = false;
+    e->failure.location = EMPTY_LOCATION;
+    e->failure.message = NULL;
+}
+
+void evaluatorInit(Evaluator *e, Compiler *c) {
+    evaluator_init_internal(e, c);
+    tableInit(&e->variables, hashPointer, cmpPointer);
+    arenaInit(&e->values.storage);
+    e->values.alloc = arenaMakeAllocator(&e->values.storage);
+}
+
+void evaluatorFree(Evaluator *e) {
+    // The variables are allocated from the arena.
+    tableFree(&e->variables);
+    arenaFree(&e->values.storage);
+    if(e->failure.message) {
+        stringFree(e->failure.message);
+    }
+    evaluator_init_internal(e, NULL);
+}
+
+static void add_error(Evaluator *e, bool has_location, Location loc, ErrorType type, const char *message) {
+    Error *err;
+    NEW0(err);
+    errorInit(err, type, has_location, loc, message);
+    compilerAddError(e->compiler, err);
+    if(type == ERR_ERROR) {
+        e->hadError = true;
+    }
+}
+
+// Record why evaluating the current initializer failed (only the first reason is kept.)
+// Always returns false.
+static bool fail(Evaluator *e, Location loc, const char *format, ...) {
+    if(e->failure.failed) {
+        return false;
+    }
+    va_list ap;
+    va_start(ap, format);
+    e->failure.message = stringVFormat(format, ap);
+    va_end(ap);
+    e->failure.failed = true;
+    e->failure.location = loc;
+    return false;
+}
+
+static inline Allocator *valueAllocator(Evaluator *e) {
+    return &e->values.alloc;
+}
+
+static Value *newSlot(Evaluator *e) {
+    Value *slot = allocatorAllocate(valueAllocator(e), sizeof(*slot));
+    slot->type = NULL;
+    slot->as.number = 0;
+    return slot;
+}
+
+
+/* Values */
+
+// Returns the fields (OBJ_VAR) of a struct type in declaration order.
+static Array *struct_fields(Evaluator *e, Type *structTy) {
+    VERIFY(structTy->type == TY_STRUCT);
+    ASTObj *st = scopeGetObject(astProgramGetModule(e->program, structTy->declModule)->moduleScope, OBJ_STRUCT, structTy->name);
+    VERIFY(st);
+    return &st->as.structure.fields;
+}
+
+static usize field_index(Evaluator *e, Type *structTy, ASTObj *field) {
+    Array *fields = struct_fields(e, structTy);
+    ARRAY_FOR(i, *fields) {
+        if(ARRAY_GET_AS(ASTObj *, fields, i) == field) {
+            return i;
+        }
+    }
+    UNREACHABLE();
+}
+
+// The value of a variable that isn't initialized.
+static void zero_value(Evaluator *e, Type *ty, Value *out) {
+    out->type = ty;
+    out->as.number = 0;
+    if(ty->type == TY_STRUCT) {
+        Array *fields = struct_fields(e, ty);
+        out->as.fields = allocatorAllocate(valueAllocator(e), sizeof(Value) * arrayLength(fields));
+        ARRAY_FOR(i, *fields) {
+            zero_value(e, ARRAY_GET_AS(ASTObj *, fields, i)->dataType, &out->as.fields[i]);
+        }
+    }
+}
+
+// Copy [src] to [dest] (structs are copied by value.)
+static void copy_value(Evaluator *e, Value *dest, Value *src) {
+    *dest = *src;
+    if(src->type && src->type->type == TY_STRUCT) {
+        usize numFields = arrayLength(struct_fields(e, src->type));
+        dest->as.fields = allocatorAllocate(valueAllocator(e), sizeof(Value) * numFields);
+        for(usize i = 0; i < numFields; ++i) {
+            copy_value(e, &dest->as.fields[i], &src->as.fields[i]);
+        }
+    }
+}
+
+// Convert a value to a constant expression allocated using [a].
+// Returns NULL for zero values (which don't need an initializer.)
+static ASTExprNode *value_to_constant(Evaluator *e, Allocator *a, Value *value, Location loc) {
+    ASTConstantValueExpr *constant = NULL;
+    switch(value->type->type) {
+        case TY_I32:
+        case TY_U32:
+            if(value->as.number == 0) {
+                return NULL;
+            }
+            constant = astConstantValueExprNew(a, EXPR_NUMBER_CONSTANT, loc, value->type);
+            constant->as.number = value->as.number;
+            return NODE_AS(ASTExprNode, constant);
+        case TY_BOOL:
+            if(!value->as.boolean) {
+                return NULL;
+            }
+            constant = astConstantValueExprNew(a, EXPR_BOOLEAN_CONSTANT, loc, value->type);
+            constant->as.boolean = true;
+            return NODE_AS(ASTExprNode, constant);
+        case TY_STR:
+            if(value->as.string == NULL) {
+                return NULL;
+            }
+            constant = astConstantValueExprNew(a, EXPR_STRING_CONSTANT, loc, value->type);
+            constant->as.string = value->as.string;
+            return NODE_AS(ASTExprNode, constant);
+        case TY_FUNCTION:
+            if(value->as.function == NULL) {
+                return NULL;
+            }
+            return NODE_AS(ASTExprNode, astObjExprNew(a, EXPR_FUNCTION, loc, value->as.function));
+        case TY_STRUCT: {
+            Array *fields = struct_fields(e, value->type);
+            ASTStructConstantExpr *st = astStructConstantExprNew(a, loc, value->type, arrayLength(fields));
+            ARRAY_FOR(i, *fields) {
+                ASTExprNode *fieldValue = value_to_constant(e, a, &value->as.fields[i], loc);
+                if(fieldValue) {
+                    arrayPush(&st->fields, arrayGet(fields, i));
+                    arrayPush(&st->values, (void *)fieldValue);
+                }
+            }
+            return arrayLength(&st->fields) > 0 ? NODE_AS(ASTExprNode, st) : NULL;
+        }
+        // Module variables and fields can't be pointers (see the Typechecker and the Parser.)
+        default:
+            UNREACHABLE();
+    }
+}
+
+
+/* Expressions */
+
+static bool step(Evaluator *e, Location loc) {
+    if(++e->current.steps > EVALUATOR_MAX_STEPS) {
+        return fail(e, loc, "Evaluation takes too long (more than %d steps).", EVALUATOR_MAX_STEPS);
+    }
+    return true;
+}
+
+// Returns the value of a module variable of the current module (NULL on failure.)
+static Value *module_variable(Evaluator *e, ASTObj *var, Location loc) {
+    TableItem *item = tableGet(&e->variables, (void *)var);
+    if(item == NULL) {
+        fail(e, loc, "Uses '%s' which can't be used at compile time.", var->name);
+        return NULL;
+    }
+    EvalVariable *variable = (EvalVariable *)item->value;
+    if(var->ownerModule != e->current.module->id) {
+        fail(e, loc, "Uses the module variable '%s' which is declared in another module.", var->name);
+        return NULL;
+    }
+    switch(variable->state) {
+        case VAR_EVALUATED:
+            return &variable->value;
+        case VAR_NOT_EVALUATED:
+        case VAR_EVALUATING:
+            fail(e, loc, "Uses the module variable '%s' before it is initialized.", var->name);
+            return NULL;
+        case VAR_FAILED:
+            fail(e, loc, "Uses the module variable '%s' which isn't a constant expression.", var->name);
+            return NULL;
+        case VAR_SKIPPED:
+            e->failure.skippedBody = true;
+            fail(e, loc, "Uses the module variable '%s' which can't be evaluated yet.", var->name);
+            return NULL;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static bool eval_expr(Evaluator *e, ASTExprNode *expr, Value *out);
+
+// Returns the slot (variable or field) an expression refers to (NULL on failure).
+// [readOnly] is set to whether the slot is (in) a module variable, which initializers may not modify.
+static Value *eval_address(Evaluator *e, ASTExprNode *expr, bool *readOnly) {
+    switch(expr->type) {
+        case EXPR_VARIABLE: {
+            ASTObj *var = NODE_AS(ASTObjExpr, expr)->obj;
+            TableItem *item = e->current.frame ? tableGet(&e->current.frame->locals, (void *)var) : NULL;
+            if(item) {
+                *readOnly = false;
+                return (Value *)item->value;
+            }
+            *readOnly = true;
+            return module_variable(e, var, expr->location);
+        }
+        case EXPR_DEREF: {
+            Value pointer;
+            if(!eval_expr(e, NODE_AS(ASTUnaryExpr, expr)->operand, &pointer)) {
+                return NULL;
+            }
+            if(pointer.as.pointer.target == NULL) {
+                fail(e, expr->location, "Dereferences a null pointer.");
+            }
+            *readOnly = pointer.as.pointer.readOnly;
+            return pointer.as.pointer.target;
+        }
+        case EXPR_PROPERTY_ACCESS: {
+            ASTBinaryExpr *access = NODE_AS(ASTBinaryExpr, expr);
+            Value *base = eval_address(e, access->lhs, readOnly);
+            if(base == NULL) {
+                return NULL;
+            }
+            VERIFY(NODE_IS(access->rhs, EXPR_VARIABLE) && base->type->type == TY_STRUCT);
+            return &base->as.fields[field_index(e, base->type, NODE_AS(ASTObjExpr, access->rhs)->obj)];
+        }
+        default: {
+            // A temporary (for example, the address of a call's return value.)
+            *readOnly = false;
+            Value *slot = newSlot(e);
+            return eval_expr(e, expr, slot) ? slot : NULL;
+        }
+    }
+}
+
+static bool eval_integer_op(Evaluator *e, ASTExprNode *expr, Value *lhs, Value *rhs, Value *out) {
+    Type *ty = lhs->type;
+    if(ty->type != TY_I32 && ty->type != TY_U32) {
+        return fail(e, expr->location, "Operator isn't supported at compile time for type '%s'.", ty->name);
+    }
+    bool isSigned = ty->type == TY_I32;
+    u64 a = lhs->as.number, b = rhs->as.number;
+    out->type = expr->dataType;
+    switch(expr->type) {
+        case EXPR_ADD: out->as.number = typeWrapInteger(ty, a + b); break;
+        case EXPR_SUBTRACT: out->as.number = typeWrapInteger(ty, a - b); break;
+        case EXPR_MULTIPLY: out->as.number = typeWrapInteger(ty, a * b); break;
+        case EXPR_DIVIDE:
+            if(b == 0) {
+                return fail(e, expr->location, "Division by zero.");
+            }
+            if(isSigned && (i64)a == INT32_MIN && (i64)b == -1) {
+                return fail(e, expr->location, "Division overflows.");
+            }
+            out->as.number = typeWrapInteger(ty, isSigned ? (u64)((i64)a / (i64)b) : a / b);
+            break;
+        case EXPR_LT: out->as.boolean = isSigned ? (i64)a < (i64)b : a < b; break;
+        case EXPR_LE: out->as.boolean = isSigned ? (i64)a <= (i64)b : a <= b; break;
+        case EXPR_GT: out->as.boolean = isSigned ? (i64)a > (i64)b : a > b; break;
+        case EXPR_GE: out->as.boolean = isSigned ? (i64)a >= (i64)b : a >= b; break;
+        default:
+            UNREACHABLE();
+    }
+    return true;
+}
+
+static ExecResult exec_stmt(Evaluator *e, ASTStmtNode *stmt);
+
+// Collect the defer statements of a function in the order they appear (they are all run when it returns.)
+static void collect_defers(ASTStmtNode *stmt, Array *defers) {
+    if(stmt == NULL) {
+        return;
+    }
+    switch(stmt->type) {
+        case STMT_BLOCK:
+            ARRAY_FOR(i, NODE_AS(ASTBlockStmt, stmt)->nodes) {
+                collect_defers(ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i), defers);
+            }
+            break;
+        case STMT_IF:
+        case STMT_EXPECT:
+            collect_defers(NODE_AS(ASTConditionalStmt, stmt)->then, defers);
+            collect_defers(NODE_AS(ASTConditionalStmt, stmt)->else_, defers);
+            break;
+        case STMT_LOOP:
+            collect_defers(NODE_AS(ASTLoopStmt, stmt)->initializer, defers);
+            collect_defers(NODE_AS(ASTStmtNode, NODE_AS(ASTLoopStmt, stmt)->body), defers);
+            break;
+        case STMT_DEFER:
+            arrayPush(defers, (void *)stmt);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool eval_call(Evaluator *e, ASTCallExpr *call, Value *out) {
+    ASTObj *fn = NULL;
+    if(NODE_IS(call->callee, EXPR_PROPERTY_ACCESS)) {
+        // A method ('this' is the first argument.)
+        ASTExprNode *method = NODE_AS(ASTBinaryExpr, call->callee)->rhs;
+        VERIFY(NODE_IS(method, EXPR_VARIABLE));
+        fn = NODE_AS(ASTObjExpr, method)->obj;
+    } else {
+        Value callee;
+        if(!eval_expr(e, call->callee, &callee)) {
+            return false;
+        }
+        fn = callee.as.function;
+        if(fn == NULL) {
+            return fail(e, call->callee->location, "Calls an uninitialized function variable.");
+        }
+    }
+    VERIFY(fn->type == OBJ_FN);
+    if(fn->ownerModule != e->current.module->id) {
+        return fail(e, call->header.location, "Calls '%s' which is declared in another module.", fn->name);
+    }
+    if(fn->as.fn.body == NULL) {
+        e->failure.skippedBody = true;
+        return fail(e, call->header.location, "The body of '%s' isn't available.", fn->name);
+    }
+    if(e->current.callDepth >= EVALUATOR_MAX_CALL_DEPTH) {
+        return fail(e, call->header.location, "Too many nested calls (more than %d).", EVALUATOR_MAX_CALL_DEPTH);
+    }
+
+    usize numArguments = arrayLength(&call->arguments);
+    VERIFY(numArguments == arrayLength(&fn->as.fn.parameters));
+    Value *arguments = allocatorAllocate(valueAllocator(e), sizeof(Value) * (numArguments > 0 ? numArguments : 1));
+    ARRAY_FOR(i, call->arguments) {
+        if(!eval_expr(e, ARRAY_GET_AS(ASTExprNode *, &call->arguments, i), &arguments[i])) {
+            return false;
+        }
+    }
+
+    EvalFrame frame;
+    frame.function = fn;
+    tableInit(&frame.locals, hashPointer, cmpPointer);
+    frame.returnValue.type = NULL;
+    if(fn->as.fn.returnType->type != TY_VOID) {
+        zero_value(e, fn->as.fn.returnType, &frame.returnValue);
+    }
+    ARRAY_FOR(i, fn->as.fn.parameters) {
+        Value *slot = newSlot(e);
+        copy_value(e, slot, &arguments[i]);
+        tableSet(&frame.locals, arrayGet(&fn->as.fn.parameters, i), (void *)slot);
+    }
+    Array defers; // Array<ASTDeferStmt *>
+    arrayInit(&defers);
+    collect_defers(NODE_AS(ASTStmtNode, fn->as.fn.body), &defers);
+
+    EvalFrame *previous = e->current.frame;
+    e->current.frame = &frame;
+    e->current.callDepth++;
+    ExecResult result = exec_stmt(e, NODE_AS(ASTStmtNode, fn->as.fn.body));
+    // The return value is computed before the defers run. Returning from a defer returns right away.
+    for(usize i = 0; i < arrayLength(&defers) && result != EXEC_FAILED; ++i) {
+        result = exec_stmt(e, NODE_AS(ASTDeferStmt, ARRAY_GET_AS(ASTDeferStmt *, &defers, i))->body);
+        if(result == EXEC_RETURN) {
+            break;
+        }
+    }
+    e->current.callDepth--;
+    e->current.frame = previous;
+    arrayFree(&defers);
+    tableFree(&frame.locals);
+
+    *out = frame.returnValue;
+    return result != EXEC_FAILED;
+}
+
+static bool eval_expr(Evaluator *e, ASTExprNode *expr, Value *out) {
+    if(!step(e, expr->location)) {
+        return false;
+    }
+    switch(expr->type) {
+        // Constant value nodes.
+        case EXPR_NUMBER_CONSTANT:
+            out->type = expr->dataType;
+            out->as.number = typeWrapInteger(expr->dataType, NODE_AS(ASTConstantValueExpr, expr)->as.number);
+            return true;
+        case EXPR_STRING_CONSTANT:
+            out->type = expr->dataType;
+            out->as.string = NODE_AS(ASTConstantValueExpr, expr)->as.string;
+            return true;
+        case EXPR_BOOLEAN_CONSTANT:
+            out->type = expr->dataType;
+            out->as.boolean = NODE_AS(ASTConstantValueExpr, expr)->as.boolean;
+            return true;
+        // Obj nodes
+        case EXPR_VARIABLE:
+        case EXPR_PROPERTY_ACCESS:
+        case EXPR_DEREF: {
+            bool readOnly;
+            Value *slot = eval_address(e, expr, &readOnly);
+            if(slot == NULL) {
+                return false;
+            }
+            *out = *slot;
+            return true;
+        }
+        case EXPR_FUNCTION:
+            out->type = expr->dataType;
+            out->as.function = NODE_AS(ASTObjExpr, expr)->obj;
+            return true;
+        // Binary nodes
+        case EXPR_ASSIGN: {
+            Value value;
+            if(!eval_expr(e, NODE_AS(ASTBinaryExpr, expr)->rhs, &value)) {
+                return false;
+            }
+            bool readOnly;
+            Value *slot = eval_address(e, NODE_AS(ASTBinaryExpr, expr)->lhs, &readOnly);
+            if(slot == NULL) {
+                return false;
+            }
+            if(readOnly) {
+                return fail(e, expr->location, "Modifies a module variable.");
+            }
+            copy_value(e, slot, &value);
+            *out = *slot;
+            return true;
+        }
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            Value lhs, rhs;
+            if(!eval_expr(e, NODE_AS(ASTBinaryExpr, expr)->lhs, &lhs) || !eval_expr(e, NODE_AS(ASTBinaryExpr, expr)->rhs, &rhs)) {
+                return false;
+            }
+            if(NODE_IS(expr, EXPR_EQ) || NODE_IS(expr, EXPR_NE)) {
+                bool equal;
+                switch(lhs.type->type) {
+                    case TY_I32:
+                    case TY_U32:
+                        equal = lhs.as.number == rhs.as.number;
+                        break;
+                    case TY_BOOL:
+                        equal = lhs.as.boolean == rhs.as.boolean;
+                        break;
+                    default:
+                        return fail(e, expr->location, "Comparing values of type '%s' isn't supported at compile time.", lhs.type->name);
+                }
+                out->type = expr->dataType;
+                out->as.boolean = NODE_IS(expr, EXPR_EQ) ? equal : !equal;
+                return true;
+            }
+            return eval_integer_op(e, expr, &lhs, &rhs, out);
+        }
+        case EXPR_LOGICAL_AND:
+        case EXPR_LOGICAL_OR: {
+            if(!eval_expr(e, NODE_AS(ASTBinaryExpr, expr)->lhs, out)) {
+                return false;
+            }
+            // Short-circuit: 'false && x' is false and 'true || x' is true.
+            if(out->as.boolean == NODE_IS(expr, EXPR_LOGICAL_OR)) {
+                return true;
+            }
+            return eval_expr(e, NODE_AS(ASTBinaryExpr, expr)->rhs, out);
+        }
+        // Unary nodes
+        case EXPR_NEGATE:
+            if(!eval_expr(e, NODE_AS(ASTUnaryExpr, expr)->operand, out)) {
+                return false;
+            }
+            if(out->type->type != TY_I32 && out->type->type != TY_U32) {
+                return fail(e, expr->location, "Negating values of type '%s' isn't supported at compile time.", out->type->name);
+            }
+            out->as.number = typeWrapInteger(out->type, 0 - out->as.number);
+            return true;
+        case EXPR_LOGICAL_NOT:
+            if(!eval_expr(e, NODE_AS(ASTUnaryExpr, expr)->operand, out)) {
+                return false;
+            }
+            out->as.boolean = !out->as.boolean;
+            return true;
+        case EXPR_ADDROF: {
+            bool readOnly;
+            Value *slot = eval_address(e, NODE_AS(ASTUnaryExpr, expr)->operand, &readOnly);
+            if(slot == NULL) {
+                return false;
+            }
+            out->type = expr->dataType;
+            out->as.pointer.target = slot;
+            out->as.pointer.readOnly = readOnly;
+            return true;
+        }
+        // Call node
+        case EXPR_CALL:
+            return eval_call(e, NODE_AS(ASTCallExpr, expr), out);
+        default:
+            return fail(e, expr->location, "Expression can't be evaluated at compile time.");
+    }
+}
+
+
+/* Statements */
+
+static ExecResult exec_stmt(Evaluator *e, ASTStmtNode *stmt) {
+    VERIFY(e->current.frame);
+    if(!step(e, stmt->location)) {
+        return EXEC_FAILED;
+    }
+    switch(stmt->type) {
+        // VarDecl nodes
+        case STMT_VAR_DECL: {
+            ASTVarDeclStmt *decl = NODE_AS(ASTVarDeclStmt, stmt);
+            Value *slot = newSlot(e);
+            if(decl->initializer) {
+                Value value;
+                if(!eval_expr(e, decl->initializer, &value)) {
+                    return EXEC_FAILED;
+                }
+                copy_value(e, slot, &value);
+            } else {
+                zero_value(e, decl->variable->dataType, slot);
+            }
+            tableSet(&e->current.frame->locals, (void *)decl->variable, (void *)slot);
+            return EXEC_NEXT;
+        }
+        // Block nodes
+        case STMT_BLOCK:
+            ARRAY_FOR(i, NODE_AS(ASTBlockStmt, stmt)->nodes) {
+                ExecResult result = exec_stmt(e, ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i));
+                if(result != EXEC_NEXT) {
+                    return result;
+                }
+            }
+            return EXEC_NEXT;
+        // Conditional nodes
+        case STMT_IF: {
+            ASTConditionalStmt *ifStmt = NODE_AS(ASTConditionalStmt, stmt);
+            Value condition;
+            if(!eval_expr(e, ifStmt->condition, &condition)) {
+                return EXEC_FAILED;
+            }
+            ASTStmtNode *body = condition.as.boolean ? ifStmt->then : ifStmt->else_;
+            return body ? exec_stmt(e, body) : EXEC_NEXT;
+        }
+        case STMT_EXPECT: {
+            // The condition is true if the expect failed, and the body (if any) handles the failure.
+            ASTConditionalStmt *expectStmt = NODE_AS(ASTConditionalStmt, stmt);
+            Value failed;
+            if(!eval_expr(e, expectStmt->condition, &failed)) {
+                return EXEC_FAILED;
+            }
+            if(!failed.as.boolean) {
+                return EXEC_NEXT;
+            }
+            if(expectStmt->then == NULL) {
+                fail(e, stmt->location, "Expect failed.");
+                return EXEC_FAILED;
+            }
+            return exec_stmt(e, expectStmt->then);
+        }
+        // Loop nodes
+        case STMT_LOOP: {
+            ASTLoopStmt *loop = NODE_AS(ASTLoopStmt, stmt);
+            if(loop->initializer && exec_stmt(e, loop->initializer) == EXEC_FAILED) {
+                return EXEC_FAILED;
+            }
+            while(true) {
+                Value condition;
+                if(!eval_expr(e, loop->condition, &condition)) {
+                    return EXEC_FAILED;
+                }
+                if(!condition.as.boolean) {
+                    return EXEC_NEXT;
+                }
+                ExecResult result = exec_stmt(e, NODE_AS(ASTStmtNode, loop->body));
+                if(result != EXEC_NEXT) {
+                    return result;
+                }
+                Value ignored;
+                if(loop->increment && !eval_expr(e, loop->increment, &ignored)) {
+                    return EXEC_FAILED;
+                }
+            }
+        }
+        // Expr nodes
+        case STMT_RETURN: {
+            ASTExprNode *expression = NODE_AS(ASTExprStmt, stmt)->expression;
+            if(expression) {
+                Value value;
+                if(!eval_expr(e, expression, &value)) {
+                    return EXEC_FAILED;
+                }
+                copy_value(e, &e->current.frame->returnValue, &value);
+            }
+            return EXEC_RETURN;
+        }
+        case STMT_EXPR: {
+            Value ignored;
+            return eval_expr(e, NODE_AS(ASTExprStmt, stmt)->expression, &ignored) ? EXEC_NEXT : EXEC_FAILED;
+        }
+        // Defer nodes
+        case STMT_DEFER:
+            // Defers are run when the function returns (see eval_call()).
+            return EXEC_NEXT;
+        default:
+            UNREACHABLE();
+    }
+}
+
+
+/* Module variables */
+
+static void evaluate_variable(Evaluator *e, ASTModule *module, EvalVariable *variable) {
+    ASTVarDeclStmt *decl = variable->decl;
+    e->current.module = module;
+    e->current.frame = NULL;
+    e->current.steps = 0;
+    e->current.callDepth = 0;
+    e->failure.failed = false;
+    e->failure.skippedBody = false;
+
+    variable->state = VAR_EVALUATING;
+    Value value;
+    if(!eval_expr(e, decl->initializer, &value)) {
+        VERIFY(e->failure.failed);
+        if(e->failure.skippedBody) {
+            // The module isn't generated unless its bodies are parsed (and the program is checked again.)
+            variable->state = VAR_SKIPPED;
+        } else {
+            variable->state = VAR_FAILED;
+            add_error(e, true, decl->initializer->location, ERR_ERROR, "Initializer of module variable is not a constant expression.");
+            add_error(e, true, e->failure.location, ERR_HINT, e->failure.message);
+        }
+        stringFree(e->failure.message);
+        e->failure.message = NULL;
+        return;
+    }
+    copy_value(e, &variable->value, &value);
+    variable->state = VAR_EVALUATED;
+    decl->initializer = value_to_constant(e, &module->ast_allocator.alloc, &variable->value, decl->initializer->location);
+}
+
+bool evaluatorEvaluate(Evaluator *e, ASTProgram *prog) {
+    VERIFY(prog);
+    e->program = prog;
+    ARRAY_FOR(i, prog->modules) {
+        ASTModule *module = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        ARRAY_FOR(j, module->variableDecls) {
+            ASTVarDeclStmt *decl = ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, j);
+            EvalVariable *variable = allocatorAllocate(valueAllocator(e), sizeof(*variable));
+            variable->decl = decl;
+            variable->state = VAR_NOT_EVALUATED;
+            if(decl->initializer == NULL) {
+                // Module variables are zero initialized.
+                zero_value(e, decl->variable->dataType, &variable->value);
+                variable->state = VAR_EVALUATED;
+            }
+            tableSet(&e->variables, (void *)decl->variable, (void *)variable);
+        }
+    }
+    // Module variables can only use the variables declared before them, so they are evaluated in order.
+    ARRAY_FOR(i, prog->modules) {
+        ASTModule *module = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        ARRAY_FOR(j, module->variableDecls) {
+            ASTObj *var = ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, j)->variable;
+            EvalVariable *variable = (EvalVariable *)tableGet(&e->variables, (void *)var)->value;
+            if(variable->state == VAR_NOT_EVALUATED) {
+                evaluate_variable(e, module, variable);
+            }
+        }
+    }
+    return !e->hadError;
+}
@@ -0,0 +1,73 @@
+#include "common.h"
+#include "memory.h"
+#include "Table.h"
+#include "Driver.h"
+#include "FrontEnd.h"
+
+static void init_checker(FrontEnd *fe) {
+    validatorInit(&fe->validator, &fe->compiler);
+    typecheckerInit(&fe->typechecker, &fe->compiler);
+    evaluatorInit(&fe->evaluator, &fe->compiler);
+    if(fe->fusedCheck) {
+        validatorSetFusedTypechecker(&fe->validator, &fe->typechecker);
+    }
+}
+
+static void free_checker(FrontEnd *fe) {
+    evaluatorFree(&fe->evaluator);
+    typecheckerFree(&fe->typechecker);
+    validatorFree(&fe->validator);
+}
+
+FrontEnd *frontEndNew(StringTable *strings) {
+    FrontEnd *fe;
+    NEW0(fe);
+    compilerInit(&fe->compiler);
+    scannerInit(&fe->scanner, &fe->compiler);
+    parserInit(&fe->parser, &fe->compiler, &fe->scanner);
+    fe->fusedCheck = false;
+    init_checker(fe);
+    astProgramInit(&fe->parsedProgram, strings);
+    astProgramInit(&fe->checkedProgram, strings);
+    tableInit(&fe->interfaces, NULL, NULL);
+    tableInit(&fe->skipBodies, NULL, NULL);
+    return fe;
+}
+
+void frontEndFree(FrontEnd *fe) {
+    driverFreeModuleInterfaces(&fe->interfaces);
+    driverFreeModuleInterfaces(&fe->skipBodies);
+    free_checker(fe);
+    parserFree(&fe->parser);
+    scannerFree(&fe->scanner);
+    compilerFree(&fe->compiler);
+    astProgramFree(&fe->checkedProgram);
+    astProgramFree(&fe->parsedProgram);
+    FREE(fe);
+}
+
+void frontEndSetFusedCheck(FrontEnd *fe, bool fused) {
+    fe->fusedCheck = fused;
+    // The typechecker is only attached when the validator is initialized.
+    free_checker(fe);
+    init_checker(fe);
+}
+
+void frontEndResetChecker(FrontEnd *fe) {
+    astProgramClear(&fe->checkedProgram);
+    free_checker(fe);
+    init_checker(fe);
+}
+
+void frontEndReset(FrontEnd *fe) {
+    // Interface tables are freed by tableFree() but can still be used afterwards.
+    driverFreeModuleInterfaces(&fe->interfaces);
+    driverFreeModuleInterfaces(&fe->skipBodies);
+    frontEndResetChecker(fe);
+    parserFree(&fe->parser);
+    scannerFree(&fe->scanner);
+    compilerClear(&fe->compiler);
+    scannerInit(&fe->scanner, &fe->compiler);
+    parserInit(&fe->parser, &fe->compiler, &fe->scanner);
+    astProgramClear(&fe->parsedProgram);
+}
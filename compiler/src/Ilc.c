@@ -0,0 +1,183 @@
+#include <stdio.h> // open_memstream()
+#include <stdlib.h> // free()
+#include "common.h"
+#include "memory.h"
+#include "Table.h"
+#include "Strings.h"
+#include "Error.h"
+#include "Writer.h"
+#include "Codegen.h"
+#include "Reachability.h"
+#include "Ast/StringTable.h"
+#include "FrontEnd.h"
+#include "Ilc.h"
+
+struct ilc_context {
+    StringTable strings; // Kept between compilations.
+    FrontEnd *frontEnd;
+    bool used; // Whether the FrontEnd was used since it was last reset.
+    Table sources; // Table<String, String> (path -> contents, both owned.)
+    usize jobs;
+    Writer output; // In-memory, the generated code (nul-terminated when there is any.)
+    char *errors; // Allocated by open_memstream(), NULL if there are no errors.
+};
+
+static void free_source_callback(TableItem *item, void *cl) {
+    UNUSED(cl);
+    stringFree((String)item->key);
+    stringFree((String)item->value);
+}
+
+static void clear_results(IlcContext *ctx) {
+    if(ctx->used) {
+        frontEndReset(ctx->frontEnd);
+        ctx->used = false;
+    }
+    writerClear(&ctx->output);
+    if(ctx->errors) {
+        // Allocated by open_memstream().
+        free(ctx->errors);
+        ctx->errors = NULL;
+    }
+}
+
+IlcContext *ilcContextNew(void) {
+    IlcContext *ctx;
+    NEW0(ctx);
+    stringTableInit(&ctx->strings);
+    ctx->frontEnd = frontEndNew(&ctx->strings);
+    ctx->used = false;
+    tableInit(&ctx->sources, NULL, NULL);
+    compilerSetSources(&ctx->frontEnd->compiler, &ctx->sources);
+    ctx->jobs = 1;
+    writerInitMemory(&ctx->output, 0);
+    ctx->errors = NULL;
+    return ctx;
+}
+
+void ilcContextFree(IlcContext *ctx) {
+    clear_results(ctx);
+    writerFree(&ctx->output);
+    tableClear(&ctx->sources, free_source_callback, NULL);
+    tableFree(&ctx->sources);
+    frontEndFree(ctx->frontEnd);
+    stringTableFree(&ctx->strings);
+    FREE(ctx);
+}
+
+void ilcContextReset(IlcContext *ctx) {
+    clear_results(ctx);
+    tableClear(&ctx->sources, free_source_callback, NULL);
+}
+
+void ilcContextSetJobs(IlcContext *ctx, size_t jobs) {
+    ctx->jobs = jobs > 0 ? jobs : 1;
+}
+
+void ilcContextSetFusedCheck(IlcContext *ctx, bool fused) {
+    frontEndSetFusedCheck(ctx->frontEnd, fused);
+}
+
+void ilcContextAddSource(IlcContext *ctx, const char *path, const char *contents, size_t length) {
+    TableItem *item = tableGet(&ctx->sources, (void *)path);
+    if(item) {
+        stringFree((String)item->value);
+        item->value = (void *)stringNCopy(contents, length);
+        return;
+    }
+    tableSet(&ctx->sources, (void *)stringCopy(path), (void *)stringNCopy(contents, length));
+}
+
+// Format the errors the same way ilc prints them.
+static void collect_errors(IlcContext *ctx) {
+    Compiler *c = &ctx->frontEnd->compiler;
+    usize length;
+    FILE *to = open_memstream(&ctx->errors, &length);
+    if(to == NULL) {
+        return;
+    }
+    ARRAY_FOR(i, c->errors) {
+        errorPrint(ARRAY_GET_AS(Error *, &c->errors, i), c, to);
+    }
+    fclose(to);
+}
+
+bool ilcCompile(IlcContext *ctx, const char *mainFile) {
+    clear_results(ctx);
+    ctx->used = true;
+    FrontEnd *fe = ctx->frontEnd;
+    compilerAddFile(&fe->compiler, mainFile);
+    bool success = parserParse(&fe->parser, &fe->parsedProgram) &&
+                   validatorValidate(&fe->validator, &fe->parsedProgram, &fe->checkedProgram) &&
+                   typecheckerTypecheck(&fe->typechecker, &fe->checkedProgram) &&
+                   evaluatorEvaluate(&fe->evaluator, &fe->checkedProgram);
+    if(!success) {
+        collect_errors(ctx);
+        return false;
+    }
+    Reachability reachable;
+    reachabilityInit(&reachable);
+    reachabilityAnalyze(&reachable, &fe->checkedProgram);
+    success = codegenGenerateToWriter(&ctx->output, &fe->checkedProgram, ctx->jobs, &reachable, true);
+    reachabilityFree(&reachable);
+    if(!success) {
+        writerClear(&ctx->output);
+        return false;
+    }
+    writerWrite(&ctx->output, "", 1);
+    return true;
+}
+
+const char *ilcContextOutput(IlcContext *ctx, size_t *length) {
+    usize dataLength;
+    const char *data = writerData(&ctx->output, &dataLength);
+    if(dataLength == 0) {
+        data = "";
+        dataLength = 1;
+    }
+    if(length) {
+        // Without the nul terminator.
+        *length = dataLength - 1;
+    }
+    return data;
+}
+
+const char *ilcContextErrors(IlcContext *ctx) {
+    return ctx->errors ? ctx->errors : "";
+}
+
+size_t ilcContextDiagnosticCount(IlcContext *ctx) {
+    return ctx->used ? arrayLength(&ctx->frontEnd->compiler.errors) : 0;
+}
+
+bool ilcContextGetDiagnostic(IlcContext *ctx, size_t index, IlcDiagnostic *diagnostic) {
+    if(index >= ilcContextDiagnosticCount(ctx)) {
+        return false;
+    }
+    Compiler *c = &ctx->frontEnd->compiler;
+    Error *err = ARRAY_GET_AS(Error *, &c->errors, index);
+    diagnostic->kind = err->type == ERR_HINT ? ILC_DIAGNOSTIC_HINT : ILC_DIAGNOSTIC_ERROR;
+    diagnostic->message = err->message;
+    diagnostic->file = NULL;
+    diagnostic->start = diagnostic->end = 0;
+    diagnostic->line = diagnostic->column = 0;
+    File *file = err->has_location ? compilerGetFile(c, err->location.file) : NULL;
+    if(file == NULL) {
+        return true;
+    }
+    diagnostic->file = file->path;
+    diagnostic->start = (size_t)err->location.start;
+    diagnostic->end = (size_t)err->location.end;
+    // The line & column are counted the same way errorPrint() does.
+    String contents = fileRead(file);
+    usize lineStart = 0;
+    diagnostic->line = 1;
+    for(usize i = 0; contents && i < diagnostic->start && i < stringLength(contents); ++i) {
+        if(contents[i] == '\n') {
+            diagnostic->line++;
+            lineStart = i + 1;
+        }
+    }
+    diagnostic->column = diagnostic->start - lineStart;
+    return true;
+}
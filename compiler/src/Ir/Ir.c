@@ -0,0 +1,619 @@
+#include <stdio.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Ast/Ast.h"
+#include "Ir/Ir.h"
+
+/* Helper functions */
+
+static unsigned hash_pointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool compare_pointers(void *a, void *b) {
+    return a == b;
+}
+
+static void *ir_alloc(IrFunction *fn, usize size) {
+    // The arena allocator zeroes the memory.
+    return allocatorAllocate(&fn->allocator.alloc, size);
+}
+
+static void init_value(IrFunction *fn, IrValue *value, IrValueKind kind, Type *type) {
+    value->kind = kind;
+    value->type = type;
+    arrayInit(&value->uses);
+    arrayPush(&fn->values, (void *)value);
+}
+
+// Remove a single use of [value] by [user].
+static void remove_use(IrValue *value, IrInstr *user) {
+    for(usize i = arrayLength(&value->uses); i > 0; --i) {
+        if(ARRAY_GET_AS(IrInstr *, &value->uses, i - 1) == user) {
+            arrayDelete(&value->uses, i - 1);
+            return;
+        }
+    }
+    UNREACHABLE();
+}
+
+static usize phi_count(IrBlock *block) {
+    usize count = 0;
+    while(count < arrayLength(&block->instructions) && ARRAY_GET_AS(IrInstr *, &block->instructions, count)->op == IR_PHI) {
+        count++;
+    }
+    return count;
+}
+
+static void add_predecessor(IrBlock *block, IrBlock *predecessor) {
+    arrayPush(&block->predecessors, (void *)predecessor);
+}
+
+static void free_block(IrBlock *block) {
+    arrayFree(&block->instructions);
+    arrayFree(&block->predecessors);
+}
+
+
+/* IrModule functions */
+
+IrModule *irModuleNew(ASTProgram *prog, ASTModule *module) {
+    IrModule *m;
+    NEW0(m);
+    m->program = prog;
+    m->module = module;
+    arrayInit(&m->functions);
+    tableInit(&m->functionTable, hash_pointer, compare_pointers);
+    tableInit(&m->pointerTypes, NULL, NULL);
+    return m;
+}
+
+static void free_pointer_type_callback(TableItem *item, bool is_last, void *cl) {
+    UNUSED(is_last);
+    UNUSED(cl);
+    typeFree((Type *)item->value);
+}
+
+void irModuleFree(IrModule *m) {
+    ARRAY_FOR(i, m->functions) {
+        irFunctionFree(ARRAY_GET_AS(IrFunction *, &m->functions, i));
+    }
+    arrayFree(&m->functions);
+    tableFree(&m->functionTable);
+    tableMap(&m->pointerTypes, free_pointer_type_callback, NULL);
+    tableFree(&m->pointerTypes);
+    FREE(m);
+}
+
+IrFunction *irModuleGetFunction(IrModule *m, ASTObj *fn) {
+    TableItem *item = tableGet(&m->functionTable, (void *)fn);
+    return item ? (IrFunction *)item->value : NULL;
+}
+
+Type *irModulePointerType(IrModule *m, Type *ty) {
+    ASTString name = stringTableFormat(m->program->strings, "&%s", ty->name);
+    // The validator adds a pointer type for every type (except pointers & functions) to the module declaring it.
+    Type *ptr = astModuleGetType(m->module, name);
+    if(ptr == NULL || ptr->type != TY_POINTER) {
+        ptr = astModuleGetType(astProgramGetModule(m->program, ty->declModule), name);
+    }
+    if(ptr && ptr->type == TY_POINTER) {
+        return ptr;
+    }
+    TableItem *item = tableGet(&m->pointerTypes, (void *)name);
+    if(item) {
+        return (Type *)item->value;
+    }
+    ptr = typeNew(TY_POINTER, name, EMPTY_LOCATION, ty->declModule);
+    ptr->as.ptr.innerType = ty;
+    tableSet(&m->pointerTypes, (void *)name, (void *)ptr);
+    return ptr;
+}
+
+void irModulePrint(FILE *to, IrModule *m) {
+    fprintf(to, "module '%s'\n", m->module->name);
+    ARRAY_FOR(i, m->functions) {
+        fputc('\n', to);
+        irFunctionPrint(to, ARRAY_GET_AS(IrFunction *, &m->functions, i));
+    }
+}
+
+
+/* IrProgram functions */
+
+void irProgramFree(IrProgram *prog) {
+    ARRAY_FOR(i, prog->modules) {
+        irModuleFree(ARRAY_GET_AS(IrModule *, &prog->modules, i));
+    }
+    arrayFree(&prog->modules);
+    prog->ast = NULL;
+}
+
+void irProgramPrint(FILE *to, IrProgram *prog) {
+    ARRAY_FOR(i, prog->modules) {
+        if(i > 0) {
+            fputc('\n', to);
+        }
+        irModulePrint(to, ARRAY_GET_AS(IrModule *, &prog->modules, i));
+    }
+}
+
+
+/* IrFunction functions */
+
+IrFunction *irFunctionNew(IrModule *m, ASTObj *fn) {
+    IrFunction *irFn;
+    NEW0(irFn);
+    irFn->fn = fn;
+    irFn->module = m;
+    arrayInit(&irFn->parameters);
+    arrayInit(&irFn->blocks);
+    arrayInit(&irFn->values);
+    arrayInit(&irFn->removedBlocks);
+    irFn->nextInstrId = 0;
+    irFn->nextBlockId = 0;
+    arenaInit(&irFn->allocator.storage);
+    irFn->allocator.alloc = arenaMakeAllocator(&irFn->allocator.storage);
+    arrayPush(&m->functions, (void *)irFn);
+    tableSet(&m->functionTable, (void *)fn, (void *)irFn);
+    return irFn;
+}
+
+void irFunctionFree(IrFunction *fn) {
+    ARRAY_FOR(i, fn->values) {
+        IrValue *value = ARRAY_GET_AS(IrValue *, &fn->values, i);
+        arrayFree(&value->uses);
+        if(IR_VALUE_IS(value, IR_VALUE_INSTRUCTION)) {
+            arrayFree(&((IrInstr *)value)->operands);
+        }
+    }
+    ARRAY_FOR(i, fn->blocks) {
+        free_block(ARRAY_GET_AS(IrBlock *, &fn->blocks, i));
+    }
+    ARRAY_FOR(i, fn->removedBlocks) {
+        free_block(ARRAY_GET_AS(IrBlock *, &fn->removedBlocks, i));
+    }
+    arrayFree(&fn->parameters);
+    arrayFree(&fn->blocks);
+    arrayFree(&fn->values);
+    arrayFree(&fn->removedBlocks);
+    // Everything else is owned by the arena.
+    arenaFree(&fn->allocator.storage);
+    FREE(fn);
+}
+
+void irFunctionRemoveBlocks(IrFunction *fn, Array *blocks) {
+    if(arrayLength(blocks) == 0) {
+        return;
+    }
+    bool *removed = CALLOC(fn->nextBlockId, sizeof(*removed));
+    ARRAY_FOR(i, *blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, blocks, i);
+        VERIFY(arrayLength(&block->predecessors) == 0);
+        // Removing the terminator first removes the block from the predecessors of its successors.
+        while(arrayLength(&block->instructions) > 0) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, arrayLength(&block->instructions) - 1);
+            irInstrRemove(instr);
+        }
+        removed[block->id] = true;
+        arrayPush(&fn->removedBlocks, (void *)block);
+    }
+    // The remaining blocks are moved down in a single pass (keeping their order.)
+    usize kept = 0;
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        if(!removed[block->id]) {
+            fn->blocks.data[kept++] = (void *)block;
+        }
+    }
+    while(arrayLength(&fn->blocks) > kept) {
+        arrayPop(&fn->blocks);
+    }
+    FREE(removed);
+}
+
+
+/* Value functions */
+
+IrConstant *irConstantNew(IrFunction *fn, Type *type) {
+    IrConstant *c = ir_alloc(fn, sizeof(*c));
+    init_value(fn, &c->header, IR_VALUE_CONSTANT, type);
+    return c;
+}
+
+IrValue *irUndefinedNew(IrFunction *fn, Type *type) {
+    IrValue *v = ir_alloc(fn, sizeof(*v));
+    init_value(fn, v, IR_VALUE_UNDEFINED, type);
+    return v;
+}
+
+IrObjectValue *irObjectValueNew(IrFunction *fn, IrValueKind kind, Type *type, ASTObj *obj) {
+    VERIFY(kind == IR_VALUE_PARAMETER || kind == IR_VALUE_GLOBAL || kind == IR_VALUE_FUNCTION);
+    IrObjectValue *v = ir_alloc(fn, sizeof(*v));
+    init_value(fn, &v->header, kind, type);
+    v->obj = obj;
+    return v;
+}
+
+void irValueReplaceAllUses(IrValue *value, IrValue *replacement) {
+    VERIFY(value != replacement);
+    ARRAY_FOR(i, value->uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &value->uses, i);
+        // A user appears once for every operand using the value, so only the first appearance replaces anything.
+        ARRAY_FOR(j, user->operands) {
+            if(IR_OPERAND(user, j) == value) {
+                user->operands.data[j] = (void *)replacement;
+                arrayPush(&replacement->uses, (void *)user);
+            }
+        }
+    }
+    arrayClear(&value->uses);
+}
+
+bool irAddressEscapes(IrValue *address) {
+    ARRAY_FOR(i, address->uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &address->uses, i);
+        switch(user->op) {
+            case IR_LOAD:
+                break;
+            case IR_STORE:
+                // Storing the address itself.
+                if(IR_OPERAND(user, 1) == address) {
+                    return true;
+                }
+                break;
+            case IR_FIELD_ADDRESS:
+                if(irAddressEscapes((IrValue *)user)) {
+                    return true;
+                }
+                break;
+            default:
+                return true;
+        }
+    }
+    return false;
+}
+
+
+/* Instruction functions */
+
+IrInstr *irInstrNew(IrFunction *fn, IrOp op, Type *type, Location location) {
+    IrInstr *instr = ir_alloc(fn, sizeof(*instr));
+    init_value(fn, &instr->header, IR_VALUE_INSTRUCTION, type);
+    instr->op = op;
+    instr->id = fn->nextInstrId++;
+    instr->block = NULL;
+    instr->location = location;
+    arrayInit(&instr->operands);
+    return instr;
+}
+
+void irInstrAddOperand(IrInstr *instr, IrValue *operand) {
+    VERIFY(operand);
+    arrayPush(&instr->operands, (void *)operand);
+    arrayPush(&operand->uses, (void *)instr);
+}
+
+void irInstrRemoveOperand(IrInstr *instr, usize index) {
+    IrValue *operand = (IrValue *)arrayDelete(&instr->operands, index);
+    remove_use(operand, instr);
+}
+
+void irInstrRemove(IrInstr *instr) {
+    ARRAY_FOR(i, instr->operands) {
+        remove_use(IR_OPERAND(instr, i), instr);
+    }
+    arrayClear(&instr->operands);
+    if(irOpIsTerminator(instr->op)) {
+        IrBlock *successors[2];
+        usize numSuccessors = irBlockSuccessors(instr->block, successors);
+        for(usize i = 0; i < numSuccessors; ++i) {
+            irBlockRemovePredecessor(successors[i], instr->block);
+        }
+    }
+    IrBlock *block = instr->block;
+    ARRAY_FOR(i, block->instructions) {
+        if(ARRAY_GET_AS(IrInstr *, &block->instructions, i) == instr) {
+            arrayDelete(&block->instructions, i);
+            break;
+        }
+    }
+    instr->block = NULL;
+}
+
+bool irOpIsTerminator(IrOp op) {
+    return op == IR_JUMP || op == IR_BRANCH || op == IR_RETURN || op == IR_EXPECT_FAILED;
+}
+
+const char *irOpName(IrOp op) {
+    VERIFY(op < IR_OP_COUNT);
+    static const char *names[] = {
+        [IR_ALLOCA]        = "alloca",
+        [IR_LOAD]          = "load",
+        [IR_STORE]         = "store",
+        [IR_FIELD_ADDRESS] = "field_address",
+        [IR_ADD]           = "add",
+        [IR_SUBTRACT]      = "sub",
+        [IR_MULTIPLY]      = "mul",
+        [IR_DIVIDE]        = "div",
+        [IR_EQ]            = "eq",
+        [IR_NE]            = "ne",
+        [IR_LT]            = "lt",
+        [IR_LE]            = "le",
+        [IR_GT]            = "gt",
+        [IR_GE]            = "ge",
+        [IR_NEGATE]        = "neg",
+        [IR_NOT]           = "not",
+        [IR_CALL]          = "call",
+        [IR_PHI]           = "phi",
+        [IR_JUMP]          = "jump",
+        [IR_BRANCH]        = "branch",
+        [IR_RETURN]        = "return",
+        [IR_EXPECT_FAILED] = "expect_failed"
+    };
+    return names[(int)op];
+}
+
+
+/* Block functions */
+
+IrBlock *irBlockNew(IrFunction *fn) {
+    IrBlock *block = ir_alloc(fn, sizeof(*block));
+    block->id = fn->nextBlockId++;
+    block->function = fn;
+    block->cold = false;
+    arrayInit(&block->instructions);
+    arrayInit(&block->predecessors);
+    arrayPush(&fn->blocks, (void *)block);
+    return block;
+}
+
+void irBlockAppend(IrBlock *block, IrInstr *instr) {
+    VERIFY(instr->block == NULL);
+    instr->block = block;
+    if(instr->op != IR_PHI) {
+        VERIFY(irBlockTerminator(block) == NULL);
+        arrayPush(&block->instructions, (void *)instr);
+        return;
+    }
+    // Phis are always at the start of the block.
+    usize index = phi_count(block);
+    arrayPush(&block->instructions, NULL);
+    for(usize i = arrayLength(&block->instructions) - 1; i > index; --i) {
+        block->instructions.data[i] = block->instructions.data[i - 1];
+    }
+    block->instructions.data[index] = (void *)instr;
+}
+
+IrInstr *irBlockTerminator(IrBlock *block) {
+    usize length = arrayLength(&block->instructions);
+    if(length == 0) {
+        return NULL;
+    }
+    IrInstr *last = ARRAY_GET_AS(IrInstr *, &block->instructions, length - 1);
+    return irOpIsTerminator(last->op) ? last : NULL;
+}
+
+usize irBlockSuccessors(IrBlock *block, IrBlock *successors[2]) {
+    IrInstr *terminator = irBlockTerminator(block);
+    if(terminator == NULL) {
+        return 0;
+    }
+    switch(terminator->op) {
+        case IR_JUMP:
+            successors[0] = terminator->as.targets[0];
+            return 1;
+        case IR_BRANCH:
+            successors[0] = terminator->as.targets[0];
+            successors[1] = terminator->as.targets[1];
+            return 2;
+        case IR_RETURN:
+        case IR_EXPECT_FAILED:
+            return 0;
+        default:
+            UNREACHABLE();
+    }
+}
+
+usize irBlockPredecessorIndex(IrBlock *block, IrBlock *predecessor) {
+    ARRAY_FOR(i, block->predecessors) {
+        if(ARRAY_GET_AS(IrBlock *, &block->predecessors, i) == predecessor) {
+            return i;
+        }
+    }
+    UNREACHABLE();
+}
+
+void irBlockRemovePredecessor(IrBlock *block, IrBlock *predecessor) {
+    usize index = irBlockPredecessorIndex(block, predecessor);
+    arrayDelete(&block->predecessors, index);
+    usize phis = phi_count(block);
+    for(usize i = 0; i < phis; ++i) {
+        irInstrRemoveOperand(ARRAY_GET_AS(IrInstr *, &block->instructions, i), index);
+    }
+}
+
+void irBuildJump(IrBlock *block, IrBlock *target, Location location) {
+    IrInstr *jump = irInstrNew(block->function, IR_JUMP, NULL, location);
+    jump->as.targets[0] = target;
+    irBlockAppend(block, jump);
+    add_predecessor(target, block);
+}
+
+void irBuildBranch(IrBlock *block, IrValue *condition, IrBlock *then, IrBlock *else_, Location location) {
+    VERIFY(then != else_);
+    IrInstr *branch = irInstrNew(block->function, IR_BRANCH, NULL, location);
+    irInstrAddOperand(branch, condition);
+    branch->as.targets[0] = then;
+    branch->as.targets[1] = else_;
+    irBlockAppend(block, branch);
+    add_predecessor(then, block);
+    add_predecessor(else_, block);
+}
+
+
+/* Printing */
+
+static void print_function_name(FILE *to, ASTObj *fn) {
+    if(fn->parent) {
+        fprintf(to, "%s.", fn->parent->name);
+    }
+    fputs(fn->name, to);
+}
+
+static void print_value(FILE *to, IrValue *value) {
+    switch(value->kind) {
+        case IR_VALUE_CONSTANT: {
+            IrConstant *c = (IrConstant *)value;
+            switch(value->type->type) {
+                case TY_BOOL:
+                    fputs(c->as.boolean ? "true" : "false", to);
+                    break;
+                case TY_STR:
+                    fprintf(to, "\"%s\"", c->as.string);
+                    break;
+                case TY_I32:
+                    // Folded constants are sign-extended (see typeWrapInteger()).
+                    fprintf(to, "%ld", (long)(i64)c->as.number);
+                    break;
+                default:
+                    fprintf(to, "%lu", (unsigned long)c->as.number);
+                    break;
+            }
+            break;
+        }
+        case IR_VALUE_UNDEFINED:
+            fputs("undefined", to);
+            break;
+        case IR_VALUE_PARAMETER:
+            fprintf(to, "%%%s", ((IrObjectValue *)value)->obj->name);
+            break;
+        case IR_VALUE_GLOBAL:
+            fprintf(to, "@%s", ((IrObjectValue *)value)->obj->name);
+            break;
+        case IR_VALUE_FUNCTION:
+            fputc('@', to);
+            print_function_name(to, ((IrObjectValue *)value)->obj);
+            break;
+        case IR_VALUE_INSTRUCTION:
+            fprintf(to, "%%%u", ((IrInstr *)value)->id);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static void print_instruction(FILE *to, IrInstr *instr) {
+    fputs("    ", to);
+    if(instr->header.type) {
+        fprintf(to, "%%%u: %s = ", instr->id, instr->header.type->name);
+    }
+    fputs(irOpName(instr->op), to);
+    switch(instr->op) {
+        case IR_ALLOCA:
+            fprintf(to, " %s", instr->as.variable->name);
+            break;
+        case IR_FIELD_ADDRESS:
+            fputc(' ', to);
+            print_value(to, IR_OPERAND(instr, 0));
+            fprintf(to, ", %s", instr->as.field->name);
+            break;
+        case IR_PHI:
+            ARRAY_FOR(i, instr->operands) {
+                fprintf(to, "%s[b%u: ", i > 0 ? ", " : " ", ARRAY_GET_AS(IrBlock *, &instr->block->predecessors, i)->id);
+                print_value(to, IR_OPERAND(instr, i));
+                fputc(']', to);
+            }
+            break;
+        case IR_JUMP:
+            fprintf(to, " b%u", instr->as.targets[0]->id);
+            break;
+        case IR_BRANCH:
+            fputc(' ', to);
+            print_value(to, IR_OPERAND(instr, 0));
+            fprintf(to, ", b%u, b%u", instr->as.targets[0]->id, instr->as.targets[1]->id);
+            break;
+        default:
+            ARRAY_FOR(i, instr->operands) {
+                fputs(i > 0 ? ", " : " ", to);
+                print_value(to, IR_OPERAND(instr, i));
+            }
+            if(instr->op == IR_CALL && instr->as.tail) {
+                fputs(" ; tail", to);
+            }
+            break;
+    }
+    fputc('\n', to);
+}
+
+void irFunctionPrint(FILE *to, IrFunction *fn) {
+    fputs("fn ", to);
+    print_function_name(to, fn->fn);
+    fputc('(', to);
+    ARRAY_FOR(i, fn->parameters) {
+        IrObjectValue *param = ARRAY_GET_AS(IrObjectValue *, &fn->parameters, i);
+        fprintf(to, "%s%%%s: %s", i > 0 ? ", " : "", param->obj->name, param->header.type->name);
+    }
+    fprintf(to, ") -> %s {\n", fn->fn->as.fn.returnType->name);
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        fprintf(to, "b%u:", block->id);
+        ARRAY_FOR(j, block->predecessors) {
+            fprintf(to, "%s b%u", j > 0 ? "," : " ; preds:", ARRAY_GET_AS(IrBlock *, &block->predecessors, j)->id);
+        }
+        if(block->cold) {
+            fputs(" ; cold", to);
+        }
+        fputc('\n', to);
+        ARRAY_FOR(j, block->instructions) {
+            print_instruction(to, ARRAY_GET_AS(IrInstr *, &block->instructions, j));
+        }
+    }
+    fputs("}\n", to);
+}
+
+
+/* Calling convention */
+
+// The size & alignment the C compiler gives a type on 64-bit targets.
+static usize type_size(Type *ty, usize *alignment) {
+    switch(ty->type) {
+        case TY_BOOL:
+            *alignment = 1;
+            return 1;
+        case TY_I32:
+        case TY_U32:
+            *alignment = 4;
+            return 4;
+        case TY_STR:
+            // A pointer & a length (see genPrelude() in Codegen.c).
+            *alignment = 8;
+            return 16;
+        case TY_STRUCT: {
+            usize size = 0;
+            *alignment = 1;
+            ARRAY_FOR(i, ty->as.structure.fieldTypes) {
+                usize fieldAlignment;
+                usize fieldSize = type_size(ARRAY_GET_AS(Type *, &ty->as.structure.fieldTypes, i), &fieldAlignment);
+                size = (size + fieldAlignment - 1) / fieldAlignment * fieldAlignment + fieldSize;
+                *alignment = fieldAlignment > *alignment ? fieldAlignment : *alignment;
+            }
+            // #[aligned(N)] (see genStructDefinition() in Codegen.c).
+            if(ty->as.structure.alignment > *alignment) {
+                *alignment = (usize)ty->as.structure.alignment;
+            }
+            return (size + *alignment - 1) / *alignment * *alignment;
+        }
+        default:
+            // Pointers (including functions.)
+            *alignment = 8;
+            return 8;
+    }
+}
+
+bool irTypeIsPassedByPointer(Type *ty) {
+    usize alignment;
+    return ty->type == TY_STRUCT && type_size(ty, &alignment) > IR_MAX_STRUCT_VALUE_SIZE;
+}
@@ -0,0 +1,816 @@
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Ast/Ast.h"
+#include "Ir/Ir.h"
+#include "Ir/Lower.h"
+
+// The SSA construction state of a block (indexed by block id.)
+typedef struct block_state {
+    Table definitions; // Table<ASTObj *, IrValue *> (the latest value of every variable written in the block.)
+    Array incompletePhis; // Array<IrInstr *> (phis added before the block was sealed, in the order they were added.)
+    bool sealed;
+} BlockState;
+
+typedef struct lowerer {
+    IrModule *module;
+    IrFunction *function;
+    IrBlock *current; // The block code is added to.
+    IrBlock *exitBlock; // Returns jump here (the defers are run, then the function returns.)
+    Array blockStates; // Array<BlockState *>
+    Table locals; // Table<ASTObj *, void> (parameters & local variables.)
+    Array localsOrder; // Array<ASTObj *> (the locals in the order they were found, see create_slots().)
+    Table slots; // Table<ASTObj *, IrInstr *> (the stack slots of the locals that aren't SSA values.)
+    Table replacements; // Table<IrValue *, IrValue *> (removed phis -> the value that replaced them.)
+    Array defers; // Array<ASTDeferStmt *> (in the order they appear in the function.)
+    bool inDefers; // Whether the defers are being lowered (returns in them return directly.)
+    bool expectChecks; // See irLowerModule().
+} Lowerer;
+
+static unsigned hash_pointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool compare_pointers(void *a, void *b) {
+    return a == b;
+}
+
+/* SSA construction */
+
+static BlockState *block_state(Lowerer *l, IrBlock *block) {
+    while(arrayLength(&l->blockStates) <= block->id) {
+        BlockState *state;
+        NEW0(state);
+        tableInit(&state->definitions, hash_pointer, compare_pointers);
+        arrayInit(&state->incompletePhis);
+        state->sealed = false;
+        arrayPush(&l->blockStates, (void *)state);
+    }
+    return ARRAY_GET_AS(BlockState *, &l->blockStates, block->id);
+}
+
+// Follow the replacements of removed phis.
+static IrValue *resolve(Lowerer *l, IrValue *value) {
+    TableItem *item;
+    while((item = tableGet(&l->replacements, (void *)value)) != NULL) {
+        value = (IrValue *)item->value;
+    }
+    return value;
+}
+
+static void write_variable(Lowerer *l, ASTObj *var, IrBlock *block, IrValue *value) {
+    tableSet(&block_state(l, block)->definitions, (void *)var, (void *)value);
+}
+
+static Type *variable_type(ASTObj *var) {
+    // The return value is stored as a variable using the function object as the key.
+    return var->type == OBJ_FN ? var->as.fn.returnType : var->dataType;
+}
+
+static IrInstr *new_phi(Lowerer *l, ASTObj *var, IrBlock *block) {
+    IrInstr *phi = irInstrNew(l->function, IR_PHI, variable_type(var), EMPTY_LOCATION);
+    phi->as.variable = var;
+    irBlockAppend(block, phi);
+    return phi;
+}
+
+static IrValue *try_remove_trivial_phi(Lowerer *l, IrInstr *phi) {
+    IrValue *same = NULL;
+    ARRAY_FOR(i, phi->operands) {
+        IrValue *operand = IR_OPERAND(phi, i);
+        if(operand == same || operand == (IrValue *)phi) {
+            continue;
+        }
+        if(same != NULL) {
+            // The phi merges at least two values.
+            return (IrValue *)phi;
+        }
+        same = operand;
+    }
+    if(same == NULL) {
+        // The phi is unreachable or in the entry block.
+        same = irUndefinedNew(l->function, phi->header.type);
+    }
+    // Remember the phis using this phi, they might become trivial.
+    Array users; // Array<IrInstr *>
+    arrayInit(&users);
+    ARRAY_FOR(i, phi->header.uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &phi->header.uses, i);
+        if(user != phi && user->op == IR_PHI) {
+            arrayPush(&users, (void *)user);
+        }
+    }
+    irValueReplaceAllUses((IrValue *)phi, same);
+    irInstrRemove(phi);
+    tableSet(&l->replacements, (void *)phi, (void *)same);
+    ARRAY_FOR(i, users) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &users, i);
+        // The user might have been removed by a previous iteration, or still be getting its operands.
+        if(user->block != NULL && arrayLength(&user->operands) == arrayLength(&user->block->predecessors)) {
+            try_remove_trivial_phi(l, user);
+        }
+    }
+    arrayFree(&users);
+    return resolve(l, same);
+}
+
+static IrValue *read_variable(Lowerer *l, ASTObj *var, IrBlock *block);
+
+static IrValue *add_phi_operands(Lowerer *l, ASTObj *var, IrInstr *phi) {
+    IrBlock *block = phi->block;
+    ARRAY_FOR(i, block->predecessors) {
+        IrBlock *predecessor = ARRAY_GET_AS(IrBlock *, &block->predecessors, i);
+        irInstrAddOperand(phi, read_variable(l, var, predecessor));
+    }
+    return try_remove_trivial_phi(l, phi);
+}
+
+static IrValue *read_variable_recursive(Lowerer *l, ASTObj *var, IrBlock *block) {
+    BlockState *state = block_state(l, block);
+    IrValue *value = NULL;
+    if(!state->sealed) {
+        // Not all predecessors are known yet, the phi is completed when the block is sealed.
+        IrInstr *phi = new_phi(l, var, block);
+        arrayPush(&state->incompletePhis, (void *)phi);
+        value = (IrValue *)phi;
+    } else if(arrayLength(&block->predecessors) == 0) {
+        // Read before it was written (or in an unreachable block.)
+        value = irUndefinedNew(l->function, variable_type(var));
+    } else if(arrayLength(&block->predecessors) == 1) {
+        value = read_variable(l, var, ARRAY_GET_AS(IrBlock *, &block->predecessors, 0));
+    } else {
+        // Break cycles by writing the phi before reading the predecessors.
+        IrInstr *phi = new_phi(l, var, block);
+        write_variable(l, var, block, (IrValue *)phi);
+        value = add_phi_operands(l, var, phi);
+    }
+    write_variable(l, var, block, value);
+    return value;
+}
+
+static IrValue *read_variable(Lowerer *l, ASTObj *var, IrBlock *block) {
+    TableItem *item = tableGet(&block_state(l, block)->definitions, (void *)var);
+    if(item) {
+        return resolve(l, (IrValue *)item->value);
+    }
+    return read_variable_recursive(l, var, block);
+}
+
+static void seal_block(Lowerer *l, IrBlock *block) {
+    BlockState *state = block_state(l, block);
+    VERIFY(!state->sealed);
+    // Completed in the order the phis were added so the generated code doesn't depend on addresses.
+    ARRAY_FOR(i, state->incompletePhis) {
+        IrInstr *phi = ARRAY_GET_AS(IrInstr *, &state->incompletePhis, i);
+        add_phi_operands(l, phi->as.variable, phi);
+    }
+    arrayClear(&state->incompletePhis);
+    state->sealed = true;
+}
+
+// Create a block whose predecessors are all known (so it is sealed right away.)
+static IrBlock *new_sealed_block(Lowerer *l) {
+    IrBlock *block = irBlockNew(l->function);
+    block_state(l, block)->sealed = true;
+    return block;
+}
+
+
+/* Pre-pass: finding the variables that live in memory */
+
+static void add_local(Lowerer *l, ASTObj *var) {
+    if(tableGet(&l->locals, (void *)var) == NULL) {
+        tableSet(&l->locals, (void *)var, NULL);
+        arrayPush(&l->localsOrder, (void *)var);
+    }
+}
+
+static void find_locals_in_expr(Lowerer *l, ASTExprNode *expr) {
+    if(expr == NULL) {
+        return;
+    }
+    switch(expr->type) {
+        case EXPR_ASSIGN:
+        case EXPR_PROPERTY_ACCESS:
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_LOGICAL_AND:
+        case EXPR_LOGICAL_OR:
+            find_locals_in_expr(l, NODE_AS(ASTBinaryExpr, expr)->lhs);
+            // The rhs of a property access is a field.
+            if(!NODE_IS(expr, EXPR_PROPERTY_ACCESS)) {
+                find_locals_in_expr(l, NODE_AS(ASTBinaryExpr, expr)->rhs);
+            }
+            break;
+        case EXPR_ADDROF: {
+            ASTExprNode *operand = NODE_AS(ASTUnaryExpr, expr)->operand;
+            if(NODE_IS(operand, EXPR_VARIABLE)) {
+                ASTObj *var = NODE_AS(ASTObjExpr, operand)->obj;
+                if(tableGet(&l->locals, (void *)var) != NULL && tableGet(&l->slots, (void *)var) == NULL) {
+                    // The slot is created once all the locals are known.
+                    tableSet(&l->slots, (void *)var, NULL);
+                }
+            }
+            find_locals_in_expr(l, operand);
+            break;
+        }
+        case EXPR_NEGATE:
+        case EXPR_LOGICAL_NOT:
+        case EXPR_DEREF:
+            find_locals_in_expr(l, NODE_AS(ASTUnaryExpr, expr)->operand);
+            break;
+        case EXPR_CALL:
+            find_locals_in_expr(l, NODE_AS(ASTCallExpr, expr)->callee);
+            ARRAY_FOR(i, NODE_AS(ASTCallExpr, expr)->arguments) {
+                find_locals_in_expr(l, ARRAY_GET_AS(ASTExprNode *, &NODE_AS(ASTCallExpr, expr)->arguments, i));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void find_locals(Lowerer *l, ASTStmtNode *stmt) {
+    if(stmt == NULL) {
+        return;
+    }
+    switch(stmt->type) {
+        case STMT_VAR_DECL:
+            add_local(l, NODE_AS(ASTVarDeclStmt, stmt)->variable);
+            find_locals_in_expr(l, NODE_AS(ASTVarDeclStmt, stmt)->initializer);
+            break;
+        case STMT_BLOCK:
+            ARRAY_FOR(i, NODE_AS(ASTBlockStmt, stmt)->nodes) {
+                find_locals(l, ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i));
+            }
+            break;
+        case STMT_IF:
+        case STMT_EXPECT:
+            find_locals_in_expr(l, NODE_AS(ASTConditionalStmt, stmt)->condition);
+            find_locals(l, NODE_AS(ASTConditionalStmt, stmt)->then);
+            find_locals(l, NODE_AS(ASTConditionalStmt, stmt)->else_);
+            break;
+        case STMT_LOOP:
+            find_locals(l, NODE_AS(ASTLoopStmt, stmt)->initializer);
+            find_locals_in_expr(l, NODE_AS(ASTLoopStmt, stmt)->condition);
+            find_locals_in_expr(l, NODE_AS(ASTLoopStmt, stmt)->increment);
+            find_locals(l, NODE_AS(ASTStmtNode, NODE_AS(ASTLoopStmt, stmt)->body));
+            break;
+        case STMT_RETURN:
+        case STMT_EXPR:
+            find_locals_in_expr(l, NODE_AS(ASTExprStmt, stmt)->expression);
+            break;
+        case STMT_DEFER:
+            find_locals(l, NODE_AS(ASTDeferStmt, stmt)->body);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static IrInstr *new_alloca(Lowerer *l, IrBlock *block, ASTObj *var, Type *type, Location location) {
+    IrInstr *slot = irInstrNew(l->function, IR_ALLOCA, irModulePointerType(l->module, type), location);
+    slot->as.variable = var;
+    irBlockAppend(block, slot);
+    return slot;
+}
+
+// Create the stack slots of all the locals that aren't SSA values (structs & address-taken locals) in the entry block.
+// The slots are created in the order the locals were found (not in table order), so the output doesn't depend on addresses.
+// Note: The address-taken locals are already in the slots table (with no slot.)
+static void create_slots(Lowerer *l, IrBlock *entry) {
+    ARRAY_FOR(i, l->localsOrder) {
+        ASTObj *var = ARRAY_GET_AS(ASTObj *, &l->localsOrder, i);
+        if(var->dataType->type == TY_STRUCT || tableGet(&l->slots, (void *)var) != NULL) {
+            tableSet(&l->slots, (void *)var, (void *)new_alloca(l, entry, var, var->dataType, var->location));
+        }
+    }
+}
+
+static IrInstr *slot_of(Lowerer *l, ASTObj *var) {
+    TableItem *item = tableGet(&l->slots, (void *)var);
+    return item ? (IrInstr *)item->value : NULL;
+}
+
+static bool is_ssa_variable(Lowerer *l, ASTObj *var) {
+    return tableGet(&l->locals, (void *)var) != NULL && slot_of(l, var) == NULL;
+}
+
+
+/* Expressions */
+
+static IrValue *emit(Lowerer *l, IrOp op, Type *type, Location location, usize numOperands, IrValue *a, IrValue *b) {
+    IrInstr *instr = irInstrNew(l->function, op, type, location);
+    if(numOperands > 0) {
+        irInstrAddOperand(instr, a);
+    }
+    if(numOperands > 1) {
+        irInstrAddOperand(instr, b);
+    }
+    irBlockAppend(l->current, instr);
+    return (IrValue *)instr;
+}
+
+static IrValue *lower_expr(Lowerer *l, ASTExprNode *expr);
+
+// The type of an expression (the validator doesn't set the type of property accesses in a chain, so the field's type is used.)
+static Type *property_type(ASTExprNode *expr) {
+    if(NODE_IS(expr, EXPR_PROPERTY_ACCESS)) {
+        return NODE_AS(ASTObjExpr, NODE_AS(ASTBinaryExpr, expr)->rhs)->obj->dataType;
+    }
+    return expr->dataType;
+}
+
+static IrValue *object_value(Lowerer *l, ASTObj *obj) {
+    if(obj->type == OBJ_FN) {
+        return (IrValue *)irObjectValueNew(l->function, IR_VALUE_FUNCTION, obj->dataType, obj);
+    }
+    VERIFY(obj->type == OBJ_VAR);
+    IrInstr *slot = slot_of(l, obj);
+    if(slot) {
+        return (IrValue *)slot;
+    }
+    // Not a local, so a module variable.
+    VERIFY(tableGet(&l->locals, (void *)obj) == NULL);
+    return (IrValue *)irObjectValueNew(l->function, IR_VALUE_GLOBAL, irModulePointerType(l->module, obj->dataType), obj);
+}
+
+// Lower an expression designating an object in memory, the value is its address.
+static IrValue *lower_address(Lowerer *l, ASTExprNode *expr) {
+    switch(expr->type) {
+        case EXPR_VARIABLE: {
+            ASTObj *var = NODE_AS(ASTObjExpr, expr)->obj;
+            if(!is_ssa_variable(l, var)) {
+                return object_value(l, var);
+            }
+            break;
+        }
+        case EXPR_DEREF:
+            return lower_expr(l, NODE_AS(ASTUnaryExpr, expr)->operand);
+        case EXPR_PROPERTY_ACCESS: {
+            ASTExprNode *lhs = NODE_AS(ASTBinaryExpr, expr)->lhs;
+            ASTObj *field = NODE_AS(ASTObjExpr, NODE_AS(ASTBinaryExpr, expr)->rhs)->obj;
+            IrValue *base = lower_address(l, lhs);
+            if(property_type(lhs)->type == TY_POINTER) {
+                // Auto-deref of a pointer field in the middle of a chain (a.ptr.field).
+                base = emit(l, IR_LOAD, property_type(lhs), lhs->location, 1, base, NULL);
+            }
+            IrInstr *address = irInstrNew(l->function, IR_FIELD_ADDRESS, irModulePointerType(l->module, field->dataType), expr->location);
+            irInstrAddOperand(address, base);
+            address->as.field = field;
+            irBlockAppend(l->current, address);
+            return (IrValue *)address;
+        }
+        default:
+            break;
+    }
+    // A value that isn't in memory (for example a struct returned by a call), so store it in a temporary slot.
+    IrValue *value = lower_expr(l, expr);
+    IrInstr *slot = new_alloca(l, l->current, NULL, expr->dataType, expr->location);
+    emit(l, IR_STORE, NULL, expr->location, 2, (IrValue *)slot, value);
+    return (IrValue *)slot;
+}
+
+static IrValue *lower_constant(Lowerer *l, ASTExprNode *expr) {
+    IrConstant *c = irConstantNew(l->function, expr->dataType);
+    switch(expr->type) {
+        case EXPR_NUMBER_CONSTANT:
+            c->as.number = NODE_AS(ASTConstantValueExpr, expr)->as.number;
+            break;
+        case EXPR_STRING_CONSTANT:
+            c->as.string = NODE_AS(ASTConstantValueExpr, expr)->as.string;
+            break;
+        case EXPR_BOOLEAN_CONSTANT:
+            c->as.boolean = NODE_AS(ASTConstantValueExpr, expr)->as.boolean;
+            break;
+        default:
+            UNREACHABLE();
+    }
+    return (IrValue *)c;
+}
+
+static IrValue *lower_assignment(Lowerer *l, ASTBinaryExpr *assignment) {
+    if(NODE_IS(assignment->lhs, EXPR_VARIABLE) && is_ssa_variable(l, NODE_AS(ASTObjExpr, assignment->lhs)->obj)) {
+        IrValue *value = lower_expr(l, assignment->rhs);
+        write_variable(l, NODE_AS(ASTObjExpr, assignment->lhs)->obj, l->current, value);
+        return value;
+    }
+    IrValue *address = lower_address(l, assignment->lhs);
+    IrValue *value = lower_expr(l, assignment->rhs);
+    emit(l, IR_STORE, NULL, assignment->header.location, 2, address, value);
+    return value;
+}
+
+// a && b, a || b
+static IrValue *lower_logical_op(Lowerer *l, ASTBinaryExpr *expr) {
+    bool isAnd = NODE_IS(NODE_AS(ASTExprNode, expr), EXPR_LOGICAL_AND);
+    IrValue *lhs = lower_expr(l, expr->lhs);
+    IrBlock *lhsEnd = l->current;
+    IrBlock *rhsBlock = new_sealed_block(l);
+    IrBlock *merge = irBlockNew(l->function);
+    if(isAnd) {
+        irBuildBranch(lhsEnd, lhs, rhsBlock, merge, expr->header.location);
+    } else {
+        irBuildBranch(lhsEnd, lhs, merge, rhsBlock, expr->header.location);
+    }
+    l->current = rhsBlock;
+    IrValue *rhs = lower_expr(l, expr->rhs);
+    irBuildJump(l->current, merge, expr->header.location);
+    seal_block(l, merge);
+    // The lhs decides the result when it is false (&&) or true (||).
+    IrConstant *shortCircuit = irConstantNew(l->function, expr->header.dataType);
+    shortCircuit->as.boolean = !isAnd;
+    IrInstr *phi = irInstrNew(l->function, IR_PHI, expr->header.dataType, expr->header.location);
+    irBlockAppend(merge, phi);
+    // The predecessors of [merge] are [lhsEnd] and then the end of the rhs.
+    irInstrAddOperand(phi, (IrValue *)shortCircuit);
+    irInstrAddOperand(phi, rhs);
+    l->current = merge;
+    return (IrValue *)phi;
+}
+
+static IrValue *lower_call(Lowerer *l, ASTCallExpr *call) {
+    IrInstr *instr = irInstrNew(l->function, IR_CALL, NULL, call->header.location);
+    instr->as.tail = false;
+    ASTExprNode *callee = call->callee;
+    usize firstArgument = 0;
+    if(NODE_IS(callee, EXPR_PROPERTY_ACCESS) && NODE_AS(ASTObjExpr, NODE_AS(ASTBinaryExpr, callee)->rhs)->obj->type == OBJ_FN) {
+        // A method call: pass the address of the struct as 'this' (instead of the argument the validator added.)
+        ASTObj *method = NODE_AS(ASTObjExpr, NODE_AS(ASTBinaryExpr, callee)->rhs)->obj;
+        IrValue *this = lower_address(l, NODE_AS(ASTBinaryExpr, callee)->lhs);
+        irInstrAddOperand(instr, (IrValue *)irObjectValueNew(l->function, IR_VALUE_FUNCTION, method->dataType, method));
+        irInstrAddOperand(instr, this);
+        firstArgument = 1;
+    } else {
+        irInstrAddOperand(instr, lower_expr(l, callee));
+    }
+    for(usize i = firstArgument; i < arrayLength(&call->arguments); ++i) {
+        irInstrAddOperand(instr, lower_expr(l, ARRAY_GET_AS(ASTExprNode *, &call->arguments, i)));
+    }
+    if(call->header.dataType->type != TY_VOID) {
+        instr->header.type = call->header.dataType;
+    }
+    irBlockAppend(l->current, instr);
+    return (IrValue *)instr;
+}
+
+static IrOp binary_op(ASTExprType type) {
+    switch(type) {
+        case EXPR_ADD: return IR_ADD;
+        case EXPR_SUBTRACT: return IR_SUBTRACT;
+        case EXPR_MULTIPLY: return IR_MULTIPLY;
+        case EXPR_DIVIDE: return IR_DIVIDE;
+        case EXPR_EQ: return IR_EQ;
+        case EXPR_NE: return IR_NE;
+        case EXPR_LT: return IR_LT;
+        case EXPR_LE: return IR_LE;
+        case EXPR_GT: return IR_GT;
+        case EXPR_GE: return IR_GE;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static IrValue *lower_expr(Lowerer *l, ASTExprNode *expr) {
+    switch(expr->type) {
+        // Constant value nodes.
+        case EXPR_NUMBER_CONSTANT:
+        case EXPR_STRING_CONSTANT:
+        case EXPR_BOOLEAN_CONSTANT:
+            return lower_constant(l, expr);
+        // Obj nodes
+        case EXPR_VARIABLE:
+        case EXPR_FUNCTION: {
+            ASTObj *obj = NODE_AS(ASTObjExpr, expr)->obj;
+            if(obj->type == OBJ_FN) {
+                return object_value(l, obj);
+            }
+            if(is_ssa_variable(l, obj)) {
+                return read_variable(l, obj, l->current);
+            }
+            return emit(l, IR_LOAD, expr->dataType, expr->location, 1, object_value(l, obj), NULL);
+        }
+        // Binary nodes
+        case EXPR_ASSIGN:
+            return lower_assignment(l, NODE_AS(ASTBinaryExpr, expr));
+        case EXPR_PROPERTY_ACCESS:
+            return emit(l, IR_LOAD, property_type(expr), expr->location, 1, lower_address(l, expr), NULL);
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE: {
+            IrValue *lhs = lower_expr(l, NODE_AS(ASTBinaryExpr, expr)->lhs);
+            IrValue *rhs = lower_expr(l, NODE_AS(ASTBinaryExpr, expr)->rhs);
+            return emit(l, binary_op(expr->type), expr->dataType, expr->location, 2, lhs, rhs);
+        }
+        case EXPR_LOGICAL_AND:
+        case EXPR_LOGICAL_OR:
+            return lower_logical_op(l, NODE_AS(ASTBinaryExpr, expr));
+        // Unary nodes
+        case EXPR_NEGATE:
+            return emit(l, IR_NEGATE, expr->dataType, expr->location, 1, lower_expr(l, NODE_AS(ASTUnaryExpr, expr)->operand), NULL);
+        case EXPR_LOGICAL_NOT:
+            return emit(l, IR_NOT, expr->dataType, expr->location, 1, lower_expr(l, NODE_AS(ASTUnaryExpr, expr)->operand), NULL);
+        case EXPR_ADDROF:
+            return lower_address(l, NODE_AS(ASTUnaryExpr, expr)->operand);
+        case EXPR_DEREF:
+            return emit(l, IR_LOAD, expr->dataType, expr->location, 1, lower_expr(l, NODE_AS(ASTUnaryExpr, expr)->operand), NULL);
+        // Call nodes
+        case EXPR_CALL:
+            return lower_call(l, NODE_AS(ASTCallExpr, expr));
+        // Other nodes
+        case EXPR_MODULE:
+        case EXPR_IDENTIFIER:
+        default:
+            UNREACHABLE();
+    }
+}
+
+
+/* Statements */
+
+// Jump to [target] unless the current block already ended (for example with a return.)
+static void jump_to(Lowerer *l, IrBlock *target, Location location) {
+    if(irBlockTerminator(l->current) == NULL) {
+        irBuildJump(l->current, target, location);
+    }
+}
+
+static void lower_stmt(Lowerer *l, ASTStmtNode *stmt);
+
+static void lower_var_decl(Lowerer *l, ASTVarDeclStmt *decl) {
+    if(decl->initializer == NULL) {
+        // Reading the variable before it is assigned results in an undefined value (or whatever is in its slot.)
+        return;
+    }
+    IrInstr *slot = slot_of(l, decl->variable);
+    if(slot) {
+        IrValue *value = lower_expr(l, decl->initializer);
+        emit(l, IR_STORE, NULL, decl->header.location, 2, (IrValue *)slot, value);
+    } else {
+        write_variable(l, decl->variable, l->current, lower_expr(l, decl->initializer));
+    }
+}
+
+static void lower_if(Lowerer *l, ASTConditionalStmt *stmt) {
+    IrValue *condition = lower_expr(l, stmt->condition);
+    IrBlock *then = new_sealed_block(l);
+    IrBlock *else_ = stmt->else_ ? new_sealed_block(l) : NULL;
+    IrBlock *merge = irBlockNew(l->function);
+    irBuildBranch(l->current, condition, then, else_ ? else_ : merge, stmt->header.location);
+    l->current = then;
+    lower_stmt(l, stmt->then);
+    jump_to(l, merge, stmt->header.location);
+    if(else_) {
+        l->current = else_;
+        lower_stmt(l, stmt->else_);
+        jump_to(l, merge, stmt->header.location);
+    }
+    seal_block(l, merge);
+    l->current = merge;
+}
+
+// Note: the parser negates the condition, so it is true when the expect fails.
+static void lower_expect(Lowerer *l, ASTConditionalStmt *stmt) {
+    IrValue *failed = lower_expr(l, stmt->condition);
+    if(!stmt->then && !l->expectChecks) {
+        // The condition is still evaluated for its side effects.
+        return;
+    }
+    IrBlock *failure = new_sealed_block(l);
+    failure->cold = true;
+    IrBlock *next = irBlockNew(l->function);
+    irBuildBranch(l->current, failed, failure, next, stmt->header.location);
+    l->current = failure;
+    if(stmt->then) {
+        // The else body handles the failure.
+        lower_stmt(l, stmt->then);
+        jump_to(l, next, stmt->header.location);
+    } else {
+        IrInstr *report = irInstrNew(l->function, IR_EXPECT_FAILED, NULL, stmt->header.location);
+        IrConstant *file = irConstantNew(l->function, astModuleGetType(l->module->module, "str"));
+        file->as.string = stmt->file;
+        IrConstant *line = irConstantNew(l->function, astModuleGetType(l->module->module, "u32"));
+        line->as.number = stmt->line;
+        irInstrAddOperand(report, (IrValue *)file);
+        irInstrAddOperand(report, (IrValue *)line);
+        irBlockAppend(failure, report);
+    }
+    seal_block(l, next);
+    l->current = next;
+}
+
+static void lower_loop(Lowerer *l, ASTLoopStmt *loop) {
+    if(loop->initializer) {
+        lower_stmt(l, loop->initializer);
+    }
+    // The header isn't sealed until the back edge is added.
+    IrBlock *header = irBlockNew(l->function);
+    IrBlock *body = new_sealed_block(l);
+    IrBlock *exit = irBlockNew(l->function);
+    irBuildJump(l->current, header, loop->header.location);
+    l->current = header;
+    IrValue *condition = lower_expr(l, loop->condition);
+    irBuildBranch(l->current, condition, body, exit, loop->header.location);
+    l->current = body;
+    lower_stmt(l, NODE_AS(ASTStmtNode, loop->body));
+    if(loop->increment) {
+        lower_expr(l, loop->increment);
+    }
+    jump_to(l, header, loop->header.location);
+    seal_block(l, header);
+    seal_block(l, exit);
+    l->current = exit;
+}
+
+static void lower_return(Lowerer *l, ASTExprStmt *stmt) {
+    IrValue *value = stmt->expression ? lower_expr(l, stmt->expression) : NULL;
+    if(l->inDefers) {
+        // Returning from a defer returns right away (the other defers aren't run.)
+        IrInstr *ret = irInstrNew(l->function, IR_RETURN, NULL, stmt->header.location);
+        if(value) {
+            irInstrAddOperand(ret, value);
+        }
+        irBlockAppend(l->current, ret);
+        return;
+    }
+    if(value) {
+        write_variable(l, l->function->fn, l->current, value);
+    }
+    irBuildJump(l->current, l->exitBlock, stmt->header.location);
+}
+
+static void lower_stmt(Lowerer *l, ASTStmtNode *stmt) {
+    if(irBlockTerminator(l->current) != NULL) {
+        // Unreachable code (after a return), lower it to a block without predecessors (it is removed later.)
+        l->current = new_sealed_block(l);
+    }
+    switch(stmt->type) {
+        // VarDecl nodes
+        case STMT_VAR_DECL:
+            lower_var_decl(l, NODE_AS(ASTVarDeclStmt, stmt));
+            break;
+        // Block nodes
+        case STMT_BLOCK:
+            ARRAY_FOR(i, NODE_AS(ASTBlockStmt, stmt)->nodes) {
+                lower_stmt(l, ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i));
+            }
+            break;
+        // Conditional nodes
+        case STMT_IF:
+            lower_if(l, NODE_AS(ASTConditionalStmt, stmt));
+            break;
+        case STMT_EXPECT:
+            lower_expect(l, NODE_AS(ASTConditionalStmt, stmt));
+            break;
+        // Loop nodes
+        case STMT_LOOP:
+            lower_loop(l, NODE_AS(ASTLoopStmt, stmt));
+            break;
+        // Expr nodes
+        case STMT_RETURN:
+            lower_return(l, NODE_AS(ASTExprStmt, stmt));
+            break;
+        case STMT_EXPR:
+            lower_expr(l, NODE_AS(ASTExprStmt, stmt)->expression);
+            break;
+        // Defer nodes
+        case STMT_DEFER:
+            // Defers are lowered in the exit block.
+            arrayPush(&l->defers, (void *)stmt);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+
+/* Functions */
+
+static void free_block_state(BlockState *state) {
+    tableFree(&state->definitions);
+    arrayFree(&state->incompletePhis);
+    FREE(state);
+}
+
+static void lower_function(Lowerer *l, ASTObj *fn) {
+    l->function = irFunctionNew(l->module, fn);
+    arrayInit(&l->blockStates);
+    tableInit(&l->locals, hash_pointer, compare_pointers);
+    arrayInit(&l->localsOrder);
+    tableInit(&l->slots, hash_pointer, compare_pointers);
+    tableInit(&l->replacements, hash_pointer, compare_pointers);
+    arrayInit(&l->defers);
+    l->inDefers = false;
+
+    ARRAY_FOR(i, fn->as.fn.parameters) {
+        add_local(l, ARRAY_GET_AS(ASTObj *, &fn->as.fn.parameters, i));
+    }
+    find_locals(l, NODE_AS(ASTStmtNode, fn->as.fn.body));
+
+    IrBlock *entry = new_sealed_block(l);
+    l->current = entry;
+    create_slots(l, entry);
+    ARRAY_FOR(i, fn->as.fn.parameters) {
+        ASTObj *param = ARRAY_GET_AS(ASTObj *, &fn->as.fn.parameters, i);
+        IrValue *value = (IrValue *)irObjectValueNew(l->function, IR_VALUE_PARAMETER, param->dataType, param);
+        arrayPush(&l->function->parameters, (void *)value);
+        IrInstr *slot = slot_of(l, param);
+        if(slot) {
+            emit(l, IR_STORE, NULL, param->location, 2, (IrValue *)slot, value);
+        } else {
+            write_variable(l, param, entry, value);
+        }
+    }
+
+    l->exitBlock = irBlockNew(l->function);
+    lower_stmt(l, NODE_AS(ASTStmtNode, fn->as.fn.body));
+    // Falling off the end of the function.
+    jump_to(l, l->exitBlock, fn->location);
+    seal_block(l, l->exitBlock);
+
+    // The exit block: the return value is read before the defers run (so they can't change it.)
+    l->current = l->exitBlock;
+    IrValue *returnValue = NULL;
+    if(fn->as.fn.returnType->type != TY_VOID) {
+        returnValue = read_variable(l, fn, l->exitBlock);
+    }
+    l->inDefers = true;
+    ARRAY_FOR(i, l->defers) {
+        lower_stmt(l, NODE_AS(ASTDeferStmt, ARRAY_GET_AS(ASTDeferStmt *, &l->defers, i))->body);
+    }
+    if(irBlockTerminator(l->current) == NULL) {
+        IrInstr *ret = irInstrNew(l->function, IR_RETURN, NULL, fn->location);
+        if(returnValue) {
+            irInstrAddOperand(ret, resolve(l, returnValue));
+        }
+        irBlockAppend(l->current, ret);
+    }
+
+    ARRAY_FOR(i, l->blockStates) {
+        free_block_state(ARRAY_GET_AS(BlockState *, &l->blockStates, i));
+    }
+    arrayFree(&l->blockStates);
+    tableFree(&l->locals);
+    arrayFree(&l->localsOrder);
+    tableFree(&l->slots);
+    tableFree(&l->replacements);
+    arrayFree(&l->defers);
+    l->function = NULL;
+    l->current = l->exitBlock = NULL;
+}
+
+static void lower_functions_in_scope(Lowerer *l, Scope *scope) {
+    Array objects; // Array<ASTObj *>
+    arrayInit(&objects);
+    scopeGetAllObjects(scope, &objects);
+    ARRAY_FOR(i, objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
+        if(obj->type == OBJ_FN && obj->as.fn.body != NULL) {
+            lower_function(l, obj);
+        } else if(obj->type == OBJ_STRUCT) {
+            lower_functions_in_scope(l, obj->as.structure.scope);
+        }
+    }
+    arrayFree(&objects);
+}
+
+IrFunction *irLowerFunction(IrModule *m, ASTObj *fn, bool expectChecks) {
+    VERIFY(fn->type == OBJ_FN && fn->as.fn.body != NULL);
+    Lowerer l = {0};
+    l.module = m;
+    l.expectChecks = expectChecks;
+    lower_function(&l, fn);
+    return irModuleGetFunction(m, fn);
+}
+
+IrModule *irLowerModule(ASTProgram *prog, ASTModule *module, bool expectChecks) {
+    Lowerer l = {0};
+    l.module = irModuleNew(prog, module);
+    l.expectChecks = expectChecks;
+    lower_functions_in_scope(&l, module->moduleScope);
+    return l.module;
+}
+
+void irLowerProgram(ASTProgram *prog, IrProgram *output, bool expectChecks) {
+    output->ast = prog;
+    arrayInit(&output->modules);
+    ARRAY_FOR(i, prog->modules) {
+        arrayPush(&output->modules, (void *)irLowerModule(prog, ARRAY_GET_AS(ASTModule *, &prog->modules, i), expectChecks));
+    }
+}
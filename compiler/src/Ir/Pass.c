@@ -0,0 +1,812 @@
+#include <stdio.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Ir/Ir.h"
+#include "Ir/Pass.h"
+
+/* Pass manager */
+
+void irPassManagerInit(IrPassManager *pm) {
+    arrayInit(&pm->passes);
+#ifdef ILC_VERIFY_IR
+    pm->verify = true;
+#else
+    pm->verify = false;
+#endif
+}
+
+void irPassManagerFree(IrPassManager *pm) {
+    arrayFree(&pm->passes);
+}
+
+void irPassManagerAdd(IrPassManager *pm, const IrPass *pass) {
+    arrayPush(&pm->passes, (void *)pass);
+}
+
+void irPassManagerAddDefaultPasses(IrPassManager *pm) {
+    irPassManagerAdd(pm, &irPassFoldConstants);
+    irPassManagerAdd(pm, &irPassRemoveUnreachableBlocks);
+    irPassManagerAdd(pm, &irPassRemoveTrivialPhis);
+    irPassManagerAdd(pm, &irPassSimplifyCfg);
+    irPassManagerAdd(pm, &irPassTailCalls);
+}
+
+static void verify_or_abort(IrFunction *fn, const char *after) {
+    if(!irVerifyFunction(fn)) {
+        LOG_ERR("Invalid IR in function '%s' after %s:\n", fn->fn->name, after);
+        irFunctionPrint(stderr, fn);
+        UNREACHABLE();
+    }
+}
+
+void irPassManagerRunOnModule(IrPassManager *pm, IrModule *m) {
+    ARRAY_FOR(i, m->functions) {
+        IrFunction *fn = ARRAY_GET_AS(IrFunction *, &m->functions, i);
+        if(pm->verify) {
+            verify_or_abort(fn, "lowering");
+        }
+        ARRAY_FOR(j, pm->passes) {
+            const IrPass *pass = ARRAY_GET_AS(const IrPass *, &pm->passes, j);
+            if(pass->run(fn) && pm->verify) {
+                verify_or_abort(fn, pass->name);
+            }
+        }
+    }
+}
+
+void irPassManagerRunOnProgram(IrPassManager *pm, IrProgram *prog) {
+    ARRAY_FOR(i, prog->modules) {
+        irPassManagerRunOnModule(pm, ARRAY_GET_AS(IrModule *, &prog->modules, i));
+    }
+}
+
+
+/* Verifier */
+
+// The verifier only uses tables and lists built once per function, so verifying is linear in the size of the IR.
+
+// An edge between two IR objects: an operand (user -> value), or a control flow edge (block -> successor.)
+typedef struct ir_edge {
+    void *from, *to;
+} IrEdge;
+
+static unsigned hash_edge(void *edge) {
+    IrEdge *e = (IrEdge *)edge;
+    return (unsigned)((usize)e->from >> 3) * 31u + (unsigned)((usize)e->to >> 3);
+}
+
+static bool compare_edges(void *a, void *b) {
+    return ((IrEdge *)a)->from == ((IrEdge *)b)->from && ((IrEdge *)a)->to == ((IrEdge *)b)->to;
+}
+
+static unsigned hash_pointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool compare_pointers(void *a, void *b) {
+    return a == b;
+}
+
+// A multiset of edges: every edge in [edges] is added to it, then every edge of the other side is taken out of it.
+typedef struct ir_edge_set {
+    Table counts; // Table<IrEdge *, usize> (the keys point into [edges].)
+    IrEdge *edges;
+    usize length, taken;
+    bool missing; // An edge was taken out that wasn't added.
+} IrEdgeSet;
+
+static void edge_set_init(IrEdgeSet *set, usize capacity) {
+    tableInit(&set->counts, hash_edge, compare_edges);
+    set->edges = CALLOC(capacity > 0 ? capacity : 1, sizeof(*set->edges));
+    set->length = set->taken = 0;
+    set->missing = false;
+}
+
+static void edge_set_free(IrEdgeSet *set) {
+    tableFree(&set->counts);
+    FREE(set->edges);
+}
+
+static void edge_set_add(IrEdgeSet *set, void *from, void *to) {
+    IrEdge *edge = &set->edges[set->length++];
+    edge->from = from;
+    edge->to = to;
+    TableItem *item = tableGet(&set->counts, (void *)edge);
+    if(item) {
+        item->value = (void *)((usize)item->value + 1);
+    } else {
+        tableSet(&set->counts, (void *)edge, (void *)1);
+    }
+}
+
+static void edge_set_take(IrEdgeSet *set, void *from, void *to) {
+    IrEdge edge = {.from = from, .to = to};
+    TableItem *item = tableGet(&set->counts, (void *)&edge);
+    if(item == NULL || (usize)item->value == 0) {
+        set->missing = true;
+        return;
+    }
+    item->value = (void *)((usize)item->value - 1);
+    set->taken++;
+}
+
+// Whether exactly the edges that were added were taken out.
+static bool edge_set_matches(IrEdgeSet *set) {
+    return !set->missing && set->taken == set->length;
+}
+
+// Only used to report the errors once a mismatch was found (it's quadratic.)
+static usize count_in_array(Array *a, void *value) {
+    usize count = 0;
+    ARRAY_FOR(i, *a) {
+        if(arrayGet(a, i) == value) {
+            count++;
+        }
+    }
+    return count;
+}
+
+#define CHECK(condition, ...) do { \
+    if(!(condition)) { \
+        LOG_ERR(__VA_ARGS__); \
+        valid = false; \
+    } \
+} while(0)
+
+static bool verify_instruction(IrBlock *block, IrInstr *instr) {
+    bool valid = true;
+    CHECK(instr->block == block, "%%%u: Wrong block (expected b%u).\n", instr->id, block->id);
+    ARRAY_FOR(i, instr->operands) {
+        IrValue *operand = IR_OPERAND(instr, i);
+        if(IR_VALUE_IS(operand, IR_VALUE_INSTRUCTION)) {
+            CHECK(((IrInstr *)operand)->block != NULL, "%%%u: Operand %lu was removed.\n", instr->id, i);
+        }
+    }
+    ARRAY_FOR(i, instr->header.uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &instr->header.uses, i);
+        CHECK(user->block != NULL, "%%%u: Used by the removed instruction %%%u.\n", instr->id, user->id);
+    }
+    if(instr->op == IR_PHI) {
+        CHECK(arrayLength(&instr->operands) == arrayLength(&block->predecessors),
+              "%%%u: The phi has %lu operands but the block has %lu predecessors.\n",
+              instr->id, arrayLength(&instr->operands), arrayLength(&block->predecessors));
+    }
+    if(instr->op == IR_BRANCH) {
+        CHECK(instr->as.targets[0] != instr->as.targets[1], "%%%u: Both targets of the branch are the same.\n", instr->id);
+    }
+    return valid;
+}
+
+// Report which use lists don't match the operands.
+static void report_use_mismatches(IrFunction *fn) {
+    bool valid = true;
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            ARRAY_FOR(k, instr->operands) {
+                IrValue *operand = IR_OPERAND(instr, k);
+                CHECK(count_in_array(&operand->uses, (void *)instr) == count_in_array(&instr->operands, (void *)operand),
+                      "%%%u: The use list of operand %lu doesn't match.\n", instr->id, k);
+            }
+            ARRAY_FOR(k, instr->header.uses) {
+                IrInstr *user = ARRAY_GET_AS(IrInstr *, &instr->header.uses, k);
+                CHECK(count_in_array(&user->operands, (void *)instr) > 0, "%%%u: Used by %%%u which doesn't use it.\n", instr->id, user->id);
+            }
+        }
+    }
+    UNUSED(valid);
+}
+
+// Check that the use lists of the values hold exactly the operands of the instructions.
+static bool verify_uses(IrFunction *fn) {
+    usize numOperands = 0;
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            numOperands += arrayLength(&ARRAY_GET_AS(IrInstr *, &block->instructions, j)->operands);
+        }
+    }
+    IrEdgeSet operands;
+    edge_set_init(&operands, numOperands);
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            ARRAY_FOR(k, instr->operands) {
+                edge_set_add(&operands, (void *)instr, arrayGet(&instr->operands, k));
+            }
+        }
+    }
+    // The removed instructions are only checked through their users (see verify_instruction()).
+    ARRAY_FOR(i, fn->values) {
+        IrValue *value = ARRAY_GET_AS(IrValue *, &fn->values, i);
+        if(IR_VALUE_IS(value, IR_VALUE_INSTRUCTION) && ((IrInstr *)value)->block == NULL) {
+            continue;
+        }
+        ARRAY_FOR(j, value->uses) {
+            edge_set_take(&operands, arrayGet(&value->uses, j), (void *)value);
+        }
+    }
+    bool valid = edge_set_matches(&operands);
+    edge_set_free(&operands);
+    if(!valid) {
+        LOG_ERR("The use lists don't match the operands.\n");
+        report_use_mismatches(fn);
+    }
+    return valid;
+}
+
+// Check that the predecessor lists hold exactly the edges of the terminators.
+static bool verify_predecessors(IrFunction *fn) {
+    bool valid = true;
+    Table blocks; // Table<IrBlock *, void> (the blocks of the function.)
+    tableInit(&blocks, hash_pointer, compare_pointers);
+    ARRAY_FOR(i, fn->blocks) {
+        tableSet(&blocks, arrayGet(&fn->blocks, i), NULL);
+    }
+    IrEdgeSet edges;
+    edge_set_init(&edges, arrayLength(&fn->blocks) * 2);
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        IrBlock *successors[2];
+        usize numSuccessors = irBlockSuccessors(block, successors);
+        for(usize j = 0; j < numSuccessors; ++j) {
+            CHECK(tableGet(&blocks, (void *)successors[j]) != NULL, "b%u: The successor b%u was removed.\n", block->id, successors[j]->id);
+            edge_set_add(&edges, (void *)block, (void *)successors[j]);
+        }
+    }
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->predecessors) {
+            IrBlock *predecessor = ARRAY_GET_AS(IrBlock *, &block->predecessors, j);
+            usize before = edges.taken;
+            edge_set_take(&edges, (void *)predecessor, (void *)block);
+            CHECK(edges.taken > before, "b%u: The predecessor b%u doesn't branch to it (or appears more than once.)\n", block->id, predecessor->id);
+        }
+    }
+    CHECK(edges.taken == edges.length, "A block isn't a predecessor of one of its successors.\n");
+    edge_set_free(&edges);
+    tableFree(&blocks);
+    return valid;
+}
+
+bool irVerifyFunction(IrFunction *fn) {
+    bool valid = true;
+    CHECK(arrayLength(&fn->blocks) > 0, "The function has no blocks.\n");
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        CHECK(block->function == fn, "b%u: Wrong function.\n", block->id);
+        CHECK(irBlockTerminator(block) != NULL, "b%u: The block isn't terminated.\n", block->id);
+        bool phisEnded = false;
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(instr->op == IR_PHI) {
+                CHECK(!phisEnded, "b%u: The phi %%%u isn't at the start of the block.\n", block->id, instr->id);
+            } else {
+                phisEnded = true;
+            }
+            if(irOpIsTerminator(instr->op)) {
+                CHECK(j + 1 == arrayLength(&block->instructions), "b%u: The terminator %%%u isn't last.\n", block->id, instr->id);
+            }
+            valid = verify_instruction(block, instr) && valid;
+        }
+    }
+    valid = verify_uses(fn) && valid;
+    valid = verify_predecessors(fn) && valid;
+    if(arrayLength(&fn->blocks) > 0) {
+        IrBlock *entry = ARRAY_GET_AS(IrBlock *, &fn->blocks, 0);
+        CHECK(arrayLength(&entry->predecessors) == 0, "The entry block b%u has predecessors.\n", entry->id);
+    }
+    return valid;
+}
+
+#undef CHECK
+
+
+/* Passes */
+
+// Replace the uses of a trivial phi (a phi merging a single value, or only itself) and remove it.
+// Returns true if the phi was removed.
+static bool remove_phi_if_trivial(IrFunction *fn, IrInstr *phi) {
+    IrValue *same = NULL;
+    ARRAY_FOR(i, phi->operands) {
+        IrValue *operand = IR_OPERAND(phi, i);
+        if(operand == same || operand == (IrValue *)phi) {
+            continue;
+        }
+        if(same != NULL) {
+            return false;
+        }
+        same = operand;
+    }
+    if(same == NULL) {
+        same = irUndefinedNew(fn, phi->header.type);
+    }
+    irValueReplaceAllUses((IrValue *)phi, same);
+    irInstrRemove(phi);
+    return true;
+}
+
+static bool remove_unreachable_blocks(IrFunction *fn) {
+    bool *reachable = CALLOC(fn->nextBlockId, sizeof(*reachable));
+    Array stack; // Array<IrBlock *>
+    arrayInit(&stack);
+    arrayPush(&stack, arrayGet(&fn->blocks, 0));
+    reachable[ARRAY_GET_AS(IrBlock *, &fn->blocks, 0)->id] = true;
+    while(arrayLength(&stack) > 0) {
+        IrBlock *block = ARRAY_POP_AS(IrBlock *, &stack);
+        IrBlock *successors[2];
+        usize numSuccessors = irBlockSuccessors(block, successors);
+        for(usize i = 0; i < numSuccessors; ++i) {
+            if(!reachable[successors[i]->id]) {
+                reachable[successors[i]->id] = true;
+                arrayPush(&stack, (void *)successors[i]);
+            }
+        }
+    }
+    // Collect the unreachable blocks, and disconnect them from the rest of the function.
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        if(!reachable[block->id]) {
+            arrayPush(&stack, (void *)block);
+            IrInstr *terminator = irBlockTerminator(block);
+            if(terminator) {
+                irInstrRemove(terminator);
+            }
+        }
+    }
+    // Values defined in unreachable blocks are only used in unreachable blocks.
+    ARRAY_FOR(i, stack) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &stack, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(arrayLength(&instr->header.uses) > 0) {
+                irValueReplaceAllUses((IrValue *)instr, irUndefinedNew(fn, instr->header.type));
+            }
+        }
+    }
+    irFunctionRemoveBlocks(fn, &stack);
+    bool changed = arrayLength(&stack) > 0;
+    arrayFree(&stack);
+    FREE(reachable);
+    return changed;
+}
+
+static bool remove_trivial_phis(IrFunction *fn) {
+    bool changed = false;
+    bool removed;
+    // Removing a phi can make the phis using it trivial.
+    do {
+        removed = false;
+        ARRAY_FOR(i, fn->blocks) {
+            IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+            for(usize j = 0; j < arrayLength(&block->instructions);) {
+                IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+                if(instr->op != IR_PHI) {
+                    break;
+                }
+                if(remove_phi_if_trivial(fn, instr)) {
+                    removed = true;
+                } else {
+                    j++;
+                }
+            }
+        }
+        changed = changed || removed;
+    } while(removed);
+    return changed;
+}
+
+// Evaluate an instruction whose operands are all constants.
+// Returns NULL if it can't be folded (including divisions by zero and overflowing divisions which are left for runtime.)
+static IrConstant *evaluate_instruction(IrFunction *fn, IrInstr *instr) {
+    usize numOperands = arrayLength(&instr->operands);
+    if(numOperands == 0 || numOperands > 2) {
+        return NULL;
+    }
+    for(usize i = 0; i < numOperands; ++i) {
+        if(!IR_VALUE_IS(IR_OPERAND(instr, i), IR_VALUE_CONSTANT)) {
+            return NULL;
+        }
+    }
+    IrConstant *lhs = (IrConstant *)IR_OPERAND(instr, 0);
+    IrConstant *rhs = (IrConstant *)IR_OPERAND(instr, numOperands - 1);
+    Type *ty = lhs->header.type;
+    if(ty->type == TY_BOOL) {
+        bool result;
+        switch(instr->op) {
+            case IR_EQ: result = lhs->as.boolean == rhs->as.boolean; break;
+            case IR_NE: result = lhs->as.boolean != rhs->as.boolean; break;
+            case IR_NOT: result = !lhs->as.boolean; break;
+            default:
+                return NULL;
+        }
+        IrConstant *c = irConstantNew(fn, instr->header.type);
+        c->as.boolean = result;
+        return c;
+    }
+    if(ty->type != TY_I32 && ty->type != TY_U32) {
+        return NULL;
+    }
+    bool isSigned = ty->type == TY_I32;
+    u64 a = typeWrapInteger(ty, lhs->as.number), b = typeWrapInteger(ty, rhs->as.number);
+    IrConstant *c = NULL;
+    #define BOOL_RESULT(expr) (c = irConstantNew(fn, instr->header.type), c->as.boolean = (expr))
+    #define NUMBER_RESULT(expr) (c = irConstantNew(fn, ty), c->as.number = typeWrapInteger(ty, (expr)))
+    switch(instr->op) {
+        case IR_ADD: NUMBER_RESULT(a + b); break;
+        case IR_SUBTRACT: NUMBER_RESULT(a - b); break;
+        case IR_MULTIPLY: NUMBER_RESULT(a * b); break;
+        case IR_DIVIDE:
+            if(b == 0 || (isSigned && (i64)a == INT32_MIN && (i64)b == -1)) {
+                return NULL;
+            }
+            NUMBER_RESULT(isSigned ? (u64)((i64)a / (i64)b) : a / b);
+            break;
+        case IR_NEGATE: NUMBER_RESULT(0 - a); break;
+        case IR_EQ: BOOL_RESULT(a == b); break;
+        case IR_NE: BOOL_RESULT(a != b); break;
+        case IR_LT: BOOL_RESULT(isSigned ? (i64)a < (i64)b : a < b); break;
+        case IR_LE: BOOL_RESULT(isSigned ? (i64)a <= (i64)b : a <= b); break;
+        case IR_GT: BOOL_RESULT(isSigned ? (i64)a > (i64)b : a > b); break;
+        case IR_GE: BOOL_RESULT(isSigned ? (i64)a >= (i64)b : a >= b); break;
+        default:
+            break;
+    }
+    #undef NUMBER_RESULT
+    #undef BOOL_RESULT
+    return c;
+}
+
+static bool constants_equal(IrConstant *a, IrConstant *b) {
+    if(a->header.type->name != b->header.type->name) {
+        return false;
+    }
+    switch(a->header.type->type) {
+        case TY_BOOL:
+            return a->as.boolean == b->as.boolean;
+        case TY_I32:
+        case TY_U32:
+            return typeWrapInteger(a->header.type, a->as.number) == typeWrapInteger(b->header.type, b->as.number);
+        default:
+            return false;
+    }
+}
+
+// Returns the constant all the operands of a phi are equal to (ignoring the phi itself), or NULL if there is none.
+static IrConstant *constant_phi_value(IrInstr *phi) {
+    IrConstant *value = NULL;
+    ARRAY_FOR(i, phi->operands) {
+        IrValue *operand = IR_OPERAND(phi, i);
+        if(operand == (IrValue *)phi) {
+            continue;
+        }
+        if(!IR_VALUE_IS(operand, IR_VALUE_CONSTANT) || (value && !constants_equal(value, (IrConstant *)operand))) {
+            return NULL;
+        }
+        value = (IrConstant *)operand;
+    }
+    return value;
+}
+
+// Replace a branch on a constant condition with a jump to the target that is always taken.
+static void fold_branch(IrInstr *branch) {
+    bool condition = ((IrConstant *)IR_OPERAND(branch, 0))->as.boolean;
+    IrBlock *taken = branch->as.targets[condition ? 0 : 1];
+    IrBlock *notTaken = branch->as.targets[condition ? 1 : 0];
+    irBlockRemovePredecessor(notTaken, branch->block);
+    irInstrRemoveOperand(branch, 0);
+    branch->op = IR_JUMP;
+    branch->as.targets[0] = taken;
+    branch->as.targets[1] = NULL;
+}
+
+static bool fold_constants(IrFunction *fn) {
+    bool changed = false;
+    bool folded;
+    // Folding a value can make its users constant, and folding a branch can make the phis of
+    // the blocks it no longer reaches constant (once the unreachable blocks are removed).
+    do {
+        folded = false;
+        bool foldedBranch = false;
+        ARRAY_FOR(i, fn->blocks) {
+            IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+            for(usize j = 0; j < arrayLength(&block->instructions);) {
+                IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+                if(instr->op == IR_BRANCH && IR_VALUE_IS(IR_OPERAND(instr, 0), IR_VALUE_CONSTANT)) {
+                    fold_branch(instr);
+                    folded = foldedBranch = true;
+                    break;
+                }
+                IrConstant *value = instr->op == IR_PHI ? constant_phi_value(instr) : evaluate_instruction(fn, instr);
+                if(value == NULL) {
+                    j++;
+                    continue;
+                }
+                irValueReplaceAllUses((IrValue *)instr, (IrValue *)value);
+                irInstrRemove(instr);
+                folded = true;
+            }
+        }
+        if(foldedBranch) {
+            remove_unreachable_blocks(fn);
+        }
+        changed = changed || folded;
+    } while(folded);
+    return changed;
+}
+
+IrInstr *irFindDivisionByZero(IrFunction *fn) {
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(instr->op != IR_DIVIDE || !IR_VALUE_IS(IR_OPERAND(instr, 1), IR_VALUE_CONSTANT)) {
+                continue;
+            }
+            IrConstant *divisor = (IrConstant *)IR_OPERAND(instr, 1);
+            if(typeWrapInteger(divisor->header.type, divisor->as.number) == 0) {
+                return instr;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Merge [block] into its only predecessor [predecessor] which jumps to it.
+// [block] is left empty and without predecessors (to be removed.)
+static void merge_into_predecessor(IrFunction *fn, IrBlock *predecessor, IrBlock *block) {
+    // The phis of a block with a single predecessor have a single operand.
+    while(arrayLength(&block->instructions) > 0 && ARRAY_GET_AS(IrInstr *, &block->instructions, 0)->op == IR_PHI) {
+        VERIFY(remove_phi_if_trivial(fn, ARRAY_GET_AS(IrInstr *, &block->instructions, 0)));
+    }
+    irInstrRemove(irBlockTerminator(predecessor));
+    ARRAY_FOR(i, block->instructions) {
+        IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, i);
+        instr->block = predecessor;
+        arrayPush(&predecessor->instructions, (void *)instr);
+    }
+    arrayClear(&block->instructions);
+    // [predecessor] always continues to [block], so it runs exactly when [block] does.
+    predecessor->cold = predecessor->cold || block->cold;
+    // The successors of [block] are now the successors of [predecessor] (in the same predecessor index.)
+    IrBlock *successors[2];
+    usize numSuccessors = irBlockSuccessors(predecessor, successors);
+    for(usize i = 0; i < numSuccessors; ++i) {
+        usize index = irBlockPredecessorIndex(successors[i], block);
+        successors[i]->predecessors.data[index] = (void *)predecessor;
+    }
+}
+
+static bool simplify_cfg(IrFunction *fn) {
+    Array merged; // Array<IrBlock *> (removed together at the end.)
+    arrayInit(&merged);
+    // Note: The successors of a merged block point to the block it was merged into, so merging chains works.
+    for(usize i = 1; i < arrayLength(&fn->blocks); ++i) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        if(arrayLength(&block->predecessors) == 1) {
+            IrBlock *predecessor = ARRAY_GET_AS(IrBlock *, &block->predecessors, 0);
+            IrInstr *terminator = irBlockTerminator(predecessor);
+            if(predecessor != block && terminator->op == IR_JUMP) {
+                merge_into_predecessor(fn, predecessor, block);
+                arrayPush(&merged, (void *)block);
+            }
+        }
+    }
+    bool changed = arrayLength(&merged) > 0;
+    irFunctionRemoveBlocks(fn, &merged);
+    arrayFree(&merged);
+    return changed;
+}
+
+// The stack slots of a function can only be reused (or freed) before a call ends if no pointer to them can exist.
+static bool slots_escape(IrFunction *fn) {
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        ARRAY_FOR(j, block->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &block->instructions, j);
+            if(instr->op == IR_ALLOCA && irAddressEscapes((IrValue *)instr)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// If [call] is in tail position (nothing runs after it, and its value is returned if the function returns one),
+// return the return instruction it reaches: the terminator of its block, or of a block it jumps to that only has phis
+// (the exit block of a function whose defers are empty). Otherwise, return NULL.
+static IrInstr *tail_call_return(IrInstr *call) {
+    IrBlock *block = call->block;
+    usize length = arrayLength(&block->instructions);
+    if(length < 2 || ARRAY_GET_AS(IrInstr *, &block->instructions, length - 2) != call) {
+        return NULL;
+    }
+    IrInstr *terminator = irBlockTerminator(block);
+    IrInstr *ret = NULL;
+    IrValue *returned = (IrValue *)call; // The value [call] is returned as.
+    if(terminator->op == IR_RETURN) {
+        ret = terminator;
+    } else if(terminator->op == IR_JUMP && terminator->as.targets[0] != block) {
+        IrBlock *exit = terminator->as.targets[0];
+        usize index = irBlockPredecessorIndex(exit, block);
+        ARRAY_FOR(i, exit->instructions) {
+            IrInstr *instr = ARRAY_GET_AS(IrInstr *, &exit->instructions, i);
+            if(instr->op == IR_RETURN) {
+                ret = instr;
+            } else if(instr->op != IR_PHI) {
+                return NULL;
+            } else if(IR_OPERAND(instr, index) == (IrValue *)call) {
+                returned = (IrValue *)instr;
+            }
+        }
+        if(ret == NULL) {
+            return NULL;
+        }
+    } else {
+        return NULL;
+    }
+    if(arrayLength(&ret->operands) > 0 && IR_OPERAND(ret, 0) != returned) {
+        return NULL;
+    }
+    // The value of the call can't be used by anything else.
+    ARRAY_FOR(i, call->header.uses) {
+        IrInstr *user = ARRAY_GET_AS(IrInstr *, &call->header.uses, i);
+        if(user != ret && !(user->op == IR_PHI && user->block == ret->block && ret->block != block)) {
+            return NULL;
+        }
+    }
+    return ret;
+}
+
+static IrObjectValue *direct_callee(IrInstr *call) {
+    IrValue *callee = IR_OPERAND(call, 0);
+    return IR_VALUE_IS(callee, IR_VALUE_FUNCTION) ? (IrObjectValue *)callee : NULL;
+}
+
+// Move everything but the stack slots of the entry block to a new block (the start of the loop self tail calls jump to),
+// and replace the parameters with phis in it.
+// Returns the new block.
+static IrBlock *split_entry_block(IrFunction *fn) {
+    IrBlock *entry = ARRAY_GET_AS(IrBlock *, &fn->blocks, 0);
+    IrBlock *start = irBlockNew(fn);
+    // Place it right after the entry block.
+    for(usize i = arrayLength(&fn->blocks) - 1; i > 1; --i) {
+        fn->blocks.data[i] = fn->blocks.data[i - 1];
+    }
+    fn->blocks.data[1] = (void *)start;
+    for(usize i = 0; i < arrayLength(&entry->instructions);) {
+        IrInstr *instr = ARRAY_GET_AS(IrInstr *, &entry->instructions, i);
+        if(instr->op == IR_ALLOCA) {
+            i++;
+            continue;
+        }
+        arrayDelete(&entry->instructions, i);
+        instr->block = start;
+        arrayPush(&start->instructions, (void *)instr);
+    }
+    IrBlock *successors[2];
+    usize numSuccessors = irBlockSuccessors(start, successors);
+    for(usize i = 0; i < numSuccessors; ++i) {
+        usize index = irBlockPredecessorIndex(successors[i], entry);
+        successors[i]->predecessors.data[index] = (void *)start;
+    }
+    irBuildJump(entry, start, fn->fn->location);
+    ARRAY_FOR(i, fn->parameters) {
+        IrObjectValue *param = ARRAY_GET_AS(IrObjectValue *, &fn->parameters, i);
+        IrInstr *phi = irInstrNew(fn, IR_PHI, param->header.type, param->obj->location);
+        phi->as.variable = param->obj;
+        irValueReplaceAllUses((IrValue *)param, (IrValue *)phi);
+        irBlockAppend(start, phi);
+        irInstrAddOperand(phi, (IrValue *)param);
+    }
+    return start;
+}
+
+// Replace a self tail call with a jump to [start] (see split_entry_block()) passing the arguments to its phis.
+static void replace_with_jump(IrInstr *call, IrBlock *start) {
+    IrBlock *block = call->block;
+    Array arguments; // Array<IrValue *>
+    arrayInitSized(&arguments, arrayLength(&call->operands));
+    for(usize i = 1; i < arrayLength(&call->operands); ++i) {
+        arrayPush(&arguments, (void *)IR_OPERAND(call, i));
+    }
+    irInstrRemove(irBlockTerminator(block));
+    VERIFY(arrayLength(&call->header.uses) == 0);
+    irInstrRemove(call);
+    irBuildJump(block, start, call->location);
+    // The phis of the parameters are first (and in the same order.)
+    ARRAY_FOR(i, arguments) {
+        irInstrAddOperand(ARRAY_GET_AS(IrInstr *, &start->instructions, i), ARRAY_GET_AS(IrValue *, &arguments, i));
+    }
+    arrayFree(&arguments);
+}
+
+// Check if the C code of a call can be a guaranteed tail call: the C compilers require the caller & callee
+// to have the same parameter & return types, and structs passed by pointer might point to the caller's stack.
+static bool same_signature(IrFunction *fn, ASTObj *callee) {
+    ASTObj *caller = fn->fn;
+    if(!typeEqual(caller->as.fn.returnType, callee->as.fn.returnType)
+       || irTypeIsPassedByPointer(caller->as.fn.returnType)
+       || arrayLength(&caller->as.fn.parameters) != arrayLength(&callee->as.fn.parameters)) {
+        return false;
+    }
+    ARRAY_FOR(i, caller->as.fn.parameters) {
+        ASTObj *a = ARRAY_GET_AS(ASTObj *, &caller->as.fn.parameters, i);
+        ASTObj *b = ARRAY_GET_AS(ASTObj *, &callee->as.fn.parameters, i);
+        if(!typeEqual(a->dataType, b->dataType) || irTypeIsPassedByPointer(a->dataType)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Mark a tail call to another function, and give it its own return (the generated code returns the call directly.)
+static void mark_tail_call(IrInstr *call, IrInstr *ret) {
+    IrBlock *block = call->block;
+    if(ret->block != block) {
+        irInstrRemove(irBlockTerminator(block));
+        IrInstr *own = irInstrNew(block->function, IR_RETURN, NULL, ret->location);
+        if(arrayLength(&ret->operands) > 0) {
+            irInstrAddOperand(own, (IrValue *)call);
+        }
+        irBlockAppend(block, own);
+    }
+    call->as.tail = true;
+}
+
+static bool tail_calls(IrFunction *fn) {
+    // Calls can't be tail calls if they may use the stack slots of the function.
+    if(slots_escape(fn)) {
+        return false;
+    }
+    // Returning from noreturn functions isn't generated (see genInstruction()).
+    bool canReturnCalls = astObjectGetAttribute(fn->fn, ATTR_NORETURN) == NULL;
+    bool changed = false;
+    IrBlock *start = NULL;
+    Array calls; // Array<IrInstr *>
+    arrayInit(&calls);
+    ARRAY_FOR(i, fn->blocks) {
+        IrBlock *block = ARRAY_GET_AS(IrBlock *, &fn->blocks, i);
+        usize length = arrayLength(&block->instructions);
+        if(length >= 2 && ARRAY_GET_AS(IrInstr *, &block->instructions, length - 2)->op == IR_CALL) {
+            arrayPush(&calls, arrayGet(&block->instructions, length - 2));
+        }
+    }
+    ARRAY_FOR(i, calls) {
+        IrInstr *call = ARRAY_GET_AS(IrInstr *, &calls, i);
+        IrInstr *ret = tail_call_return(call);
+        IrObjectValue *callee = direct_callee(call);
+        if(ret == NULL || callee == NULL) {
+            continue;
+        }
+        if(callee->obj == fn->fn) {
+            // Self tail calls become loops.
+            if(start == NULL) {
+                start = split_entry_block(fn);
+            }
+            replace_with_jump(call, start);
+            changed = true;
+        } else if(canReturnCalls && !astObjectGetAttribute(callee->obj, ATTR_INLINE) && same_signature(fn, callee->obj)) {
+            mark_tail_call(call, ret);
+            changed = true;
+        }
+    }
+    arrayFree(&calls);
+    if(changed) {
+        // The blocks the calls returned through might not be used anymore.
+        remove_unreachable_blocks(fn);
+        remove_trivial_phis(fn);
+        simplify_cfg(fn);
+    }
+    return changed;
+}
+
+const IrPass irPassFoldConstants = {"fold-constants", fold_constants};
+const IrPass irPassRemoveUnreachableBlocks = {"remove-unreachable-blocks", remove_unreachable_blocks};
+const IrPass irPassRemoveTrivialPhis = {"remove-trivial-phis", remove_trivial_phis};
+const IrPass irPassSimplifyCfg = {"simplify-cfg", simplify_cfg};
+const IrPass irPassTailCalls = {"tail-calls", tail_calls};
@@ -0,0 +1,258 @@
+#include <string.h> // memcmp(), strlen()
+#include <fcntl.h> // open()
+#include <unistd.h> // close(), unlink()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Strings.h"
+#include "Writer.h"
+#include "Ast/Program.h"
+#include "ModuleInterface.h"
+
+#define MODULE_INTERFACE_MAGIC "ILCI"
+
+/* Writing */
+
+static void write_u32(Writer *w, u32 value) {
+    char bytes[4] = {(char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24)};
+    writerWrite(w, bytes, sizeof(bytes));
+}
+
+static void write_string(Writer *w, const char *s) {
+    usize length = strlen(s);
+    write_u32(w, (u32)length);
+    writerWrite(w, s, length);
+}
+
+static void write_type(Writer *w, ASTProgram *prog, Type *ty) {
+    switch(ty->type) {
+        case TY_VOID:
+        case TY_I32:
+        case TY_U32:
+        case TY_STR:
+        case TY_BOOL:
+            writerWriteChar(w, IFACE_TYPE_PRIMITIVE);
+            writerWriteChar(w, (char)ty->type);
+            break;
+        case TY_POINTER:
+            writerWriteChar(w, IFACE_TYPE_POINTER);
+            write_type(w, prog, ty->as.ptr.innerType);
+            break;
+        case TY_FUNCTION:
+            writerWriteChar(w, IFACE_TYPE_FUNCTION);
+            write_u32(w, (u32)arrayLength(&ty->as.fn.parameterTypes));
+            ARRAY_FOR(i, ty->as.fn.parameterTypes) {
+                write_type(w, prog, ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i));
+            }
+            write_type(w, prog, ty->as.fn.returnType);
+            break;
+        case TY_STRUCT:
+            writerWriteChar(w, IFACE_TYPE_STRUCT);
+            write_string(w, astProgramGetModule(prog, ty->declModule)->name);
+            write_string(w, ty->name);
+            break;
+        case TY_IDENTIFIER:
+        case TY_SCOPE_RESOLUTION:
+        default:
+            // Checked modules don't have these.
+            UNREACHABLE();
+    }
+}
+
+static void write_attributes(Writer *w, ASTObj *obj) {
+    write_u32(w, (u32)arrayLength(&obj->attributes));
+    ARRAY_FOR(i, obj->attributes) {
+        ASTAttribute *attr = ARRAY_GET_AS(ASTAttribute *, &obj->attributes, i);
+        writerWriteChar(w, (char)attr->type);
+        write_string(w, attr->name);
+        writerWriteChar(w, attr->hasArgument ? 1 : 0);
+        write_u32(w, (u32)attr->argument);
+        write_u32(w, (u32)(attr->argument >> 32));
+    }
+}
+
+static void write_function(Writer *w, ASTProgram *prog, ASTObj *fn) {
+    write_string(w, fn->name);
+    write_attributes(w, fn);
+    write_u32(w, (u32)arrayLength(&fn->as.fn.parameters));
+    ARRAY_FOR(i, fn->as.fn.parameters) {
+        ASTObj *param = ARRAY_GET_AS(ASTObj *, &fn->as.fn.parameters, i);
+        write_string(w, param->name);
+        write_type(w, prog, param->dataType);
+    }
+    write_type(w, prog, fn->as.fn.returnType);
+}
+
+// Write the objects of type [type] in [objects].
+static void write_objects(Writer *w, ASTProgram *prog, Array *objects, ASTObjType type) {
+    u32 count = 0;
+    ARRAY_FOR(i, *objects) {
+        count += ARRAY_GET_AS(ASTObj *, objects, i)->type == type ? 1 : 0;
+    }
+    write_u32(w, count);
+    ARRAY_FOR(i, *objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, objects, i);
+        if(obj->type != type) {
+            continue;
+        }
+        switch(type) {
+            case OBJ_VAR:
+                write_string(w, obj->name);
+                write_type(w, prog, obj->dataType);
+                break;
+            case OBJ_FN:
+                write_function(w, prog, obj);
+                break;
+            case OBJ_STRUCT: {
+                write_string(w, obj->name);
+                write_attributes(w, obj);
+                write_objects(w, prog, &obj->as.structure.fields, OBJ_VAR);
+                Array members; // Array<ASTObj *>
+                arrayInit(&members);
+                scopeGetAllObjects(obj->as.structure.scope, &members);
+                write_objects(w, prog, &members, OBJ_FN);
+                arrayFree(&members);
+                break;
+            }
+            default:
+                UNREACHABLE();
+        }
+    }
+}
+
+static void collect_import_name_callback(TableItem *item, bool is_last, void *names) {
+    UNUSED(is_last);
+    arrayPush((Array *)names, item->key);
+}
+
+static void write_interface(Writer *w, ASTProgram *prog, ASTModule *m) {
+    writerWriteLiteral(w, MODULE_INTERFACE_MAGIC);
+    write_u32(w, MODULE_INTERFACE_VERSION);
+    write_string(w, m->name);
+
+    Array names; // Array<ASTString>
+    arrayInit(&names);
+    tableMap(&m->importedModules, collect_import_name_callback, (void *)&names);
+    write_u32(w, (u32)arrayLength(&names));
+    ARRAY_FOR(i, names) {
+        write_string(w, ARRAY_GET_AS(ASTString, &names, i));
+    }
+    arrayFree(&names);
+
+    Array objects; // Array<ASTObj *>
+    arrayInit(&objects);
+    scopeGetAllObjects(m->moduleScope, &objects);
+    write_objects(w, prog, &objects, OBJ_STRUCT);
+    write_objects(w, prog, &objects, OBJ_FN);
+    arrayFree(&objects);
+
+    // Module variables are written in declaration order.
+    write_u32(w, (u32)arrayLength(&m->variableDecls));
+    ARRAY_FOR(i, m->variableDecls) {
+        ASTVarDeclStmt *decl = ARRAY_GET_AS(ASTVarDeclStmt *, &m->variableDecls, i);
+        write_string(w, decl->variable->name);
+        write_type(w, prog, decl->variable->dataType);
+    }
+}
+
+bool moduleInterfaceWrite(ASTProgram *prog, ASTModule *m, const char *path) {
+    String tmp = stringFormat("%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        stringFree(tmp);
+        return false;
+    }
+    Writer w;
+    writerInit(&w, fd, 0);
+    write_interface(&w, prog, m);
+    bool success = writerFree(&w);
+    success = close(fd) == 0 && success;
+    success = success && rename(tmp, path) == 0;
+    if(!success) {
+        unlink(tmp);
+    }
+    stringFree(tmp);
+    return success;
+}
+
+/* Reading */
+
+bool moduleInterfaceOpen(ModuleInterface *mi, const char *path) {
+    mi->data = NULL;
+    mi->size = mi->offset = 0;
+    mi->failed = true;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (usize)st.st_size < sizeof(MODULE_INTERFACE_MAGIC) - 1 + 4) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, (usize)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file is closed.
+    close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    mi->data = (const u8 *)data;
+    mi->size = (usize)st.st_size;
+    mi->failed = false;
+    if(memcmp(mi->data, MODULE_INTERFACE_MAGIC, sizeof(MODULE_INTERFACE_MAGIC) - 1) != 0) {
+        moduleInterfaceClose(mi);
+        return false;
+    }
+    mi->offset = sizeof(MODULE_INTERFACE_MAGIC) - 1;
+    if(moduleInterfaceReadU32(mi) != MODULE_INTERFACE_VERSION) {
+        moduleInterfaceClose(mi);
+        return false;
+    }
+    return true;
+}
+
+void moduleInterfaceClose(ModuleInterface *mi) {
+    if(mi->data) {
+        munmap((void *)mi->data, mi->size);
+    }
+    mi->data = NULL;
+    mi->size = mi->offset = 0;
+}
+
+// Check that [length] more bytes can be read.
+static bool can_read(ModuleInterface *mi, usize length) {
+    if(mi->failed || mi->size - mi->offset < length) {
+        mi->failed = true;
+        return false;
+    }
+    return true;
+}
+
+u8 moduleInterfaceReadByte(ModuleInterface *mi) {
+    if(!can_read(mi, 1)) {
+        return 0;
+    }
+    return mi->data[mi->offset++];
+}
+
+u32 moduleInterfaceReadU32(ModuleInterface *mi) {
+    if(!can_read(mi, 4)) {
+        return 0;
+    }
+    const u8 *b = mi->data + mi->offset;
+    mi->offset += 4;
+    return (u32)b[0] | (u32)b[1] << 8 | (u32)b[2] << 16 | (u32)b[3] << 24;
+}
+
+const char *moduleInterfaceReadString(ModuleInterface *mi, u32 *length) {
+    *length = moduleInterfaceReadU32(mi);
+    if(!can_read(mi, *length)) {
+        *length = 0;
+        return "";
+    }
+    const char *s = (const char *)(mi->data + mi->offset);
+    mi->offset += *length;
+    return s;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h> // strerror(), strlen()
+#include <errno.h>
+#include <fcntl.h> // open(), AT_FDCWD
+#include <unistd.h> // read(), close(), unlink()
+#include <dirent.h> // opendir(), readdir()
+#include <sys/stat.h> // mkdir(), stat(), utimensat()
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Strings.h"
+#include "Writer.h"
+#include "ObjectCache.h"
+
+String objectCacheDefaultDir(void) {
+    const char *dir = getenv("ILC_CACHE_DIR");
+    if(dir && *dir) {
+        return stringCopy(dir);
+    }
+    dir = getenv("XDG_CACHE_HOME");
+    if(dir && *dir) {
+        return stringFormat("%s/ilc", dir);
+    }
+    dir = getenv("HOME");
+    if(dir && *dir) {
+        return stringFormat("%s/.cache/ilc", dir);
+    }
+    return NULL;
+}
+
+// Create [path] and all its missing parent directories.
+static bool make_directories(const char *path) {
+    String p = stringCopy(path);
+    bool success = true;
+    for(char *c = p + 1; success; ++c) {
+        if(*c != '/' && *c != '\0') {
+            continue;
+        }
+        char old = *c;
+        *c = '\0';
+        if(mkdir(p, 0755) < 0 && errno != EEXIST) {
+            success = false;
+        }
+        *c = old;
+        if(old == '\0') {
+            break;
+        }
+    }
+    stringFree(p);
+    return success;
+}
+
+bool objectCacheInit(ObjectCache *c, const char *dir, u64 maxSize) {
+    if(!make_directories(dir)) {
+        LOG_ERR("Failed to create the object cache directory '%s': %s\n", dir, strerror(errno));
+        return false;
+    }
+    c->dir = stringCopy(dir);
+    c->maxSize = maxSize;
+    c->hits = c->misses = c->stores = 0;
+    return true;
+}
+
+void objectCacheFree(ObjectCache *c) {
+    stringFree(c->dir);
+    c->dir = NULL;
+}
+
+static String entry_path(ObjectCache *c, const char *key) {
+    VERIFY(strlen(key) > 2);
+    return stringFormat("%s/%.2s/%s.o", c->dir, key, key + 2);
+}
+
+// Copy [from] to [to] through a temporary file which is renamed into place,
+// so readers of [to] never see a partially written file.
+static bool copy_file_atomically(const char *from, const char *to) {
+    int in = open(from, O_RDONLY);
+    if(in < 0) {
+        return false;
+    }
+    String tmp = stringFormat("%s.tmpXXXXXX", to);
+    int out = mkstemp(tmp);
+    if(out < 0) {
+        close(in);
+        stringFree(tmp);
+        return false;
+    }
+    Writer writer;
+    writerInit(&writer, out, 0);
+    char buffer[16 * 1024];
+    bool success = true;
+    isize bytesRead;
+    while((bytesRead = read(in, buffer, sizeof(buffer))) != 0) {
+        if(bytesRead < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            success = false;
+            break;
+        }
+        writerWrite(&writer, buffer, (usize)bytesRead);
+    }
+    success = writerFree(&writer) && success;
+    success = close(out) == 0 && success;
+    close(in);
+    // mkstemp() creates the file with mode 0600.
+    success = success && chmod(tmp, 0644) == 0 && rename(tmp, to) == 0;
+    if(!success) {
+        unlink(tmp);
+    }
+    stringFree(tmp);
+    return success;
+}
+
+bool objectCacheLookup(ObjectCache *c, const char *key, const char *objectPath) {
+    String path = entry_path(c, key);
+    bool hit = copy_file_atomically(path, objectPath);
+    if(hit) {
+        // Mark the entry as recently used.
+        utimensat(AT_FDCWD, path, NULL, 0);
+        c->hits++;
+    } else {
+        c->misses++;
+    }
+    stringFree(path);
+    return hit;
+}
+
+void objectCacheStore(ObjectCache *c, const char *key, const char *objectPath) {
+    String dir = stringFormat("%s/%.2s", c->dir, key);
+    if(mkdir(dir, 0755) == 0 || errno == EEXIST) {
+        String path = entry_path(c, key);
+        if(copy_file_atomically(objectPath, path)) {
+            c->stores++;
+        }
+        stringFree(path);
+    }
+    stringFree(dir);
+}
+
+typedef struct cache_entry {
+    String path;
+    u64 size;
+    struct timespec lastUse;
+} CacheEntry;
+
+static int compare_entries_by_last_use(const void *a, const void *b) {
+    const CacheEntry *entryA = *(const CacheEntry **)a, *entryB = *(const CacheEntry **)b;
+    if(entryA->lastUse.tv_sec != entryB->lastUse.tv_sec) {
+        return entryA->lastUse.tv_sec < entryB->lastUse.tv_sec ? -1 : 1;
+    }
+    return entryA->lastUse.tv_nsec < entryB->lastUse.tv_nsec ? -1 : entryA->lastUse.tv_nsec > entryB->lastUse.tv_nsec;
+}
+
+static bool has_suffix(const char *s, const char *suffix) {
+    usize length = strlen(s), suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(s + length - suffixLength, suffix) == 0;
+}
+
+// Push a CacheEntry for every object in [dir] to [entries] and return their total size.
+static u64 collect_entries(const char *dir, Array *entries) {
+    DIR *d = opendir(dir);
+    if(!d) {
+        return 0;
+    }
+    u64 total = 0;
+    struct dirent *ent;
+    while((ent = readdir(d)) != NULL) {
+        // Temporary files are skipped (they belong to a running ilc process.)
+        if(!has_suffix(ent->d_name, ".o")) {
+            continue;
+        }
+        String path = stringFormat("%s/%s", dir, ent->d_name);
+        struct stat st;
+        if(stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+            stringFree(path);
+            continue;
+        }
+        CacheEntry *entry;
+        NEW0(entry);
+        entry->path = path;
+        entry->size = (u64)st.st_size;
+        entry->lastUse = st.st_mtim;
+        arrayPush(entries, (void *)entry);
+        total += entry->size;
+    }
+    closedir(d);
+    return total;
+}
+
+void objectCacheTrim(ObjectCache *c) {
+    DIR *d = opendir(c->dir);
+    if(!d) {
+        return;
+    }
+    Array entries; // Array<CacheEntry *>
+    arrayInit(&entries);
+    u64 total = 0;
+    struct dirent *ent;
+    while((ent = readdir(d)) != NULL) {
+        if(ent->d_name[0] == '.' || strlen(ent->d_name) != 2) {
+            continue;
+        }
+        String subdir = stringFormat("%s/%s", c->dir, ent->d_name);
+        total += collect_entries(subdir, &entries);
+        stringFree(subdir);
+    }
+    closedir(d);
+    if(total > c->maxSize) {
+        qsort(entries.data, arrayLength(&entries), sizeof(*entries.data), compare_entries_by_last_use);
+        for(usize i = 0; i < arrayLength(&entries) && total > c->maxSize; ++i) {
+            CacheEntry *entry = ARRAY_GET_AS(CacheEntry *, &entries, i);
+            // Another process might have evicted the entry already.
+            if(unlink(entry->path) == 0 || errno == ENOENT) {
+                total -= entry->size;
+            }
+        }
+    }
+    ARRAY_FOR(i, entries) {
+        CacheEntry *entry = ARRAY_GET_AS(CacheEntry *, &entries, i);
+        stringFree(entry->path);
+        FREE(entry);
+    }
+    arrayFree(&entries);
+}
@@ -1,4 +1,5 @@
 #include <stddef.h> // NULL
+#include <string.h> // strcmp()
 #include "Ast/Module.h"
 #include "Ast/Object.h"
 #include "Ast/StringTable.h"
@@ -10,6 +11,7 @@
 #include "Error.h"
 #include "Token.h"
 #include "Ast/Ast.h"
+#include "ModuleInterface.h"
 #include "Parser.h"
 
 /***
@@ -33,6 +35,11 @@ static void parser_init_internal(Parser *p, Compiler *c, Scanner *s) {
     p->state.had_error = false;
     p->state.need_sync = false;
     p->state.idTypeCounter = 0;
+    p->state.lines.file = (FileID)-1;
+    p->state.lines.offset = 0;
+    p->state.lines.line = 1;
+    p->interfaces = NULL;
+    p->skipBodies = NULL;
     p->primitives.void_ = NULL;
     p->primitives.int32 = NULL;
     p->primitives.uint32 = NULL;
@@ -42,6 +49,13 @@ static void parser_init_internal(Parser *p, Compiler *c, Scanner *s) {
 void parserInit(Parser *p, Compiler *c, Scanner *s) {
     parser_init_internal(p, c, s);
     p->tmp_buffer = stringNew(20); // Note: 20 is a random number that seems large enough for most short strings.
+    arrayInit(&p->pendingInterfaces);
+    arrayInit(&p->skippedBodies);
+}
+
+static void free_skipped_body_callback(void *body, void *cl) {
+    UNUSED(cl);
+    FREE(body);
 }
 
 void parserFree(Parser *p) {
@@ -49,6 +63,9 @@ void parserFree(Parser *p) {
         stringFree(p->tmp_buffer);
         p->tmp_buffer = NULL;
     }
+    arrayFree(&p->pendingInterfaces);
+    arrayMap(&p->skippedBodies, free_skipped_body_callback, NULL);
+    arrayFree(&p->skippedBodies);
     parser_init_internal(p, NULL, NULL);
 }
 
@@ -56,6 +73,14 @@ void parserSetDumpTokens(Parser *p, bool dumpTokens) {
     p->dumpTokens = dumpTokens;
 }
 
+void parserSetModuleInterfaces(Parser *p, Table *interfaces) {
+    p->interfaces = interfaces;
+}
+
+void parserSetSkipBodies(Parser *p, Table *modules) {
+    p->skipBodies = modules;
+}
+
 /* Parser helper functions */
 
 // if !expr, returns NULL. otherwise expands to said result.
@@ -156,6 +181,23 @@ static bool match(Parser *p, TokenType expected) {
     return true;
 }
 
+// Returns the line (starting at 1) of [loc] in the file being scanned.
+// Note: Tokens are mostly parsed in order, so lines are counted from the last location asked for.
+static u32 line_of(Parser *p, Location loc) {
+    if(loc.file != p->state.lines.file || loc.start < p->state.lines.offset) {
+        p->state.lines.file = loc.file;
+        p->state.lines.offset = 0;
+        p->state.lines.line = 1;
+    }
+    String source = p->scanner->source;
+    for(; p->state.lines.offset < loc.start; ++p->state.lines.offset) {
+        if(source[p->state.lines.offset] == '\n') {
+            p->state.lines.line++;
+        }
+    }
+    return p->state.lines.line;
+}
+
 static inline ASTModule *getCurrentModule(Parser *p) {
     return astProgramGetModule(p->program, p->current.module);
 }
@@ -659,11 +701,15 @@ static ASTStmtNode *parseDeferStmt(Parser *p) {
 static ASTStmtNode *parseExpectStmt(Parser *p) {
     // Assumes 'expect' was already consumed.
     Location loc = previous(p).location;
+    u32 line = line_of(p, loc);
     ASTExprNode *condition = TRY(ASTExprNode *, parseExpression(p));
     loc = locationMerge(loc, previous(p).location);
     condition = NODE_AS(ASTExprNode, astUnaryExprNew(getCurrentAllocator(p), EXPR_LOGICAL_NOT, loc, p->primitives.boolean, condition));
     if(match(p, TK_SEMICOLON)) {
-        return NODE_AS(ASTStmtNode, astConditionalStmtNew(getCurrentAllocator(p), STMT_EXPECT, locationMerge(loc, previous(p).location), condition, NULL, NULL));
+        ASTConditionalStmt *expect = astConditionalStmtNew(getCurrentAllocator(p), STMT_EXPECT, locationMerge(loc, previous(p).location), condition, NULL, NULL);
+        expect->file = stringTableString(p->program->strings, compilerGetFile(p->compiler, loc.file)->path);
+        expect->line = line;
+        return NODE_AS(ASTStmtNode, expect);
     }
     ASTStmtNode *else_ = NULL;
     if(match(p, TK_ELSE)) {
@@ -679,7 +725,10 @@ static ASTStmtNode *parseExpectStmt(Parser *p) {
         errorAt(p, current(p).location, tmp_buffer_format(p, "Expected 'else' but got '%s'.", tokenTypeString(current(p).type)));
         return NULL;
     }
-    return NODE_AS(ASTStmtNode, astConditionalStmtNew(getCurrentAllocator(p), STMT_EXPECT, locationMerge(loc, previous(p).location), condition, else_, NULL));
+    ASTConditionalStmt *expect = astConditionalStmtNew(getCurrentAllocator(p), STMT_EXPECT, locationMerge(loc, previous(p).location), condition, else_, NULL);
+    expect->file = stringTableString(p->program->strings, compilerGetFile(p->compiler, loc.file)->path);
+    expect->line = line;
+    return NODE_AS(ASTStmtNode, expect);
 }
 
 // statement -> block(statement) | return_stmt | if_stmt | while_loop_stmt | defer_stmt | expression_stmt
@@ -712,16 +761,19 @@ static ASTString parseIdentifier(Parser *p) {
     return stringTableFormat(p->program->strings, "%.*s", idTk.length, idTk.lexeme);
 }
 
-// identifier_type -> identifier
-static Type *parseIdentifierType(Parser *p) {
-    // An identifier type is an unkown type that could be a struct or a type alias.
-    ASTString ident = TRY(ASTString, parseIdentifier(p));
-    Location loc = previous(p).location;
+static Type *makeIdentifierType(Parser *p, ASTString ident, Location loc) {
     ASTString name = stringTableFormat(p->program->strings, "%s%u", ident, p->state.idTypeCounter++);
     Type *ty = typeNew(TY_IDENTIFIER, name, loc, p->current.module);
     ty->as.id.actualName = ident;
     astModuleAddType(getCurrentModule(p), ty);
     return ty;
+}
+
+// identifier_type -> identifier
+static Type *parseIdentifierType(Parser *p) {
+    // An identifier type is an unkown type that could be a struct or a type alias.
+    ASTString ident = TRY(ASTString, parseIdentifier(p));
+    return makeIdentifierType(p, ident, previous(p).location);
     // TODO: <thoughts>
     //        This function should only parse, not add to the module maybe?
     //        Think about TY_IDENTIFIER. Should it be TY_UNKNOWN maybe? might be clearer.
@@ -939,6 +991,73 @@ static bool parseParameterList(Parser *p, Array *parameters) {
     return !hadError;
 }
 
+// Parse a function body in a new scope containing [parameters].
+static ASTBlockStmt *parseFunctionBody(Parser *p, Array *parameters) {
+    // Assumes '{' was already consumed.
+    Scope *scope = enterScope(p, SCOPE_DEPTH_BLOCK);
+    ARRAY_FOR(i, *parameters) {
+        ASTObj *param = ARRAY_GET_AS(ASTObj *, parameters, i);
+        scopeAddObject(scope, param);
+    }
+    ASTBlockStmt *body = parseBlockStmt(p, scope, parseFunctionBodyStatements);
+    leaveScope(p);
+    return body;
+}
+
+// Skip a block by matching braces (without building any AST nodes).
+static bool skipBlock(Parser *p) {
+    // Assumes '{' was already consumed.
+    usize depth = 1;
+    while(!isEof(p) && current(p).type != TK_FILE_CHANGED) {
+        if(current(p).type == TK_LBRACE) {
+            depth++;
+        } else if(current(p).type == TK_RBRACE && --depth == 0) {
+            break;
+        }
+        advance(p);
+    }
+    return consume(p, TK_RBRACE);
+}
+
+static inline bool shouldSkipBodies(Parser *p) {
+    return p->skipBodies && tableGet(p->skipBodies, (void *)getCurrentModule(p)->name) != NULL;
+}
+
+// attributes -> ('#' '[' attribute (',' attribute)* ']')*
+// attribute -> identifier ('(' number_literal ')')?
+// attributes: Array<ASTAttribute *> (The names are resolved by the Validator.)
+static bool parseAttributes(Parser *p, Array *attributes) {
+    while(match(p, TK_HASH)) {
+        if(!consume(p, TK_LBRACKET)) {
+            return false;
+        }
+        do {
+            Location loc = current(p).location;
+            ASTString name = parseIdentifier(p);
+            if(!name) {
+                return false;
+            }
+            ASTAttribute *attr = astAttributeNew(getCurrentAllocator(p), ATTR_UNKNOWN, loc, name);
+            if(match(p, TK_LPAREN)) {
+                if(!consume(p, TK_NUMBER_LITERAL)) {
+                    return false;
+                }
+                attr->hasArgument = true;
+                attr->argument = strtoul(previous(p).lexeme, NULL, 10);
+                if(!consume(p, TK_RPAREN)) {
+                    return false;
+                }
+                attr->location = locationMerge(loc, previous(p).location);
+            }
+            arrayPush(attributes, (void *)attr);
+        } while(match(p, TK_COMMA));
+        if(!consume(p, TK_RBRACKET)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // function_decl -> 'fn' identifier '(' parameter_list ')' ('->' type)+ block
 // structName: For methods ONLY. otherwise set to NULL.
 static ASTObj *parseFunctionDecl(Parser *p, ASTString structName) {
@@ -1007,14 +1126,11 @@ static ASTObj *parseFunctionDecl(Parser *p, ASTString structName) {
         arrayFree(&parameters);
         return NULL;
     }
-    Scope *scope = enterScope(p, SCOPE_DEPTH_BLOCK);
-    ARRAY_FOR(i, parameters) {
-        ASTObj *param = ARRAY_GET_AS(ASTObj *, &parameters, i);
-        scopeAddObject(scope, param);
-    }
-    ASTBlockStmt *body = parseBlockStmt(p, scope, parseFunctionBodyStatements);
-    leaveScope(p);
-    if(!body) {
+    Location bodyStart = previous(p).location;
+    // Skipped bodies are parsed later if needed (see parserParseSkippedBodies()).
+    bool skipBody = shouldSkipBodies(p);
+    ASTBlockStmt *body = skipBody ? NULL : parseFunctionBody(p, &parameters);
+    if(skipBody ? !skipBlock(p) : body == NULL) {
         arrayFree(&parameters);
         return NULL;
     }
@@ -1024,6 +1140,15 @@ static ASTObj *parseFunctionDecl(Parser *p, ASTString structName) {
     fnObj->as.fn.returnType = returnType;
     arrayCopy(&fnObj->as.fn.parameters, &parameters);
     arrayFree(&parameters);
+    if(skipBody) {
+        SkippedBody *skipped;
+        NEW0(skipped);
+        skipped->fn = fnObj;
+        skipped->module = p->current.module;
+        skipped->parentScope = getCurrentScope(p);
+        skipped->start = bodyStart;
+        arrayPush(&p->skippedBodies, (void *)skipped);
+    }
     return fnObj;
 }
 
@@ -1049,7 +1174,7 @@ static Type *makeStructType(Parser *p, ASTString name, Location declLoc, ModuleI
 
 // struct_field -> typed_var ';'
 // fieldTypes: Array<Type *>
-// structRef: The ASTObj* refering to the struct being parsed. NOT MODIFIED!
+// structRef: The ASTObj* refering to the struct being parsed (only its field list is modified.)
 static bool parse_struct_field(Parser *p, Array *fieldTypes, ASTObj *structRef) {
     ASTObj *field = parseTypedVariable(p);
     bool hadError = false;
@@ -1076,6 +1201,7 @@ static bool parse_struct_field(Parser *p, Array *fieldTypes, ASTObj *structRef)
             hint(p, prefField->location, "Previous definition was here.");
         } else {
             scopeAddObject(getCurrentScope(p), field);
+            arrayPush(&structRef->as.structure.fields, (void *)field);
             arrayPush(fieldTypes, (void *)field->dataType);
         }
     }
@@ -1085,13 +1211,21 @@ static bool parse_struct_field(Parser *p, Array *fieldTypes, ASTObj *structRef)
 }
 
 // TODO: Remove this function since "this" is now parsed parseFunctionDecl().
-// method_decl -> function_decl (with extra 'this' parameter.)
+// method_decl -> attributes function_decl (with extra 'this' parameter.)
 static bool parse_method_decl(Parser *p, ASTObj *structure) {
-    VERIFY(consume(p, TK_FN)); // MUST be true if this function is called by parseSTructDecl().
+    Array attributes; // Array<ASTAttribute *>
+    arrayInit(&attributes);
+    if(!parseAttributes(p, &attributes) || !consume(p, TK_FN)) {
+        arrayFree(&attributes);
+        return false;
+    }
     ASTObj *method = parseFunctionDecl(p, structure->name);
     if(!method) {
+        arrayFree(&attributes);
         return false;
     }
+    arrayCopy(&method->attributes, &attributes);
+    arrayFree(&attributes);
     method->parent = structure;
     scopeAddObject(getCurrentScope(p), method);
     return true;
@@ -1112,7 +1246,7 @@ static ASTObj *parseStructDecl(Parser *p) {
     Scope *sc = enterScope(p, SCOPE_DEPTH_STRUCT);
     bool hadError = false;
     // First parse any fields.
-    while(current(p).type != TK_RBRACE && current(p).type != TK_FN) {
+    while(current(p).type != TK_RBRACE && current(p).type != TK_FN && current(p).type != TK_HASH) {
         if(current(p).type != TK_IDENTIFIER) {
             // Advance anyway to prevent infinite loop here.
             advance(p);
@@ -1134,7 +1268,7 @@ static ASTObj *parseStructDecl(Parser *p) {
     arrayFree(&fieldTypes);
     // Now parse any methods.
     while(current(p).type != TK_RBRACE) {
-        if(current(p).type != TK_FN) {
+        if(current(p).type != TK_FN && current(p).type != TK_HASH) {
             // Advance anyway to prevent infinite loop here.
             advance(p);
             error(p, tmp_buffer_format(p, "Expected method declaration but got '%s'.", tokenTypeString(previous(p).type)));
@@ -1144,7 +1278,7 @@ static ASTObj *parseStructDecl(Parser *p) {
             hadError = true;
             // Synchronize to bound function/struct boundaries.
             // TODO: when the 'public' keyword is added, also sync to it.
-            while(!isEof(p) && current(p).type != TK_FN && current(p).type != TK_RBRACE) {
+            while(!isEof(p) && current(p).type != TK_FN && current(p).type != TK_HASH && current(p).type != TK_RBRACE) {
                 advance(p);
             }
         }
@@ -1157,11 +1291,17 @@ static ASTObj *parseStructDecl(Parser *p) {
     return st;
 }
 
-// declaration -> var_decl | function_decl | struct_decl | extern_decl
+// declaration -> var_decl | attributes (function_decl | struct_decl) | extern_decl
 static ASTObj *parseDeclaration(Parser *p) {
     // Notes: * Add nothing to scope. we only parse!
     //        * No need to TRY() since if 'result' is NULL, we will return NULL.
     //        * Variable declarations are handled in parseModuleBody().
+    Array attributes; // Array<ASTAttribute *>
+    arrayInit(&attributes);
+    if(!parseAttributes(p, &attributes)) {
+        arrayFree(&attributes);
+        return NULL;
+    }
     ASTObj *result = NULL;
     if(match(p, TK_FN)) {
         result = parseFunctionDecl(p, NULL);
@@ -1169,10 +1309,15 @@ static ASTObj *parseDeclaration(Parser *p) {
         result = parseStructDecl(p);
 //    } else if(match(p, TK_EXTERN)) {
 //
+    } else if(arrayLength(&attributes) > 0) {
+        errorAt(p, current(p).location, "Expected a function or struct declaration after attributes.");
     } else {
         errorAt(p, current(p).location, "Expected declaration.");
     }
-
+    if(result) {
+        arrayCopy(&result->attributes, &attributes);
+    }
+    arrayFree(&attributes);
     return result;
 }
 
@@ -1187,6 +1332,7 @@ static void synchronizeToDecl(Parser *p) {
     }
     while(!isEof(p)) {
         switch(current(p).type) {
+            case TK_HASH: // Attributes of a function or struct.
             case TK_FN:
             // If we were parsing a struct when we failed, we want to exit it completely
             // since we unwound the scope tree to the module scope, meaning that the state
@@ -1209,6 +1355,7 @@ static void synchronizeToDecl(Parser *p) {
 static void synchronizeToFnStructDecl(Parser *p) {
     while(!isEof(p)) {
         switch(current(p).type) {
+            case TK_HASH: // Attributes of a function or struct.
             case TK_FN:
             case TK_STRUCT:
             //case TK_EXTERN: // TODO: re-add once we parse extern structs (also in synchronizeToDecl().)
@@ -1237,6 +1384,27 @@ static void import_primitive_types(Parser *p, ModuleID mID) {
 #undef DEF
 }
 
+// Check if the source file of the module [name] was already added (e.g. imported by another module.)
+static bool is_module_file_added(Parser *p, ASTString name) {
+    ARRAY_FOR(i, p->compiler->files) {
+        File *f = ARRAY_GET_AS(File *, &p->compiler->files, i);
+        if(strcmp(f->fileNameNoExtension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Queue the module [name] to be loaded from its interface (see parserParse().)
+static void queue_interface(Parser *p, ASTString name) {
+    ARRAY_FOR(i, p->pendingInterfaces) {
+        if(ARRAY_GET_AS(ASTString, &p->pendingInterfaces, i) == name) {
+            return;
+        }
+    }
+    arrayPush(&p->pendingInterfaces, (void *)name);
+}
+
 // Returns true on successful parse, or false on failure.
 // module_body -> import* declaration*
 // import -> 'import' <str> ';'
@@ -1275,13 +1443,21 @@ static bool parseModuleBody(Parser *p, ASTString name) {
             }
             // Trim '"'s from beginning and end of string.
             ASTString importStr = stringTableFormat(p->program->strings, "%.*s", importStrToken.length-2, importStrToken.lexeme+1);
+            if(p->interfaces && tableGet(p->interfaces, (void *)importStr) != NULL) {
+                // Loaded from its interface once all the source files are parsed (see parserParse().)
+                queue_interface(p, importStr);
+                astModuleAddImport(getCurrentModule(p), importStr, (ModuleID)-1);
+                continue;
+            }
             // TODO: replace "." with PATH variable of sorts (MODULE_PATH/IMPORT_PATH etc.)
-            if(!doesFileExist(".", tmp_buffer_format(p, "%s.ilc", importStr))) {
+            if(!compilerHasFile(p->compiler, tmp_buffer_format(p, "%s.ilc", importStr))) {
                 errorAt(p, importStrToken.location, tmp_buffer_format(p, "Cannot find module '%s'.", importStr));
                 hint(p, importStrToken.location, tmp_buffer_format(p, "Is the filename of requested module '%s.ilc'?", importStr));
                 continue;
             }
-            compilerAddFile(p->compiler, stringTableFormat(p->program->strings, "%s.ilc", importStr));
+            if(!is_module_file_added(p, importStr)) {
+                compilerAddFile(p->compiler, stringTableFormat(p->program->strings, "%s.ilc", importStr));
+            }
             // ModuleID is added in validator. for now, set it to -1 just to have a value that is unlikely to occur naturaly.
             astModuleAddImport(getCurrentModule(p), importStr, (ModuleID)-1);
         } else if(match(p, TK_FILE_CHANGED)) {
@@ -1312,10 +1488,239 @@ static bool parseModuleBody(Parser *p, ASTString name) {
         }
     }
 
+    p->current.module = 0;
     p->current.scope = NULL;
     return !p->state.had_error;
 }
 
+/* Module interfaces (see ModuleInterface.h) */
+
+static ASTString read_interface_string(Parser *p, ModuleInterface *mi) {
+    u32 length;
+    const char *s = moduleInterfaceReadString(mi, &length);
+    return stringTableFormat(p->program->strings, "%.*s", (int)length, s);
+}
+
+// Only single level scope resolution is supported (see validateType()).
+static Type *makeScopeResolutionType(Parser *p, ASTString moduleName, ASTString typeName) {
+    ASTString name = stringTableFormat(p->program->strings, "%s::%s", moduleName, typeName);
+    Type *existingType = astModuleGetType(getCurrentModule(p), name);
+    if(existingType) {
+        return existingType;
+    }
+    Type *ty = typeNew(TY_SCOPE_RESOLUTION, name, EMPTY_LOCATION, p->current.module);
+    arrayPush(&ty->as.scopeResolution.path, (void *)makeIdentifierType(p, moduleName, EMPTY_LOCATION));
+    ty->as.scopeResolution.ty = makeIdentifierType(p, typeName, EMPTY_LOCATION);
+    astModuleAddType(getCurrentModule(p), ty);
+    return ty;
+}
+
+// Returns NULL if the type is invalid.
+static Type *read_interface_type(Parser *p, ModuleInterface *mi) {
+    switch((InterfaceTypeTag)moduleInterfaceReadByte(mi)) {
+        case IFACE_TYPE_PRIMITIVE:
+            switch((TypeType)moduleInterfaceReadByte(mi)) {
+                case TY_VOID: return p->primitives.void_;
+                case TY_I32: return p->primitives.int32;
+                case TY_U32: return p->primitives.uint32;
+                case TY_STR: return p->primitives.str;
+                case TY_BOOL: return p->primitives.boolean;
+                default: return NULL;
+            }
+        case IFACE_TYPE_POINTER: {
+            Type *pointee = TRY(Type *, read_interface_type(p, mi));
+            ASTString ptrName = stringTableFormat(p->program->strings, "&%s", pointee->type == TY_IDENTIFIER ? pointee->as.id.actualName : pointee->name);
+            Type *ty = astModuleGetType(getCurrentModule(p), ptrName);
+            if(ty == NULL) {
+                ty = typeNew(TY_POINTER, ptrName, EMPTY_LOCATION, p->current.module);
+                ty->as.ptr.innerType = pointee;
+                astModuleAddType(getCurrentModule(p), ty);
+            }
+            return ty;
+        }
+        case IFACE_TYPE_FUNCTION: {
+            u32 numParameters = moduleInterfaceReadU32(mi);
+            Array parameterTypes; // Array<Type *>
+            arrayInit(&parameterTypes);
+            Type *returnType = NULL;
+            for(u32 i = 0; i < numParameters && !mi->failed; ++i) {
+                Type *ty = read_interface_type(p, mi);
+                if(ty == NULL) {
+                    break;
+                }
+                arrayPush(&parameterTypes, (void *)ty);
+            }
+            if(arrayLength(&parameterTypes) == numParameters) {
+                returnType = read_interface_type(p, mi);
+            }
+            Type *ty = returnType ? makeFunctionTypeWithParameterTypes(p, parameterTypes, returnType) : NULL;
+            arrayFree(&parameterTypes);
+            return ty;
+        }
+        case IFACE_TYPE_STRUCT: {
+            ASTString moduleName = read_interface_string(p, mi);
+            ASTString name = read_interface_string(p, mi);
+            if(moduleName == getCurrentModule(p)->name) {
+                return makeIdentifierType(p, name, EMPTY_LOCATION);
+            }
+            // The struct might belong to a module that isn't imported directly (e.g. an inferred variable type.)
+            astModuleAddImport(getCurrentModule(p), moduleName, (ModuleID)-1);
+            queue_interface(p, moduleName);
+            return makeScopeResolutionType(p, moduleName, name);
+        }
+        default:
+            return NULL;
+    }
+}
+
+// Returns false if an attribute is invalid.
+static bool read_interface_attributes(Parser *p, ModuleInterface *mi, Array *attributes) {
+    u32 numAttributes = moduleInterfaceReadU32(mi);
+    for(u32 i = 0; i < numAttributes && !mi->failed; ++i) {
+        ASTAttributeType type = (ASTAttributeType)moduleInterfaceReadByte(mi);
+        ASTString name = read_interface_string(p, mi);
+        bool hasArgument = moduleInterfaceReadByte(mi) != 0;
+        u64 low = moduleInterfaceReadU32(mi);
+        u64 high = moduleInterfaceReadU32(mi);
+        if(type == ATTR_UNKNOWN || type >= ATTR_TYPE_COUNT) {
+            return false;
+        }
+        ASTAttribute *attr = astAttributeNew(getCurrentAllocator(p), type, EMPTY_LOCATION, name);
+        attr->argument = low | high << 32;
+        attr->hasArgument = hasArgument;
+        arrayPush(attributes, (void *)attr);
+    }
+    return !mi->failed;
+}
+
+static ASTObj *read_interface_function(Parser *p, ModuleInterface *mi) {
+    ASTString name = read_interface_string(p, mi);
+    Array attributes; // Array<ASTAttribute *>
+    arrayInit(&attributes);
+    if(!read_interface_attributes(p, mi, &attributes)) {
+        arrayFree(&attributes);
+        return NULL;
+    }
+    u32 numParameters = moduleInterfaceReadU32(mi);
+    Array parameters; // Array<ASTObj *>
+    arrayInit(&parameters);
+    for(u32 i = 0; i < numParameters && !mi->failed; ++i) {
+        ASTString paramName = read_interface_string(p, mi);
+        Type *paramType = read_interface_type(p, mi);
+        if(paramType == NULL) {
+            break;
+        }
+        arrayPush(&parameters, (void *)astModuleNewObj(getCurrentModule(p), OBJ_VAR, EMPTY_LOCATION, paramName, paramType));
+    }
+    Type *returnType = arrayLength(&parameters) == numParameters ? read_interface_type(p, mi) : NULL;
+    if(returnType == NULL) {
+        arrayFree(&parameters);
+        arrayFree(&attributes);
+        return NULL;
+    }
+    Type *fnType = makeFunctionType(p, parameters, returnType);
+    // Note: the body stays NULL since it isn't part of the interface.
+    ASTObj *fnObj = astModuleNewObj(getCurrentModule(p), OBJ_FN, EMPTY_LOCATION, name, fnType);
+    fnObj->as.fn.returnType = returnType;
+    arrayCopy(&fnObj->as.fn.parameters, &parameters);
+    arrayFree(&parameters);
+    arrayCopy(&fnObj->attributes, &attributes);
+    arrayFree(&attributes);
+    return fnObj;
+}
+
+static ASTObj *read_interface_struct(Parser *p, ModuleInterface *mi) {
+    ASTString name = read_interface_string(p, mi);
+    ASTObj *st = astModuleNewObj(getCurrentModule(p), OBJ_STRUCT, EMPTY_LOCATION, name, NULL);
+    Scope *sc = enterScope(p, SCOPE_DEPTH_STRUCT);
+    Array fieldTypes; // Array<Type *>
+    arrayInit(&fieldTypes);
+    bool hadError = !read_interface_attributes(p, mi, &st->attributes);
+    u32 numFields = hadError ? 0 : moduleInterfaceReadU32(mi);
+    for(u32 i = 0; i < numFields && !hadError; ++i) {
+        ASTString fieldName = read_interface_string(p, mi);
+        Type *fieldType = read_interface_type(p, mi);
+        if(fieldType == NULL) {
+            hadError = true;
+            break;
+        }
+        ASTObj *field = astModuleNewObj(getCurrentModule(p), OBJ_VAR, EMPTY_LOCATION, fieldName, fieldType);
+        field->parent = st;
+        scopeAddObject(sc, field);
+        arrayPush(&st->as.structure.fields, (void *)field);
+        arrayPush(&fieldTypes, (void *)fieldType);
+    }
+    // The type has to exist before the methods since their 'this' parameter uses it.
+    Type *type = hadError ? NULL : makeStructType(p, name, EMPTY_LOCATION, p->current.module, &fieldTypes);
+    arrayFree(&fieldTypes);
+    u32 numMethods = hadError ? 0 : moduleInterfaceReadU32(mi);
+    for(u32 i = 0; i < numMethods && !hadError; ++i) {
+        ASTObj *method = read_interface_function(p, mi);
+        if(method == NULL) {
+            hadError = true;
+            break;
+        }
+        method->parent = st;
+        scopeAddObject(sc, method);
+    }
+    leaveScope(p);
+    if(hadError) {
+        return NULL;
+    }
+    st->as.structure.scope = sc;
+    st->dataType = type;
+    return st;
+}
+
+// Load the module [name] from the interface file at [path].
+// Returns true on success, or false if the interface is invalid.
+static bool loadModuleInterface(Parser *p, ASTString name, const char *path) {
+    ModuleInterface mi;
+    if(!moduleInterfaceOpen(&mi, path)) {
+        return false;
+    }
+    ModuleID mID = astProgramNewModule(p->program, name);
+    ASTModule *module = astProgramGetModule(p->program, mID);
+    p->current.module = mID;
+    p->current.scope = module->moduleScope;
+    import_primitive_types(p, mID);
+
+    bool success = read_interface_string(p, &mi) == name;
+    u32 numImports = success ? moduleInterfaceReadU32(&mi) : 0;
+    for(u32 i = 0; i < numImports && !mi.failed; ++i) {
+        ASTString importName = read_interface_string(p, &mi);
+        astModuleAddImport(module, importName, (ModuleID)-1);
+        queue_interface(p, importName);
+    }
+    u32 numStructs = success ? moduleInterfaceReadU32(&mi) : 0;
+    for(u32 i = 0; i < numStructs && success; ++i) {
+        ASTObj *st = read_interface_struct(p, &mi);
+        success = st != NULL && scopeAddObject(module->moduleScope, st);
+    }
+    u32 numFunctions = success ? moduleInterfaceReadU32(&mi) : 0;
+    for(u32 i = 0; i < numFunctions && success; ++i) {
+        ASTObj *fn = read_interface_function(p, &mi);
+        success = fn != NULL && scopeAddObject(module->moduleScope, fn);
+    }
+    u32 numVariables = success ? moduleInterfaceReadU32(&mi) : 0;
+    for(u32 i = 0; i < numVariables && success; ++i) {
+        ASTString varName = read_interface_string(p, &mi);
+        Type *varType = read_interface_type(p, &mi);
+        if(varType == NULL) {
+            success = false;
+            break;
+        }
+        ASTObj *var = astModuleNewObj(module, OBJ_VAR, EMPTY_LOCATION, varName, varType);
+        success = scopeAddObject(module->moduleScope, var);
+        arrayPush(&module->variableDecls, (void *)astVarDeclStmtNew(getCurrentAllocator(p), EMPTY_LOCATION, var, NULL));
+    }
+    success = success && !mi.failed && mi.offset == mi.size;
+    moduleInterfaceClose(&mi);
+    p->current.module = 0;
+    p->current.scope = NULL;
+    return success;
+}
+
 bool parserParse(Parser *p, ASTProgram *prog) {
     p->program = prog;
 
@@ -1339,6 +1744,75 @@ bool parserParse(Parser *p, ASTProgram *prog) {
         }
     }
 
+    // Note: loading an interface may queue more interfaces (its imports.)
+    for(usize i = 0; i < arrayLength(&p->pendingInterfaces); ++i) {
+        ASTString name = ARRAY_GET_AS(ASTString, &p->pendingInterfaces, i);
+        TableItem *item = tableGet(p->interfaces, (void *)name);
+        if(item == NULL || !loadModuleInterface(p, name, (const char *)item->value)) {
+            add_error(p, false, EMPTY_LOCATION, ERR_ERROR, tmp_buffer_format(p, "Failed to load the interface of module '%s'.", name));
+            if(item) {
+                add_error(p, false, EMPTY_LOCATION, ERR_HINT, tmp_buffer_format(p, "Removing '%s' will make the next build parse the module instead.", (const char *)item->value));
+            }
+            p->program = NULL;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool is_skipped_body_of(Parser *p, SkippedBody *skipped, ASTString module) {
+    return stringEqual(astProgramGetModule(p->program, skipped->module)->name, module);
+}
+
+bool parserHasSkippedBodies(Parser *p, ASTString module) {
+    ARRAY_FOR(i, p->skippedBodies) {
+        if(is_skipped_body_of(p, ARRAY_GET_AS(SkippedBody *, &p->skippedBodies, i), module)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseSkippedBody(Parser *p, SkippedBody *skipped) {
+    if(!scannerSetPosition(p->scanner, skipped->start.file, skipped->start.start)) {
+        return false;
+    }
+    ASTModule *module = astProgramGetModule(p->program, skipped->module);
+    p->current.module = skipped->module;
+    p->current.scope = skipped->parentScope;
+    p->primitives.void_ = astModuleGetType(module, "void");
+    p->primitives.int32 = astModuleGetType(module, "i32");
+    p->primitives.uint32 = astModuleGetType(module, "u32");
+    p->primitives.str = astModuleGetType(module, "str");
+    p->primitives.boolean = astModuleGetType(module, "bool");
+    // Scan the '{' and the first token of the body.
+    advance(p);
+    advance(p);
+    ASTBlockStmt *body = parseFunctionBody(p, &skipped->fn->as.fn.parameters);
+    p->current.module = 0;
+    p->current.scope = NULL;
+    if(!body || p->state.had_error) {
+        return false;
+    }
+    skipped->fn->as.fn.body = body;
+    return true;
+}
+
+bool parserParseSkippedBodies(Parser *p, ASTString module) {
+    VERIFY(p->program);
+    for(usize i = 0; i < arrayLength(&p->skippedBodies);) {
+        SkippedBody *skipped = ARRAY_GET_AS(SkippedBody *, &p->skippedBodies, i);
+        if(!is_skipped_body_of(p, skipped, module)) {
+            i++;
+            continue;
+        }
+        if(!parseSkippedBody(p, skipped)) {
+            return false;
+        }
+        arrayDelete(&p->skippedBodies, i);
+        FREE(skipped);
+    }
     return true;
 }
 
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Ast/Ast.h"
+#include "Reachability.h"
+
+static unsigned hashPointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool cmpPointer(void *a, void *b) {
+    return a == b;
+}
+
+void reachabilityInit(Reachability *r) {
+    r->program = NULL; // set in reachabilityAnalyze()
+    tableInit(&r->objects, hashPointer, cmpPointer);
+    tableInit(&r->types, hashPointer, cmpPointer);
+    arrayInit(&r->worklist);
+    r->counts.functions = (ReachabilityCount){0, 0};
+    r->counts.structs = (ReachabilityCount){0, 0};
+    r->counts.functionTypes = (ReachabilityCount){0, 0};
+    r->counts.variables = (ReachabilityCount){0, 0};
+}
+
+void reachabilityFree(Reachability *r) {
+    arrayFree(&r->worklist);
+    tableFree(&r->types);
+    tableFree(&r->objects);
+    r->program = NULL;
+}
+
+static void mark_object(Reachability *r, ASTObj *obj);
+
+// The same type can be represented by more than one Type (for example, in different ASTPrograms),
+// so types are identified by the Type stored in the module declaring them.
+static Type *canonical_type(Reachability *r, Type *ty) {
+    if(typeIsPrimitive(ty)) {
+        return ty;
+    }
+    Type *canonical = astModuleGetType(astProgramGetModule(r->program, ty->declModule), ty->name);
+    return canonical ? canonical : ty;
+}
+
+static void mark_type(Reachability *r, Type *ty) {
+    if(ty == NULL) {
+        return;
+    }
+    ty = canonical_type(r, ty);
+    if(tableGet(&r->types, (void *)ty) != NULL) {
+        return;
+    }
+    tableSet(&r->types, (void *)ty, NULL);
+    switch(ty->type) {
+        case TY_POINTER:
+            mark_type(r, ty->as.ptr.innerType);
+            break;
+        case TY_FUNCTION:
+            mark_type(r, ty->as.fn.returnType);
+            ARRAY_FOR(i, ty->as.fn.parameterTypes) {
+                mark_type(r, ARRAY_GET_AS(Type *, &ty->as.fn.parameterTypes, i));
+            }
+            break;
+        case TY_STRUCT: {
+            ASTObj *st = scopeGetObject(astProgramGetModule(r->program, ty->declModule)->moduleScope, OBJ_STRUCT, ty->name);
+            VERIFY(st);
+            mark_object(r, st);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static bool is_module_variable(Reachability *r, ASTObj *obj) {
+    if(obj->type != OBJ_VAR || obj->parent != NULL) {
+        return false;
+    }
+    Scope *moduleScope = astProgramGetModule(r->program, obj->ownerModule)->moduleScope;
+    return scopeGetObject(moduleScope, OBJ_VAR, obj->name) == obj;
+}
+
+static void mark_object(Reachability *r, ASTObj *obj) {
+    if(tableGet(&r->objects, (void *)obj) != NULL) {
+        return;
+    }
+    tableSet(&r->objects, (void *)obj, NULL);
+    arrayPush(&r->worklist, (void *)obj);
+}
+
+static void visit_expr(Reachability *r, ASTExprNode *expr) {
+    if(expr == NULL) {
+        return;
+    }
+    mark_type(r, expr->dataType);
+    switch(expr->type) {
+        case EXPR_STRUCT_CONSTANT:
+            ARRAY_FOR(i, NODE_AS(ASTStructConstantExpr, expr)->values) {
+                visit_expr(r, ARRAY_GET_AS(ASTExprNode *, &NODE_AS(ASTStructConstantExpr, expr)->values, i));
+            }
+            break;
+        // Obj nodes
+        case EXPR_VARIABLE:
+        case EXPR_FUNCTION: {
+            ASTObj *obj = NODE_AS(ASTObjExpr, expr)->obj;
+            // Locals, parameters & fields are generated with whatever uses them.
+            if(obj->type == OBJ_FN || is_module_variable(r, obj)) {
+                mark_object(r, obj);
+            }
+            break;
+        }
+        // Binary nodes
+        case EXPR_ASSIGN:
+        case EXPR_PROPERTY_ACCESS:
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_LOGICAL_AND:
+        case EXPR_LOGICAL_OR:
+            visit_expr(r, NODE_AS(ASTBinaryExpr, expr)->lhs);
+            visit_expr(r, NODE_AS(ASTBinaryExpr, expr)->rhs);
+            break;
+        // Unary nodes
+        case EXPR_NEGATE:
+        case EXPR_LOGICAL_NOT:
+        case EXPR_ADDROF:
+        case EXPR_DEREF:
+            visit_expr(r, NODE_AS(ASTUnaryExpr, expr)->operand);
+            break;
+        // Call node
+        case EXPR_CALL:
+            visit_expr(r, NODE_AS(ASTCallExpr, expr)->callee);
+            ARRAY_FOR(i, NODE_AS(ASTCallExpr, expr)->arguments) {
+                visit_expr(r, ARRAY_GET_AS(ASTExprNode *, &NODE_AS(ASTCallExpr, expr)->arguments, i));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void visit_stmt(Reachability *r, ASTStmtNode *stmt) {
+    if(stmt == NULL) {
+        return;
+    }
+    switch(stmt->type) {
+        case STMT_VAR_DECL:
+            mark_type(r, NODE_AS(ASTVarDeclStmt, stmt)->variable->dataType);
+            visit_expr(r, NODE_AS(ASTVarDeclStmt, stmt)->initializer);
+            break;
+        case STMT_BLOCK:
+            ARRAY_FOR(i, NODE_AS(ASTBlockStmt, stmt)->nodes) {
+                visit_stmt(r, ARRAY_GET_AS(ASTStmtNode *, &NODE_AS(ASTBlockStmt, stmt)->nodes, i));
+            }
+            break;
+        case STMT_IF:
+        case STMT_EXPECT:
+            visit_expr(r, NODE_AS(ASTConditionalStmt, stmt)->condition);
+            visit_stmt(r, NODE_AS(ASTConditionalStmt, stmt)->then);
+            visit_stmt(r, NODE_AS(ASTConditionalStmt, stmt)->else_);
+            break;
+        case STMT_LOOP:
+            visit_stmt(r, NODE_AS(ASTLoopStmt, stmt)->initializer);
+            visit_expr(r, NODE_AS(ASTLoopStmt, stmt)->condition);
+            visit_expr(r, NODE_AS(ASTLoopStmt, stmt)->increment);
+            visit_stmt(r, NODE_AS(ASTStmtNode, NODE_AS(ASTLoopStmt, stmt)->body));
+            break;
+        case STMT_RETURN:
+        case STMT_EXPR:
+            visit_expr(r, NODE_AS(ASTExprStmt, stmt)->expression);
+            break;
+        case STMT_DEFER:
+            visit_stmt(r, NODE_AS(ASTDeferStmt, stmt)->body);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static ASTVarDeclStmt *find_module_variable_decl(Reachability *r, ASTObj *var) {
+    ASTModule *module = astProgramGetModule(r->program, var->ownerModule);
+    ARRAY_FOR(i, module->variableDecls) {
+        ASTVarDeclStmt *decl = ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, i);
+        if(decl->variable == var) {
+            return decl;
+        }
+    }
+    UNREACHABLE();
+}
+
+// Mark everything [obj] uses.
+static void visit_object(Reachability *r, ASTObj *obj) {
+    switch(obj->type) {
+        case OBJ_FN:
+            // Methods are generated with their struct.
+            if(obj->parent) {
+                mark_object(r, obj->parent);
+            }
+            mark_type(r, obj->as.fn.returnType);
+            ARRAY_FOR(i, obj->as.fn.parameters) {
+                mark_type(r, ARRAY_GET_AS(ASTObj *, &obj->as.fn.parameters, i)->dataType);
+            }
+            visit_stmt(r, NODE_AS(ASTStmtNode, obj->as.fn.body));
+            break;
+        case OBJ_STRUCT: {
+            mark_type(r, obj->dataType);
+            Array objects; // Array<ASTObj *>
+            arrayInitSized(&objects, scopeGetNumObjects(obj->as.structure.scope));
+            scopeGetAllObjects(obj->as.structure.scope, &objects);
+            ARRAY_FOR(i, objects) {
+                ASTObj *field = ARRAY_GET_AS(ASTObj *, &objects, i);
+                if(field->type == OBJ_VAR) {
+                    mark_type(r, field->dataType);
+                }
+            }
+            arrayFree(&objects);
+            break;
+        }
+        case OBJ_VAR:
+            mark_type(r, obj->dataType);
+            visit_expr(r, find_module_variable_decl(r, obj)->initializer);
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
+static void count_type_callback(TableItem *item, bool is_last, void *reachability) {
+    UNUSED(is_last);
+    Reachability *r = (Reachability *)reachability;
+    Type *ty = (Type *)item->value;
+    if(ty->type == TY_FUNCTION) {
+        r->counts.functionTypes.total++;
+        r->counts.functionTypes.reachable += reachabilityHasType(r, ty) ? 1 : 0;
+    }
+}
+
+static void count_scope(Reachability *r, Scope *scope) {
+    Array objects; // Array<ASTObj *>
+    arrayInitSized(&objects, scopeGetNumObjects(scope));
+    scopeGetAllObjects(scope, &objects);
+    ARRAY_FOR(i, objects) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
+        usize reachable = reachabilityHasObject(r, obj) ? 1 : 0;
+        if(obj->type == OBJ_FN) {
+            r->counts.functions.total++;
+            r->counts.functions.reachable += reachable;
+        } else if(obj->type == OBJ_STRUCT) {
+            r->counts.structs.total++;
+            r->counts.structs.reachable += reachable;
+            count_scope(r, obj->as.structure.scope);
+        }
+    }
+    arrayFree(&objects);
+}
+
+void reachabilityAnalyze(Reachability *r, ASTProgram *prog) {
+    VERIFY(prog);
+    r->program = prog;
+    ASTString mainName = stringTableString(prog->strings, "main");
+    ARRAY_FOR(i, prog->modules) {
+        ASTObj *mainFn = scopeGetObject(ARRAY_GET_AS(ASTModule *, &prog->modules, i)->moduleScope, OBJ_FN, mainName);
+        if(mainFn) {
+            mark_object(r, mainFn);
+        }
+    }
+    while(arrayLength(&r->worklist) > 0) {
+        visit_object(r, ARRAY_POP_AS(ASTObj *, &r->worklist));
+    }
+
+    ARRAY_FOR(i, prog->modules) {
+        ASTModule *module = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
+        count_scope(r, module->moduleScope);
+        tableMap(&module->types, count_type_callback, (void *)r);
+        ARRAY_FOR(j, module->variableDecls) {
+            r->counts.variables.total++;
+            r->counts.variables.reachable += reachabilityHasObject(r, ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, j)->variable) ? 1 : 0;
+        }
+    }
+}
+
+bool reachabilityHasObject(Reachability *r, ASTObj *obj) {
+    return tableGet(&r->objects, (void *)obj) != NULL;
+}
+
+bool reachabilityHasType(Reachability *r, Type *ty) {
+    return tableGet(&r->types, (void *)canonical_type(r, ty)) != NULL;
+}
+
+static void print_count(FILE *to, const char *name, ReachabilityCount count, bool last) {
+    fprintf(to, "%zu/%zu %s%s", count.total - count.reachable, count.total, name, last ? ".\n" : ", ");
+}
+
+void reachabilityPrintSummary(FILE *to, Reachability *r) {
+    fputs("Removed unreachable code: ", to);
+    print_count(to, "functions & methods", r->counts.functions, false);
+    print_count(to, "structs", r->counts.structs, false);
+    print_count(to, "function types", r->counts.functionTypes, false);
+    print_count(to, "module variables", r->counts.variables, true);
+}
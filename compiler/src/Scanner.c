@@ -306,6 +306,17 @@ static bool set_source(Scanner *s, FileID file) {
     return true;
 }
 
+bool scannerSetPosition(Scanner *s, FileID file, usize offset) {
+    compilerSetCurrentFile(s->compiler, file);
+    if(!set_source(s, file)) {
+        return false;
+    }
+    VERIFY(offset <= stringLength(s->source));
+    s->start = s->current = offset;
+    s->failed_to_set_source = false;
+    return true;
+}
+
 Token scannerNextToken(Scanner *s) {
     if(s->failed_to_set_source) {
         // if we failed to set the source, we can't do anything.
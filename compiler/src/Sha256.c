@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <string.h> // memcpy()
+#include "common.h"
+#include "Sha256.h"
+
+static const u32 round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void compress(Sha256 *h, const u8 *block) {
+    u32 w[64];
+    for(int i = 0; i < 16; ++i) {
+        w[i] = (u32)block[i * 4] << 24 | (u32)block[i * 4 + 1] << 16 | (u32)block[i * 4 + 2] << 8 | (u32)block[i * 4 + 3];
+    }
+    for(int i = 16; i < 64; ++i) {
+        u32 s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        u32 s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    u32 a = h->state[0], b = h->state[1], c = h->state[2], d = h->state[3];
+    u32 e = h->state[4], f = h->state[5], g = h->state[6], k = h->state[7];
+    for(int i = 0; i < 64; ++i) {
+        u32 s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        u32 choice = (e & f) ^ (~e & g);
+        u32 t1 = k + s1 + choice + round_constants[i] + w[i];
+        u32 s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        u32 majority = (a & b) ^ (a & c) ^ (b & c);
+        u32 t2 = s0 + majority;
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h->state[0] += a;
+    h->state[1] += b;
+    h->state[2] += c;
+    h->state[3] += d;
+    h->state[4] += e;
+    h->state[5] += f;
+    h->state[6] += g;
+    h->state[7] += k;
+}
+
+#undef ROTR
+
+void sha256Init(Sha256 *h) {
+    static const u32 initial_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(h->state, initial_state, sizeof(initial_state));
+    h->length = 0;
+    h->blockLength = 0;
+}
+
+void sha256Update(Sha256 *h, const void *data, usize length) {
+    const u8 *bytes = (const u8 *)data;
+    h->length += length;
+    if(h->blockLength > 0) {
+        usize needed = sizeof(h->block) - h->blockLength;
+        usize n = length < needed ? length : needed;
+        memcpy(h->block + h->blockLength, bytes, n);
+        h->blockLength += n;
+        bytes += n;
+        length -= n;
+        if(h->blockLength < sizeof(h->block)) {
+            return;
+        }
+        compress(h, h->block);
+        h->blockLength = 0;
+    }
+    // Full blocks are hashed directly from [data].
+    while(length >= sizeof(h->block)) {
+        compress(h, bytes);
+        bytes += sizeof(h->block);
+        length -= sizeof(h->block);
+    }
+    memcpy(h->block, bytes, length);
+    h->blockLength = length;
+}
+
+bool sha256UpdateFile(Sha256 *h, const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if(!fp) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    u64 size = (u64)ftell(fp);
+    rewind(fp);
+    sha256Update(h, &size, sizeof(size));
+    char buffer[16 * 1024];
+    usize bytesRead;
+    while((bytesRead = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        sha256Update(h, buffer, bytesRead);
+    }
+    bool success = !ferror(fp);
+    fclose(fp);
+    return success;
+}
+
+void sha256Final(Sha256 *h, u8 digest[SHA256_DIGEST_SIZE]) {
+    u64 bit_length = h->length * 8;
+    // Padding: 0x80, zeros, and the big-endian bit length in the last 8 bytes of a block.
+    h->block[h->blockLength++] = 0x80;
+    if(h->blockLength > sizeof(h->block) - 8) {
+        memset(h->block + h->blockLength, 0, sizeof(h->block) - h->blockLength);
+        compress(h, h->block);
+        h->blockLength = 0;
+    }
+    memset(h->block + h->blockLength, 0, sizeof(h->block) - 8 - h->blockLength);
+    for(int i = 0; i < 8; ++i) {
+        h->block[63 - i] = (u8)(bit_length >> (i * 8));
+    }
+    compress(h, h->block);
+    for(int i = 0; i < 8; ++i) {
+        digest[i * 4] = (u8)(h->state[i] >> 24);
+        digest[i * 4 + 1] = (u8)(h->state[i] >> 16);
+        digest[i * 4 + 2] = (u8)(h->state[i] >> 8);
+        digest[i * 4 + 3] = (u8)h->state[i];
+    }
+}
+
+void sha256FinalHex(Sha256 *h, char hex[SHA256_HEX_SIZE]) {
+    static const char digits[] = "0123456789abcdef";
+    u8 digest[SHA256_DIGEST_SIZE];
+    sha256Final(h, digest);
+    for(usize i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0xf];
+    }
+    hex[SHA256_HEX_SIZE - 1] = '\0';
+}
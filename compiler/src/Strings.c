@@ -141,3 +141,20 @@ void stringAppend(String *dest, const char *format, ...) {
     stringVAppend(dest, format, ap);
     va_end(ap);
 }
+
+void stringNAppend(String *dest, const char *src, size_t length) {
+    VERIFY(is_valid(*dest));
+    StringHeader *h = from_str(*dest);
+    if(h->length + length + 1 > h->capacity) {
+        // Grow geometrically so repeated appends don't reallocate every time.
+        size_t new_capacity = h->capacity * 2;
+        if(new_capacity < h->length + length + 1) {
+            new_capacity = h->length + length + 1;
+        }
+        *dest = stringResize(*dest, new_capacity);
+        h = from_str(*dest);
+    }
+    memcpy(*dest + h->length, src, length);
+    h->length += length;
+    (*dest)[h->length] = '\0';
+}
@@ -188,8 +188,14 @@ void tableClear(Table *t, void (*free_item_callback)(TableItem *item, void *cl),
         if(free_item_callback) {
             free_item_callback(item, cl);
         }
-        tableDelete(t, (void *)item->key);
     }
+    // All the items are removed, so there is no need to leave tombstones (a cleared table is like a new one.)
+    for(size_t i = 0; i < t->capacity; ++i) {
+        t->items[i].is_empty = true;
+        t->items[i].key = NULL;
+        t->items[i].value = NULL;
+    }
+    t->used = 0;
 }
 
 #undef Item
@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <unistd.h> // sysconf()
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "ThreadPool.h"
+
+typedef struct thread_pool_task {
+    ThreadPoolTaskFn fn;
+    void *arg;
+} ThreadPoolTask;
+
+typedef struct worker_arg {
+    ThreadPool *pool;
+    usize index;
+} WorkerArg;
+
+static void *worker_main(void *arg) {
+    WorkerArg *workerArg = (WorkerArg *)arg;
+    ThreadPool *pool = workerArg->pool;
+    usize index = workerArg->index;
+    FREE(workerArg);
+
+    pthread_mutex_lock(&pool->lock);
+    while(true) {
+        while(pool->nextTask == arrayLength(&pool->tasks) && !pool->shuttingDown) {
+            pthread_cond_wait(&pool->hasTasks, &pool->lock);
+        }
+        if(pool->nextTask == arrayLength(&pool->tasks)) {
+            // Shutting down and no tasks are left.
+            break;
+        }
+        ThreadPoolTask *task = ARRAY_GET_AS(ThreadPoolTask *, &pool->tasks, pool->nextTask++);
+        // Reuse the queue storage once it's drained.
+        if(pool->nextTask == arrayLength(&pool->tasks)) {
+            arrayClear(&pool->tasks);
+            pool->nextTask = 0;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        task->fn(task->arg, index);
+        FREE(task);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->unfinishedTasks == 0) {
+            pthread_cond_broadcast(&pool->allDone);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+void threadPoolInit(ThreadPool *pool, usize numWorkers) {
+    VERIFY(numWorkers > 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->hasTasks, NULL);
+    pthread_cond_init(&pool->allDone, NULL);
+    arrayInit(&pool->tasks);
+    pool->nextTask = 0;
+    pool->unfinishedTasks = 0;
+    pool->shuttingDown = false;
+    pool->numWorkers = numWorkers;
+    pool->workers = CALLOC(numWorkers, sizeof(*pool->workers));
+    for(usize i = 0; i < numWorkers; ++i) {
+        WorkerArg *arg;
+        NEW0(arg);
+        arg->pool = pool;
+        arg->index = i;
+        VERIFY(pthread_create(&pool->workers[i], NULL, worker_main, (void *)arg) == 0);
+    }
+}
+
+void threadPoolFree(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shuttingDown = true;
+    pthread_cond_broadcast(&pool->hasTasks);
+    pthread_mutex_unlock(&pool->lock);
+    for(usize i = 0; i < pool->numWorkers; ++i) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    FREE(pool->workers);
+    pool->workers = NULL;
+    pool->numWorkers = 0;
+    arrayFree(&pool->tasks);
+    pthread_cond_destroy(&pool->allDone);
+    pthread_cond_destroy(&pool->hasTasks);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+void threadPoolSubmit(ThreadPool *pool, ThreadPoolTaskFn fn, void *arg) {
+    ThreadPoolTask *task;
+    NEW0(task);
+    task->fn = fn;
+    task->arg = arg;
+    pthread_mutex_lock(&pool->lock);
+    VERIFY(!pool->shuttingDown);
+    arrayPush(&pool->tasks, (void *)task);
+    pool->unfinishedTasks++;
+    pthread_cond_signal(&pool->hasTasks);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void threadPoolWait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while(pool->unfinishedTasks > 0) {
+        pthread_cond_wait(&pool->allDone, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+usize threadPoolDefaultSize(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (usize)cores : 1;
+}
@@ -4,6 +4,8 @@
 #include "Error.h"
 #include "Ast/Ast.h"
 #include "Compiler.h"
+#include "Ir/Lower.h"
+#include "Ir/Pass.h"
 #include "Typechecker.h"
 
 static void typechecker_init_internal(Typechecker *typechecker, Compiler *c) {
@@ -14,13 +16,44 @@ static void typechecker_init_internal(Typechecker *typechecker, Compiler *c) {
     typechecker->current.scope = NULL;
     typechecker->current.function = NULL;
     typechecker->current.module = NULL;
+    typechecker->fused.enabled = false;
+    typechecker->fused.errors = NULL;
+}
+
+static unsigned hashPointer(void *ptr) {
+    return (unsigned)((usize)ptr >> 3);
+}
+
+static bool cmpPointer(void *a, void *b) {
+    return a == b;
 }
 
 void typecheckerInit(Typechecker *typechecker, Compiler *c) {
     typechecker_init_internal(typechecker, c);
+    tableInit(&typechecker->fused.deferredErrors, hashPointer, cmpPointer);
+    arrayInit(&typechecker->divisions);
+}
+
+static void free_error_callback(void *err, void *cl) {
+    UNUSED(cl);
+    errorFree((Error *)err);
+    FREE(err);
+}
+
+static void free_deferred_errors_callback(TableItem *item, bool is_last, void *cl) {
+    UNUSED(is_last);
+    UNUSED(cl);
+    Array *errors = (Array *)item->value;
+    arrayMap(errors, free_error_callback, NULL);
+    arrayFree(errors);
+    FREE(errors);
 }
 
 void typecheckerFree(Typechecker *typechecker) {
+    // Errors are only left over here if validation failed in fused mode.
+    tableMap(&typechecker->fused.deferredErrors, free_deferred_errors_callback, NULL);
+    tableFree(&typechecker->fused.deferredErrors);
+    arrayFree(&typechecker->divisions);
     typechecker_init_internal(typechecker, NULL);
 }
 
@@ -28,6 +61,11 @@ static void add_error(Typechecker *typ, bool has_location, Location loc, ErrorTy
     Error *err;
     NEW0(err);
     errorInit(err, type, has_location, loc, message);
+    // In fused mode, errors are reported later by typecheckerTypecheck() (see Typechecker.h).
+    if(typ->fused.errors) {
+        arrayPush(typ->fused.errors, (void *)err);
+        return;
+    }
     compilerAddError(typ->compiler, err);
     typ->hadError = true;
 }
@@ -86,21 +124,57 @@ static bool checkTypes(Typechecker *typ, Location errLoc, Type *expected, Type *
     return true;
 }
 
-static void typecheckExpr(Typechecker *typ, ASTExprNode *expr);
-static void typecheckVariableDecl(Typechecker *typ, ASTVarDeclStmt *decl) {
-    if(decl->variable->dataType->type == TY_POINTER) {
-        error(typ, decl->header.location, "Pointer types are not allowed in this context.");
-        return;
+// Evaluate an integer expression made of constants only (with the same wraparound semantics as the IR, see irPassFoldConstants).
+// Returns false if [expr] isn't constant or can't be evaluated (e.g. a division by zero).
+static bool evaluateIntegerConstant(ASTExprNode *expr, u64 *value) {
+    Type *ty = expr->dataType;
+    if(!ty || (ty->type != TY_I32 && ty->type != TY_U32)) {
+        return false;
     }
-    if(decl->initializer) {
-        typecheckExpr(typ, decl->initializer);
-        if(!checkTypes(typ, decl->header.location, decl->variable->dataType, decl->initializer->dataType)) {
-            return;
+    switch(expr->type) {
+        case EXPR_NUMBER_CONSTANT:
+            *value = typeWrapInteger(ty, NODE_AS(ASTConstantValueExpr, expr)->as.number);
+            return true;
+        case EXPR_NEGATE: {
+            u64 operand;
+            if(!evaluateIntegerConstant(NODE_AS(ASTUnaryExpr, expr)->operand, &operand)) {
+                return false;
+            }
+            *value = typeWrapInteger(ty, 0 - operand);
+            return true;
+        }
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE: {
+            u64 lhs, rhs;
+            if(!evaluateIntegerConstant(NODE_AS(ASTBinaryExpr, expr)->lhs, &lhs) || !evaluateIntegerConstant(NODE_AS(ASTBinaryExpr, expr)->rhs, &rhs)) {
+                return false;
+            }
+            if(expr->type == EXPR_ADD) {
+                *value = typeWrapInteger(ty, lhs + rhs);
+            } else if(expr->type == EXPR_SUBTRACT) {
+                *value = typeWrapInteger(ty, lhs - rhs);
+            } else if(expr->type == EXPR_MULTIPLY) {
+                *value = typeWrapInteger(ty, lhs * rhs);
+            } else if(rhs == 0 || (ty->type == TY_I32 && (i64)lhs == INT32_MIN && (i64)rhs == -1)) {
+                return false;
+            } else if(ty->type == TY_I32) {
+                *value = typeWrapInteger(ty, (u64)((i64)lhs / (i64)rhs));
+            } else {
+                *value = lhs / rhs;
+            }
+            return true;
         }
+        default:
+            break;
     }
+    return false;
 }
 
-static void typecheckExpr(Typechecker *typ, ASTExprNode *expr) {
+// Checks done on a single expression node.
+// Note: the children of [expr] (if any) have to be checked first (see typecheckExpr()).
+static void checkExprNode(Typechecker *typ, ASTExprNode *expr) {
     VERIFY(expr);
     switch(expr->type) {
         // Constant value nodes.
@@ -131,8 +205,6 @@ static void typecheckExpr(Typechecker *typ, ASTExprNode *expr) {
         case EXPR_GE:
         case EXPR_LOGICAL_AND:
         case EXPR_LOGICAL_OR:
-            typecheckExpr(typ, NODE_AS(ASTBinaryExpr, expr)->lhs);
-            typecheckExpr(typ, NODE_AS(ASTBinaryExpr, expr)->rhs);
             if(NODE_IS(NODE_AS(ASTBinaryExpr, expr)->lhs, EXPR_PROPERTY_ACCESS)) {
                 ASTExprNode *rhs = NODE_AS(ASTBinaryExpr, NODE_AS(ASTBinaryExpr, expr)->lhs)->rhs;
                 while(NODE_IS(rhs, EXPR_PROPERTY_ACCESS)) {
@@ -142,13 +214,24 @@ static void typecheckExpr(Typechecker *typ, ASTExprNode *expr) {
             } else {
                 checkTypes(typ, expr->location, NODE_AS(ASTBinaryExpr, expr)->lhs->dataType, NODE_AS(ASTBinaryExpr, expr)->rhs->dataType);
             }
+            if(NODE_IS(expr, EXPR_DIVIDE)) {
+                // Constant expressions are folded (see irPassFoldConstants), so a constant division by zero is an error.
+                u64 divisor;
+                if(evaluateIntegerConstant(NODE_AS(ASTBinaryExpr, expr)->rhs, &divisor)) {
+                    if(divisor == 0) {
+                        error(typ, NODE_AS(ASTBinaryExpr, expr)->rhs->location, "Division by zero.");
+                    }
+                } else if(typ->current.function && (arrayLength(&typ->divisions) == 0 || ARRAY_GET_AS(ASTObj *, &typ->divisions, arrayLength(&typ->divisions) - 1) != typ->current.function)) {
+                    // The divisor might still be known to be zero once constants are propagated (see checkDivisions()).
+                    arrayPush(&typ->divisions, (void *)typ->current.function);
+                }
+            }
             break;
         // Unary nodes
         case EXPR_NEGATE:
         case EXPR_LOGICAL_NOT:
         case EXPR_ADDROF:
         case EXPR_DEREF:
-            typecheckExpr(typ, NODE_AS(ASTUnaryExpr, expr)->operand);
             if(NODE_IS(expr, EXPR_LOGICAL_NOT)) {
                 checkTypes(typ, NODE_AS(ASTUnaryExpr, expr)->operand->location, astModuleGetType(getCurrentModule(typ), "bool"), NODE_AS(ASTUnaryExpr, expr)->operand->dataType);
             }
@@ -178,6 +261,97 @@ static void typecheckExpr(Typechecker *typ, ASTExprNode *expr) {
     }
 }
 
+static void typecheckExpr(Typechecker *typ, ASTExprNode *expr) {
+    VERIFY(expr);
+    // Note: property access and call nodes don't typecheck their children.
+    switch(expr->type) {
+        // Binary nodes
+        case EXPR_ASSIGN:
+        case EXPR_ADD:
+        case EXPR_SUBTRACT:
+        case EXPR_MULTIPLY:
+        case EXPR_DIVIDE:
+        case EXPR_EQ:
+        case EXPR_NE:
+        case EXPR_LT:
+        case EXPR_LE:
+        case EXPR_GT:
+        case EXPR_GE:
+        case EXPR_LOGICAL_AND:
+        case EXPR_LOGICAL_OR:
+            typecheckExpr(typ, NODE_AS(ASTBinaryExpr, expr)->lhs);
+            typecheckExpr(typ, NODE_AS(ASTBinaryExpr, expr)->rhs);
+            break;
+        // Unary nodes
+        case EXPR_NEGATE:
+        case EXPR_LOGICAL_NOT:
+        case EXPR_ADDROF:
+        case EXPR_DEREF:
+            typecheckExpr(typ, NODE_AS(ASTUnaryExpr, expr)->operand);
+            break;
+        default:
+            break;
+    }
+    checkExprNode(typ, expr);
+}
+
+// Returns false if the initializer shouldn't be typechecked.
+static bool checkVariableDeclType(Typechecker *typ, ASTVarDeclStmt *decl) {
+    if(decl->variable->dataType->type == TY_POINTER) {
+        error(typ, decl->header.location, "Pointer types are not allowed in this context.");
+        return false;
+    }
+    return true;
+}
+
+static void typecheckVariableDecl(Typechecker *typ, ASTVarDeclStmt *decl) {
+    if(!checkVariableDeclType(typ, decl)) {
+        return;
+    }
+    if(decl->initializer) {
+        typecheckExpr(typ, decl->initializer);
+        if(!checkTypes(typ, decl->header.location, decl->variable->dataType, decl->initializer->dataType)) {
+            return;
+        }
+    }
+}
+
+// Checks done on a single statement node.
+// Note: * The children of [stmt] (if any) have to be checked first (see typecheckStmt()).
+//       * Variable declarations are checked by typecheckVariableDecl().
+static void checkStmtNode(Typechecker *typ, ASTStmtNode *stmt) {
+    VERIFY(stmt);
+    switch(stmt->type) {
+        // Conditional nodes
+        case STMT_IF:
+        case STMT_EXPECT: {
+            ASTConditionalStmt *conditionalStmt = NODE_AS(ASTConditionalStmt, stmt);
+            checkTypes(typ, conditionalStmt->condition->location, astModuleGetType(getCurrentModule(typ), "bool"), conditionalStmt->condition->dataType);
+            break;
+        }
+        // Expr nodes
+        case STMT_RETURN:
+            VERIFY(typ->current.function);
+            if(NODE_AS(ASTExprStmt, stmt)->expression != NULL) {
+                checkTypes(typ, NODE_AS(ASTExprStmt, stmt)->expression->location, typ->current.function->as.fn.returnType, NODE_AS(ASTExprStmt, stmt)->expression->dataType);
+            } else {
+                if(typ->current.function->as.fn.returnType->type != TY_VOID) {
+                    error(typ, stmt->location, "Return with no value in function '%s' returning '%s'.", typ->current.function->name, typ->current.function->as.fn.returnType->name);
+                }
+            }
+            break;
+        case STMT_VAR_DECL:
+        case STMT_BLOCK:
+        case STMT_LOOP:
+        case STMT_EXPR:
+        case STMT_DEFER:
+            // nothing.
+            break;
+        default:
+            UNREACHABLE();
+    }
+}
+
 static void typecheckStmt(Typechecker *typ, ASTStmtNode *stmt) {
     VERIFY(stmt);
     switch(stmt->type) {
@@ -207,7 +381,7 @@ static void typecheckStmt(Typechecker *typ, ASTStmtNode *stmt) {
             if(conditionalStmt->else_) {
                 typecheckStmt(typ, conditionalStmt->else_);
             }
-            checkTypes(typ, conditionalStmt->condition->location, astModuleGetType(getCurrentModule(typ), "bool"), conditionalStmt->condition->dataType);
+            checkStmtNode(typ, stmt);
             break;
         }
         // Loop nodes
@@ -225,15 +399,10 @@ static void typecheckStmt(Typechecker *typ, ASTStmtNode *stmt) {
         }
         // Expr nodes
         case STMT_RETURN:
-            VERIFY(typ->current.function);
             if(NODE_AS(ASTExprStmt, stmt)->expression != NULL) {
                 typecheckExpr(typ, NODE_AS(ASTExprStmt, stmt)->expression);
-                checkTypes(typ, NODE_AS(ASTExprStmt, stmt)->expression->location, typ->current.function->as.fn.returnType, NODE_AS(ASTExprStmt, stmt)->expression->dataType);
-            } else {
-                if(typ->current.function->as.fn.returnType->type != TY_VOID) {
-                    error(typ, stmt->location, "Return with no value in function '%s' returning '%s'.", typ->current.function->name, typ->current.function->as.fn.returnType->name);
-                }
             }
+            checkStmtNode(typ, stmt);
             break;
         case STMT_EXPR:
             typecheckExpr(typ, NODE_AS(ASTExprStmt, stmt)->expression);
@@ -254,8 +423,32 @@ static void typecheckStmt(Typechecker *typ, ASTStmtNode *stmt) {
  * That's all. Unreachable code is detected by parser.
  **/
 
+// Report the errors found in fused mode for [key] (see Typechecker.h).
+static void reportDeferredErrors(Typechecker *typ, void *key) {
+    TableItem *item = tableGet(&typ->fused.deferredErrors, key);
+    if(!item) {
+        return;
+    }
+    Array *errors = (Array *)item->value;
+    ARRAY_FOR(i, *errors) {
+        compilerAddError(typ->compiler, ARRAY_GET_AS(Error *, errors, i));
+        typ->hadError = true;
+    }
+    arrayFree(errors);
+    FREE(errors);
+    tableDelete(&typ->fused.deferredErrors, key);
+}
+
 static void typecheckFunction(Typechecker *typ, ASTObj *fn) {
     // TODO: control flow
+    if(typ->fused.enabled) {
+        reportDeferredErrors(typ, (void *)fn);
+        return;
+    }
+    if(fn->as.fn.body == NULL) {
+        // Loaded from a module interface (see ModuleInterface.h.)
+        return;
+    }
     typ->current.function = fn;
     typecheckStmt(typ, NODE_AS(ASTStmtNode, fn->as.fn.body));
     typ->current.function = NULL;
@@ -331,9 +524,13 @@ static void typecheckModule(Typechecker *typ, ASTModule *module) {
     typ->current.module = module;
     typ->current.scope = module->moduleScope;
 
-    ARRAY_FOR(i, module->variableDecls) {
-        ASTVarDeclStmt *decl = ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, i);
-        typecheckVariableDecl(typ, decl);
+    if(typ->fused.enabled) {
+        reportDeferredErrors(typ, (void *)module);
+    } else {
+        ARRAY_FOR(i, module->variableDecls) {
+            ASTVarDeclStmt *decl = ARRAY_GET_AS(ASTVarDeclStmt *, &module->variableDecls, i);
+            typecheckVariableDecl(typ, decl);
+        }
     }
     if(typ->hadError) {
         // equivalent of a return for the purpos of control flow.
@@ -347,9 +544,94 @@ typecheck_module_end:
     typ->current.scope = NULL;
 }
 
+void typecheckerEnableFused(Typechecker *typechecker) {
+    typechecker->fused.enabled = true;
+}
+
+void typecheckerSetFusedContext(Typechecker *typechecker, ASTModule *module, ASTObj *function) {
+    VERIFY(typechecker->fused.enabled);
+    typechecker->current.module = module;
+    typechecker->current.function = function;
+    void *key = function ? (void *)function : (void *)module;
+    TableItem *item = tableGet(&typechecker->fused.deferredErrors, key);
+    if(item) {
+        typechecker->fused.errors = (Array *)item->value;
+        return;
+    }
+    Array *errors;
+    NEW0(errors);
+    arrayInit(errors);
+    tableSet(&typechecker->fused.deferredErrors, key, (void *)errors);
+    typechecker->fused.errors = errors;
+}
+
+usize typecheckerFusedMark(Typechecker *typechecker) {
+    VERIFY(typechecker->fused.errors);
+    return arrayLength(typechecker->fused.errors);
+}
+
+// Drop the errors found since [mark] (used for the children the typechecker doesn't check).
+static void discardFusedErrors(Typechecker *typ, usize mark) {
+    while(arrayLength(typ->fused.errors) > mark) {
+        Error *err = (Error *)arrayPop(typ->fused.errors);
+        errorFree(err);
+        FREE(err);
+    }
+}
+
+void typecheckerCheckExprNode(Typechecker *typechecker, ASTExprNode *expr, usize mark) {
+    VERIFY(typechecker->fused.errors);
+    if(NODE_IS(expr, EXPR_CALL) || NODE_IS(expr, EXPR_PROPERTY_ACCESS)) {
+        discardFusedErrors(typechecker, mark);
+    }
+    checkExprNode(typechecker, expr);
+}
+
+void typecheckerCheckStmtNode(Typechecker *typechecker, ASTStmtNode *stmt, usize mark) {
+    VERIFY(typechecker->fused.errors);
+    if(NODE_IS(stmt, STMT_VAR_DECL)) {
+        ASTVarDeclStmt *decl = NODE_AS(ASTVarDeclStmt, stmt);
+        if(!checkVariableDeclType(typechecker, decl)) {
+            // The error was added after the initializer's errors, so re-add it after discarding them.
+            Error *err = (Error *)arrayPop(typechecker->fused.errors);
+            discardFusedErrors(typechecker, mark);
+            arrayPush(typechecker->fused.errors, (void *)err);
+            return;
+        }
+        if(decl->initializer) {
+            checkTypes(typechecker, decl->header.location, decl->variable->dataType, decl->initializer->dataType);
+        }
+        return;
+    }
+    checkStmtNode(typechecker, stmt);
+}
+
+// Lower the functions dividing by a non-constant divisor and fold their constants to find
+// divisors that are only known to be zero after propagation (e.g. 'var z = 0; return 10 / z;').
+// Only these functions are lowered, so checking the rest of the program costs nothing.
+static void checkDivisions(Typechecker *typ) {
+    IrPassManager pm;
+    irPassManagerInit(&pm);
+    irPassManagerAddDefaultPasses(&pm);
+    ARRAY_FOR(i, typ->divisions) {
+        ASTObj *fn = ARRAY_GET_AS(ASTObj *, &typ->divisions, i);
+        IrModule *m = irModuleNew(typ->program, astProgramGetModule(typ->program, fn->ownerModule));
+        irLowerFunction(m, fn, true);
+        irPassManagerRunOnModule(&pm, m);
+        IrInstr *division = irFindDivisionByZero(irModuleGetFunction(m, fn));
+        if(division) {
+            error(typ, division->location, "Division by zero.");
+        }
+        irModuleFree(m);
+    }
+    irPassManagerFree(&pm);
+}
+
 bool typecheckerTypecheck(Typechecker *typechecker, ASTProgram *prog) {
     VERIFY(prog);
     typechecker->program = prog;
+    // In fused mode, errors found from here on are reported immediately.
+    typechecker->fused.errors = NULL;
 
     ARRAY_FOR(i, prog->modules) {
         ASTModule *module = ARRAY_GET_AS(ASTModule *, &prog->modules, i);
@@ -363,5 +645,8 @@ bool typecheckerTypecheck(Typechecker *typechecker, ASTProgram *prog) {
         typechecker->hadError = true;
         compilerAddError(typechecker->compiler, err);
     }
+    if(!typechecker->hadError) {
+        checkDivisions(typechecker);
+    }
     return !typechecker->hadError;
 }
@@ -19,6 +19,7 @@
 void validatorInit(Validator *v, Compiler *c) {
     v->parsedProgram = v->checkedProgram = NULL;
     v->compiler = c;
+    v->fusedTypechecker = NULL;
     v->hadError = false;
     v->current.checkedScope = v->current.parsedScope = NULL;
     v->current.function = NULL;
@@ -31,6 +32,11 @@ void validatorFree(Validator *v) {
     memset(v, 0, sizeof(*v));
 }
 
+void validatorSetFusedTypechecker(Validator *v, Typechecker *typechecker) {
+    typecheckerEnableFused(typechecker);
+    v->fusedTypechecker = typechecker;
+}
+
 static void enterScope(Validator *v, Scope *parsedScope) {
     Scope *sc = scopeNew(v->current.checkedScope, parsedScope->depth);
     scopeAddChild(v->current.checkedScope, sc);
@@ -227,6 +233,17 @@ static Type *expr_data_type_complex(Validator *v, ASTExprNode *expr, bool isInCa
     }
 }
 
+// Fused typechecking helpers (see Typechecker.h).
+static inline usize fusedMark(Validator *v) {
+    return v->fusedTypechecker ? typecheckerFusedMark(v->fusedTypechecker) : 0;
+}
+
+// Note: Nodes are only typechecked while there are no errors since
+//       typechecking errors aren't reported if validating fails.
+static inline bool shouldTypecheck(Validator *v, void *checkedNode) {
+    return v->fusedTypechecker && checkedNode && !v->hadError;
+}
+
 static inline Type *exprDataType(Validator *v, ASTExprNode *expr) {
     return expr_data_type_complex(v, expr, false);
 }
@@ -384,6 +401,14 @@ static void unpackPropertyAccessExpr(Array *a, ASTExprNode *n) {
 }
 
 // Note: C.R.E for [parsedExpr] to be NULL.
+// Returns the function (or method) [callee] refers to, or NULL if it is called through a variable.
+static ASTObj *calleeFunction(ASTExprNode *callee) {
+    if(NODE_IS(callee, EXPR_PROPERTY_ACCESS)) {
+        callee = NODE_AS(ASTBinaryExpr, callee)->rhs;
+    }
+    return NODE_IS(callee, EXPR_FUNCTION) ? NODE_AS(ASTObjExpr, callee)->obj : NULL;
+}
+
 static ASTExprNode *validateExpr(Validator *v, ASTExprNode *parsedExpr) {
     VERIFY(parsedExpr);
     // 1. For each node, do (depending on type):
@@ -392,6 +417,7 @@ static ASTExprNode *validateExpr(Validator *v, ASTExprNode *parsedExpr) {
     //      CALL: check that callee is callable, validate argument expressions + correct amount of them.
     // 2. Also set the data type for each node.
 
+    usize mark = fusedMark(v);
     ASTExprNode *checkedExpr = NULL;
     switch(parsedExpr->type) {
         // Constant value nodes.
@@ -620,6 +646,13 @@ static ASTExprNode *validateExpr(Validator *v, ASTExprNode *parsedExpr) {
                 arrayFree(&checkedArguments);
                 break;
             }
+            ASTObj *calleeFn = calleeFunction(checkedCallee);
+            if(calleeFn && calleeFn == v->current.function && astObjectGetAttribute(calleeFn, ATTR_INLINE)) {
+                // It can't be inlined into itself (the C compiler fails on always_inline functions it can't inline.)
+                error(v, parsedExpr->location, "An 'inline' function can't call itself.");
+                arrayFree(&checkedArguments);
+                break;
+            }
             Type *calleeType = expr_data_type_complex(v, checkedCallee, true);
             VERIFY(calleeType);
             checkedExpr = (ASTExprNode *)astCallExprNew(getCurrentAllocator(v), parsedExpr->location, calleeType, checkedCallee, &checkedArguments);
@@ -727,6 +760,9 @@ static ASTExprNode *validateExpr(Validator *v, ASTExprNode *parsedExpr) {
             UNREACHABLE();
     }
 
+    if(shouldTypecheck(v, checkedExpr)) {
+        typecheckerCheckExprNode(v->fusedTypechecker, checkedExpr, mark);
+    }
     return checkedExpr;
 }
 
@@ -735,6 +771,7 @@ static ASTVarDeclStmt *validateVariableDecl(Validator *v, ASTVarDeclStmt *parsed
 // Note: C.R.E for [parsedStmt] to be NULL.
 static ASTStmtNode *validateStmt(Validator *v, ASTStmtNode *parsedStmt) {
     VERIFY(parsedStmt);
+    usize mark = fusedMark(v);
     ASTStmtNode *checkedStmt = NULL;
     switch(parsedStmt->type) {
         // VarDecl nodes
@@ -797,7 +834,10 @@ static ASTStmtNode *validateStmt(Validator *v, ASTStmtNode *parsedStmt) {
             if(parsedExpect->then) {
                 checkedThen = TRY(ASTStmtNode *, validateStmt(v, parsedExpect->then));
             }
-            checkedStmt = NODE_AS(ASTStmtNode, astConditionalStmtNew(getCurrentAllocator(v), STMT_EXPECT, parsedStmt->location, checkedCondition, checkedThen, NULL));
+            ASTConditionalStmt *checkedExpect = astConditionalStmtNew(getCurrentAllocator(v), STMT_EXPECT, parsedStmt->location, checkedCondition, checkedThen, NULL);
+            checkedExpect->file = parsedExpect->file;
+            checkedExpect->line = parsedExpect->line;
+            checkedStmt = NODE_AS(ASTStmtNode, checkedExpect);
             break;
         }
         // Loop nodes
@@ -820,6 +860,10 @@ static ASTStmtNode *validateStmt(Validator *v, ASTStmtNode *parsedStmt) {
         // Expr nodes
         case STMT_RETURN: {
             // Can't use same code as STMT_EXPR due to return statements not requiring an operand.
+            if(astObjectGetAttribute(v->current.function, ATTR_NORETURN)) {
+                error(v, parsedStmt->location, "A 'noreturn' function can't return.");
+                return NULL;
+            }
             ASTExprNode *checkedOperand = NULL;
             if(NODE_AS(ASTExprStmt, parsedStmt)->expression) {
                 checkedOperand = TRY(ASTExprNode *, validateExpr(v, NODE_AS(ASTExprStmt, parsedStmt)->expression));
@@ -846,6 +890,10 @@ static ASTStmtNode *validateStmt(Validator *v, ASTStmtNode *parsedStmt) {
             UNREACHABLE();
     }
 
+    // Note: variable declarations are typechecked in validateVariableDecl().
+    if(shouldTypecheck(v, checkedStmt) && !NODE_IS(checkedStmt, STMT_VAR_DECL)) {
+        typecheckerCheckStmtNode(v->fusedTypechecker, checkedStmt, mark);
+    }
     return checkedStmt;
 }
 
@@ -859,14 +907,9 @@ static ASTVarDeclStmt *validateVariableDecl(Validator *v, ASTVarDeclStmt *parsed
     // make sure there is a type (that is not void.)
     // Make sure not assigned to itself (above two checks should catch this error.)
 
-    // TODO: properly define this. another global variable is also const.
-    #define IS_CONST_EXPR(expr) ((expr)->type == EXPR_NUMBER_CONSTANT || (expr)->type == EXPR_STRING_CONSTANT)
-    if(getCurrentCheckedScope(v)->depth == SCOPE_DEPTH_MODULE_NAMESPACE && parsedVarDecl->initializer && !IS_CONST_EXPR(parsedVarDecl->initializer)) {
-        error(v, parsedVarDecl->initializer->location, "Initializer of module variable is not a constant expression.");
-        return NULL;
-    }
-    #undef IS_CONST_EXPR
+    // Note: Module variable initializers are evaluated at compile time after typechecking (see Evaluator.h).
 
+    usize mark = fusedMark(v);
     ASTExprNode *checkedInitializer = NULL;
     if(parsedVarDecl->initializer) {
         checkedInitializer = TRY(ASTExprNode *, validateExpr(v, parsedVarDecl->initializer));
@@ -889,7 +932,7 @@ static ASTVarDeclStmt *validateVariableDecl(Validator *v, ASTVarDeclStmt *parsed
     }
     dataType = TRY(Type *, validateType(v, dataType));
 
-    if(dataType->type == TY_U32 && NODE_IS(checkedInitializer, EXPR_NUMBER_CONSTANT)) {
+    if(dataType->type == TY_U32 && checkedInitializer && NODE_IS(checkedInitializer, EXPR_NUMBER_CONSTANT)) {
         // TODO: wrap initializer in type conversion expression.
         checkedInitializer->dataType = getTypeInCurrentModule(v, "u32");
     }
@@ -898,6 +941,9 @@ static ASTVarDeclStmt *validateVariableDecl(Validator *v, ASTVarDeclStmt *parsed
     bool added = scopeAddObject(getCurrentCheckedScope(v), checkedObj);
     VERIFY(added == true);
     ASTVarDeclStmt *checkedVarDecl = astVarDeclStmtNew(getCurrentAllocator(v), parsedVarDecl->header.location, checkedObj, checkedInitializer);
+    if(shouldTypecheck(v, checkedVarDecl)) {
+        typecheckerCheckStmtNode(v->fusedTypechecker, NODE_AS(ASTStmtNode, checkedVarDecl), mark);
+    }
     return checkedVarDecl;
 }
 
@@ -910,15 +956,127 @@ static bool validateFunction(Validator *v, ASTObj *fn) {
     // Get the predecled checked function.
     ASTObj *checkedFn = scopeGetObject(getCurrentCheckedScope(v), OBJ_FN, fn->name);
     VERIFY(checkedFn); // MUST exist.
+    if(fn->as.fn.body == NULL) {
+        // Loaded from a module interface (see ModuleInterface.h.)
+        return true;
+    }
     v->current.function = checkedFn;
+    if(v->fusedTypechecker) {
+        typecheckerSetFusedContext(v->fusedTypechecker, getCurrentCheckedModule(v), checkedFn);
+    }
     ASTStmtNode *checkedBody = TRY(ASTStmtNode *, validateStmt(v, NODE_AS(ASTStmtNode, fn->as.fn.body)));
     v->current.function = NULL;
+    if(v->fusedTypechecker) {
+        typecheckerSetFusedContext(v->fusedTypechecker, getCurrentCheckedModule(v), NULL);
+    }
     checkedFn->as.fn.body = NODE_AS(ASTBlockStmt, checkedBody);
 
     // checkedFn is already in the current scope. see above.
     return true;
 }
 
+// The largest alignment '#[aligned(N)]' accepts (a page.)
+#define MAX_ATTRIBUTE_ALIGNMENT 4096
+
+// The attribute each attribute can't be used together with (ATTR_UNKNOWN if there is none.)
+static const ASTAttributeType conflictingAttributes[ATTR_TYPE_COUNT] = {
+    [ATTR_INLINE]   = ATTR_NOINLINE,
+    [ATTR_NOINLINE] = ATTR_INLINE,
+    [ATTR_HOT]      = ATTR_COLD,
+    [ATTR_COLD]     = ATTR_HOT,
+    [ATTR_PURE]     = ATTR_CONST,
+    [ATTR_CONST]    = ATTR_PURE
+};
+
+// Checks that the attributes of the function [fn] match its signature.
+static bool validateFunctionAttributes(Validator *v, ASTObj *fn) {
+    bool hadError = false;
+    ASTAttribute *attr = NULL;
+    if((attr = astObjectGetAttribute(fn, ATTR_NORETURN)) && fn->as.fn.returnType->type != TY_VOID) {
+        error(v, attr->location, "A 'noreturn' function must return 'void'.");
+        hadError = true;
+    }
+    // The result of pure & const functions is all they do (calls to them may be merged or removed.)
+    if((attr = astObjectGetAttribute(fn, ATTR_PURE)) || (attr = astObjectGetAttribute(fn, ATTR_CONST))) {
+        if(fn->as.fn.returnType->type == TY_VOID) {
+            error(v, attr->location, "A '%s' function must return a value.", attr->name);
+            hadError = true;
+        }
+    }
+    // Const functions may not read memory at all (only their arguments.)
+    if((attr = astObjectGetAttribute(fn, ATTR_CONST))) {
+        ARRAY_FOR(i, fn->as.fn.parameters) {
+            ASTObj *param = ARRAY_GET_AS(ASTObj *, &fn->as.fn.parameters, i);
+            if(param->dataType->type == TY_POINTER) {
+                error(v, attr->location, "A 'const' function can't have pointer parameters.");
+                hint(v, param->location, "Consider using 'pure' instead.");
+                hadError = true;
+                break;
+            }
+        }
+    }
+    return !hadError;
+}
+
+// Resolves & checks the attributes of [parsedObj], and adds them to [checkedObj] (a function or struct).
+// Note: The parameters & return type of checked functions MUST already be set.
+static bool validateAttributes(Validator *v, ASTObj *parsedObj, ASTObj *checkedObj) {
+    bool hadError = false;
+    ARRAY_FOR(i, parsedObj->attributes) {
+        ASTAttribute *parsedAttr = ARRAY_GET_AS(ASTAttribute *, &parsedObj->attributes, i);
+        ASTAttributeType type = astAttributeTypeFromName(parsedAttr->name);
+        if(type == ATTR_UNKNOWN) {
+            error(v, parsedAttr->location, "Unknown attribute '%s'.", parsedAttr->name);
+            hadError = true;
+            continue;
+        }
+        ASTObjType target = type == ATTR_ALIGNED ? OBJ_STRUCT : OBJ_FN;
+        if(checkedObj->type != target) {
+            error(v, parsedAttr->location, "Attribute '%s' can only be applied to %s.", parsedAttr->name, target == OBJ_FN ? "functions" : "structs");
+            hadError = true;
+            continue;
+        }
+        if(type == ATTR_ALIGNED) {
+            u64 alignment = parsedAttr->argument;
+            if(!parsedAttr->hasArgument) {
+                error(v, parsedAttr->location, "Attribute 'aligned' requires an alignment (for example 'aligned(16)').");
+                hadError = true;
+                continue;
+            }
+            if(alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > MAX_ATTRIBUTE_ALIGNMENT) {
+                error(v, parsedAttr->location, "Alignment must be a power of 2 no larger than %d.", MAX_ATTRIBUTE_ALIGNMENT);
+                hadError = true;
+                continue;
+            }
+        } else if(parsedAttr->hasArgument) {
+            error(v, parsedAttr->location, "Attribute '%s' doesn't take an argument.", parsedAttr->name);
+            hadError = true;
+            continue;
+        }
+        ASTAttribute *previous = astObjectGetAttribute(checkedObj, type);
+        if(previous) {
+            error(v, parsedAttr->location, "Duplicate attribute '%s'.", parsedAttr->name);
+            hint(v, previous->location, "Previous attribute was here.");
+            hadError = true;
+            continue;
+        }
+        if(conflictingAttributes[type] != ATTR_UNKNOWN && (previous = astObjectGetAttribute(checkedObj, conflictingAttributes[type]))) {
+            error(v, parsedAttr->location, "Attribute '%s' can't be used together with '%s'.", parsedAttr->name, previous->name);
+            hint(v, previous->location, "'%s' was applied here.", previous->name);
+            hadError = true;
+            continue;
+        }
+        ASTAttribute *checkedAttr = astAttributeNew(getCurrentAllocator(v), type, parsedAttr->location, parsedAttr->name);
+        checkedAttr->hasArgument = parsedAttr->hasArgument;
+        checkedAttr->argument = parsedAttr->argument;
+        arrayPush(&checkedObj->attributes, (void *)checkedAttr);
+    }
+    if(!hadError && checkedObj->type == OBJ_FN) {
+        hadError = !validateFunctionAttributes(v, checkedObj);
+    }
+    return !hadError;
+}
+
 static bool validateCurrentScope(Validator *v);
 static bool validateStruct(Validator *v, ASTObj *st) {
     Type *checkedStructType = validateType(v, st->dataType);
@@ -931,30 +1089,30 @@ static bool validateStruct(Validator *v, ASTObj *st) {
 
     checkedStruct->as.structure.scope = getCurrentCheckedScope(v);
     scopeAddObject(getCurrentCheckedModule(v)->moduleScope, checkedStruct);
+    bool hadError = !validateAttributes(v, st, checkedStruct);
+    ASTAttribute *aligned = astObjectGetAttribute(checkedStruct, ATTR_ALIGNED);
+    checkedStructType->as.structure.alignment = aligned ? aligned->argument : 0;
 
     // Note: when we validate types, we validate the fields (their types.)
-    //       So here we only add them to the scope.
-    Array objects;
-    arrayInit(&objects);
-    scopeGetAllObjects(st->as.structure.scope, &objects);
-    ARRAY_FOR(i, objects) {
-        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &objects, i);
-        if(obj->type == OBJ_VAR) {
-            Type *checkedFieldType = validateType(v, obj->dataType);
-            VERIFY(checkedFieldType); // TODO: Guaranteed to exist I think (type validation in module)??
-            ASTObj *checkedField = astModuleNewObj(getCurrentCheckedModule(v), obj->type, obj->location, obj->name, checkedFieldType);
-            // Set the parent of the field as the struct.
-            checkedField->parent = checkedStruct;
-            // Note: parser checks for field re-declaration.
-            scopeAddObject(getCurrentCheckedScope(v), checkedField);
-        }
+    //       So here we only add them to the scope (in declaration order.)
+    ARRAY_FOR(i, st->as.structure.fields) {
+        ASTObj *obj = ARRAY_GET_AS(ASTObj *, &st->as.structure.fields, i);
+        Type *checkedFieldType = validateType(v, obj->dataType);
+        VERIFY(checkedFieldType); // TODO: Guaranteed to exist I think (type validation in module)??
+        ASTObj *checkedField = astModuleNewObj(getCurrentCheckedModule(v), obj->type, obj->location, obj->name, checkedFieldType);
+        // Set the parent of the field as the struct.
+        checkedField->parent = checkedStruct;
+        // Note: parser checks for field re-declaration.
+        scopeAddObject(getCurrentCheckedScope(v), checkedField);
+        arrayPush(&checkedStruct->as.structure.fields, (void *)checkedField);
     }
-    arrayFree(&objects);
     // Set objParent to this struct so that all of the functions in its scope have it as their parent.
     v->current.objParent = checkedStruct;
     // Note: the checked struct has to exist before validating the methods since they
     //       use the struct. Here, the struct is now created at the beginning of this function.
-    bool hadError = !validateCurrentScope(v);
+    if(!validateCurrentScope(v)) {
+        hadError = true;
+    }
     v->current.objParent = NULL;
     leaveScope(v);
     return !hadError;
@@ -983,9 +1141,30 @@ static void predeclFunction(Validator *v, ASTObj *parsedFn) {
     if(!checkedDataType || !checkedReturnType || hadError) {
         return;
     }
+    if(!validateAttributes(v, parsedFn, checkedFnPredecl)) {
+        return;
+    }
     scopeAddObject(getCurrentCheckedScope(v), checkedFnPredecl);
 }
 
+// Validate module scope level variable declarations ("globals".)
+static bool validateModuleVariableDecls(Validator *v) {
+    ASTModule *parsedModule = astProgramGetModule(v->parsedProgram, v->current.module);
+    ASTModule *checkedModule = getCurrentCheckedModule(v);
+    if(v->fusedTypechecker) {
+        typecheckerSetFusedContext(v->fusedTypechecker, checkedModule, NULL);
+    }
+    ARRAY_FOR(i, parsedModule->variableDecls) {
+        ASTVarDeclStmt *parsedVarDecl = ARRAY_GET_AS(ASTVarDeclStmt *, &parsedModule->variableDecls, i);
+        // Note: validateVariableDecl() also validates the objects.
+        ASTVarDeclStmt *checkedVarDecl = validateVariableDecl(v, parsedVarDecl);
+        if(checkedVarDecl) {
+            arrayPush(&checkedModule->variableDecls, (void *)checkedVarDecl);
+        }
+    }
+    return !v->hadError;
+}
+
 // Note: scope here refers to a namespace type scope (i.e. SCOPE_DEPTH_MODULE_NAMESPACE or SCOPE_DEPTH_STRUCT)
 static bool validateCurrentScope(Validator *v) {
     VERIFY(v->current.parsedScope);
@@ -1025,6 +1204,11 @@ static bool validateCurrentScope(Validator *v) {
         return false;
     }
 
+    if(getCurrentCheckedScope(v)->depth == SCOPE_DEPTH_MODULE_NAMESPACE && !validateModuleVariableDecls(v)) {
+        arrayFree(&objectsInScope);
+        return false;
+    }
+
     // Now validate functions.
     ARRAY_FOR(i, objectsInScope) {
         ASTObj *parsedObj = ARRAY_GET_AS(ASTObj *, &objectsInScope, i);
@@ -1125,24 +1309,13 @@ static void validateModule(Validator *v, ModuleID moduleID) {
         return;
     }
 
-    // Validate module scope level variable declarations ("globals".)
-    ARRAY_FOR(i, parsedModule->variableDecls) {
-        ASTVarDeclStmt *parsedVarDecl = ARRAY_GET_AS(ASTVarDeclStmt *, &parsedModule->variableDecls, i);
-        // Note: validateVariableDecl() also validates the objects.
-        ASTVarDeclStmt *checkedVarDecl = validateVariableDecl(v, parsedVarDecl);
-        if(checkedVarDecl) {
-            arrayPush(&checkedModule->variableDecls, (void *)checkedVarDecl);
-        }
-    }
-    if(v->hadError) {
-        return;
-    }
     // Notes to clear my confusion:
     // * When validating a scope, we DON'T have enought info to validate OBJ_VARs.
     //   - Hence we validate them as we encounter them, which doesn't cause any problem for locals
     //     since we can't use them before they are declared.
     //   - Since we validate OBJ_VARs as we encounter them, we skip them when validating the objects
-    //     in a scope. This means we can validate "globals" before the scope (but after the types).
+    //     in a scope. "globals" are validated by validateCurrentScope() once the functions are
+    //     predeclared (so initializers can call them), but before the function bodies (which use them).
     // * When is validateCurrentScope() called then?
     //   - When validating a module or a struct only. In the future, they will be called on enums
     //     as well (unless they are implemented using structs.)
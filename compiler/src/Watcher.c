@@ -0,0 +1,133 @@
+#include <string.h> // strerror(), strrchr()
+#include <errno.h>
+#include <poll.h> // poll()
+#include <unistd.h> // read(), close()
+#include <sys/inotify.h>
+#include "common.h"
+#include "memory.h"
+#include "Array.h"
+#include "Table.h"
+#include "Strings.h"
+#include "Watcher.h"
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE)
+
+static unsigned hash_descriptor(void *wd) {
+    return (unsigned)(usize)wd;
+}
+
+static bool compare_descriptors(void *a, void *b) {
+    return a == b;
+}
+
+void watcherInit(Watcher *w) {
+    w->fd = -1;
+    tableInit(&w->directories, hash_descriptor, compare_descriptors);
+    tableInit(&w->files, NULL, NULL);
+}
+
+static void free_directory_callback(TableItem *item, void *cl) {
+    UNUSED(cl);
+    stringFree((String)item->value);
+}
+
+static void free_file_callback(TableItem *item, void *cl) {
+    UNUSED(cl);
+    stringFree((String)item->key);
+}
+
+// Stop watching everything.
+static void clear(Watcher *w) {
+    if(w->fd >= 0) {
+        close(w->fd);
+        w->fd = -1;
+    }
+    tableClear(&w->directories, free_directory_callback, NULL);
+    tableClear(&w->files, free_file_callback, NULL);
+}
+
+void watcherFree(Watcher *w) {
+    clear(w);
+    tableFree(&w->directories);
+    tableFree(&w->files);
+}
+
+bool watcherSetFiles(Watcher *w, Array *paths) {
+    // A new instance is simpler than removing the watches that aren't needed anymore.
+    clear(w);
+    w->fd = inotify_init1(IN_CLOEXEC);
+    if(w->fd < 0) {
+        LOG_ERR("Failed to initialize inotify: %s\n", strerror(errno));
+        return false;
+    }
+    ARRAY_FOR(i, *paths) {
+        const char *path = ARRAY_GET_AS(const char *, paths, i);
+        const char *slash = strrchr(path, '/');
+        String directory = slash ? stringNCopy(path, slash == path ? 1 : (usize)(slash - path)) : stringCopy(".");
+        const char *name = slash ? slash + 1 : path;
+        // Adding the same directory again returns the same watch descriptor.
+        int wd = inotify_add_watch(w->fd, directory, WATCH_EVENTS);
+        if(wd < 0) {
+            LOG_ERR("Failed to watch '%s': %s\n", directory, strerror(errno));
+            stringFree(directory);
+            clear(w);
+            return false;
+        }
+        String file = stringFormat("%s/%s", directory, name);
+        if(tableGet(&w->files, (void *)file) == NULL) {
+            tableSet(&w->files, (void *)file, NULL);
+        } else {
+            stringFree(file);
+        }
+        TableItem *item = tableGet(&w->directories, (void *)(usize)wd);
+        if(item == NULL) {
+            tableSet(&w->directories, (void *)(usize)wd, (void *)directory);
+        } else {
+            stringFree(directory);
+        }
+    }
+    return true;
+}
+
+// Read the pending events and check if any of them is about a watched file.
+// Blocks until there are events to read.
+static bool read_events(Watcher *w, bool *changed) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    isize length = read(w->fd, buffer, sizeof(buffer));
+    if(length < 0) {
+        if(errno == EINTR) {
+            return true;
+        }
+        LOG_ERR("Failed to read inotify events: %s\n", strerror(errno));
+        return false;
+    }
+    for(char *p = buffer; p < buffer + length; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+        struct inotify_event *event = (struct inotify_event *)p;
+        TableItem *item = tableGet(&w->directories, (void *)(usize)event->wd);
+        if(item == NULL || event->len == 0) {
+            continue;
+        }
+        String file = stringFormat("%s/%s", (String)item->value, event->name);
+        *changed = *changed || tableGet(&w->files, (void *)file) != NULL;
+        stringFree(file);
+    }
+    return true;
+}
+
+bool watcherWait(Watcher *w) {
+    VERIFY(w->fd >= 0);
+    bool changed = false;
+    while(!changed) {
+        if(!read_events(w, &changed)) {
+            return false;
+        }
+    }
+    // Let the rest of the changes (e.g. saving many files at once) settle.
+    struct pollfd pfd = {.fd = w->fd, .events = POLLIN};
+    while(poll(&pfd, 1, WATCHER_SETTLE_MS) > 0) {
+        if(!read_events(w, &changed)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h> // memcpy(), strlen()
+#include <errno.h>
+#include <unistd.h> // write()
+#include <sys/uio.h> // writev()
+#include "common.h"
+#include "memory.h"
+#include "Writer.h"
+
+void writerInit(Writer *w, int fd, usize capacity) {
+    w->fd = fd;
+    w->capacity = capacity > 0 ? capacity : WRITER_DEFAULT_CAPACITY;
+    w->buffer = ALLOC(w->capacity);
+    w->length = 0;
+    w->hadError = false;
+}
+
+void writerInitMemory(Writer *w, usize capacity) {
+    writerInit(w, -1, capacity);
+}
+
+const char *writerData(Writer *w, usize *length) {
+    VERIFY(w->fd < 0);
+    *length = w->length;
+    return w->buffer;
+}
+
+void writerClear(Writer *w) {
+    VERIFY(w->fd < 0);
+    w->length = 0;
+}
+
+bool writerFree(Writer *w) {
+    bool success = writerFlush(w);
+    FREE(w->buffer);
+    w->buffer = NULL;
+    w->length = w->capacity = 0;
+    w->fd = -1;
+    return success;
+}
+
+// Write all of [iov] handling partial writes and interrupts.
+static bool write_all(Writer *w, struct iovec *iov, int iovcnt) {
+    while(iovcnt > 0) {
+        isize written = writev(w->fd, iov, iovcnt);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        // Skip the fully written buffers and adjust the partially written one.
+        while(iovcnt > 0 && (usize)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if(iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+// Make room for at least [needed] more bytes in an in-memory Writer.
+static void grow(Writer *w, usize needed) {
+    usize new_capacity = w->capacity * 2;
+    if(new_capacity < w->length + needed) {
+        new_capacity = w->length + needed;
+    }
+    w->buffer = REALLOC(w->buffer, new_capacity);
+    w->capacity = new_capacity;
+}
+
+// Write the buffered output followed by [data] (which is NOT copied into the buffer).
+static void flush_with(Writer *w, const char *data, usize length) {
+    VERIFY(w->fd >= 0);
+    if(w->hadError) {
+        w->length = 0;
+        return;
+    }
+    struct iovec iov[2] = {
+        {.iov_base = w->buffer, .iov_len = w->length},
+        {.iov_base = (void *)data, .iov_len = length}
+    };
+    if(!write_all(w, iov, length > 0 ? 2 : 1)) {
+        w->hadError = true;
+    }
+    w->length = 0;
+}
+
+bool writerFlush(Writer *w) {
+    if(w->fd >= 0 && w->length > 0) {
+        flush_with(w, NULL, 0);
+    }
+    return !w->hadError;
+}
+
+void writerWrite(Writer *w, const char *data, usize length) {
+    if(w->length + length <= w->capacity) {
+        memcpy(w->buffer + w->length, data, length);
+        w->length += length;
+        return;
+    }
+    if(w->fd < 0) {
+        grow(w, length);
+        memcpy(w->buffer + w->length, data, length);
+        w->length += length;
+        return;
+    }
+    if(length >= w->capacity / 2) {
+        // Big chunks are written directly together with the buffered output.
+        flush_with(w, data, length);
+        return;
+    }
+    flush_with(w, NULL, 0);
+    memcpy(w->buffer, data, length);
+    w->length = length;
+}
+
+void writerWriteChar(Writer *w, char c) {
+    if(w->length == w->capacity) {
+        if(w->fd < 0) {
+            grow(w, 1);
+        } else {
+            flush_with(w, NULL, 0);
+        }
+    }
+    w->buffer[w->length++] = c;
+}
+
+void writerWriteCString(Writer *w, const char *s) {
+    writerWrite(w, s, strlen(s));
+}
+
+void writerWriteUnsigned(Writer *w, u64 value) {
+    // The largest u64 has 20 digits.
+    char digits[20];
+    usize i = sizeof(digits);
+    do {
+        digits[--i] = '0' + (value % 10);
+        value /= 10;
+    } while(value > 0);
+    writerWrite(w, digits + i, sizeof(digits) - i);
+}
+
+void writerWriteSigned(Writer *w, i64 value) {
+    if(value < 0) {
+        writerWriteChar(w, '-');
+        // Negate as unsigned so INT64_MIN doesn't overflow.
+        writerWriteUnsigned(w, -(u64)value);
+        return;
+    }
+    writerWriteUnsigned(w, (u64)value);
+}
+
+void writerVFormat(Writer *w, const char *format, va_list ap) {
+    va_list copy;
+    va_copy(copy, ap);
+    usize available = w->capacity - w->length;
+    int needed_length = vsnprintf(w->buffer + w->length, available, format, copy);
+    va_end(copy);
+    VERIFY(needed_length >= 0);
+    if((usize)needed_length < available) {
+        w->length += needed_length;
+        return;
+    }
+    // Didn't fit (vsnprintf() needs room for the nul terminator as well.)
+    if(w->fd < 0) {
+        grow(w, needed_length + 1);
+        w->length += vsnprintf(w->buffer + w->length, w->capacity - w->length, format, ap);
+        return;
+    }
+    flush_with(w, NULL, 0);
+    if((usize)needed_length < w->capacity) {
+        w->length = vsnprintf(w->buffer, w->capacity, format, ap);
+        return;
+    }
+    char *tmp = ALLOC(needed_length + 1);
+    vsnprintf(tmp, needed_length + 1, format, ap);
+    writerWrite(w, tmp, needed_length);
+    FREE(tmp);
+}
+
+void writerFormat(Writer *w, const char *format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    writerVFormat(w, format, ap);
+    va_end(ap);
+}
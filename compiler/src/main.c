@@ -1,15 +1,30 @@
 #include <stdio.h>
+#include <time.h> // clock_gettime()
 #include <getopt.h>
+#include <stdlib.h> // strtoul(), getenv()
+#include <string.h> // strcmp()
+#include <unistd.h> // getcwd()
+#include <sys/stat.h> // stat()
 #include "common.h"
 #include "memory.h"
+#include "Table.h"
 #include "Token.h"
 #include "Ast/Program.h"
 #include "Compiler.h"
-#include "Scanner.h"
 #include "Parser.h"
 #include "Validator.h"
 #include "Typechecker.h"
+#include "FrontEnd.h"
 #include "Codegen.h"
+#include "Reachability.h"
+#include "Ir/Ir.h"
+#include "Ir/Lower.h"
+#include "Ir/Pass.h"
+#include "ThreadPool.h"
+#include "Driver.h"
+#include "BuildState.h"
+#include "Daemon.h"
+#include "Watcher.h"
 
 enum return_values {
     RET_SUCCESS = 0,
@@ -17,7 +32,8 @@ enum return_values {
     RET_PARSE_FAILURE,
     RET_VALIDATE_FAILURE,
     RET_TYPECHECK_FAILURE,
-    RET_CODEGEN_FAILURE
+    RET_CODEGEN_FAILURE,
+    RET_BUILD_FAILURE
 };
 
 typedef struct options {
@@ -25,6 +41,23 @@ typedef struct options {
     bool dump_parsed_ast;
     bool dump_checked_ast;
     bool dump_tokens;
+    bool dump_ir;
+    bool fused_check;
+    bool report_unreachable;
+    const char *modules_dir; // NULL if not set.
+    usize jobs;
+    bool watch;
+    bool expect_checks;
+    // 'build' command options.
+    bool build;
+    const char *output;
+    const char *cc;
+    const char *build_dir; // NULL if not set.
+    bool quiet;
+    const char *cache_dir; // NULL for the default.
+    bool no_cache;
+    u64 cache_size;
+    bool unity;
 } Options;
 
 bool parse_arguments(Options *opts, int argc, char **argv) {
@@ -33,18 +66,51 @@ bool parse_arguments(Options *opts, int argc, char **argv) {
         {"dump-parsed-ast",  no_argument, 0, 'p'},
         {"dump-checked-ast", no_argument, 0, 'd'},
         {"dump-tokens",      no_argument, 0, 't'},
+        {"dump-ir",          no_argument, 0, 'i'},
+        {"fused-check",      no_argument, 0, 'f'},
+        {"report-unreachable", no_argument, 0, 'r'},
+        {"emit-modules",     required_argument, 0, 'm'},
+        {"jobs",             required_argument, 0, 'j'},
+        {"watch",            no_argument, 0, 'w'},
+        {"no-expect-checks", no_argument, 0, 'e'},
+        {"output",           required_argument, 0, 'o'},
+        {"cc",               required_argument, 0, 'c'},
+        {"build-dir",        required_argument, 0, 'b'},
+        {"quiet",            no_argument, 0, 'q'},
+        {"cache-dir",        required_argument, 0, 'C'},
+        {"cache-size",       required_argument, 0, 's'},
+        {"no-cache",         no_argument, 0, 'n'},
+        {"unity",            no_argument, 0, 'u'},
         {0,                  0,           0,  0}
     };
     int c;
-    while((c = getopt_long(argc, argv, "hpdt", long_options, NULL)) != -1) {
+    while((c = getopt_long(argc, argv, "hpdtifrm:j:weo:c:b:qC:s:nu", long_options, NULL)) != -1) {
         switch(c) {
             case 'h':
                 printf("Usage: %s [options] file\n", argv[0]);
+                printf("       %s build [options] [build options] file\n", argv[0]);
+                printf("       %s daemon socket\n", argv[0]);
                 printf("Options:\n");
                 printf("\t--help,             -h    Print this help.\n");
                 printf("\t--dump-parsed-ast,  -p    Dump the parsed AST.\n");
                 printf("\t--dump-checked-ast, -d    Dump the parsed, validated & typechecked AST.\n");
                 printf("\t--dump-tokens,      -t    Dump the scanned tokens.\n");
+                printf("\t--dump-ir,          -i    Dump the IR (after the default passes).\n");
+                printf("\t--fused-check,      -f    Validate & typecheck in a single pass.\n");
+                printf("\t--report-unreachable, -r  Print how much unreachable code was left out of the generated C code.\n");
+                printf("\t--emit-modules dir, -m    Write a C source file and header per module to 'dir' instead of printing the C code.\n");
+                printf("\t--jobs N,           -j    Generate (and compile when building) up to N modules in parallel (default: amount of CPU cores).\n");
+                printf("\t--watch,            -w    Compile again whenever a source file changes.\n");
+                printf("\t--no-expect-checks, -e    Don't check expect statements without an else body (their conditions are still evaluated).\n");
+                printf("Build options:\n");
+                printf("\t--output file,      -o    The executable to build (default: a.out).\n");
+                printf("\t--cc command,       -c    The C compiler to use (default: $CC or '" DRIVER_DEFAULT_CC "').\n");
+                printf("\t--build-dir dir,    -b    Where to put the generated C code & object files (default: <output>.build).\n");
+                printf("\t--quiet,            -q    Don't print the compile times & object cache statistics.\n");
+                printf("\t--cache-dir dir,    -C    The object cache directory (default: $ILC_CACHE_DIR, $XDG_CACHE_HOME/ilc, or ~/.cache/ilc).\n");
+                printf("\t--cache-size MiB,   -s    The maximum size of the object cache (default: %d MiB).\n", (int)(OBJECT_CACHE_DEFAULT_MAX_SIZE / (1024 * 1024)));
+                printf("\t--no-cache,         -n    Don't use the object cache.\n");
+                printf("\t--unity,            -u    Compile the whole program as a single C file (slower to rebuild, but faster code).\n");
                 return false;
             case 'p':
                 opts->dump_parsed_ast = true;
@@ -55,6 +121,70 @@ bool parse_arguments(Options *opts, int argc, char **argv) {
             case 't':
                 opts->dump_tokens = true;
                 break;
+            case 'i':
+                opts->dump_ir = true;
+                break;
+            case 'f':
+                opts->fused_check = true;
+                break;
+            case 'r':
+                opts->report_unreachable = true;
+                break;
+            case 'm':
+                opts->modules_dir = optarg;
+                break;
+            case 'w':
+                opts->watch = true;
+                break;
+            case 'e':
+                opts->expect_checks = false;
+                break;
+            case 'j': {
+                char *end = NULL;
+                unsigned long jobs = strtoul(optarg, &end, 10);
+                if(*optarg == '\0' || *end != '\0' || jobs == 0) {
+                    fprintf(stderr, "Invalid amount of jobs '%s'!\n", optarg);
+                    return false;
+                }
+                opts->jobs = (usize)jobs;
+                break;
+            }
+            case 'o':
+            case 'c':
+            case 'b':
+            case 'q':
+            case 'C':
+            case 's':
+            case 'n':
+            case 'u':
+                if(!opts->build) {
+                    fprintf(stderr, "Option '-%c' is only valid with the 'build' command!\n", c);
+                    return false;
+                }
+                if(c == 'o') {
+                    opts->output = optarg;
+                } else if(c == 'c') {
+                    opts->cc = optarg;
+                } else if(c == 'b') {
+                    opts->build_dir = optarg;
+                } else if(c == 'q') {
+                    opts->quiet = true;
+                } else if(c == 'C') {
+                    opts->cache_dir = optarg;
+                } else if(c == 's') {
+                    char *end = NULL;
+                    unsigned long long size = strtoull(optarg, &end, 10);
+                    if(*optarg == '\0' || *end != '\0') {
+                        fprintf(stderr, "Invalid cache size '%s'!\n", optarg);
+                        return false;
+                    }
+                    opts->cache_size = (u64)size * 1024 * 1024;
+                } else if(c == 'n') {
+                    opts->no_cache = true;
+                } else {
+                    opts->unity = true;
+                }
+                break;
             default:
                 return false;
         }
@@ -71,93 +201,523 @@ bool parse_arguments(Options *opts, int argc, char **argv) {
     return true;
 }
 
-int main(int argc, char **argv) {
-    int return_value = RET_SUCCESS;
-    StringTable stringTable;
-    ASTProgram parsedProgram, checkedProgram;
-    Compiler c;
-    Scanner s;
-    Parser p;
-    Validator v;
-    Typechecker typ;
-    stringTableInit(&stringTable);
-    astProgramInit(&parsedProgram, &stringTable);
-    astProgramInit(&checkedProgram, &stringTable);
-    compilerInit(&c);
-    scannerInit(&s, &c);
-    parserInit(&p, &c, &s);
-    validatorInit(&v, &c);
-    typecheckerInit(&typ, &c);
-
-    Options opts = {
+// Validate, typecheck & evaluate (see Evaluator.h) the parsed program.
+// Returns RET_SUCCESS, or the return value for the failed stage (errors are already printed.)
+static int check_program(FrontEnd *fe) {
+    if(!validatorValidate(&fe->validator, &fe->parsedProgram, &fe->checkedProgram)) {
+        if(compilerHadError(&fe->compiler)) {
+            compilerPrintErrors(&fe->compiler);
+        } else {
+            fputs("\x1b[1;31mError:\x1b[0m Validator failed with no errors!\n", stderr);
+        }
+        return RET_VALIDATE_FAILURE;
+    }
+
+    if(!typecheckerTypecheck(&fe->typechecker, &fe->checkedProgram)) {
+        if(compilerHadError(&fe->compiler)) {
+            compilerPrintErrors(&fe->compiler);
+        } else {
+            fputs("\x1b[1;31mError:\x1b[0m Typechecker failed with no errors!\n", stderr);
+        }
+        return RET_TYPECHECK_FAILURE;
+    }
+
+    if(!evaluatorEvaluate(&fe->evaluator, &fe->checkedProgram)) {
+        compilerPrintErrors(&fe->compiler);
+        return RET_TYPECHECK_FAILURE;
+    }
+    return RET_SUCCESS;
+}
+
+// Parse the function bodies the parser skipped in the modules that are about to be generated,
+// and check the program again (see BuildOptions::beforeGenerate).
+static bool parse_skipped_bodies(void *front_end, ASTProgram *prog, bool *modules) {
+    FrontEnd *fe = (FrontEnd *)front_end;
+    bool parsedBodies = false;
+    for(usize i = 0; i < arrayLength(&prog->modules); ++i) {
+        ASTString name = astProgramGetModule(prog, (ModuleID)i)->name;
+        if(!modules[i] || !parserHasSkippedBodies(&fe->parser, name)) {
+            continue;
+        }
+        if(!parserParseSkippedBodies(&fe->parser, name)) {
+            compilerPrintErrors(&fe->compiler);
+            return false;
+        }
+        parsedBodies = true;
+    }
+    if(!parsedBodies) {
+        return true;
+    }
+    // The checked program doesn't have the new bodies, so it's checked again from scratch.
+    frontEndResetChecker(fe);
+    return check_program(fe) == RET_SUCCESS;
+}
+
+/* Daemon (see Daemon.h) */
+
+#define WARM_MAX_PROGRAMS 16
+
+// The fingerprint of a source file a cached program was compiled from.
+typedef struct source_stamp {
+    String path;
+    struct timespec mtime;
+    off_t size;
+    char hash[SHA256_HEX_SIZE];
+} SourceStamp;
+
+// A checked program kept warm by the daemon.
+typedef struct cached_program {
+    String key; // The working directory, the main file & the front end options.
+    FrontEnd *frontEnd;
+    StringTable *strings; // The strings of the program (freed with it.)
+    Array sources; // Array<SourceStamp *>
+} CachedProgram;
+
+// The state a daemon keeps between requests.
+typedef struct warm_state {
+    Array programs; // Array<CachedProgram *> (the most recently used one is last.)
+} WarmState;
+
+static void free_cached_program(CachedProgram *cp) {
+    ARRAY_FOR(i, cp->sources) {
+        SourceStamp *stamp = ARRAY_GET_AS(SourceStamp *, &cp->sources, i);
+        stringFree(stamp->path);
+        FREE(stamp);
+    }
+    arrayFree(&cp->sources);
+    frontEndFree(cp->frontEnd);
+    stringTableFree(cp->strings);
+    FREE(cp->strings);
+    stringFree(cp->key);
+    FREE(cp);
+}
+
+// Returns NULL if the working directory can't be read.
+static String warm_key(Options *opts) {
+    char cwd[4096];
+    if(getcwd(cwd, sizeof(cwd)) == NULL) {
+        return NULL;
+    }
+    return stringFormat("%s\n%s\n%d", cwd, opts->file_path, opts->fused_check);
+}
+
+// Check if a source file is unchanged: the modification time & size are checked first,
+// and the contents are only hashed if they differ.
+static bool source_unchanged(SourceStamp *stamp) {
+    struct stat st;
+    if(stat(stamp->path, &st) < 0) {
+        return false;
+    }
+    if(st.st_mtim.tv_sec == stamp->mtime.tv_sec && st.st_mtim.tv_nsec == stamp->mtime.tv_nsec && st.st_size == stamp->size) {
+        return true;
+    }
+    char hash[SHA256_HEX_SIZE];
+    if(!buildStateHashSource(stamp->path, hash) || strcmp(hash, stamp->hash) != 0) {
+        return false;
+    }
+    // Only touched, no need to hash it again next time.
+    stamp->mtime = st.st_mtim;
+    stamp->size = st.st_size;
+    return true;
+}
+
+// Find the cached program for [key] if all its sources are unchanged.
+// Outdated programs are dropped.
+static CachedProgram *warm_state_find(WarmState *warm, const char *key) {
+    ARRAY_FOR(i, warm->programs) {
+        CachedProgram *cp = ARRAY_GET_AS(CachedProgram *, &warm->programs, i);
+        if(strcmp(cp->key, key) != 0) {
+            continue;
+        }
+        arrayDelete(&warm->programs, i);
+        bool fresh = true;
+        for(usize j = 0; fresh && j < arrayLength(&cp->sources); ++j) {
+            fresh = source_unchanged(ARRAY_GET_AS(SourceStamp *, &cp->sources, j));
+        }
+        if(!fresh) {
+            free_cached_program(cp);
+            return NULL;
+        }
+        arrayPush(&warm->programs, (void *)cp);
+        return cp;
+    }
+    return NULL;
+}
+
+// Cache a successfully compiled program (ownership of [key], [fe] & [strings] is taken.)
+static void warm_state_add(WarmState *warm, String key, FrontEnd *fe, StringTable *strings) {
+    CachedProgram *cp;
+    NEW0(cp);
+    cp->key = key;
+    cp->frontEnd = fe;
+    cp->strings = strings;
+    arrayInit(&cp->sources);
+    ARRAY_FOR(i, fe->compiler.files) {
+        File *f = ARRAY_GET_AS(File *, &fe->compiler.files, i);
+        SourceStamp *stamp;
+        NEW0(stamp);
+        stamp->path = stringCopy(f->path);
+        struct stat st;
+        // Sources that can't be read are always outdated.
+        if(stat(f->path, &st) < 0 || !buildStateHashSource(f->path, stamp->hash)) {
+            stamp->hash[0] = '\0';
+        } else {
+            stamp->mtime = st.st_mtim;
+            stamp->size = st.st_size;
+        }
+        arrayPush(&cp->sources, (void *)stamp);
+    }
+    if(arrayLength(&warm->programs) == WARM_MAX_PROGRAMS) {
+        free_cached_program((CachedProgram *)arrayDelete(&warm->programs, 0));
+    }
+    arrayPush(&warm->programs, (void *)cp);
+}
+
+/* Compiling */
+
+// Parse a command line into [opts].
+// Returns false if the arguments are invalid (or the help was printed.)
+static bool parse_command(Options *opts, int argc, char **argv) {
+    *opts = (Options){
         .file_path = "./test.ilc",
         .dump_parsed_ast = false,
         .dump_checked_ast = false,
-        .dump_tokens = false
+        .dump_tokens = false,
+        .dump_ir = false,
+        .fused_check = false,
+        .report_unreachable = false,
+        .modules_dir = NULL,
+        .jobs = threadPoolDefaultSize(),
+        .watch = false,
+        .expect_checks = true,
+        .build = false,
+        .output = "a.out",
+        .cc = getenv("CC") ? getenv("CC") : DRIVER_DEFAULT_CC,
+        .build_dir = NULL,
+        .quiet = false,
+        .cache_dir = NULL,
+        .no_cache = false,
+        .cache_size = OBJECT_CACHE_DEFAULT_MAX_SIZE,
+        .unity = false
     };
-    if(!parse_arguments(&opts, argc, argv)) {
-        return_value = RET_ARG_PARSE_FAILURE;
-        goto end;
+    if(argc > 1 && strcmp(argv[1], "build") == 0) {
+        opts->build = true;
+        // Parse the rest of the arguments as if 'build' wasn't there.
+        argv[1] = argv[0];
+        argc--;
+        argv++;
     }
+    // Fully reinitialize getopt (the daemon parses many command lines.)
+    optind = 0;
+    return parse_arguments(opts, argc, argv);
+}
 
-    if(opts.dump_tokens) {
-        parserSetDumpTokens(&p, true);
+// Add the source files of the program compiled by [fe] to [sources] (Array<String>, owned Strings.)
+static void collect_sources(FrontEnd *fe, Array *sources) {
+    ARRAY_FOR(i, fe->compiler.files) {
+        arrayPush(sources, (void *)stringCopy(ARRAY_GET_AS(File *, &fe->compiler.files, i)->path));
     }
+}
 
-    compilerAddFile(&c, opts.file_path);
+static void collect_interface_source_callback(TableItem *item, bool is_last, void *sources) {
+    UNUSED(is_last);
+    // Imported modules are always found at "<name>.ilc" (see parseModuleBody().)
+    arrayPush((Array *)sources, (void *)stringFormat("%s.ilc", (const char *)item->key));
+}
 
-    if(!parserParse(&p, &parsedProgram)) {
-        if(compilerHadError(&c)) {
-            compilerPrintErrors(&c);
-        } else {
-            fputs("\x1b[1;31mError:\x1b[0m Parser failed with no errors!\n", stderr);
+// Compile a program.
+// [warm] is the state kept between compilations (NULL if there is none.)
+// If [sources] isn't NULL, the paths of all the source files that were used are added to it (Array<String>, owned Strings.)
+static int compile(Options *o, WarmState *warm, Array *sources) {
+    int return_value = RET_SUCCESS;
+    String build_dir = NULL;
+    String key = NULL;
+    // Every program has its own strings, so they are freed along with it.
+    StringTable *strings = NULL;
+    FrontEnd *fe = NULL;
+    CachedProgram *cached = NULL;
+    // The options may be used many times (see watch()), so they aren't changed.
+    Options opts = *o;
+
+    BuildOptions build_opts = {
+        .mainFile = opts.file_path,
+        .cc = opts.cc,
+        .buildDir = NULL,
+        .output = opts.output,
+        .jobs = opts.jobs,
+        .printTimes = !opts.quiet,
+        .unity = opts.unity,
+        .expectChecks = opts.expect_checks,
+        .cache = NULL,
+        .beforeGenerate = parse_skipped_bodies,
+        .beforeGenerateContext = NULL
+    };
+    if(opts.build) {
+        build_dir = opts.build_dir ? stringCopy(opts.build_dir) : stringFormat("%s.build", opts.output);
+        build_opts.buildDir = build_dir;
+        if(driverIsUpToDate(&build_opts)) {
+            if(!opts.quiet) {
+                LOG_MSG("'%s' is up to date.\n", opts.output);
+            }
+            if(sources) {
+                // Nothing was parsed, but the sources are the same as in the previous build.
+                BuildState state;
+                buildStateInit(&state);
+                String path = stringFormat("%s/" BUILD_STATE_FILE_NAME, build_dir);
+                if(buildStateLoad(&state, path)) {
+                    ARRAY_FOR(i, state.modules) {
+                        arrayPush(sources, (void *)stringCopy(ARRAY_GET_AS(ModuleState *, &state.modules, i)->path));
+                    }
+                }
+                stringFree(path);
+                buildStateFree(&state);
+            }
+            goto end;
         }
-        return_value = RET_PARSE_FAILURE;
-        goto end;
     }
 
-    if(opts.dump_parsed_ast) {
-        printf("====== PARSED AST DUMP for '%s' ======\n", opts.file_path);
-        astProgramPrint(stdout, &parsedProgram);
-        puts("\n====== END ======"); // prints newline.
+    // Builds are incremental on their own (see Driver.h), and the tokens can only be dumped when scanning.
+    if(warm && !opts.build && !opts.dump_tokens && (key = warm_key(&opts)) != NULL) {
+        cached = warm_state_find(warm, key);
+    }
+    if(cached) {
+        fe = cached->frontEnd;
+    } else {
+        NEW0(strings);
+        stringTableInit(strings);
+        fe = frontEndNew(strings);
     }
+    build_opts.beforeGenerateContext = (void *)fe;
 
-    if(!validatorValidate(&v, &parsedProgram, &checkedProgram)) {
-        if(compilerHadError(&c)) {
-            compilerPrintErrors(&c);
-        } else {
-            fputs("\x1b[1;31mError:\x1b[0m Validator failed with no errors!\n", stderr);
+    if(!cached) {
+        if(opts.build) {
+            driverFindModuleInterfaces(&build_opts, &fe->interfaces, &fe->skipBodies);
+            parserSetModuleInterfaces(&fe->parser, &fe->interfaces);
+            parserSetSkipBodies(&fe->parser, &fe->skipBodies);
         }
-        return_value = RET_VALIDATE_FAILURE;
-        goto end;
-    }
 
-    if(!typecheckerTypecheck(&typ, &checkedProgram)) {
-        if(compilerHadError(&c)) {
-            compilerPrintErrors(&c);
-        } else {
-            fputs("\x1b[1;31mError:\x1b[0m Typechecker failed with no errors!\n", stderr);
+        if(opts.dump_tokens) {
+            parserSetDumpTokens(&fe->parser, true);
         }
-        return_value = RET_TYPECHECK_FAILURE;
+
+        if(opts.fused_check) {
+            frontEndSetFusedCheck(fe, true);
+        }
+
+        compilerAddFile(&fe->compiler, opts.file_path);
+
+        if(!parserParse(&fe->parser, &fe->parsedProgram)) {
+            if(compilerHadError(&fe->compiler)) {
+                compilerPrintErrors(&fe->compiler);
+            } else {
+                fputs("\x1b[1;31mError:\x1b[0m Parser failed with no errors!\n", stderr);
+            }
+            return_value = RET_PARSE_FAILURE;
+            goto end;
+        }
+    }
+
+    if(opts.dump_parsed_ast) {
+        printf("====== PARSED AST DUMP for '%s' ======\n", opts.file_path);
+        astProgramPrint(stdout, &fe->parsedProgram);
+        puts("\n====== END ======"); // prints newline.
+    }
+
+    if(!cached && (return_value = check_program(fe)) != RET_SUCCESS) {
         goto end;
     }
 
     if(opts.dump_checked_ast) {
         printf("====== CHECKED AST DUMP for '%s' ======\n", opts.file_path);
-        astProgramPrint(stdout, &checkedProgram);
+        astProgramPrint(stdout, &fe->checkedProgram);
         puts("\n====== END ======"); // prints newline.
     }
 
-    codegenGenerate(stdout, &checkedProgram);
+    if(opts.dump_ir) {
+        printf("====== IR DUMP for '%s' ======\n", opts.file_path);
+        IrProgram ir;
+        irLowerProgram(&fe->checkedProgram, &ir, opts.expect_checks);
+        IrPassManager pm;
+        irPassManagerInit(&pm);
+        // The IR being looked at is always verified.
+        pm.verify = true;
+        irPassManagerAddDefaultPasses(&pm);
+        irPassManagerRunOnProgram(&pm, &ir);
+        irPassManagerFree(&pm);
+        irProgramPrint(stdout, &ir);
+        irProgramFree(&ir);
+        puts("====== END ======");
+    }
+
+    if(opts.build) {
+        ObjectCache cache;
+        String cache_dir = NULL;
+        if(!opts.no_cache) {
+            cache_dir = opts.cache_dir ? stringCopy(opts.cache_dir) : objectCacheDefaultDir();
+        }
+        // Building without the cache is still possible if it can't be used.
+        if(cache_dir && objectCacheInit(&cache, cache_dir, opts.cache_size)) {
+            build_opts.cache = &cache;
+        }
+        bool success = driverBuild(&build_opts, &fe->compiler, &fe->checkedProgram);
+        if(build_opts.cache) {
+            objectCacheFree(&cache);
+        }
+        if(cache_dir) {
+            stringFree(cache_dir);
+        }
+        if(!success) {
+            return_value = RET_BUILD_FAILURE;
+            goto end;
+        }
+    } else if(opts.modules_dir) {
+        if(!codegenGenerateModules(opts.modules_dir, &fe->checkedProgram, opts.jobs, NULL, opts.expect_checks)) {
+            return_value = RET_CODEGEN_FAILURE;
+            goto end;
+        }
+    } else {
+        // Only what the entry point can reach is generated when generating the whole program at once.
+        Reachability reachable;
+        reachabilityInit(&reachable);
+        reachabilityAnalyze(&reachable, &fe->checkedProgram);
+        if(opts.report_unreachable) {
+            reachabilityPrintSummary(stderr, &reachable);
+        }
+        bool success = codegenGenerate(stdout, &fe->checkedProgram, opts.jobs, &reachable, opts.expect_checks);
+        reachabilityFree(&reachable);
+        if(!success) {
+            fputs("\x1b[1;31mError:\x1b[0m Failed to write the generated code!\n", stderr);
+            return_value = RET_CODEGEN_FAILURE;
+            goto end;
+        }
+    }
+
+    if(key && !cached) {
+        warm_state_add(warm, key, fe, strings);
+        key = NULL;
+        fe = NULL;
+        strings = NULL;
+    }
 
 end:
-    typecheckerFree(&typ);
-    validatorFree(&v);
-    parserFree(&p);
-    scannerFree(&s);
-    compilerFree(&c);
-    astProgramFree(&checkedProgram);
-    astProgramFree(&parsedProgram);
-    stringTableFree(&stringTable);
+    if(sources && fe) {
+        collect_sources(fe, sources);
+        tableMap(&fe->interfaces, collect_interface_source_callback, (void *)sources);
+    }
+    if(build_dir) {
+        stringFree(build_dir);
+    }
+    if(key) {
+        stringFree(key);
+    }
+    if(fe && !cached) {
+        frontEndFree(fe);
+    }
+    if(strings) {
+        stringTableFree(strings);
+        FREE(strings);
+    }
     return return_value;
 }
+
+static void warm_state_init(WarmState *warm) {
+    arrayInit(&warm->programs);
+}
+
+static void warm_state_free(WarmState *warm) {
+    ARRAY_FOR(i, warm->programs) {
+        free_cached_program(ARRAY_GET_AS(CachedProgram *, &warm->programs, i));
+    }
+    arrayFree(&warm->programs);
+}
+
+static f64 milliseconds_since(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)(now.tv_sec - start->tv_sec) * 1000.0 + (f64)(now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static void free_string_callback(void *s, void *cl) {
+    UNUSED(cl);
+    stringFree((String)s);
+}
+
+// Compile the program, and then compile it again whenever any of its source files changes.
+// Only returns on failure.
+// Note: A rebuild only happens after a source changed, so the checked program of the previous one
+//       is always outdated and the whole program is checked again (nothing is kept between rebuilds). 'ilc build --watch' still only regenerates the affected modules (see Driver.h).
+static int watch(Options *opts) {
+    Watcher watcher;
+    watcherInit(&watcher);
+    Array sources; // Array<String>
+    arrayInit(&sources);
+    bool watching = true;
+    while(watching) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int status = compile(opts, NULL, &sources);
+        // The main file is watched even if it couldn't be read.
+        arrayPush(&sources, (void *)stringCopy(opts->file_path));
+        fflush(stdout);
+        LOG_MSG("%s '%s' in %.2f ms, watching %zu files for changes...\n",
+                status == RET_SUCCESS ? "Compiled" : "Failed to compile", opts->file_path, milliseconds_since(&start), arrayLength(&sources) - 1);
+        watching = watcherSetFiles(&watcher, &sources) && watcherWait(&watcher);
+        arrayMap(&sources, free_string_callback, NULL);
+        arrayClear(&sources);
+    }
+    arrayFree(&sources);
+    watcherFree(&watcher);
+    return RET_BUILD_FAILURE;
+}
+
+static int daemon_handler(int argc, char **argv, void *warm) {
+    Options opts;
+    if(!parse_command(&opts, argc, argv)) {
+        return RET_ARG_PARSE_FAILURE;
+    }
+    if(opts.watch) {
+        // Watching is done by the client (see main()).
+        fputs("\x1b[1;31mError:\x1b[0m '--watch' can't be used with the daemon!\n", stderr);
+        return RET_ARG_PARSE_FAILURE;
+    }
+    return compile(&opts, (WarmState *)warm, NULL);
+}
+
+static int serve(const char *socketPath) {
+    WarmState warm;
+    warm_state_init(&warm);
+    bool success = daemonServe(socketPath, daemon_handler, (void *)&warm);
+    warm_state_free(&warm);
+    return success ? RET_SUCCESS : RET_ARG_PARSE_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    if(argc > 1 && strcmp(argv[1], "daemon") == 0) {
+        if(argc != 3) {
+            fprintf(stderr, "Usage: %s daemon socket\n", argv[0]);
+            return RET_ARG_PARSE_FAILURE;
+        }
+        return serve(argv[2]);
+    }
+    // The arguments are parsed by the daemon too, so they are parsed here on a copy.
+    char **args = CALLOC((usize)argc + 1, sizeof(*args));
+    memcpy(args, argv, sizeof(*args) * (usize)argc);
+    Options opts;
+    bool parsed = parse_command(&opts, argc, args);
+    FREE(args);
+    if(!parsed) {
+        return RET_ARG_PARSE_FAILURE;
+    }
+    if(opts.watch) {
+        return watch(&opts);
+    }
+
+    // Forward the command line to the daemon if there is one (and run it here otherwise.)
+    const char *socketPath = getenv(DAEMON_SOCKET_ENV);
+    int status;
+    if(socketPath && *socketPath && daemonForward(socketPath, argc, argv, &status)) {
+        return status;
+    }
+
+    return compile(&opts, NULL, NULL);
+}
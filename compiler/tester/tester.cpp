@@ -1,13 +1,47 @@
 #include <iostream>
+#include <iomanip>
 #include <string>
-#include <string_view>
 #include <filesystem>
 #include <exception>
 #include <vector>
 #include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <csignal>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#ifdef TESTER_IN_PROCESS
+#include "Ilc.h"
+#else
+typedef struct ilc_context IlcContext;
+#endif
 
 namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// A test is only flagged as slower than its baseline if it is also slower by at least this much,
+// so the noise in very fast tests doesn't fail them.
+static constexpr double MIN_REGRESSION_MS = 20.0;
+
+struct Options {
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    double timeout_seconds = 10.0;
+    std::string baseline_path; // Compare the times against this baseline (if not empty.)
+    std::string save_baseline_path; // Write the times to this baseline (if not empty.)
+    double tolerance_percent = 50.0;
+    bool in_process = false; // Compile the tests using libilc instead of running ilc.
+    size_t stress_programs = 0; // Compile this many generated programs instead of running the tests (in-process only.)
+};
 
 struct ParseError final : public std::exception {
     ParseError(const char *what) {
@@ -27,6 +61,9 @@ struct Test {
     std::string name, tester_output, output;
     fs::path path;
     bool compiler_failed = false, test_parsing_failed = false, output_doesnt_match = false;
+    bool timed_out = false, regressed = false;
+    bool build = false; // A build test (a directory with a 'steps' file, see run_build_step().)
+    double time_ms = 0.0; // The wall time of running ilc (all the steps for build tests.)
     struct {
         bool should_fail = false;
         bool should_succeed = false;
@@ -74,33 +111,75 @@ static unsigned number_width(unsigned value) {
     return width;
 }
 
+// The baseline is a text file with a line per test: <name> <wall time in ms>
+static std::map<std::string, double> load_baseline(const std::string &path) {
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    if(!file) {
+        throw std::runtime_error("Failed to open the baseline '" + path + "'");
+    }
+    std::string name;
+    double time_ms;
+    while(file >> name >> time_ms) {
+        baseline[name] = time_ms;
+    }
+    return baseline;
+}
+
 class Tester {
 public:
-    Tester() {}
+    Tester(std::string ilc_path, Options options) : ilc_path(std::move(ilc_path)), options(std::move(options)),
+                                                    worker_state(new WorkerState[this->options.jobs]) {}
     ~Tester() {}
     void add_test(Test &t) {
         tests.push_back({t, tests.size()});
     }
 
+    // Run the tests on [options.jobs] workers. The results are printed in order as they become available.
     void run() {
-        for(auto &[test, idx] : tests) {
-            std::string expected;
-            try {
-                expected = parse_expected(test);
-            } catch(ParseError &err) {
-                test.test_parsing_failed = true;
-                test.tester_output = err.what();
-                test_summary(test, idx);
-                continue;
+        if(!options.baseline_path.empty()) {
+            baseline = load_baseline(options.baseline_path);
+        }
+        std::sort(tests.begin(), tests.end(), [](auto &a, auto &b) { return a.first.name < b.first.name; });
+        for(size_t i = 0; i < tests.size(); ++i) {
+            tests[i].second = i;
+        }
+        auto start = Clock::now();
+        std::vector<bool> done(tests.size(), false);
+        std::mutex lock;
+        std::condition_variable finished;
+        std::atomic<size_t> next_test{0};
+        auto worker = [&](unsigned worker_index) {
+            IlcContext *ctx = new_context();
+            size_t i;
+            while((i = next_test++) < tests.size()) {
+                run_test(tests[i].first, ctx, worker_state[worker_index]);
+                std::lock_guard<std::mutex> guard(lock);
+                done[i] = true;
+                finished.notify_one();
             }
-            if(test.options.skip) {
-                test_summary(test, idx);
-                continue;
+            free_context(ctx);
+        };
+        std::vector<std::thread> workers;
+        for(unsigned i = 0; i < std::min<size_t>(options.jobs, tests.size()); ++i) {
+            workers.emplace_back(worker, i);
+        }
+        std::thread watchdog = start_watchdog();
+        for(auto &[test, idx] : tests) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                finished.wait(guard, [&done, idx = idx]() { return done[idx]; });
             }
-            execute(test);
-            check(test, expected);
             test_summary(test, idx);
         }
+        for(auto &w : workers) {
+            w.join();
+        }
+        stop_watchdog(watchdog);
+        total_time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if(!options.save_baseline_path.empty()) {
+            save_baseline(options.save_baseline_path);
+        }
     }
 
     void summary() {
@@ -109,17 +188,200 @@ public:
         std::cout << std::setw(width) << total_skipped_tests << '/' << tests.size() << " tests \x1b[33mskipped\x1b[0m.\n";
         std::cout << std::setw(width) << total_passed_tests << '/' << tests.size() << " tests \x1b[32mpassed\x1b[0m.\n";
         std::cout << std::setw(width) << total_failed_tests << '/' << tests.size() << " tests \x1b[31mfailed\x1b[0m.\n";
+        std::cout << "Ran in " << std::fixed << std::setprecision(2) << total_time_ms << " ms using " << options.jobs << " jobs"
+                  << (options.in_process ? " (in-process).\n" : ".\n");
     }
 
+    bool failed() const {
+        return total_failed_tests > 0;
+    }
+
+#ifdef TESTER_IN_PROCESS
+    // Compile [options.stress_programs] generated programs in-process and report the throughput.
+    // Every fourth program uses an undefined variable, and must fail with the matching diagnostic.
+    void stress() {
+        std::atomic<size_t> next_program{0}, failed_programs{0};
+        std::mutex lock;
+        std::string first_failure;
+        auto start = Clock::now();
+        auto worker = [&]() {
+            IlcContext *ctx = new_context();
+            size_t i;
+            while((i = next_program++) < options.stress_programs) {
+                std::string reason = stress_program(ctx, i);
+                if(!reason.empty()) {
+                    failed_programs++;
+                    std::lock_guard<std::mutex> guard(lock);
+                    if(first_failure.empty()) {
+                        first_failure = "program " + std::to_string(i) + ": " + reason;
+                    }
+                }
+            }
+            free_context(ctx);
+        };
+        std::vector<std::thread> workers;
+        for(unsigned i = 0; i < std::min<size_t>(options.jobs, options.stress_programs); ++i) {
+            workers.emplace_back(worker);
+        }
+        for(auto &w : workers) {
+            w.join();
+        }
+        total_time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        total_failed_tests = (int)failed_programs;
+        std::cout << "\x1b[1mStress:\x1b[0m compiled " << options.stress_programs << " generated programs in "
+                  << format_ms(total_time_ms) << " using " << options.jobs << " jobs ("
+                  << std::fixed << std::setprecision(0) << (double)options.stress_programs / (total_time_ms / 1000.0) << " programs/s).\n";
+        if(failed_programs > 0) {
+            std::cout << failed_programs << " programs \x1b[31mfailed\x1b[0m, the first one was " << first_failure << '\n';
+        }
+    }
+#endif
+
 private:
+    // The test a worker is running (used by the in-process watchdog.)
+    struct WorkerState {
+        std::atomic<long long> started_ns{0}; // 0 when the worker isn't running a test.
+        std::atomic<const Test *> test{nullptr};
+    };
+
+    IlcContext *new_context() {
+#ifdef TESTER_IN_PROCESS
+        if(options.in_process) {
+            return ilcContextNew();
+        }
+#endif
+        return nullptr;
+    }
+
+    void free_context(IlcContext *ctx) {
+#ifdef TESTER_IN_PROCESS
+        if(ctx) {
+            ilcContextFree(ctx);
+        }
+#else
+        (void)ctx;
+#endif
+    }
+
+    static long long now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // A compilation running in a thread can't be killed, so an in-process test that runs for
+    // longer than the timeout is reported and the tester exits.
+    std::thread start_watchdog() {
+        if(!options.in_process) {
+            return std::thread();
+        }
+        watchdog_running = true;
+        return std::thread([this]() {
+            long long timeout_ns = (long long)(options.timeout_seconds * 1e9);
+            std::unique_lock<std::mutex> guard(watchdog_lock);
+            while(!watchdog_stop.wait_for(guard, std::chrono::milliseconds(100), [this]() { return !watchdog_running; })) {
+                for(unsigned i = 0; i < options.jobs; ++i) {
+                    long long started = worker_state[i].started_ns;
+                    const Test *test = worker_state[i].test;
+                    if(started != 0 && test && now_ns() - started > timeout_ns) {
+                        std::cout << std::endl << test->name << ": \x1b[1;31mTimed out\x1b[0m after "
+                                  << format_ms(options.timeout_seconds * 1000.0) << " (in-process tests can't be stopped).\n";
+                        std::_Exit(1);
+                    }
+                }
+            }
+        });
+    }
+
+    void stop_watchdog(std::thread &watchdog) {
+        if(!watchdog.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(watchdog_lock);
+            watchdog_running = false;
+        }
+        watchdog_stop.notify_one();
+        watchdog.join();
+    }
+
+    void run_test(Test &test, IlcContext *ctx, WorkerState &state) {
+        std::string expected;
+        try {
+            // Build tests run ilc, so they can't run in-process.
+            test.options.skip = test.build && options.in_process;
+            expected = test.build ? "" : parse_expected(test);
+        } catch(ParseError &err) {
+            test.test_parsing_failed = true;
+            test.tester_output = err.what();
+            return;
+        }
+        if(test.options.skip) {
+            return;
+        }
+        if(test.build) {
+            execute_build(test);
+            if(test.timed_out) {
+                test.compiler_failed = true;
+                test.tester_output = "Timed out after " + format_ms(options.timeout_seconds * 1000.0) + ".";
+            } else {
+                check_time(test);
+            }
+            return;
+        }
+        if(ctx) {
+            state.test = &test;
+            state.started_ns = now_ns();
+            execute_in_process(test, ctx);
+            state.started_ns = 0;
+        } else {
+            execute(test);
+        }
+        if(test.timed_out) {
+            test.compiler_failed = true;
+            test.tester_output = "Timed out after " + format_ms(options.timeout_seconds * 1000.0) + ".";
+            return;
+        }
+        check(test, expected);
+        check_time(test);
+    }
+
+    void check_time(Test &test) {
+        auto it = baseline.find(test.name);
+        if(it == baseline.end() || test.compiler_failed || test.output_doesnt_match) {
+            return;
+        }
+        double allowed = it->second * (1.0 + options.tolerance_percent / 100.0);
+        if(test.time_ms > allowed && test.time_ms - it->second > MIN_REGRESSION_MS) {
+            test.regressed = true;
+            test.tester_output = "Compile time regressed: " + format_ms(test.time_ms) + " (baseline: " + format_ms(it->second) + ").";
+        }
+    }
+
+    void save_baseline(const std::string &path) {
+        std::ofstream file(path);
+        if(!file) {
+            throw std::runtime_error("Failed to write the baseline '" + path + "'");
+        }
+        for(auto &[test, idx] : tests) {
+            if(!test.options.skip && !test.test_parsing_failed) {
+                file << test.name << ' ' << std::fixed << std::setprecision(3) << test.time_ms << '\n';
+            }
+        }
+    }
+
+    static std::string format_ms(double ms) {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(2) << ms << " ms";
+        return s.str();
+    }
+
     void test_summary(Test &test, int idx) {
         std::cout << "(" << std::setw(number_width(tests.size())) << idx + 1 << "/" << tests.size() << ") " << test.name << ": ";
         if(test.options.skip) {
             total_skipped_tests++;
             std::cout << "\x1b[1;33mSkipped\x1b[0m";
-        } else if(test.compiler_failed || test.output_doesnt_match) {
+        } else if(test.compiler_failed || test.output_doesnt_match || test.regressed) {
             total_failed_tests++;
-            std::cout << "\x1b[1;31mFailed\x1b[0m\n"
+            std::cout << "\x1b[1;31mFailed\x1b[0m (" << format_ms(test.time_ms) << ")\n"
                       << "ilc exit status: " << test.ilc_exit_status << '\n'
                       << (test.tester_output.length() > 0 ? std::string("reason:\n" + test.tester_output + '\n') : std::string(""))
                       << (test.output.length() > 0 ? std::string("\n") + test.output : "")
@@ -132,21 +394,265 @@ private:
                       << '\n';
         } else {
             total_passed_tests++;
-            std::cout << "\x1b[1;32mPassed\x1b[0m";
+            std::cout << "\x1b[1;32mPassed\x1b[0m (" << format_ms(test.time_ms) << ")";
         }
         std::cout << '\n';
     }
 
+    Clock::time_point deadline_from(Clock::time_point start) const {
+        return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.timeout_seconds));
+    }
+
+    // Run ilc on the test collecting its stdout & stderr, and kill it if it takes longer than the timeout.
     void execute(Test &test) {
-        FILE *p = popen(std::string_view(get_ilc_path() + " " + test.path.c_str() + " 2>&1").data(), "r");
-        char buffer[4096] = {0};
-        while(fgets(buffer, sizeof(buffer), p) != nullptr) {
-            test.output.append(buffer);
+        auto start = Clock::now();
+        test.ilc_exit_status = run_process({ilc_path, test.path.string()}, "", deadline_from(start), test.output, test.timed_out);
+        test.time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Run [args] in the directory [cwd] (the current one if empty) appending its stdout & stderr to [output],
+    // and kill it at [deadline] (setting [timed_out].) Returns its exit status (128 + the signal if it was killed.)
+    static int run_process(std::vector<std::string> args, const std::string &cwd, Clock::time_point deadline,
+                           std::string &output, bool &timed_out) {
+        int fds[2];
+        if(pipe2(fds, O_CLOEXEC) < 0) {
+            throw std::runtime_error(std::string("pipe2() failed: ") + strerror(errno));
+        }
+        // Prepared before forking, only async-signal-safe functions can be used in the child.
+        std::vector<char *> argv;
+        for(auto &arg : args) {
+            argv.push_back(arg.data());
         }
-        int status = pclose(p);
-        test.ilc_exit_status = WEXITSTATUS(status);
+        argv.push_back(nullptr);
+        const char *dir = cwd.empty() ? nullptr : cwd.c_str();
+        pid_t pid = fork();
+        if(pid < 0) {
+            throw std::runtime_error(std::string("fork() failed: ") + strerror(errno));
+        } else if(pid == 0) {
+            if(dir && chdir(dir) < 0) {
+                _exit(127);
+            }
+            dup2(fds[1], STDOUT_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        close(fds[1]);
+        char buffer[4096];
+        for(;;) {
+            int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            struct pollfd pfd = {fds[0], POLLIN, 0};
+            int ready = remaining > 0 ? poll(&pfd, 1, remaining) : 0;
+            if(ready < 0 && errno == EINTR) {
+                continue;
+            } else if(ready == 0) {
+                timed_out = true;
+                kill(pid, SIGKILL);
+                break;
+            }
+            ssize_t length = read(fds[0], buffer, sizeof(buffer));
+            if(length <= 0) {
+                break;
+            }
+            output.append(buffer, (size_t)length);
+        }
+        close(fds[0]);
+        int status;
+        while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
     }
 
+    // Remove the escape sequences (colors) from the output of ilc.
+    static std::string strip_escapes(const std::string &s) {
+        std::string stripped;
+        for(size_t i = 0; i < s.length(); ++i) {
+            if(s[i] == '\x1b') {
+                while(i < s.length() && s[i] != 'm') {
+                    i++;
+                }
+            } else {
+                stripped += s[i];
+            }
+        }
+        return stripped;
+    }
+
+    // Run a step of a build test in its working directory [work]. Returns the reason it failed, or an empty string.
+    // Steps (one per line, empty lines & lines starting with '#' are ignored):
+    //   build STATUS    Build 'main.ilc' into 'program' (with an object cache in the working directory),
+    //                   and check that running it exits with STATUS.
+    //   expect TEXT     The output of the last build has a line containing TEXT.
+    //   copy FROM TO    Copy the file FROM over TO (to edit a module between builds.)
+    //   clean           Remove the build directory (but not the object cache.)
+    std::string run_build_step(Test &test, const fs::path &work, const std::string &step, Clock::time_point deadline, std::string &output) {
+        std::istringstream in(step);
+        std::string command;
+        in >> command;
+        if(command == "build") {
+            int expected_status;
+            if(!(in >> expected_status)) {
+                throw ParseError(("Invalid step '" + step + "'").c_str());
+            }
+            output.clear();
+            std::string ilc = fs::absolute(ilc_path).string();
+            test.ilc_exit_status = run_process({ilc, "build", "-o", "program", "-C", "cache", "main.ilc"}, work.string(), deadline, output, test.timed_out);
+            output = strip_escapes(output);
+            if(test.timed_out || test.ilc_exit_status != 0) {
+                return "ilc failed.";
+            }
+            std::string program_output;
+            int status = run_process({"./program"}, work.string(), deadline, program_output, test.timed_out);
+            if(!test.timed_out && status != expected_status) {
+                return "The program exited with " + std::to_string(status) + " instead of " + std::to_string(expected_status) + ".";
+            }
+        } else if(command == "expect") {
+            std::string text;
+            std::getline(in >> std::ws, text);
+            if(output.find(text) == std::string::npos) {
+                return "The output of the last build doesn't contain '" + text + "'.";
+            }
+        } else if(command == "copy") {
+            std::string from, to;
+            if(!(in >> from >> to)) {
+                throw ParseError(("Invalid step '" + step + "'").c_str());
+            }
+            fs::copy_file(work / from, work / to, fs::copy_options::overwrite_existing);
+        } else if(command == "clean") {
+            fs::remove_all(work / "program.build");
+        } else {
+            throw ParseError(("Unknown step '" + step + "'").c_str());
+        }
+        return "";
+    }
+
+    // Run the steps of a build test in a temporary copy of its directory.
+    void execute_build(Test &test) {
+        auto start = Clock::now();
+        auto deadline = deadline_from(start);
+        std::ifstream steps(test.path / "steps");
+        if(!steps) {
+            test.test_parsing_failed = true;
+            test.tester_output = "Missing the 'steps' file.";
+            return;
+        }
+        std::string work_template = (fs::temp_directory_path() / "ilc-tester-XXXXXX").string();
+        if(mkdtemp(work_template.data()) == nullptr) {
+            throw std::runtime_error(std::string("mkdtemp() failed: ") + strerror(errno));
+        }
+        fs::path work(work_template);
+        fs::copy(test.path, work, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+        std::string step, output;
+        try {
+            while(std::getline(steps, step) && !test.timed_out) {
+                if(step.empty() || step[0] == '#') {
+                    continue;
+                }
+                std::string reason = run_build_step(test, work, step, deadline, output);
+                if(!reason.empty()) {
+                    test.compiler_failed = true;
+                    test.tester_output = "Step '" + step + "' failed: " + reason;
+                    test.output = output;
+                    break;
+                }
+            }
+        } catch(ParseError &err) {
+            test.test_parsing_failed = true;
+            test.tester_output = err.what();
+        }
+        fs::remove_all(work);
+        test.time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+#ifdef TESTER_IN_PROCESS
+    // Format the diagnostics like ilc prints them (without the source lines).
+    static std::string format_diagnostics(IlcContext *ctx) {
+        std::string output;
+        IlcDiagnostic d;
+        for(size_t i = 0; ilcContextGetDiagnostic(ctx, i, &d); ++i) {
+            output += (d.kind == ILC_DIAGNOSTIC_HINT ? "Hint: " : "Error: ") + std::string(d.message) + '\n';
+            if(d.file) {
+                output += "--- " + std::string(d.file) + ':' + std::to_string(d.line) + ':' + std::to_string(d.column) + '\n';
+            }
+        }
+        return output;
+    }
+
+    // Compile the test using libilc. The exit status is set to what ilc would have exited with.
+    void execute_in_process(Test &test, IlcContext *ctx) {
+        std::ifstream file(test.path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string source = contents.str();
+        std::string path = test.path.string();
+        auto start = Clock::now();
+        ilcContextReset(ctx);
+        ilcContextAddSource(ctx, path.c_str(), source.data(), source.length());
+        bool success = ilcCompile(ctx, path.c_str());
+        test.time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        test.ilc_exit_status = success ? 0 : 1;
+        if(!success) {
+            test.output = format_diagnostics(ctx);
+            return;
+        }
+        // The output must only depend on the source: compiling it again in the same (reset) context,
+        // where the AST & IR are at different addresses, must generate the same C code.
+        std::string first = ilcContextOutput(ctx, nullptr);
+        ilcContextReset(ctx);
+        ilcContextAddSource(ctx, path.c_str(), source.data(), source.length());
+        if(!ilcCompile(ctx, path.c_str()) || first != ilcContextOutput(ctx, nullptr)) {
+            test.compiler_failed = true;
+            test.tester_output = "Compiling the test again in the same context generated different code.";
+        }
+    }
+
+    // Returns the reason [index] failed, or an empty string if it passed.
+    std::string stress_program(IlcContext *ctx, size_t index) {
+        bool should_fail = index % 4 == 3;
+        std::string name = "stress" + std::to_string(index);
+        std::ostringstream source;
+        size_t functions = 1 + index % 8;
+        for(size_t i = 0; i < functions; ++i) {
+            source << "fn " << name << "_f" << i << "(a: i32, b: i32) -> i32 {\n"
+                   << "\tvar c = a + b * " << i + index << ";\n"
+                   << "\tif c > " << i << " {\n"
+                   << "\t\treturn c - a;\n"
+                   << "\t}\n"
+                   << "\treturn c;\n"
+                   << "}\n\n";
+        }
+        source << "fn main() -> i32 {\n"
+               << "\tvar result = 0;\n";
+        for(size_t i = 0; i < functions; ++i) {
+            source << "\tresult = result + " << name << "_f" << i << "(result, " << i << ");\n";
+        }
+        // Every function is 8 lines long, so this is at line (functions * 8 + 2 + functions + 1).
+        if(should_fail) {
+            source << "\tresult = missing_" << index << ";\n";
+        }
+        source << "\treturn result;\n"
+               << "}\n";
+        std::string path = name + ".ilc", contents = source.str();
+        ilcContextReset(ctx);
+        ilcContextAddSource(ctx, path.c_str(), contents.data(), contents.length());
+        bool success = ilcCompile(ctx, path.c_str());
+        if(!should_fail) {
+            return success ? "" : "should have succeeded:\n" + format_diagnostics(ctx);
+        } else if(success) {
+            return "should have failed!";
+        }
+        IlcDiagnostic d;
+        std::string expected = "Identifier 'missing_" + std::to_string(index) + "' does not exist.";
+        size_t expected_line = functions * 9 + 3;
+        if(!ilcContextGetDiagnostic(ctx, 0, &d) || d.kind != ILC_DIAGNOSTIC_ERROR || expected != d.message ||
+           !d.file || path != d.file || d.line != expected_line) {
+            return "expected 'Error: " + expected + "' at line " + std::to_string(expected_line) + ", got:\n" + format_diagnostics(ctx);
+        }
+        return "";
+    }
+#else
+    void execute_in_process(Test &, IlcContext *) {}
+#endif
+
     void check(Test &test, std::string &expected) {
         // trim any escape sequences.
         std::string output;
@@ -240,21 +746,103 @@ private:
         return contents.substr(pos);
     }
 
+    std::string ilc_path;
+    Options options;
+    std::map<std::string, double> baseline; // test name -> wall time in ms.
     int total_skipped_tests = 0;
     int total_failed_tests = 0;
     int total_passed_tests = 0;
+    double total_time_ms = 0.0;
     std::vector<std::pair<Test, int>> tests;
+    std::unique_ptr<WorkerState[]> worker_state;
+    bool watchdog_running = false;
+    std::mutex watchdog_lock;
+    std::condition_variable watchdog_stop;
 };
 
-int main(void) {
-    Tester t;
+static void usage(const char *name) {
+    std::cout << "Usage: " << name << " [options]\n"
+              << "Options:\n"
+              << "\t-j N                   Run up to N tests in parallel (default: amount of CPU cores).\n"
+              << "\t-t SECONDS             Fail tests that run for longer than SECONDS (default: 10).\n"
+              << "\t--baseline FILE        Fail tests whose time regressed compared to the times in FILE.\n"
+              << "\t--save-baseline FILE   Write the time of every test to FILE.\n"
+              << "\t--tolerance PERCENT    How much slower than the baseline a test may be (default: 50).\n"
+#ifdef TESTER_IN_PROCESS
+              << "\t--in-process           Compile the tests using libilc instead of running ilc.\n"
+              << "\t--stress N             Compile N generated programs in-process instead of running the tests.\n"
+#endif
+              ;
+}
+
+static bool parse_options(int argc, char **argv, Options &options) {
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        try {
+            if(arg == "-j" && has_value) {
+                options.jobs = (unsigned)std::stoul(argv[++i]);
+            } else if(arg == "-t" && has_value) {
+                options.timeout_seconds = std::stod(argv[++i]);
+            } else if(arg == "--baseline" && has_value) {
+                options.baseline_path = argv[++i];
+            } else if(arg == "--save-baseline" && has_value) {
+                options.save_baseline_path = argv[++i];
+            } else if(arg == "--tolerance" && has_value) {
+                options.tolerance_percent = std::stod(argv[++i]);
+#ifdef TESTER_IN_PROCESS
+            } else if(arg == "--in-process") {
+                options.in_process = true;
+            } else if(arg == "--stress" && has_value) {
+                options.stress_programs = std::stoul(argv[++i]);
+                options.in_process = true;
+#endif
+            } else {
+                usage(argv[0]);
+                return false;
+            }
+        } catch(std::logic_error &) {
+            std::cerr << "Invalid value for '" << arg << "'!\n";
+            return false;
+        }
+    }
+    if(options.jobs == 0 || options.timeout_seconds <= 0.0) {
+        usage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if(!parse_options(argc, argv, options)) {
+        return 2;
+    }
+#ifdef TESTER_IN_PROCESS
+    if(options.stress_programs > 0) {
+        Tester t("", options);
+        t.stress();
+        return t.failed() ? 1 : 0;
+    }
+#endif
+    Tester t(options.in_process ? std::string() : get_ilc_path(), options);
     for(const auto &dir : fs::directory_iterator(".")) {
         if(dir.path().extension() == ".ilc") {
             Test test(dir.path().filename().stem().c_str(), dir.path().c_str());
             t.add_test(test);
         }
     }
+    // Build tests (see Tester::run_build_step()).
+    if(fs::is_directory("builds")) {
+        for(const auto &dir : fs::directory_iterator("builds")) {
+            if(dir.is_directory()) {
+                Test test(("builds/" + dir.path().filename().string()).c_str(), dir.path().c_str());
+                test.build = true;
+                t.add_test(test);
+            }
+        }
+    }
     t.run();
     t.summary();
-    return 0;
+    return t.failed() ? 1 : 0;
 }